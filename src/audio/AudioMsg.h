@@ -23,7 +23,7 @@
 #define _AudioMsg_H_
 
 #include "../api.h"
-#include "../base/Queue.h"
+#include "../base/LockFreeQueue.h"
 #include "../base/Exception.h"
 
 #include "AudioBuffer.h"
@@ -78,7 +78,7 @@ private:
 };
 
 typedef boost::shared_ptr<AudioMsg> AudioMsgPtr;
-typedef Queue<AudioMsg> AudioMsgQueue;
+typedef MsgQueue<AudioMsg>::type AudioMsgQueue;
 typedef boost::shared_ptr<AudioMsgQueue> AudioMsgQueuePtr;
 
 }
@@ -21,6 +21,9 @@
 /* Enable parallel port support */
 #undef AVG_ENABLE_PARPORT
 
+/* Use lock-free message queues */
+#undef AVG_ENABLE_LOCKFREE_QUEUES
+
 /* Enable ffmpeg swscale support. */
 #define AVG_ENABLE_SWSCALE
 
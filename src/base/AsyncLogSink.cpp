@@ -0,0 +1,106 @@
+//
+//  libavg - Media Playback Engine.
+//  Copyright (C) 2003-2014 Ulrich von Zadow
+//
+//  This library is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU Lesser General Public
+//  License as published by the Free Software Foundation; either
+//  version 2 of the License, or (at your option) any later version.
+//
+//  This library is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//  Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public
+//  License along with this library; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+//  Current versions can be found at www.libavg.de
+//
+
+
+#include "AsyncLogSink.h"
+
+#include "Logger.h"
+#include "StringHelper.h"
+
+#include <boost/bind.hpp>
+
+using namespace std;
+
+namespace avg {
+
+LogWriterThread::LogWriterThread(CQueue& cmdQ, const LogSinkPtr& pSink,
+        const boost::atomic<int>& numDroppedMsgs, int& numReportedDroppedMsgs)
+    : WorkerThread<LogWriterThread>("LogWriter", cmdQ),
+      m_pSink(pSink),
+      m_NumDroppedMsgs(numDroppedMsgs),
+      m_NumReportedDroppedMsgs(numReportedDroppedMsgs)
+{
+}
+
+void LogWriterThread::writeMessage(const tm& time, unsigned millis, 
+        const category_t& category, severity_t severity, const UTF8String& sMsg)
+{
+    int numDroppedMsgs = m_NumDroppedMsgs.load(boost::memory_order_relaxed);
+    if (numDroppedMsgs != m_NumReportedDroppedMsgs) {
+        m_pSink->logMessage(&time, millis, Logger::category::NONE, 
+                Logger::severity::WARNING, 
+                "Log queue full, " + toString(numDroppedMsgs-m_NumReportedDroppedMsgs)
+                + " messages dropped.");
+        m_NumReportedDroppedMsgs = numDroppedMsgs;
+    }
+    m_pSink->logMessage(&time, millis, category, severity, sMsg);
+}
+
+bool LogWriterThread::work()
+{
+    waitForCommand();
+    return true;
+}
+
+
+AsyncLogSink::AsyncLogSink(const LogSinkPtr& pSink, int queueSize)
+    : m_pSink(pSink),
+      m_CmdQueue(queueSize),
+      m_NumDroppedMsgs(0),
+      m_NumReportedDroppedMsgs(0)
+{
+    m_pThread = new boost::thread(LogWriterThread(m_CmdQueue, m_pSink, m_NumDroppedMsgs,
+            m_NumReportedDroppedMsgs));
+}
+
+AsyncLogSink::~AsyncLogSink()
+{
+    m_CmdQueue.pushCmd(boost::bind(&LogWriterThread::stop, _1));
+    m_pThread->join();
+    delete m_pThread;
+
+    // Write messages that arrived after the stop command.
+    LogWriterThread writer(m_CmdQueue, m_pSink, m_NumDroppedMsgs, 
+            m_NumReportedDroppedMsgs);
+    LogWriterThread::CmdPtr pCmd = m_CmdQueue.pop(false);
+    while (pCmd) {
+        pCmd->execute(&writer);
+        pCmd = m_CmdQueue.pop(false);
+    }
+}
+
+void AsyncLogSink::logMessage(const tm* pTime, unsigned millis, 
+        const category_t& category, severity_t severity, const UTF8String& sMsg)
+{
+    // Can't log from here, since the Logger calls this with its mutex held.
+    bool bPushed = m_CmdQueue.tryPushCmd(boost::bind(&LogWriterThread::writeMessage, _1,
+            *pTime, millis, category, severity, sMsg));
+    if (!bPushed) {
+        m_NumDroppedMsgs.fetch_add(1, boost::memory_order_relaxed);
+    }
+}
+
+int AsyncLogSink::getNumDroppedMessages() const
+{
+    return m_NumDroppedMsgs.load(boost::memory_order_relaxed);
+}
+
+}
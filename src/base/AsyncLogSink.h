@@ -0,0 +1,80 @@
+//
+//  libavg - Media Playback Engine.
+//  Copyright (C) 2003-2014 Ulrich von Zadow
+//
+//  This library is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU Lesser General Public
+//  License as published by the Free Software Foundation; either
+//  version 2 of the License, or (at your option) any later version.
+//
+//  This library is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//  Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public
+//  License along with this library; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+//  Current versions can be found at www.libavg.de
+//
+
+
+#ifndef _AsyncLogSink_H_
+#define _AsyncLogSink_H_
+
+#include "../api.h"
+#include "ILogSink.h"
+#include "WorkerThread.h"
+
+#include <boost/atomic.hpp>
+#include <boost/thread.hpp>
+
+namespace avg {
+
+class AVG_API LogWriterThread: public WorkerThread<LogWriterThread>
+{
+public:
+    LogWriterThread(CQueue& cmdQ, const LogSinkPtr& pSink,
+            const boost::atomic<int>& numDroppedMsgs, int& numReportedDroppedMsgs);
+
+    void writeMessage(const tm& time, unsigned millis, const category_t& category,
+            severity_t severity, const UTF8String& sMsg);
+
+private:
+    virtual bool work();
+
+    LogSinkPtr m_pSink;
+    const boost::atomic<int>& m_NumDroppedMsgs;
+    int& m_NumReportedDroppedMsgs;
+};
+
+// Forwards log messages to another sink in a background thread, so threads that log
+// never wait for I/O. Messages are passed through a bounded queue; if it is full,
+// messages are dropped and counted, and the number of dropped messages is logged
+// with the next message that gets through.
+// Pending messages are written when the AsyncLogSink is destroyed.
+class AVG_API AsyncLogSink: public ILogSink
+{
+public:
+    static const int DEFAULT_QUEUE_SIZE = 1024;
+
+    AsyncLogSink(const LogSinkPtr& pSink, int queueSize=DEFAULT_QUEUE_SIZE);
+    virtual ~AsyncLogSink();
+
+    virtual void logMessage(const tm* pTime, unsigned millis, const category_t& category,
+            severity_t severity, const UTF8String& sMsg);
+
+    int getNumDroppedMessages() const;
+
+private:
+    LogSinkPtr m_pSink;
+    LogWriterThread::CQueue m_CmdQueue;
+    boost::atomic<int> m_NumDroppedMsgs;
+    int m_NumReportedDroppedMsgs;
+    boost::thread* m_pThread;
+};
+
+}
+
+#endif
@@ -0,0 +1,154 @@
+//
+//  libavg - Media Playback Engine.
+//  Copyright (C) 2003-2014 Ulrich von Zadow
+//
+//  This library is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU Lesser General Public
+//  License as published by the Free Software Foundation; either
+//  version 2 of the License, or (at your option) any later version.
+//
+//  This library is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//  Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public
+//  License along with this library; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+//  Current versions can be found at www.libavg.de
+//
+#include "CPUFeatures.h"
+
+#include "Exception.h"
+#include "Logger.h"
+#include "OSHelper.h"
+
+#if defined(AVG_X86)
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+using namespace std;
+
+namespace avg {
+
+#ifdef AVG_X86
+static void cpuid(int leaf, unsigned regs[4])
+{
+#ifdef _MSC_VER
+    int cpuInfo[4];
+    __cpuidex(cpuInfo, leaf, 0);
+    for (int i=0; i<4; ++i) {
+        regs[i] = unsigned(cpuInfo[i]);
+    }
+#else
+    __cpuid_count(leaf, 0, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+static unsigned long long getXCR0()
+{
+#ifdef _MSC_VER
+    return _xgetbv(0);
+#else
+    unsigned eax;
+    unsigned edx;
+    __asm__ __volatile__ ("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    return (((unsigned long long)edx) << 32) | eax;
+#endif
+}
+#endif
+
+static SIMDLevel detectSIMDLevel()
+{
+#ifdef AVG_X86
+    unsigned regs[4];
+    cpuid(0, regs);
+    unsigned maxLeaf = regs[0];
+    if (maxLeaf < 1) {
+        return SIMD_NONE;
+    }
+    cpuid(1, regs);
+    bool bSSE2 = (regs[3] & (1 << 26)) != 0;
+    bool bSSSE3 = (regs[2] & (1 << 9)) != 0;
+    bool bOSXSave = (regs[2] & (1 << 27)) != 0;
+    bool bAVX = (regs[2] & (1 << 28)) != 0;
+    if (!bSSE2) {
+        return SIMD_NONE;
+    }
+    if (!bSSSE3) {
+        return SIMD_SSE2;
+    }
+    // AVX2 needs the OS to save the ymm registers on context switches.
+    if (maxLeaf >= 7 && bOSXSave && bAVX && (getXCR0() & 6) == 6) {
+        cpuid(7, regs);
+        if (regs[1] & (1 << 5)) {
+            return SIMD_AVX2;
+        }
+    }
+    return SIMD_SSSE3;
+#else
+    return SIMD_NONE;
+#endif
+}
+
+SIMDLevel getCPUSIMDLevel()
+{
+    static SIMDLevel level = detectSIMDLevel();
+    return level;
+}
+
+static SIMDLevel initSIMDLevel()
+{
+    SIMDLevel level = getCPUSIMDLevel();
+    string sEnvLevel;
+    if (getEnv("AVG_SIMD", sEnvLevel)) {
+        SIMDLevel envLevel = stringToSIMDLevel(sEnvLevel);
+        if (envLevel < level) {
+            level = envLevel;
+        }
+    }
+    AVG_TRACE(Logger::category::CONFIG, Logger::severity::INFO,
+            "SIMD instruction set: " << getSIMDLevelString(level));
+    return level;
+}
+
+SIMDLevel getSIMDLevel()
+{
+    static SIMDLevel level = initSIMDLevel();
+    return level;
+}
+
+string getSIMDLevelString(SIMDLevel level)
+{
+    switch (level) {
+        case SIMD_NONE:
+            return "none";
+        case SIMD_SSE2:
+            return "sse2";
+        case SIMD_SSSE3:
+            return "ssse3";
+        case SIMD_AVX2:
+            return "avx2";
+        default:
+            AVG_ASSERT(false);
+            return "";
+    }
+}
+
+SIMDLevel stringToSIMDLevel(const string& s)
+{
+    for (int i=SIMD_NONE; i<=SIMD_AVX2; ++i) {
+        if (s == getSIMDLevelString(SIMDLevel(i))) {
+            return SIMDLevel(i);
+        }
+    }
+    throw Exception(AVG_ERR_INVALID_ARGS, "Unknown SIMD level '"+s+
+            "'. Must be none, sse2, ssse3 or avx2.");
+}
+
+}
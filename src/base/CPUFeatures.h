@@ -0,0 +1,60 @@
+//
+//  libavg - Media Playback Engine.
+//  Copyright (C) 2003-2014 Ulrich von Zadow
+//
+//  This library is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU Lesser General Public
+//  License as published by the Free Software Foundation; either
+//  version 2 of the License, or (at your option) any later version.
+//
+//  This library is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//  Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public
+//  License along with this library; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+//  Current versions can be found at www.libavg.de
+//
+#ifndef _CPUFeatures_H_
+#define _CPUFeatures_H_
+
+#include "../api.h"
+
+#include <string>
+
+#if defined(__i386__) || defined(__x86_64__) || defined(_M_IX86) || defined(_M_X64)
+#define AVG_X86
+#endif
+
+// Functions marked with these may use instructions beyond the ones the compiler
+// flags allow. They must only be called if getSIMDLevel() says the CPU supports them.
+#if defined(AVG_X86) && defined(__GNUC__)
+#define AVG_TARGET_SSE2 __attribute__((target("sse2")))
+#define AVG_TARGET_SSSE3 __attribute__((target("ssse3")))
+#define AVG_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define AVG_TARGET_SSE2
+#define AVG_TARGET_SSSE3
+#define AVG_TARGET_AVX2
+#endif
+
+namespace avg {
+
+enum SIMDLevel {SIMD_NONE, SIMD_SSE2, SIMD_SSSE3, SIMD_AVX2};
+
+// Highest instruction set extension supported by the CPU and the OS.
+AVG_API SIMDLevel getCPUSIMDLevel();
+
+// Instruction set extension optimized code should use. This is getCPUSIMDLevel(),
+// limited by the AVG_SIMD environment variable (none, sse2, ssse3 or avx2) if set.
+AVG_API SIMDLevel getSIMDLevel();
+
+AVG_API std::string getSIMDLevelString(SIMDLevel level);
+AVG_API SIMDLevel stringToSIMDLevel(const std::string& s);
+
+}
+
+#endif
@@ -24,31 +24,109 @@
 
 #include "Command.h"
 #include "Queue.h"
+#include "LockFreeQueue.h"
 
 #include "../api.h"
 
+#include <boost/function.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include <deque>
+
 namespace avg {
 
-template<class RECEIVER>
-class AVG_TEMPLATE_API CmdQueue: public Queue<Command<RECEIVER> >
+// BASE_QUEUE can be Queue or LockFreeQueue. Note that LockFreeQueue is always bounded.
+template<class RECEIVER, template<class> class BASE_QUEUE = Queue>
+class AVG_TEMPLATE_API CmdQueue: public BASE_QUEUE<Command<RECEIVER> >
 {
 public:
     CmdQueue(int maxSize=-1);
-    typedef typename Queue<Command<RECEIVER> >::QElementPtr CmdPtr;
+    typedef typename BASE_QUEUE<Command<RECEIVER> >::QElementPtr CmdPtr;
+    typedef boost::function<void()> ListenerFunc;
     void pushCmd(typename Command<RECEIVER>::CmdFunc func);
-    
+    void pushCmd(const CmdPtr& pCmd);
+    // Returns false instead of blocking if the queue is full.
+    bool tryPushCmd(typename Command<RECEIVER>::CmdFunc func);
+    // Puts commands that were popped but not executed back at the front of the queue.
+    void requeueCmds(const std::deque<CmdPtr>& pCmds);
+
+    // Calls func once as soon as there is a command in the queue. Used to wake up 
+    // WorkerThreads that run as cooperative tasks.
+    void notifyOnCmd(const ListenerFunc& func);
+
+private:
+    void notifyListener();
+
+    boost::mutex m_ListenerMutex;
+    std::deque<ListenerFunc> m_ListenerFuncs;
 };
 
-template<class RECEIVER>
-CmdQueue<RECEIVER>::CmdQueue(int maxSize)
-    : Queue<Command<RECEIVER> >(maxSize)
+template<class RECEIVER, template<class> class BASE_QUEUE>
+CmdQueue<RECEIVER, BASE_QUEUE>::CmdQueue(int maxSize)
+    : BASE_QUEUE<Command<RECEIVER> >(maxSize)
+{
+}
+
+template<class RECEIVER, template<class> class BASE_QUEUE>
+void CmdQueue<RECEIVER, BASE_QUEUE>::pushCmd(typename Command<RECEIVER>::CmdFunc func)
+{
+    pushCmd(CmdPtr(new Command<RECEIVER>(func)));
+}
+
+template<class RECEIVER, template<class> class BASE_QUEUE>
+void CmdQueue<RECEIVER, BASE_QUEUE>::pushCmd(const CmdPtr& pCmd)
+{
+    this->push(pCmd);
+    notifyListener();
+}
+
+template<class RECEIVER, template<class> class BASE_QUEUE>
+bool CmdQueue<RECEIVER, BASE_QUEUE>::tryPushCmd(typename Command<RECEIVER>::CmdFunc func)
+{
+    if (this->tryPush(CmdPtr(new Command<RECEIVER>(func)))) {
+        notifyListener();
+        return true;
+    } else {
+        return false;
+    }
+}
+
+template<class RECEIVER, template<class> class BASE_QUEUE>
+void CmdQueue<RECEIVER, BASE_QUEUE>::requeueCmds(const std::deque<CmdPtr>& pCmds)
+{
+    this->pushFront(pCmds);
+    for (unsigned i=0; i<pCmds.size(); ++i) {
+        notifyListener();
+    }
+}
+
+template<class RECEIVER, template<class> class BASE_QUEUE>
+void CmdQueue<RECEIVER, BASE_QUEUE>::notifyListener()
 {
+    ListenerFunc listenerFunc;
+    {
+        boost::lock_guard<boost::mutex> lock(m_ListenerMutex);
+        if (!m_ListenerFuncs.empty()) {
+            listenerFunc = m_ListenerFuncs.front();
+            m_ListenerFuncs.pop_front();
+        }
+    }
+    if (listenerFunc) {
+        listenerFunc();
+    }
 }
 
-template<class RECEIVER>
-void CmdQueue<RECEIVER>::pushCmd(typename Command<RECEIVER>::CmdFunc func)
+template<class RECEIVER, template<class> class BASE_QUEUE>
+void CmdQueue<RECEIVER, BASE_QUEUE>::notifyOnCmd(const ListenerFunc& func)
 {
-    this->push(CmdPtr(new Command<RECEIVER>(func)));
+    {
+        boost::lock_guard<boost::mutex> lock(m_ListenerMutex);
+        if (this->empty()) {
+            m_ListenerFuncs.push_back(func);
+            return;
+        }
+    }
+    func();
 }
 
 }
@@ -0,0 +1,113 @@
+//
+//  libavg - Media Playback Engine.
+//  Copyright (C) 2003-2014 Ulrich von Zadow
+//
+//  This library is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU Lesser General Public
+//  License as published by the Free Software Foundation; either
+//  version 2 of the License, or (at your option) any later version.
+//
+//  This library is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//  Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public
+//  License along with this library; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+//  Current versions can be found at www.libavg.de
+//
+
+#include "FrameArena.h"
+
+#include "Exception.h"
+
+using namespace std;
+
+namespace avg {
+
+static size_t alignSize(size_t numBytes)
+{
+    return (numBytes+FrameArena::ALIGNMENT-1) & ~(FrameArena::ALIGNMENT-1);
+}
+
+FrameArena::FrameArena(size_t blockSize)
+    : m_pBlock(0),
+      m_BlockSize(alignSize(blockSize)),
+      m_Pos(0),
+      m_NumOverflowBytes(0),
+      m_NumBytesAllocated(0),
+      m_NumHeapAllocs(0)
+{
+    AVG_ASSERT(blockSize > 0);
+    m_pBlock = allocHeapBlock(m_BlockSize);
+}
+
+FrameArena::~FrameArena()
+{
+    reset();
+    delete[] m_pBlock;
+}
+
+void* FrameArena::allocate(size_t numBytes)
+{
+    size_t size = alignSize(numBytes);
+    m_NumBytesAllocated += size;
+    if (m_Pos+size <= m_BlockSize) {
+        void* pMem = m_pBlock+m_Pos;
+        m_Pos += size;
+        return pMem;
+    } else {
+        char* pMem = allocHeapBlock(size);
+        m_pOverflowBlocks.push_back(pMem);
+        m_NumOverflowBytes += size;
+        return pMem;
+    }
+}
+
+void FrameArena::reset()
+{
+    if (!m_pOverflowBlocks.empty()) {
+        for (unsigned i=0; i<m_pOverflowBlocks.size(); ++i) {
+            delete[] m_pOverflowBlocks[i];
+        }
+        m_pOverflowBlocks.clear();
+        size_t bytesNeeded = m_Pos+m_NumOverflowBytes;
+        while (m_BlockSize < bytesNeeded) {
+            m_BlockSize *= 2;
+        }
+        delete[] m_pBlock;
+        m_pBlock = allocHeapBlock(m_BlockSize);
+        m_NumOverflowBytes = 0;
+    }
+    m_Pos = 0;
+}
+
+size_t FrameArena::getNumBytesUsed() const
+{
+    return m_Pos+m_NumOverflowBytes;
+}
+
+size_t FrameArena::getBlockSize() const
+{
+    return m_BlockSize;
+}
+
+long long FrameArena::getNumBytesAllocated() const
+{
+    return m_NumBytesAllocated;
+}
+
+int FrameArena::getNumHeapAllocs() const
+{
+    return m_NumHeapAllocs;
+}
+
+char* FrameArena::allocHeapBlock(size_t numBytes)
+{
+    m_NumHeapAllocs++;
+    return new char[numBytes];
+}
+
+}
@@ -0,0 +1,169 @@
+//
+//  libavg - Media Playback Engine.
+//  Copyright (C) 2003-2014 Ulrich von Zadow
+//
+//  This library is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU Lesser General Public
+//  License as published by the Free Software Foundation; either
+//  version 2 of the License, or (at your option) any later version.
+//
+//  This library is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//  Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public
+//  License along with this library; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+//  Current versions can be found at www.libavg.de
+//
+
+#ifndef _FrameArena_H_
+#define _FrameArena_H_
+
+#include "../api.h"
+
+#include <vector>
+#include <new>
+#include <cstddef>
+
+namespace avg {
+
+// Bump allocator for data that lives no longer than a frame. Memory is handed out
+// from one block and released all at once by reset(). Allocations that don't fit
+// get their own heap block; at the next reset(), the main block is enlarged so it
+// holds everything the last frame needed. In steady state, no heap allocations are
+// made. Not thread-safe - the Player's arena is only used in the main thread.
+class AVG_API FrameArena
+{
+public:
+    static const size_t DEFAULT_BLOCK_SIZE = 64*1024;
+    static const size_t ALIGNMENT = 16;
+
+    FrameArena(size_t blockSize=DEFAULT_BLOCK_SIZE);
+    virtual ~FrameArena();
+
+    void* allocate(size_t numBytes);
+    void reset();
+
+    size_t getNumBytesUsed() const;
+    size_t getBlockSize() const;
+    // Total number of bytes allocated from the arena since it was created.
+    long long getNumBytesAllocated() const;
+    // Number of times the arena had to go to the heap.
+    int getNumHeapAllocs() const;
+
+private:
+    FrameArena(const FrameArena&);
+    FrameArena& operator=(const FrameArena&);
+
+    char* allocHeapBlock(size_t numBytes);
+
+    char* m_pBlock;
+    size_t m_BlockSize;
+    size_t m_Pos;
+
+    std::vector<char*> m_pOverflowBlocks;
+    size_t m_NumOverflowBytes;
+
+    long long m_NumBytesAllocated;
+    int m_NumHeapAllocs;
+};
+
+// STL allocator that takes its memory from a FrameArena. deallocate() is a no-op, so
+// containers using it must not outlive the frame.
+template<class T>
+class FrameArenaAllocator
+{
+public:
+    typedef T value_type;
+    typedef T* pointer;
+    typedef const T* const_pointer;
+    typedef T& reference;
+    typedef const T& const_reference;
+    typedef size_t size_type;
+    typedef ptrdiff_t difference_type;
+
+    template<class U>
+    struct rebind {
+        typedef FrameArenaAllocator<U> other;
+    };
+
+    explicit FrameArenaAllocator(FrameArena& arena)
+        : m_pArena(&arena)
+    {
+    }
+
+    template<class U>
+    FrameArenaAllocator(const FrameArenaAllocator<U>& other)
+        : m_pArena(other.getArena())
+    {
+    }
+
+    pointer address(reference val) const
+    {
+        return &val;
+    }
+
+    const_pointer address(const_reference val) const
+    {
+        return &val;
+    }
+
+    pointer allocate(size_type n, const void* = 0)
+    {
+        return static_cast<pointer>(m_pArena->allocate(n*sizeof(T)));
+    }
+
+    void deallocate(pointer, size_type)
+    {
+    }
+
+    size_type max_size() const
+    {
+        return size_t(-1)/sizeof(T);
+    }
+
+    void construct(pointer p, const T& val)
+    {
+        new((void*)p) T(val);
+    }
+
+    void destroy(pointer p)
+    {
+        p->~T();
+    }
+
+    FrameArena* getArena() const
+    {
+        return m_pArena;
+    }
+
+private:
+    FrameArena* m_pArena;
+};
+
+template<class T, class U>
+bool operator==(const FrameArenaAllocator<T>& a, const FrameArenaAllocator<U>& b)
+{
+    return a.getArena() == b.getArena();
+}
+
+template<class T, class U>
+bool operator!=(const FrameArenaAllocator<T>& a, const FrameArenaAllocator<U>& b)
+{
+    return a.getArena() != b.getArena();
+}
+
+// Vector that allocates from a FrameArena. Construct it with a
+// FrameArenaAllocator<T>(arena).
+template<class T>
+struct FrameVector
+{
+    typedef std::vector<T, FrameArenaAllocator<T> > type;
+};
+
+}
+
+#endif
@@ -0,0 +1,135 @@
+//
+//  libavg - Media Playback Engine.
+//  Copyright (C) 2003-2014 Ulrich von Zadow
+//
+//  This library is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU Lesser General Public
+//  License as published by the Free Software Foundation; either
+//  version 2 of the License, or (at your option) any later version.
+//
+//  This library is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//  Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public
+//  License along with this library; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+//  Current versions can be found at www.libavg.de
+//
+
+
+#include "LatencyHistogram.h"
+
+#include <string.h>
+#include <math.h>
+
+namespace avg {
+
+LatencyHistogram::LatencyHistogram()
+{
+    clear();
+}
+
+void LatencyHistogram::addValue(long long value)
+{
+    if (value < 0) {
+        value = 0;
+    }
+    m_Counts[getBucketIndex(value)]++;
+    if (m_NumValues == 0 || value < m_Min) {
+        m_Min = value;
+    }
+    if (value > m_Max) {
+        m_Max = value;
+    }
+    m_Sum += value;
+    m_NumValues++;
+}
+
+void LatencyHistogram::clear()
+{
+    memset(m_Counts, 0, sizeof(m_Counts));
+    m_NumValues = 0;
+    m_Sum = 0;
+    m_Min = 0;
+    m_Max = 0;
+}
+
+int LatencyHistogram::getNumValues() const
+{
+    return m_NumValues;
+}
+
+long long LatencyHistogram::getMin() const
+{
+    return m_Min;
+}
+
+long long LatencyHistogram::getMax() const
+{
+    return m_Max;
+}
+
+long long LatencyHistogram::getAvg() const
+{
+    if (m_NumValues == 0) {
+        return 0;
+    } else {
+        return m_Sum/m_NumValues;
+    }
+}
+
+long long LatencyHistogram::getPercentile(float percentile) const
+{
+    if (m_NumValues == 0) {
+        return 0;
+    }
+    int rank = int(ceil(percentile/100*m_NumValues));
+    if (rank < 1) {
+        rank = 1;
+    }
+    int numValues = 0;
+    for (int i=0; i<NUM_BUCKETS; ++i) {
+        numValues += m_Counts[i];
+        if (numValues >= rank) {
+            long long value = getBucketMaxValue(i);
+            if (value > m_Max) {
+                return m_Max;
+            } else {
+                return value;
+            }
+        }
+    }
+    return m_Max;
+}
+
+int LatencyHistogram::getBucketIndex(long long value)
+{
+    if (value < NUM_SUB_BUCKETS) {
+        return int(value);
+    }
+    int highestBit = SUB_BUCKET_BITS;
+    while (highestBit < 62 && (value >> (highestBit+1)) != 0) {
+        highestBit++;
+    }
+    if (highestBit > MAX_VALUE_BITS) {
+        return NUM_BUCKETS-1;
+    }
+    int shift = highestBit-SUB_BUCKET_BITS;
+    int subBucket = int(value >> shift) & (NUM_SUB_BUCKETS-1);
+    return (shift+1)*NUM_SUB_BUCKETS + subBucket;
+}
+
+long long LatencyHistogram::getBucketMaxValue(int index)
+{
+    if (index < NUM_SUB_BUCKETS) {
+        return index;
+    }
+    int shift = index/NUM_SUB_BUCKETS - 1;
+    long long subBucket = index % NUM_SUB_BUCKETS;
+    return ((NUM_SUB_BUCKETS+subBucket+1) << shift) - 1;
+}
+
+}
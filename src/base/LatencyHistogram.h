@@ -0,0 +1,69 @@
+//
+//  libavg - Media Playback Engine.
+//  Copyright (C) 2003-2014 Ulrich von Zadow
+//
+//  This library is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU Lesser General Public
+//  License as published by the Free Software Foundation; either
+//  version 2 of the License, or (at your option) any later version.
+//
+//  This library is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//  Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public
+//  License along with this library; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+//  Current versions can be found at www.libavg.de
+//
+
+
+#ifndef _LatencyHistogram_H_
+#define _LatencyHistogram_H_
+
+#include "../api.h"
+
+namespace avg {
+
+// Fixed-size histogram of durations in microseconds with logarithmic buckets
+// (similar to HdrHistogram). Each power of two is split into NUM_SUB_BUCKETS
+// linear buckets, so percentiles are accurate to 1/NUM_SUB_BUCKETS (6.25%) of the
+// value. Values above MAX_VALUE end up in the last bucket; min, max and average are
+// exact.
+class AVG_API LatencyHistogram
+{
+public:
+    static const int SUB_BUCKET_BITS = 4;
+    static const int NUM_SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+    static const int MAX_VALUE_BITS = 36; // 2^36 us = 19 hours
+    static const int NUM_BUCKETS = (MAX_VALUE_BITS-SUB_BUCKET_BITS+2)*NUM_SUB_BUCKETS;
+
+    LatencyHistogram();
+
+    void addValue(long long value);
+    void clear();
+
+    int getNumValues() const;
+    long long getMin() const;
+    long long getMax() const;
+    long long getAvg() const;
+    // percentile is in the range 0..100. Returns the largest value that could be in
+    // the corresponding bucket, but never more than the maximum.
+    long long getPercentile(float percentile) const;
+
+private:
+    static int getBucketIndex(long long value);
+    static long long getBucketMaxValue(int index);
+
+    unsigned m_Counts[NUM_BUCKETS];
+    int m_NumValues;
+    long long m_Sum;
+    long long m_Min;
+    long long m_Max;
+};
+
+}
+
+#endif
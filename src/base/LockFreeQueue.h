@@ -0,0 +1,416 @@
+//
+//  libavg - Media Playback Engine.
+//  Copyright (C) 2003-2014 Ulrich von Zadow
+//
+//  This library is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU Lesser General Public
+//  License as published by the Free Software Foundation; either
+//  version 2 of the License, or (at your option) any later version.
+//
+//  This library is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//  Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public
+//  License along with this library; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+//  Current versions can be found at www.libavg.de
+//
+
+#ifndef _LockFreeQueue_H_
+#define _LockFreeQueue_H_
+
+#include "../api.h"
+#include "../avgconfigwrapper.h"
+#include "Queue.h"
+
+#include <boost/atomic.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include <assert.h>
+#include <deque>
+
+namespace avg {
+
+// Bounded queue with the same interface as Queue, implemented as a ring buffer
+// of sequenced cells (D. Vyukov's bounded MPMC queue). push() and pop() don't take
+// a lock unless they need to block. A blocking call first yields and retries a few
+// times; the mutex and condition are only used to put threads to sleep when the queue
+// stays empty (pop) or full (push).
+// Any number of threads may push and pop concurrently. peek() is only safe if
+// no other thread pops at the same time, i.e. when there is a single consumer.
+// Since the ring buffer is preallocated, the queue is always bounded. If no maximum
+// size is given, DEFAULT_SIZE is used.
+// Elements returned with pushFront() can't go into the ring buffer, so they are kept
+// in a small locked deque that is consumed before the ring buffer. As long as it is
+// empty, checking it costs a single atomic load.
+template<class QElement>
+class AVG_TEMPLATE_API LockFreeQueue
+{
+public:
+    typedef boost::shared_ptr<QElement> QElementPtr;
+
+    static const int DEFAULT_SIZE = 1024;
+    // Number of times a blocking operation yields and retries before going to sleep.
+    static const int NUM_SPINS = 64;
+
+    LockFreeQueue(int maxSize=-1);
+    virtual ~LockFreeQueue();
+
+    bool empty() const;
+    QElementPtr pop(bool bBlock = true);
+    void popBatch(std::deque<QElementPtr>& pElems, int maxNum=-1);
+    void clear();
+    void push(const QElementPtr& pElem);
+    bool tryPush(const QElementPtr& pElem);
+    // Puts elements back at the front of the queue, keeping their order. Used to
+    // return elements that were taken by popBatch() but not consumed. Ignores the
+    // maximum size, since the elements were in the queue before.
+    void pushFront(const std::deque<QElementPtr>& pElems);
+    QElementPtr peek(bool bBlock = true) const;
+    int size() const;
+    int getMaxSize() const;
+
+private:
+    LockFreeQueue(const LockFreeQueue&);
+    LockFreeQueue& operator=(const LockFreeQueue&);
+
+    struct Cell {
+        boost::atomic<size_t> m_Seq;
+        QElementPtr m_pElem;
+    };
+
+    bool pushCell(const QElementPtr& pElem);
+    bool popCell(QElementPtr& pElem);
+    bool peekCell(QElementPtr& pElem) const;
+    bool spinPush(const QElementPtr& pElem);
+    bool spinPop(QElementPtr& pElem);
+    bool spinPeek(QElementPtr& pElem) const;
+    void wakeWaiters() const;
+
+    Cell* m_pCells;
+    size_t m_Mask;
+    int m_MaxSize;
+
+    // Producer and consumer positions live on separate cache lines.
+    char m_Pad0[64];
+    boost::atomic<size_t> m_EnqueuePos;
+    char m_Pad1[64];
+    boost::atomic<size_t> m_DequeuePos;
+    char m_Pad2[64];
+
+    mutable boost::atomic<int> m_NumWaiters;
+    mutable boost::mutex m_Mutex;
+    mutable boost::condition m_Cond;
+
+    std::deque<QElementPtr> m_pFrontElems;
+    boost::atomic<int> m_NumFrontElems;
+    mutable boost::mutex m_FrontMutex;
+};
+
+template<class QElement>
+LockFreeQueue<QElement>::LockFreeQueue(int maxSize)
+    : m_EnqueuePos(0),
+      m_DequeuePos(0),
+      m_NumWaiters(0),
+      m_NumFrontElems(0)
+{
+    if (maxSize <= 0) {
+        maxSize = DEFAULT_SIZE;
+    }
+    m_MaxSize = maxSize;
+    size_t numCells = 2;
+    while (numCells < size_t(maxSize)) {
+        numCells *= 2;
+    }
+    m_Mask = numCells-1;
+    m_pCells = new Cell[numCells];
+    for (size_t i=0; i<numCells; ++i) {
+        m_pCells[i].m_Seq.store(i, boost::memory_order_relaxed);
+    }
+}
+
+template<class QElement>
+LockFreeQueue<QElement>::~LockFreeQueue()
+{
+    delete[] m_pCells;
+}
+
+template<class QElement>
+bool LockFreeQueue<QElement>::empty() const
+{
+    return size() == 0;
+}
+
+template<class QElement>
+typename LockFreeQueue<QElement>::QElementPtr LockFreeQueue<QElement>::pop(bool bBlock)
+{
+    QElementPtr pElem;
+    if (!popCell(pElem) && bBlock && !spinPop(pElem)) {
+        unique_lock lock(m_Mutex);
+        m_NumWaiters.fetch_add(1);
+        boost::atomic_thread_fence(boost::memory_order_seq_cst);
+        while (!popCell(pElem)) {
+            m_Cond.wait(lock);
+        }
+        m_NumWaiters.fetch_sub(1);
+    }
+    if (pElem) {
+        wakeWaiters();
+    }
+    return pElem;
+}
+
+template<class QElement>
+void LockFreeQueue<QElement>::popBatch(std::deque<QElementPtr>& pElems, int maxNum)
+{
+    QElementPtr pElem;
+    int numElems = 0;
+    while ((maxNum == -1 || numElems < maxNum) && popCell(pElem)) {
+        pElems.push_back(pElem);
+        numElems++;
+    }
+    if (numElems > 0) {
+        wakeWaiters();
+    }
+}
+
+template<class QElement>
+void LockFreeQueue<QElement>::clear()
+{
+    QElementPtr pElem;
+    do {
+        pElem = pop(false);
+    } while (pElem);
+}
+
+template<class QElement>
+typename LockFreeQueue<QElement>::QElementPtr
+        LockFreeQueue<QElement>::peek(bool bBlock) const
+{
+    QElementPtr pElem;
+    if (!peekCell(pElem) && bBlock && !spinPeek(pElem)) {
+        unique_lock lock(m_Mutex);
+        m_NumWaiters.fetch_add(1);
+        boost::atomic_thread_fence(boost::memory_order_seq_cst);
+        while (!peekCell(pElem)) {
+            m_Cond.wait(lock);
+        }
+        m_NumWaiters.fetch_sub(1);
+    }
+    return pElem;
+}
+
+template<class QElement>
+void LockFreeQueue<QElement>::push(const QElementPtr& pElem)
+{
+    assert(pElem);
+    if (!pushCell(pElem) && !spinPush(pElem)) {
+        unique_lock lock(m_Mutex);
+        m_NumWaiters.fetch_add(1);
+        boost::atomic_thread_fence(boost::memory_order_seq_cst);
+        while (!pushCell(pElem)) {
+            m_Cond.wait(lock);
+        }
+        m_NumWaiters.fetch_sub(1);
+    }
+    wakeWaiters();
+}
+
+template<class QElement>
+bool LockFreeQueue<QElement>::tryPush(const QElementPtr& pElem)
+{
+    assert(pElem);
+    if (pushCell(pElem)) {
+        wakeWaiters();
+        return true;
+    } else {
+        return false;
+    }
+}
+
+template<class QElement>
+void LockFreeQueue<QElement>::pushFront(const std::deque<QElementPtr>& pElems)
+{
+    if (pElems.empty()) {
+        return;
+    }
+    {
+        unique_lock lock(m_FrontMutex);
+        m_pFrontElems.insert(m_pFrontElems.begin(), pElems.begin(), pElems.end());
+        m_NumFrontElems.fetch_add(int(pElems.size()), boost::memory_order_release);
+    }
+    wakeWaiters();
+}
+
+template<class QElement>
+int LockFreeQueue<QElement>::size() const
+{
+    int numFrontElems = m_NumFrontElems.load(boost::memory_order_acquire);
+    size_t dequeuePos = m_DequeuePos.load(boost::memory_order_acquire);
+    size_t enqueuePos = m_EnqueuePos.load(boost::memory_order_acquire);
+    long diff = long(enqueuePos - dequeuePos);
+    if (diff < 0) {
+        return numFrontElems;
+    } else {
+        return numFrontElems+int(diff);
+    }
+}
+
+template<class QElement>
+int LockFreeQueue<QElement>::getMaxSize() const
+{
+    return m_MaxSize;
+}
+
+template<class QElement>
+bool LockFreeQueue<QElement>::pushCell(const QElementPtr& pElem)
+{
+    Cell* pCell;
+    size_t pos = m_EnqueuePos.load(boost::memory_order_relaxed);
+    while (true) {
+        long numElems = long(pos - m_DequeuePos.load(boost::memory_order_acquire));
+        if (numElems >= long(m_MaxSize)) {
+            return false;
+        }
+        pCell = &m_pCells[pos & m_Mask];
+        size_t seq = pCell->m_Seq.load(boost::memory_order_acquire);
+        long diff = long(seq) - long(pos);
+        if (diff == 0) {
+            if (m_EnqueuePos.compare_exchange_weak(pos, pos+1,
+                    boost::memory_order_relaxed))
+            {
+                break;
+            }
+        } else if (diff < 0) {
+            return false;
+        } else {
+            pos = m_EnqueuePos.load(boost::memory_order_relaxed);
+        }
+    }
+    pCell->m_pElem = pElem;
+    pCell->m_Seq.store(pos+1, boost::memory_order_release);
+    return true;
+}
+
+template<class QElement>
+bool LockFreeQueue<QElement>::popCell(QElementPtr& pElem)
+{
+    if (m_NumFrontElems.load(boost::memory_order_acquire) > 0) {
+        unique_lock lock(m_FrontMutex);
+        if (!m_pFrontElems.empty()) {
+            pElem = m_pFrontElems.front();
+            m_pFrontElems.pop_front();
+            m_NumFrontElems.fetch_sub(1, boost::memory_order_relaxed);
+            return true;
+        }
+    }
+    Cell* pCell;
+    size_t pos = m_DequeuePos.load(boost::memory_order_relaxed);
+    while (true) {
+        pCell = &m_pCells[pos & m_Mask];
+        size_t seq = pCell->m_Seq.load(boost::memory_order_acquire);
+        long diff = long(seq) - long(pos+1);
+        if (diff == 0) {
+            if (m_DequeuePos.compare_exchange_weak(pos, pos+1,
+                    boost::memory_order_relaxed))
+            {
+                break;
+            }
+        } else if (diff < 0) {
+            return false;
+        } else {
+            pos = m_DequeuePos.load(boost::memory_order_relaxed);
+        }
+    }
+    pElem = pCell->m_pElem;
+    pCell->m_pElem.reset();
+    pCell->m_Seq.store(pos+m_Mask+1, boost::memory_order_release);
+    return true;
+}
+
+template<class QElement>
+bool LockFreeQueue<QElement>::peekCell(QElementPtr& pElem) const
+{
+    if (m_NumFrontElems.load(boost::memory_order_acquire) > 0) {
+        unique_lock lock(m_FrontMutex);
+        if (!m_pFrontElems.empty()) {
+            pElem = m_pFrontElems.front();
+            return true;
+        }
+    }
+    size_t pos = m_DequeuePos.load(boost::memory_order_relaxed);
+    const Cell* pCell = &m_pCells[pos & m_Mask];
+    if (pCell->m_Seq.load(boost::memory_order_acquire) == pos+1) {
+        pElem = pCell->m_pElem;
+        return true;
+    } else {
+        return false;
+    }
+}
+
+template<class QElement>
+bool LockFreeQueue<QElement>::spinPush(const QElementPtr& pElem)
+{
+    for (int i=0; i<NUM_SPINS; ++i) {
+        boost::this_thread::yield();
+        if (pushCell(pElem)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+template<class QElement>
+bool LockFreeQueue<QElement>::spinPop(QElementPtr& pElem)
+{
+    for (int i=0; i<NUM_SPINS; ++i) {
+        boost::this_thread::yield();
+        if (popCell(pElem)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+template<class QElement>
+bool LockFreeQueue<QElement>::spinPeek(QElementPtr& pElem) const
+{
+    for (int i=0; i<NUM_SPINS; ++i) {
+        boost::this_thread::yield();
+        if (peekCell(pElem)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+template<class QElement>
+void LockFreeQueue<QElement>::wakeWaiters() const
+{
+    boost::atomic_thread_fence(boost::memory_order_seq_cst);
+    if (m_NumWaiters.load(boost::memory_order_relaxed) > 0) {
+        unique_lock lock(m_Mutex);
+        m_Cond.notify_all();
+    }
+}
+
+// Queue implementation used for the message queues between threads. Configure with
+// --enable-lockfree-queues to use LockFreeQueue.
+template<class QElement>
+struct MsgQueue
+{
+#ifdef AVG_ENABLE_LOCKFREE_QUEUES
+    typedef LockFreeQueue<QElement> type;
+#else
+    typedef Queue<QElement> type;
+#endif
+};
+
+}
+#endif
@@ -22,10 +22,13 @@
 #include "Logger.h"
 #include "Exception.h"
 #include "StandardLogSink.h"
+#include "AsyncLogSink.h"
 #include "OSHelper.h"
 
 #include <boost/algorithm/string.hpp>
 
+#include <stdlib.h>
+
 #ifdef _WIN32
 #include <Winsock2.h>
 #include <time.h>
@@ -72,6 +75,12 @@ namespace {
 
 boost::mutex Logger::m_CategoryMutex;
 
+static void removeAsyncStdLogSink()
+{
+    // Writes pending messages.
+    Logger::get()->removeStdLogSink();
+}
+
 Logger * Logger::get()
 {
     lock_guard lock(s_logMutex);
@@ -82,6 +91,8 @@ Logger * Logger::get()
 }
 
 Logger::Logger()
+    : m_NumCategories(0),
+      m_MinSeverity(severity::NONE)
 {
     m_Severity = severity::WARNING;
     string sEnvSeverity;
@@ -118,6 +129,11 @@ Logger::Logger()
     bool bEnvOmitStdErr = getEnv("AVG_LOG_OMIT_STDERR", sDummy);
     if (!bEnvOmitStdErr) {
         m_pStdSink = LogSinkPtr(new StandardLogSink);
+        bool bEnvAsync = getEnv("AVG_LOG_ASYNC", sDummy);
+        if (bEnvAsync) {
+            m_pStdSink = LogSinkPtr(new AsyncLogSink(m_pStdSink));
+            atexit(removeAsyncStdLogSink);
+        }
         addLogSink(m_pStdSink);
     }
 }
@@ -156,19 +172,38 @@ category_t Logger::configureCategory(category_t category, severity_t severity)
     lock_guard lock(m_CategoryMutex);
     severity = (severity == Logger::severity::NONE) ? m_Severity : severity;
     UTF8String sCategory = boost::to_upper_copy(string(category));
-    CatToSeverityMap::iterator it;
-    it = m_CategorySeverities.find(sCategory);
-    if ( it != m_CategorySeverities.end()) {
-        m_CategorySeverities.erase(sCategory);
+    int numCategories = m_NumCategories.load(boost::memory_order_relaxed);
+    int i;
+    for (i=0; i<numCategories; ++i) {
+        if (m_Categories[i].m_sName == sCategory) {
+            break;
+        }
     }
-    pair<const category_t, const severity_t> element(sCategory, severity);
-    m_CategorySeverities.insert(element);
+    if (i == numCategories) {
+        if (numCategories == MAX_CATEGORIES) {
+            throw Exception(AVG_ERR_OUT_OF_RANGE, "Too many log categories.");
+        }
+        m_Categories[i].m_sName = sCategory;
+    }
+    m_Categories[i].m_Severity.store(severity, boost::memory_order_relaxed);
+    if (i == numCategories) {
+        m_NumCategories.store(numCategories+1, boost::memory_order_release);
+    }
+    updateMinSeverity();
     return sCategory;
 }
 
 CatToSeverityMap Logger::getCategories()
 {
-    return m_CategorySeverities;
+    lock_guard lock(m_CategoryMutex);
+    CatToSeverityMap categories;
+    int numCategories = m_NumCategories.load(boost::memory_order_relaxed);
+    for (int i=0; i<numCategories; ++i) {
+        pair<const category_t, const severity_t> element(m_Categories[i].m_sName,
+                m_Categories[i].m_Severity.load(boost::memory_order_relaxed));
+        categories.insert(element);
+    }
+    return categories;
 }
 
 void Logger::trace(const UTF8String& sMsg, const category_t& category,
@@ -228,6 +263,37 @@ void Logger::log(const UTF8String& msg, const category_t& category,
     }
 }
 
+int Logger::getCategoryIndex(const category_t& category) const
+{
+    int numCategories = m_NumCategories.load(boost::memory_order_acquire);
+    for (int i=0; i<numCategories; ++i) {
+        if (m_Categories[i].m_sName == category) {
+            return i;
+        }
+    }
+    string msg("Unknown category: " + category);
+    throw Exception(AVG_ERR_INVALID_ARGS, msg);
+}
+
+const category_t& Logger::getCategoryName(int categoryIndex) const
+{
+    return m_Categories[categoryIndex].m_sName;
+}
+
+void Logger::updateMinSeverity()
+{
+    // Called with m_CategoryMutex held.
+    int numCategories = m_NumCategories.load(boost::memory_order_relaxed);
+    severity_t minSeverity = severity::CRITICAL;
+    for (int i=0; i<numCategories; ++i) {
+        severity_t severity = m_Categories[i].m_Severity.load(boost::memory_order_relaxed);
+        if (severity < minSeverity) {
+            minSeverity = severity;
+        }
+    }
+    m_MinSeverity.store(minSeverity, boost::memory_order_relaxed);
+}
+
 void Logger::setupCategory()
 {
     configureCategory(category::NONE);
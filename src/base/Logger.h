@@ -31,6 +31,7 @@
 #include <boost/noncopyable.hpp>
 #include <boost/functional/hash.hpp>
 #include <boost/unordered_map.hpp>
+#include <boost/atomic.hpp>
 
 #include <string>
 #include <vector>
@@ -105,36 +106,67 @@ public:
     void log(const UTF8String& msg, const category_t& category=category::APP,
             severity_t severity=severity::INFO) const;
 
+    // Returns the slot of a configured category in the category table. Slots never
+    // change, so callers can resolve a category once and use the shouldLog() overload
+    // below from then on. Throws for unknown categories.
+    int getCategoryIndex(const category_t& category) const;
+    const category_t& getCategoryName(int categoryIndex) const;
+
+    // Lock-free. If severity is below the threshold of every category, this is a 
+    // single atomic load. Otherwise, the category is looked up in the category table; 
+    // unknown categories throw.
     inline bool shouldLog(const category_t& category, severity_t severity) const {
-        lock_guard lock(m_CategoryMutex);
-        try {
-            severity_t targetSeverity = m_CategorySeverities.at(category);
-            return (targetSeverity <= severity);
-        } catch (out_of_range e){
-            string msg("Unknown category: " + category);
-            throw Exception(AVG_ERR_INVALID_ARGS, msg);
+        if (severity < m_MinSeverity.load(boost::memory_order_relaxed)) {
+            return false;
         }
+        return shouldLog(getCategoryIndex(category), severity);
+    }
+
+    // Lock-free, a single atomic load. Used by AVG_TRACE, so disabled log statements
+    // are cheap in inner loops.
+    inline bool shouldLog(int categoryIndex, severity_t severity) const {
+        return m_Categories[categoryIndex].m_Severity.load(boost::memory_order_relaxed)
+                <= severity;
     }
 
 private:
     Logger();
     void setupCategory();
+    void updateMinSeverity();
+
+    static const int MAX_CATEGORIES = 256;
+    struct CategoryEntry {
+        category_t m_sName;
+        boost::atomic<severity_t> m_Severity;
+    };
 
     std::vector<LogSinkPtr> m_pSinks;
     LogSinkPtr m_pStdSink;
-    CatToSeverityMap m_CategorySeverities;
+    // Entries are only ever appended and never move, so readers don't need a lock.
+    CategoryEntry m_Categories[MAX_CATEGORIES];
+    boost::atomic<int> m_NumCategories;
+    boost::atomic<severity_t> m_MinSeverity;
     severity_t m_Severity;
     static boost::mutex m_CategoryMutex;
 };
 
-#define AVG_TRACE(category, severity, sMsg) { \
-if (Logger::get()->shouldLog(category, severity)) { \
+// Logs to a category that was resolved using Logger::getCategoryIndex().
+#define AVG_TRACE_INDEXED(categoryIndex, severity, sMsg) { \
+if (Logger::get()->shouldLog(categoryIndex, severity)) { \
     std::stringstream tmp(std::stringstream::in | std::stringstream::out); \
     tmp << sMsg; \
-    Logger::get()->trace(tmp.str(), category, severity); \
+    Logger::get()->trace(tmp.str(), Logger::get()->getCategoryName(categoryIndex), \
+            severity); \
     }\
 }\
 
+// The category is resolved the first time the statement runs, so it must be the same
+// every time. Use AVG_TRACE_INDEXED for categories that vary.
+#define AVG_TRACE(category, severity, sMsg) { \
+    static const int avgTraceCategoryIndex = Logger::get()->getCategoryIndex(category); \
+    AVG_TRACE_INDEXED(avgTraceCategoryIndex, severity, sMsg); \
+}\
+
 #define AVG_LOG_ERROR(sMsg){ \
     AVG_TRACE(Logger::category::NONE, Logger::severity::ERROR, sMsg); \
 }\
@@ -45,6 +45,8 @@ using namespace std;
 
 ObjectCounter* ObjectCounter::s_pObjectCounter = 0;
 bool ObjectCounter::s_bDeleted = false;
+boost::thread_specific_ptr<ObjectCounter::CounterShard>
+        ObjectCounter::s_pShard(ObjectCounter::releaseShard);
 boost::mutex * pCounterMutex;
 
 void deleteObjectCounter()
@@ -54,6 +56,13 @@ void deleteObjectCounter()
     ObjectCounter::s_pObjectCounter = 0;
 }
 
+ObjectCounter::CounterShard::CounterShard()
+{
+    for (int i=0; i<MAX_TYPES; ++i) {
+        m_Counts[i].store(0, boost::memory_order_relaxed);
+    }
+}
+
 ObjectCounter::ObjectCounter()
 {
 }
@@ -61,6 +70,9 @@ ObjectCounter::ObjectCounter()
 ObjectCounter::~ObjectCounter()
 {
     s_bDeleted = true;
+    for (unsigned i=0; i<m_pShards.size(); ++i) {
+        delete m_pShards[i];
+    }
 }
 
 ObjectCounter * ObjectCounter::get()
@@ -81,14 +93,12 @@ ObjectCounter * ObjectCounter::get()
 void ObjectCounter::incRef(const std::type_info* pType)
 {
 #ifdef DEBUG_ALLOC
-    lock_guard Lock(*pCounterMutex);
-    TypeMap::iterator MapEntry = m_TypeMap.find(pType);
-    if (MapEntry == m_TypeMap.end()) {
-        m_TypeMap[pType] = 1;
-    } else {
-        (MapEntry->second)++;
-    }
-//    cerr << "incRef " << demangle(pType->name()) << ":" << m_TypeMap[pType] << endl;
+    CounterShard* pShard = getShard();
+    int i = getTypeIndex(pShard, pType, false);
+    // Only the owning thread writes to a shard, so this doesn't need to be an atomic
+    // read-modify-write.
+    boost::atomic<int>& count = pShard->m_Counts[i];
+    count.store(count.load(boost::memory_order_relaxed)+1, boost::memory_order_relaxed);
 #endif
 }
 
@@ -100,44 +110,32 @@ void ObjectCounter::decRef(const std::type_info* pType)
         // s_pObjectCounter has been deleted.
         return;
     }
-    lock_guard Lock(*pCounterMutex);
-    TypeMap::iterator MapEntry = m_TypeMap.find(pType);
-    if (MapEntry == m_TypeMap.end()) {
-        cerr << "ObjectCounter for " << demangle(pType->name()) 
-                << " does not exist." << endl;
-        // Can't decref a type that hasn't been incref'd.
-        AVG_ASSERT(false);
-    } else {
-        (MapEntry->second)--;
-        if (MapEntry->second < 0) {
-            cerr << "ObjectCounter: refcount for " << 
-                    demangle(MapEntry->first->name()) <<
-                    " < 0" << endl;
-            AVG_ASSERT(false);
-        }
-    }
-//    cerr << "decRef " << demangle(pType->name()) << ":" << MapEntry->second << endl;
+    CounterShard* pShard = getShard();
+    int i = getTypeIndex(pShard, pType, true);
+    boost::atomic<int>& count = pShard->m_Counts[i];
+    count.store(count.load(boost::memory_order_relaxed)-1, boost::memory_order_relaxed);
 #endif
 }
     
 int ObjectCounter::getCount(const std::type_info* pType)
 {
-    TypeMap::iterator MapEntry = m_TypeMap.find(pType);
-    if (MapEntry == m_TypeMap.end()) {
+    lock_guard lock(*pCounterMutex);
+    map<const type_info*, int>::iterator it = m_TypeIndexes.find(pType);
+    if (it == m_TypeIndexes.end()) {
         return 0;
     } else {
-        return MapEntry->second;
+        return sumCounts(it->second);
     }
-    
 }
 
 std::string ObjectCounter::dump()
 {
     stringstream ss;
     ss << "Object dump: " << endl;
+    TypeMap typeMap = getObjectCount();
     TypeMap::iterator it;
     vector<string> strings;
-    for (it = m_TypeMap.begin(); it != m_TypeMap.end(); ++it) {
+    for (it = typeMap.begin(); it != typeMap.end(); ++it) {
         stringstream tempStream;
         if (it->second > 0) {
             tempStream << "  " << demangle(it->first->name()) << ": " << it->second;
@@ -180,8 +178,80 @@ string ObjectCounter::demangle(string s)
     return sResult;
 }
 
-TypeMap ObjectCounter::getObjectCount(){
-    return m_TypeMap;
+TypeMap ObjectCounter::getObjectCount()
+{
+    lock_guard lock(*pCounterMutex);
+    TypeMap typeMap;
+    for (unsigned i=0; i<m_pTypes.size(); ++i) {
+        typeMap[m_pTypes[i]] = sumCounts(i);
+    }
+    return typeMap;
+}
+
+void ObjectCounter::releaseShard(CounterShard* pShard)
+{
+    // Called on thread exit. The counts stay in the shard and the next thread that
+    // starts reuses it.
+    if (s_pObjectCounter) {
+        lock_guard lock(*pCounterMutex);
+        s_pObjectCounter->m_pFreeShards.push_back(pShard);
+    }
+}
+
+ObjectCounter::CounterShard* ObjectCounter::getShard()
+{
+    CounterShard* pShard = s_pShard.get();
+    if (!pShard) {
+        lock_guard lock(*pCounterMutex);
+        if (m_pFreeShards.empty()) {
+            pShard = new CounterShard;
+            m_pShards.push_back(pShard);
+        } else {
+            pShard = m_pFreeShards.back();
+            m_pFreeShards.pop_back();
+        }
+        s_pShard.reset(pShard);
+    }
+    return pShard;
+}
+
+int ObjectCounter::getTypeIndex(CounterShard* pShard, const std::type_info* pType,
+        bool bMustExist)
+{
+    map<const type_info*, int>::iterator it = pShard->m_TypeIndexes.find(pType);
+    if (it != pShard->m_TypeIndexes.end()) {
+        return it->second;
+    }
+
+    lock_guard lock(*pCounterMutex);
+    int typeIndex;
+    it = m_TypeIndexes.find(pType);
+    if (it == m_TypeIndexes.end()) {
+        if (bMustExist) {
+            cerr << "ObjectCounter for " << demangle(pType->name()) 
+                    << " does not exist." << endl;
+            // Can't decref a type that hasn't been incref'd.
+            AVG_ASSERT(false);
+        }
+        AVG_ASSERT_MSG(m_pTypes.size() < unsigned(MAX_TYPES),
+                "ObjectCounter: Too many types.");
+        typeIndex = int(m_pTypes.size());
+        m_pTypes.push_back(pType);
+        m_TypeIndexes[pType] = typeIndex;
+    } else {
+        typeIndex = it->second;
+    }
+    pShard->m_TypeIndexes[pType] = typeIndex;
+    return typeIndex;
+}
+
+int ObjectCounter::sumCounts(int typeIndex) const
+{
+    int count = 0;
+    for (unsigned i=0; i<m_pShards.size(); ++i) {
+        count += m_pShards[i]->m_Counts[typeIndex].load(boost::memory_order_relaxed);
+    }
+    return count;
 }
 
 }
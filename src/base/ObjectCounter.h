@@ -23,16 +23,27 @@
 #define _ObjectCounter_H_
 
 #include "../api.h"
+
+#include <boost/atomic.hpp>
+#include <boost/thread/tss.hpp>
+
 #include <string>
 #include <map>
+#include <vector>
 #include <typeinfo>
 
 namespace avg {
 
 typedef std::map<const std::type_info *, int> TypeMap;
 
+// Counts live objects per type. Every thread updates its own shard of counters, so
+// incRef() and decRef() don't take locks once a thread has seen a type. The shards
+// are summed up when counts are queried. An object may be destroyed in a different
+// thread than it was created in, so only the sums are meaningful.
 class AVG_API ObjectCounter {
 public:
+    static const int MAX_TYPES = 1024;
+
     static ObjectCounter* get();
     virtual ~ObjectCounter();
 
@@ -46,11 +57,29 @@ public:
     TypeMap getObjectCount();
 
 private:
+    struct CounterShard {
+        CounterShard();
+
+        // Cache of the global type indexes, only used by the owning thread.
+        std::map<const std::type_info*, int> m_TypeIndexes;
+        boost::atomic<int> m_Counts[MAX_TYPES];
+    };
+
     ObjectCounter();
     static void deleteSingleton();
+    static void releaseShard(CounterShard* pShard);
+
+    CounterShard* getShard();
+    int getTypeIndex(CounterShard* pShard, const std::type_info* pType,
+            bool bMustExist);
+    int sumCounts(int typeIndex) const;
 
-    TypeMap m_TypeMap;
+    std::map<const std::type_info*, int> m_TypeIndexes;
+    std::vector<const std::type_info*> m_pTypes;
+    std::vector<CounterShard*> m_pShards;
+    std::vector<CounterShard*> m_pFreeShards;
 
+    static boost::thread_specific_ptr<CounterShard> s_pShard;
     static ObjectCounter* s_pObjectCounter;
     static bool s_bDeleted;
     friend void deleteObjectCounter();
@@ -58,4 +87,3 @@ private:
 
 }
 #endif 
-
@@ -30,6 +30,7 @@ ProfilingZone::ProfilingZone(const ProfilingZoneID& zoneID)
     : m_TimeSum(0),
       m_AvgTime(0),
       m_NumFrames(0),
+      m_bStartedInFrame(false),
       m_Indent(0),
       m_ZoneID(zoneID)
 {
@@ -46,12 +47,18 @@ void ProfilingZone::restart()
     m_NumFrames = 0;
     m_AvgTime = 0;
     m_TimeSum = 0;
+    m_bStartedInFrame = false;
+    m_Histogram.clear();
 }
 
 void ProfilingZone::reset()
 {
     m_NumFrames++;
     m_AvgTime = (m_AvgTime*(m_NumFrames-1)+m_TimeSum)/m_NumFrames;
+    if (m_bStartedInFrame) {
+        m_Histogram.addValue(m_TimeSum);
+        m_bStartedInFrame = false;
+    }
     m_TimeSum = 0;
 }
 
@@ -65,6 +72,24 @@ long long ProfilingZone::getAvgUSecs() const
     return m_AvgTime;
 }
 
+const LatencyHistogram& ProfilingZone::getHistogram() const
+{
+    return m_Histogram;
+}
+
+ProfilingZoneStats ProfilingZone::getStats() const
+{
+    ProfilingZoneStats stats;
+    stats.m_sName = getName();
+    stats.m_NumFrames = m_Histogram.getNumValues();
+    stats.m_AvgTime = m_Histogram.getAvg();
+    stats.m_P50Time = m_Histogram.getPercentile(50);
+    stats.m_P95Time = m_Histogram.getPercentile(95);
+    stats.m_P99Time = m_Histogram.getPercentile(99);
+    stats.m_MaxTime = m_Histogram.getMax();
+    return stats;
+}
+
 void ProfilingZone::setIndentLevel(int indent)
 {
     m_Indent = indent;
@@ -25,9 +25,23 @@
 #include "../api.h"
 #include "ProfilingZoneID.h"
 #include "TimeSource.h"
+#include "LatencyHistogram.h"
 
 namespace avg {
 
+// Per-frame times of a zone in microseconds. Frames in which the zone didn't run are
+// not counted.
+struct AVG_API ProfilingZoneStats
+{
+    std::string m_sName;
+    int m_NumFrames;
+    long long m_AvgTime;
+    long long m_P50Time;
+    long long m_P95Time;
+    long long m_P99Time;
+    long long m_MaxTime;
+};
+
 class AVG_API ProfilingZone
 {
 public:
@@ -38,6 +52,7 @@ public:
     void start() 
     {
         m_StartTime = TimeSource::get()->getCurrentMicrosecs();
+        m_bStartedInFrame = true;
     };
     void stop()
     {
@@ -46,6 +61,8 @@ public:
     void reset();
     long long getUSecs() const;
     long long getAvgUSecs() const;
+    const LatencyHistogram& getHistogram() const;
+    ProfilingZoneStats getStats() const;
     void setIndentLevel(int indent);
     int getIndentLevel() const;
     std::string getIndentString() const;
@@ -56,6 +73,8 @@ private:
     long long m_AvgTime;
     long long m_StartTime;
     int m_NumFrames;
+    bool m_bStartedInFrame;
+    LatencyHistogram m_Histogram;
     int m_Indent;
     const ProfilingZoneID& m_ZoneID;
 };
@@ -45,8 +45,15 @@ public:
 
     bool empty() const;
     QElementPtr pop(bool bBlock = true);
+    void popBatch(std::deque<QElementPtr>& pElems, int maxNum=-1);
     void clear();
     void push(const QElementPtr& pElem);
+    // Like push(), but returns false instead of blocking if the queue is full.
+    bool tryPush(const QElementPtr& pElem);
+    // Puts elements back at the front of the queue, keeping their order. Used to
+    // return elements that were taken by popBatch() but not consumed. Ignores the
+    // maximum size, since the elements were in the queue before.
+    void pushFront(const std::deque<QElementPtr>& pElems);
     QElementPtr peek(bool bBlock = true) const;
     int size() const;
     int getMaxSize() const;
@@ -90,6 +97,28 @@ typename Queue<QElement>::QElementPtr Queue<QElement>::pop(bool bBlock)
     return pElem;
 }
 
+// Moves up to maxNum elements (all elements if maxNum is -1) to the end of pElems,
+// taking the lock only once.
+template<class QElement>
+void Queue<QElement>::popBatch(std::deque<QElementPtr>& pElems, int maxNum)
+{
+    unique_lock lock(m_Mutex);
+    if (m_pElements.empty()) {
+        return;
+    }
+    if (pElems.empty() && (maxNum == -1 || unsigned(maxNum) >= m_pElements.size())) {
+        pElems.swap(m_pElements);
+    } else {
+        int numElems = int(m_pElements.size());
+        if (maxNum != -1 && maxNum < numElems) {
+            numElems = maxNum;
+        }
+        pElems.insert(pElems.end(), m_pElements.begin(), m_pElements.begin()+numElems);
+        m_pElements.erase(m_pElements.begin(), m_pElements.begin()+numElems);
+    }
+    m_Cond.notify_all();
+}
+
 template<class QElement>
 void Queue<QElement>::clear()
 {
@@ -124,6 +153,30 @@ void Queue<QElement>::push(const QElementPtr& pElem)
     m_Cond.notify_one();
 }
 
+template<class QElement>
+bool Queue<QElement>::tryPush(const QElementPtr& pElem)
+{
+    assert(pElem);
+    unique_lock lock(m_Mutex);
+    if (m_pElements.size() == (unsigned)m_MaxSize) {
+        return false;
+    }
+    m_pElements.push_back(pElem);
+    m_Cond.notify_one();
+    return true;
+}
+
+template<class QElement>
+void Queue<QElement>::pushFront(const std::deque<QElementPtr>& pElems)
+{
+    if (pElems.empty()) {
+        return;
+    }
+    unique_lock lock(m_Mutex);
+    m_pElements.insert(m_pElements.begin(), pElems.begin(), pElems.end());
+    m_Cond.notify_all();
+}
+
 template<class QElement>
 int Queue<QElement>::size() const
 {
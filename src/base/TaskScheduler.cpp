@@ -0,0 +1,293 @@
+//
+//  libavg - Media Playback Engine.
+//  Copyright (C) 2003-2014 Ulrich von Zadow
+//
+//  This library is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU Lesser General Public
+//  License as published by the Free Software Foundation; either
+//  version 2 of the License, or (at your option) any later version.
+//
+//  This library is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//  Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public
+//  License along with this library; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+//  Current versions can be found at www.libavg.de
+//
+
+#include "TaskScheduler.h"
+
+#include "Logger.h"
+#include "ThreadHelper.h"
+#include "ThreadProfiler.h"
+#include "ScopeTimer.h"
+#include "StringHelper.h"
+
+#include <boost/bind.hpp>
+
+#include <stdlib.h>
+
+using namespace std;
+
+namespace avg {
+
+static ProfilingZoneID TaskProfilingZone("Task", true);
+
+Task::Task(const TaskFunc& func, Priority priority, ProfilingZoneID* pZoneID)
+    : m_Func(func),
+      m_Priority(priority),
+      m_pZoneID(pZoneID),
+      m_bDone(false)
+{
+    if (!m_pZoneID) {
+        m_pZoneID = &TaskProfilingZone;
+    }
+}
+
+Task::~Task()
+{
+}
+
+Task::Priority Task::getPriority() const
+{
+    return m_Priority;
+}
+
+bool Task::isDone() const
+{
+    lock_guard lock(m_Mutex);
+    return m_bDone;
+}
+
+void Task::wait()
+{
+    TaskScheduler* pScheduler = TaskScheduler::get();
+    if (pScheduler->isSchedulerThread()) {
+        // Don't block a scheduler thread: The task might be waiting in a queue.
+        while (!isDone()) {
+            if (!pScheduler->runPendingTask()) {
+                boost::unique_lock<boost::mutex> lock(m_Mutex);
+                if (!m_bDone) {
+                    m_DoneCondition.timed_wait(lock, boost::posix_time::milliseconds(1));
+                }
+            }
+        }
+    } else {
+        boost::unique_lock<boost::mutex> lock(m_Mutex);
+        while (!m_bDone) {
+            m_DoneCondition.wait(lock);
+        }
+    }
+    if (m_pException) {
+        throw *m_pException;
+    }
+}
+
+TaskPtr Task::then(const TaskFunc& func, Priority priority, ProfilingZoneID* pZoneID)
+{
+    TaskPtr pTask(new Task(func, priority, pZoneID));
+    {
+        lock_guard lock(m_Mutex);
+        if (!m_bDone) {
+            m_pContinuations.push_back(pTask);
+            return pTask;
+        }
+    }
+    TaskScheduler::get()->submit(pTask);
+    return pTask;
+}
+
+void Task::run()
+{
+    {
+        ScopeTimer timer(*m_pZoneID);
+        try {
+            if (m_Func) {
+                m_Func();
+            }
+        } catch (const Exception& ex) {
+            m_pException = boost::shared_ptr<Exception>(new Exception(ex));
+        } catch (const std::exception& ex) {
+            m_pException = boost::shared_ptr<Exception>(
+                    new Exception(AVG_ERR_UNKNOWN, ex.what()));
+        }
+    }
+    m_Func = TaskFunc();
+    vector<TaskPtr> pContinuations;
+    {
+        lock_guard lock(m_Mutex);
+        m_bDone = true;
+        pContinuations.swap(m_pContinuations);
+        m_DoneCondition.notify_all();
+    }
+    for (unsigned i=0; i<pContinuations.size(); ++i) {
+        TaskScheduler::get()->submit(pContinuations[i]);
+    }
+}
+
+
+boost::thread_specific_ptr<int> TaskScheduler::s_pThreadIndex;
+TaskScheduler* TaskScheduler::s_pTaskScheduler = 0;
+
+void deleteTaskScheduler()
+{
+    delete TaskScheduler::s_pTaskScheduler;
+    TaskScheduler::s_pTaskScheduler = 0;
+}
+
+TaskScheduler* TaskScheduler::get()
+{
+    if (!s_pTaskScheduler) {
+        s_pTaskScheduler = new TaskScheduler(getNumWorkerCPUs());
+        atexit(deleteTaskScheduler);
+    }
+    return s_pTaskScheduler;
+}
+
+TaskScheduler::TaskScheduler(int numThreads)
+    : m_NumPendingTasks(0),
+      m_NumSleepingThreads(0),
+      m_NextQueue(0),
+      m_bShouldStop(false)
+{
+    for (int i=0; i<numThreads; ++i) {
+        m_pQueues.push_back(new TaskQueue);
+    }
+    for (int i=0; i<numThreads; ++i) {
+        m_pThreads.push_back(new boost::thread(
+                boost::bind(&TaskScheduler::threadFunc, this, i)));
+    }
+}
+
+TaskScheduler::~TaskScheduler()
+{
+    {
+        lock_guard lock(m_SleepMutex);
+        m_bShouldStop = true;
+        m_SleepCondition.notify_all();
+    }
+    for (unsigned i=0; i<m_pThreads.size(); ++i) {
+        m_pThreads[i]->join();
+        delete m_pThreads[i];
+    }
+    for (unsigned i=0; i<m_pQueues.size(); ++i) {
+        delete m_pQueues[i];
+    }
+}
+
+TaskPtr TaskScheduler::submit(const TaskFunc& func, Task::Priority priority,
+        ProfilingZoneID* pZoneID)
+{
+    TaskPtr pTask(new Task(func, priority, pZoneID));
+    submit(pTask);
+    return pTask;
+}
+
+void TaskScheduler::submit(TaskPtr pTask)
+{
+    int queueIndex;
+    if (isSchedulerThread()) {
+        queueIndex = *s_pThreadIndex;
+    } else {
+        queueIndex = m_NextQueue.fetch_add(1) % m_pQueues.size();
+    }
+    TaskQueue* pQueue = m_pQueues[queueIndex];
+    {
+        lock_guard lock(pQueue->m_Mutex);
+        pQueue->m_pTasks[pTask->getPriority()].push_back(pTask);
+    }
+    m_NumPendingTasks.fetch_add(1);
+    wakeThreads();
+}
+
+int TaskScheduler::getNumThreads() const
+{
+    return int(m_pThreads.size());
+}
+
+int TaskScheduler::getNumPendingTasks() const
+{
+    return m_NumPendingTasks.load();
+}
+
+bool TaskScheduler::isSchedulerThread() const
+{
+    return s_pThreadIndex.get() != 0;
+}
+
+void TaskScheduler::threadFunc(int threadIndex)
+{
+    s_pThreadIndex.reset(new int(threadIndex));
+    setAffinityMask(false);
+    ThreadProfiler* pProfiler = ThreadProfiler::get();
+    pProfiler->setName("TaskScheduler " + toString(threadIndex));
+    pProfiler->start();
+    while (!m_bShouldStop) {
+        if (runPendingTask()) {
+            pProfiler->reset();
+        } else {
+            boost::unique_lock<boost::mutex> lock(m_SleepMutex);
+            m_NumSleepingThreads.fetch_add(1);
+            boost::atomic_thread_fence(boost::memory_order_seq_cst);
+            while (!m_bShouldStop && m_NumPendingTasks.load() <= 0) {
+                m_SleepCondition.wait(lock);
+            }
+            m_NumSleepingThreads.fetch_sub(1);
+        }
+    }
+    pProfiler->dumpStatistics();
+    pProfiler->kill();
+}
+
+bool TaskScheduler::runPendingTask()
+{
+    TaskPtr pTask = popTask(*s_pThreadIndex);
+    if (pTask) {
+        pTask->run();
+        return true;
+    } else {
+        return false;
+    }
+}
+
+TaskPtr TaskScheduler::popTask(int threadIndex)
+{
+    // Higher priorities first. Within a priority, take the newest task from our own
+    // queue (it's most likely to be in the cache) or steal the oldest from others.
+    int numQueues = int(m_pQueues.size());
+    for (int prio=0; prio<Task::NUM_PRIORITIES; ++prio) {
+        for (int i=0; i<numQueues; ++i) {
+            TaskQueue* pQueue = m_pQueues[(threadIndex+i) % numQueues];
+            lock_guard lock(pQueue->m_Mutex);
+            deque<TaskPtr>& pTasks = pQueue->m_pTasks[prio];
+            if (!pTasks.empty()) {
+                TaskPtr pTask;
+                if (i == 0) {
+                    pTask = pTasks.back();
+                    pTasks.pop_back();
+                } else {
+                    pTask = pTasks.front();
+                    pTasks.pop_front();
+                }
+                m_NumPendingTasks.fetch_sub(1);
+                return pTask;
+            }
+        }
+    }
+    return TaskPtr();
+}
+
+void TaskScheduler::wakeThreads()
+{
+    boost::atomic_thread_fence(boost::memory_order_seq_cst);
+    if (m_NumSleepingThreads.load() > 0) {
+        lock_guard lock(m_SleepMutex);
+        m_SleepCondition.notify_one();
+    }
+}
+
+}
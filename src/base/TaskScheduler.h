@@ -0,0 +1,132 @@
+//
+//  libavg - Media Playback Engine.
+//  Copyright (C) 2003-2014 Ulrich von Zadow
+//
+//  This library is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU Lesser General Public
+//  License as published by the Free Software Foundation; either
+//  version 2 of the License, or (at your option) any later version.
+//
+//  This library is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//  Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public
+//  License along with this library; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+//  Current versions can be found at www.libavg.de
+//
+
+#ifndef _TaskScheduler_H_
+#define _TaskScheduler_H_
+
+#include "../api.h"
+#include "Exception.h"
+
+#include <boost/shared_ptr.hpp>
+#include <boost/function.hpp>
+#include <boost/atomic.hpp>
+#include <boost/thread.hpp>
+#include <boost/thread/condition.hpp>
+#include <boost/thread/tss.hpp>
+
+#include <deque>
+#include <vector>
+
+namespace avg {
+
+class ProfilingZoneID;
+class Task;
+typedef boost::shared_ptr<Task> TaskPtr;
+typedef boost::function<void()> TaskFunc;
+
+class AVG_API Task
+{
+public:
+    enum Priority {HIGH, NORMAL, LOW};
+    static const int NUM_PRIORITIES = 3;
+
+    // pZoneID is used to profile the task on the thread it runs on. It must be a
+    // multithreaded zone that outlives the task.
+    Task(const TaskFunc& func, Priority priority=NORMAL, ProfilingZoneID* pZoneID=0);
+    virtual ~Task();
+
+    Priority getPriority() const;
+    bool isDone() const;
+
+    // Blocks until the task has run and rethrows exceptions the task threw. If
+    // called in a TaskScheduler thread, other tasks are run while waiting.
+    void wait();
+
+    // Schedules func to run once this task is done.
+    TaskPtr then(const TaskFunc& func, Priority priority=NORMAL,
+            ProfilingZoneID* pZoneID=0);
+
+private:
+    friend class TaskScheduler;
+    void run();
+
+    TaskFunc m_Func;
+    Priority m_Priority;
+    ProfilingZoneID* m_pZoneID;
+
+    bool m_bDone;
+    boost::shared_ptr<Exception> m_pException;
+    std::vector<TaskPtr> m_pContinuations;
+    mutable boost::mutex m_Mutex;
+    boost::condition m_DoneCondition;
+};
+
+// Process-wide pool of threads that run Tasks. Each thread has its own queue per
+// priority. Tasks submitted from a scheduler thread go to that thread's queue;
+// threads that run out of work steal the oldest tasks from other queues.
+// The number of threads is the number of processors setAffinityMask() leaves to
+// non-main threads.
+class AVG_API TaskScheduler
+{
+public:
+    static TaskScheduler* get();
+    virtual ~TaskScheduler();
+
+    TaskPtr submit(const TaskFunc& func, Task::Priority priority=Task::NORMAL,
+            ProfilingZoneID* pZoneID=0);
+    void submit(TaskPtr pTask);
+
+    int getNumThreads() const;
+    int getNumPendingTasks() const;
+    bool isSchedulerThread() const;
+
+private:
+    TaskScheduler(int numThreads);
+    friend class Task;
+    friend void deleteTaskScheduler();
+
+    struct TaskQueue {
+        boost::mutex m_Mutex;
+        std::deque<TaskPtr> m_pTasks[Task::NUM_PRIORITIES];
+    };
+
+    void threadFunc(int threadIndex);
+    bool runPendingTask();
+    TaskPtr popTask(int threadIndex);
+    void wakeThreads();
+
+    std::vector<TaskQueue*> m_pQueues;
+    std::vector<boost::thread*> m_pThreads;
+
+    boost::atomic<int> m_NumPendingTasks;
+    boost::atomic<int> m_NumSleepingThreads;
+    boost::atomic<unsigned> m_NextQueue;
+    boost::atomic<bool> m_bShouldStop;
+    boost::mutex m_SleepMutex;
+    boost::condition m_SleepCondition;
+
+    static boost::thread_specific_ptr<int> s_pThreadIndex;
+    static TaskScheduler* s_pTaskScheduler;
+};
+
+}
+
+#endif
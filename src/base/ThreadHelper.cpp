@@ -42,12 +42,9 @@ void printAffinityMask(cpu_set_t& mask)
 }
 #endif
 
-void setAffinityMask(bool bIsMainThread)
-{
-    // The main thread gets the first processor to itself. All other threads share the
-    // rest of the processors available, unless, of course, there is only one processor
-    // in the machine.
 #ifdef linux
+const cpu_set_t& getAllProcessors()
+{
     static cpu_set_t allProcessors;
     static bool bInitialized = false;
     if (!bInitialized) {
@@ -57,13 +54,23 @@ void setAffinityMask(bool bIsMainThread)
 //        printAffinityMask(allProcessors);
         bInitialized = true;
     }
+    return allProcessors;
+}
+#endif
+
+void setAffinityMask(bool bIsMainThread)
+{
+    // The main thread gets the first processor to itself. All other threads share the
+    // rest of the processors available, unless, of course, there is only one processor
+    // in the machine.
+#ifdef linux
     cpu_set_t mask;
     if (bIsMainThread) {
         CPU_ZERO(&mask);
         CPU_SET(0, &mask);
 //        cerr << "Main Thread: ";
     } else {
-        mask = allProcessors;
+        mask = getAllProcessors();
         if (CPU_COUNT(&mask) > 1) {
             CPU_CLR(0, &mask);
         }
@@ -93,6 +100,21 @@ void setAffinityMask(bool bIsMainThread)
 #endif
 }
 
+unsigned getNumWorkerCPUs()
+{
+    // Number of processors that setAffinityMask(false) leaves to non-main threads.
+#ifdef linux
+    unsigned numCPUs = CPU_COUNT(&getAllProcessors());
+#else
+    unsigned numCPUs = boost::thread::hardware_concurrency();
+#endif
+    if (numCPUs > 1) {
+        return numCPUs-1;
+    } else {
+        return 1;
+    }
+}
+
 unsigned getLowestBitSet(unsigned val)
 {
     AVG_ASSERT(val != 0); // Doh
@@ -30,6 +30,7 @@
 namespace avg {
 
 void AVG_API setAffinityMask(bool bIsMainThread);
+unsigned AVG_API getNumWorkerCPUs();
 typedef boost::lock_guard<boost::mutex> lock_guard;
 unsigned getLowestBitSet(unsigned val);
 void AVG_API yield();
@@ -25,6 +25,7 @@
 #include "Exception.h"
 #include "ProfilingZone.h"
 #include "ScopeTimer.h"
+#include "TimeSource.h"
 
 #include <sstream>
 #include <iomanip>
@@ -36,6 +37,7 @@ using namespace boost;
 namespace avg {
     
 thread_specific_ptr<ThreadProfiler*> ThreadProfiler::s_pInstance;
+bool ThreadProfiler::s_bZoneStatsEnabled = false;
 
 ThreadProfiler* ThreadProfiler::get() 
 {
@@ -54,21 +56,26 @@ void ThreadProfiler::kill()
 
 ThreadProfiler::ThreadProfiler()
     : m_sName(""),
-      m_LogCategory(Logger::category::PROFILE)
+      m_LogCategoryIndex(Logger::get()->getCategoryIndex(Logger::category::PROFILE)),
+      m_NumCmdWakeups(0),
+      m_NumCmds(0),
+      m_MaxCmdsPerWakeup(0)
 {
     m_bRunning = false;
-    ScopeTimer::enableTimers(Logger::get()->shouldLog(m_LogCategory,
-            Logger::severity::INFO));
+    updateTimers();
 }
 
 ThreadProfiler::~ThreadProfiler() 
 {
+    if (m_pTraceBuffer) {
+        m_pTraceBuffer->setThreadDead();
+    }
 }
 
 void ThreadProfiler::setLogCategory(category_t category)
 {
     AVG_ASSERT(!m_bRunning);
-    m_LogCategory = category;
+    m_LogCategoryIndex = Logger::get()->getCategoryIndex(category);
 }
 
 void ThreadProfiler::start()
@@ -86,6 +93,9 @@ void ThreadProfiler::restart()
 
 void ThreadProfiler::startZone(const ProfilingZoneID& zoneID)
 {
+    if (TraceRecorder::isRecording()) {
+        traceEvent(zoneID, true);
+    }
     ZoneMap::iterator it = m_ZoneMap.find(&zoneID);
     // Duplicated code to avoid instantiating a new smart pointer when it's not
     // necessary.
@@ -106,25 +116,39 @@ void ThreadProfiler::stopZone(const ProfilingZoneID& zoneID)
     ProfilingZonePtr& pZone = it->second;
     pZone->stop();
     m_ActiveZones.pop_back();
+    if (TraceRecorder::isRecording()) {
+        traceEvent(zoneID, false);
+    }
 }
 
 void ThreadProfiler::dumpStatistics()
 {
     if (!m_Zones.empty()) {
-        AVG_TRACE(m_LogCategory, Logger::severity::INFO, "Thread " << m_sName);
-        AVG_TRACE(m_LogCategory, Logger::severity::INFO,
-                "Zone name                          Avg. time");
-        AVG_TRACE(m_LogCategory, Logger::severity::INFO,
-                "---------                          ---------");
+        AVG_TRACE_INDEXED(m_LogCategoryIndex, Logger::severity::INFO,
+                "Thread " << m_sName);
+        AVG_TRACE_INDEXED(m_LogCategoryIndex, Logger::severity::INFO,
+                "Zone name                          Avg. time      p50      p99      max");
+        AVG_TRACE_INDEXED(m_LogCategoryIndex, Logger::severity::INFO,
+                "---------                          ---------      ---      ---      ---");
 
         ZoneVector::iterator it;
         for (it = m_Zones.begin(); it != m_Zones.end(); ++it) {
-            AVG_TRACE(m_LogCategory, Logger::severity::INFO,
+            const LatencyHistogram& histogram = (*it)->getHistogram();
+            AVG_TRACE_INDEXED(m_LogCategoryIndex, Logger::severity::INFO,
                     std::setw(35) << std::left 
                     << ((*it)->getIndentString()+(*it)->getName())
-                    << std::setw(9) << std::right << (*it)->getAvgUSecs());
+                    << std::setw(9) << std::right << (*it)->getAvgUSecs()
+                    << std::setw(9) << histogram.getPercentile(50)
+                    << std::setw(9) << histogram.getPercentile(99)
+                    << std::setw(9) << histogram.getMax());
         }
-        AVG_TRACE(m_LogCategory, Logger::severity::INFO, "");
+        AVG_TRACE_INDEXED(m_LogCategoryIndex, Logger::severity::INFO, "");
+    }
+    if (m_NumCmdWakeups > 0) {
+        AVG_TRACE_INDEXED(m_LogCategoryIndex, Logger::severity::INFO,
+                "Thread " << m_sName << ": Commands per wakeup: avg " 
+                << getAvgCmdsPerWakeup() << ", max " << m_MaxCmdsPerWakeup << ", " 
+                << m_NumCmdWakeups << " wakeups");
     }
 }
 
@@ -141,6 +165,63 @@ int ThreadProfiler::getNumZones()
     return m_Zones.size();
 }
 
+vector<ProfilingZoneStats> ThreadProfiler::getZoneStats() const
+{
+    vector<ProfilingZoneStats> stats;
+    ZoneVector::const_iterator it;
+    for (it = m_Zones.begin(); it != m_Zones.end(); ++it) {
+        stats.push_back((*it)->getStats());
+    }
+    return stats;
+}
+
+void ThreadProfiler::enableZoneStats(bool bEnable)
+{
+    s_bZoneStatsEnabled = bEnable;
+    updateTimers();
+}
+
+bool ThreadProfiler::areZoneStatsEnabled()
+{
+    return s_bZoneStatsEnabled;
+}
+
+void ThreadProfiler::updateTimers()
+{
+    ScopeTimer::enableTimers(s_bZoneStatsEnabled || TraceRecorder::isRecording() ||
+            Logger::get()->shouldLog(Logger::category::PROFILE, Logger::severity::INFO));
+}
+
+void ThreadProfiler::addCmdWakeup(int numCmds)
+{
+    if (numCmds > 0) {
+        m_NumCmdWakeups++;
+        m_NumCmds += numCmds;
+        if (numCmds > m_MaxCmdsPerWakeup) {
+            m_MaxCmdsPerWakeup = numCmds;
+        }
+    }
+}
+
+int ThreadProfiler::getNumCmdWakeups() const
+{
+    return m_NumCmdWakeups;
+}
+
+float ThreadProfiler::getAvgCmdsPerWakeup() const
+{
+    if (m_NumCmdWakeups == 0) {
+        return 0;
+    } else {
+        return float(m_NumCmds)/m_NumCmdWakeups;
+    }
+}
+
+int ThreadProfiler::getMaxCmdsPerWakeup() const
+{
+    return m_MaxCmdsPerWakeup;
+}
+
 const std::string& ThreadProfiler::getName() const
 {
     return m_sName;
@@ -149,6 +230,9 @@ const std::string& ThreadProfiler::getName() const
 void ThreadProfiler::setName(const std::string& sName)
 {
     m_sName = sName;
+    if (m_pTraceBuffer) {
+        m_pTraceBuffer->setThreadName(sName);
+    }
 }
 
 
@@ -180,5 +264,12 @@ ProfilingZonePtr ThreadProfiler::addZone(const ProfilingZoneID& zoneID)
     return pZone;
 }
 
+void ThreadProfiler::traceEvent(const ProfilingZoneID& zoneID, bool bBegin)
+{
+    if (!m_pTraceBuffer || !m_pTraceBuffer->isActive()) {
+        m_pTraceBuffer = TraceRecorder::get()->createBuffer(m_sName);
+    }
+    m_pTraceBuffer->addEvent(&zoneID, TimeSource::get()->getCurrentMicrosecs(), bBegin);
 }
 
+}
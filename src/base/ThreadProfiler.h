@@ -24,6 +24,7 @@
 
 #include "../api.h"
 #include "ILogSink.h"
+#include "TraceRecorder.h"
 
 #include <boost/thread.hpp>
 #include <boost/shared_ptr.hpp>
@@ -43,6 +44,7 @@ typedef boost::shared_ptr<ThreadProfiler> ThreadProfilerPtr;
 class ProfilingZone;
 typedef boost::shared_ptr<ProfilingZone> ProfilingZonePtr;
 class ProfilingZoneID;
+struct ProfilingZoneStats;
 
 class AVG_API ThreadProfiler
 {
@@ -60,12 +62,29 @@ public:
     void dumpStatistics();
     void reset();
     int getNumZones();
+    // Per-frame time statistics of all zones this thread has run, in the order
+    // dumpStatistics() prints them.
+    std::vector<ProfilingZoneStats> getZoneStats() const;
+
+    // Zones are only timed if profiling is logged, a trace is being recorded or zone
+    // statistics are enabled explicitly.
+    static void enableZoneStats(bool bEnable);
+    static bool areZoneStatsEnabled();
+    static void updateTimers();
+
+    // Statistics for command queue processing. Only wakeups that processed at least
+    // one command are counted.
+    void addCmdWakeup(int numCmds);
+    int getNumCmdWakeups() const;
+    float getAvgCmdsPerWakeup() const;
+    int getMaxCmdsPerWakeup() const;
 
     const std::string& getName() const;
     void setName(const std::string& sName);
 
 private:
     ProfilingZonePtr addZone(const ProfilingZoneID& zoneID);
+    void traceEvent(const ProfilingZoneID& zoneID, bool bBegin);
     std::string m_sName;
 
 #if defined(_WIN32) || defined(_LIBCPP_VERSION)
@@ -78,9 +97,16 @@ private:
     ZoneVector m_ActiveZones;
     ZoneVector m_Zones;
     bool m_bRunning;
-    category_t m_LogCategory;
+    int m_LogCategoryIndex;
+
+    int m_NumCmdWakeups;
+    long long m_NumCmds;
+    int m_MaxCmdsPerWakeup;
+
+    TraceBufferPtr m_pTraceBuffer;
 
     static boost::thread_specific_ptr<ThreadProfiler*> s_pInstance;
+    static bool s_bZoneStatsEnabled;
 };
 
 }
@@ -47,7 +47,7 @@ namespace avg {
 
 TimeSource* TimeSource::m_pTimeSource = 0;
 
-TimeSource * TimeSource::get()
+TimeSource * TimeSource::create()
 {
     if (!m_pTimeSource) {
 #ifdef _WIN32
@@ -64,10 +64,28 @@ TimeSource * TimeSource::get()
 }
 
 TimeSource::TimeSource()
+    : m_FrameStartTime(0)
 {
 #ifdef __APPLE__
     mach_timebase_info(&m_TimebaseInfo);
+#elif defined(_WIN32)
+    LARGE_INTEGER frequency;
+    BOOL bOk = QueryPerformanceFrequency(&frequency);
+    AVG_ASSERT(bOk);
+    m_PerfCounterFrequency = frequency.QuadPart;
+#else
+    m_ClockID = CLOCK_MONOTONIC;
+#ifdef CLOCK_MONOTONIC_RAW
+    // Depending on the kernel, CLOCK_MONOTONIC_RAW may need a system call.
+    struct timespec now;
+    if (clock_gettime(CLOCK_MONOTONIC_RAW, &now) == 0 &&
+            measureClockCost(CLOCK_MONOTONIC_RAW) <= measureClockCost(CLOCK_MONOTONIC))
+    {
+        m_ClockID = CLOCK_MONOTONIC_RAW;
+    }
 #endif
+#endif
+    m_FrameStartTime = getCurrentMicrosecs();
 }
 
 TimeSource::~TimeSource()
@@ -79,21 +97,49 @@ long long TimeSource::getCurrentMillisecs()
     return getCurrentMicrosecs()/1000;
 }
 
+#ifdef __APPLE__
 long long TimeSource::getCurrentMicrosecs()
 {
-#ifdef _WIN32
-    return (long long)(timeGetTime())*1000;
-#else
-#ifdef __APPLE__
     long long systemTime = mach_absolute_time();
     return (systemTime * m_TimebaseInfo.numer/m_TimebaseInfo.denom)/1000;
+}
+#elif defined(_WIN32)
+long long TimeSource::getCurrentMicrosecs()
+{
+    LARGE_INTEGER counter;
+    QueryPerformanceCounter(&counter);
+    // Split the conversion to avoid overflowing.
+    long long secs = counter.QuadPart/m_PerfCounterFrequency;
+    long long remainder = counter.QuadPart%m_PerfCounterFrequency;
+    return secs*1000000+(remainder*1000000)/m_PerfCounterFrequency;
+}
 #else
-    struct timespec now;
-    int rc = clock_gettime(CLOCK_MONOTONIC, &now);
-    assert(rc == 0);
-    return ((long long)now.tv_sec)*1000000+now.tv_nsec/1000;
-#endif
+long long TimeSource::measureClockCost(clockid_t clockID)
+{
+    // Returns the minimum time in nanoseconds that 100 clock reads take.
+    long long minTime = -1;
+    for (int i=0; i<5; ++i) {
+        struct timespec start;
+        struct timespec end;
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (int j=0; j<100; ++j) {
+            clock_gettime(clockID, &now);
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        long long time = (end.tv_sec-start.tv_sec)*1000000000LL +
+                (end.tv_nsec-start.tv_nsec);
+        if (minTime == -1 || time < minTime) {
+            minTime = time;
+        }
+    }
+    return minTime;
+}
 #endif
+
+void TimeSource::setFrameStartTime()
+{
+    m_FrameStartTime.store(getCurrentMicrosecs(), boost::memory_order_relaxed);
 }
 
 void TimeSource::sleepUntil(long long targetTime)
@@ -24,8 +24,12 @@
 
 #include "../api.h"
 
+#include <boost/atomic.hpp>
+
 #ifdef __APPLE__ 
 #include <mach/mach_time.h>
+#elif !defined(_WIN32)
+#include <time.h>
 #endif
 
 namespace avg {
@@ -34,6 +38,9 @@ namespace avg {
 // This class is a monotonic time source with an undefined start time. Time is guarranteed
 // to increase monotonically. The time source has no jumps and does not go backwards,
 // even if system time is changed.
+// On Linux, the clock is read using clock_gettime(), which doesn't enter the kernel on
+// current systems. CLOCK_MONOTONIC_RAW is used if it is at least as fast as
+// CLOCK_MONOTONIC. On Windows, the performance counter is used.
 class AVG_API TimeSource {
 public:
     static TimeSource* get();
@@ -41,18 +48,59 @@ public:
    
     long long getCurrentMillisecs();
     long long getCurrentMicrosecs();
+
+    // The time the current frame started. Set by the Player at the beginning of each
+    // frame. Reading it is much cheaper than reading the clock, and it is the same
+    // for everything that happens in a frame.
+    void setFrameStartTime();
+    long long getFrameStartMicrosecs() const;
+    long long getFrameStartMillisecs() const;
     
     void sleepUntil(long long targetTime);
 
 private:    
     TimeSource();
+    static TimeSource* create();
 #ifdef __APPLE__
     mach_timebase_info_data_t m_TimebaseInfo;
+#elif defined(_WIN32)
+    long long m_PerfCounterFrequency;
+#else
+    static long long measureClockCost(clockid_t clockID);
+    clockid_t m_ClockID;
 #endif
+    boost::atomic<long long> m_FrameStartTime;
     
     static TimeSource* m_pTimeSource;
 };
 
+inline TimeSource* TimeSource::get()
+{
+    if (!m_pTimeSource) {
+        return create();
+    }
+    return m_pTimeSource;
+}
+
+#if !defined(__APPLE__) && !defined(_WIN32)
+inline long long TimeSource::getCurrentMicrosecs()
+{
+    struct timespec now;
+    clock_gettime(m_ClockID, &now);
+    return ((long long)now.tv_sec)*1000000+now.tv_nsec/1000;
+}
+#endif
+
+inline long long TimeSource::getFrameStartMicrosecs() const
+{
+    return m_FrameStartTime.load(boost::memory_order_relaxed);
+}
+
+inline long long TimeSource::getFrameStartMillisecs() const
+{
+    return getFrameStartMicrosecs()/1000;
+}
+
 void AVG_API msleep(int millisecs);
 
 }
@@ -0,0 +1,304 @@
+//
+//  libavg - Media Playback Engine.
+//  Copyright (C) 2003-2014 Ulrich von Zadow
+//
+//  This library is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU Lesser General Public
+//  License as published by the Free Software Foundation; either
+//  version 2 of the License, or (at your option) any later version.
+//
+//  This library is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//  Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public
+//  License along with this library; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+//  Current versions can be found at www.libavg.de
+//
+
+
+#include "TraceRecorder.h"
+
+#include "Exception.h"
+#include "Logger.h"
+#include "ProfilingZoneID.h"
+#include "ThreadProfiler.h"
+#include "StringHelper.h"
+
+#include <stdlib.h>
+
+using namespace std;
+
+namespace avg {
+
+TraceBuffer::TraceBuffer(int threadID, int numEvents)
+    : m_WritePos(0),
+      m_ReadPos(0),
+      m_NumDroppedEvents(0),
+      m_ThreadID(threadID),
+      m_bActive(true),
+      m_bThreadAlive(true)
+{
+    size_t size = 2;
+    while (size < size_t(numEvents)) {
+        size *= 2;
+    }
+    m_Events.resize(size);
+    m_Mask = size-1;
+}
+
+TraceBuffer::~TraceBuffer()
+{
+}
+
+void TraceBuffer::addEvent(const ProfilingZoneID* pZoneID, long long time, bool bBegin)
+{
+    size_t writePos = m_WritePos.load(boost::memory_order_relaxed);
+    if (writePos - m_ReadPos.load(boost::memory_order_acquire) > m_Mask) {
+        m_NumDroppedEvents.fetch_add(1, boost::memory_order_relaxed);
+        return;
+    }
+    Event& event = m_Events[writePos & m_Mask];
+    event.m_pZoneID = pZoneID;
+    event.m_Time = time;
+    event.m_bBegin = bBegin;
+    m_WritePos.store(writePos+1, boost::memory_order_release);
+}
+
+void TraceBuffer::drain(vector<Event>& events)
+{
+    size_t readPos = m_ReadPos.load(boost::memory_order_relaxed);
+    size_t writePos = m_WritePos.load(boost::memory_order_acquire);
+    for (; readPos != writePos; ++readPos) {
+        events.push_back(m_Events[readPos & m_Mask]);
+    }
+    m_ReadPos.store(readPos, boost::memory_order_release);
+}
+
+int TraceBuffer::getThreadID() const
+{
+    return m_ThreadID;
+}
+
+string TraceBuffer::getThreadName() const
+{
+    boost::mutex::scoped_lock lock(m_NameMutex);
+    return m_sThreadName;
+}
+
+void TraceBuffer::setThreadName(const string& sName)
+{
+    boost::mutex::scoped_lock lock(m_NameMutex);
+    m_sThreadName = sName;
+}
+
+int TraceBuffer::getNumDroppedEvents() const
+{
+    return m_NumDroppedEvents.load(boost::memory_order_relaxed);
+}
+
+void TraceBuffer::deactivate()
+{
+    m_bActive.store(false, boost::memory_order_relaxed);
+}
+
+bool TraceBuffer::isThreadAlive() const
+{
+    return m_bThreadAlive.load(boost::memory_order_acquire);
+}
+
+void TraceBuffer::setThreadDead()
+{
+    m_bThreadAlive.store(false, boost::memory_order_release);
+}
+
+
+boost::atomic<bool> TraceRecorder::s_bRecording(false);
+TraceRecorder* TraceRecorder::s_pTraceRecorder = 0;
+
+void deleteTraceRecorder()
+{
+    delete TraceRecorder::s_pTraceRecorder;
+    TraceRecorder::s_pTraceRecorder = 0;
+}
+
+TraceRecorder* TraceRecorder::get()
+{
+    if (!s_pTraceRecorder) {
+        s_pTraceRecorder = new TraceRecorder();
+        atexit(deleteTraceRecorder);
+    }
+    return s_pTraceRecorder;
+}
+
+TraceRecorder::TraceRecorder()
+    : m_bFirstEvent(true),
+      m_EventsPerThread(DEFAULT_BUFFER_SIZE),
+      m_NextThreadID(1),
+      m_NumDroppedEvents(0)
+{
+}
+
+TraceRecorder::~TraceRecorder()
+{
+    if (isRecording()) {
+        stop();
+    }
+}
+
+void TraceRecorder::start(const string& sFilename, int eventsPerThread)
+{
+    boost::mutex::scoped_lock lock(m_Mutex);
+    if (isRecording()) {
+        throw Exception(AVG_ERR_UNSUPPORTED, "Tracing already started.");
+    }
+    m_File.open(sFilename.c_str(), ios::out | ios::trunc);
+    if (!m_File) {
+        m_File.clear();
+        throw Exception(AVG_ERR_FILEIO, "Opening "+sFilename+" for writing failed.");
+    }
+    m_sFilename = sFilename;
+    m_File << "{\"traceEvents\":[";
+    m_bFirstEvent = true;
+    m_EventsPerThread = eventsPerThread;
+    m_NumDroppedEvents = 0;
+    s_bRecording.store(true);
+    ThreadProfiler::updateTimers();
+    AVG_TRACE(Logger::category::PROFILE, Logger::severity::INFO,
+            "Tracing to " << sFilename);
+}
+
+void TraceRecorder::flush()
+{
+    boost::mutex::scoped_lock lock(m_Mutex);
+    if (!isRecording()) {
+        return;
+    }
+    vector<ThreadTrace>::iterator it = m_Threads.begin();
+    while (it != m_Threads.end()) {
+        // Check before draining so no events of a dead thread are lost.
+        bool bAlive = it->m_pBuffer->isThreadAlive();
+        flushThread(*it);
+        if (bAlive) {
+            ++it;
+        } else {
+            m_NumDroppedEvents += it->m_pBuffer->getNumDroppedEvents();
+            it = m_Threads.erase(it);
+        }
+    }
+    m_File.flush();
+}
+
+void TraceRecorder::stop()
+{
+    flush();
+    boost::mutex::scoped_lock lock(m_Mutex);
+    if (!isRecording()) {
+        return;
+    }
+    s_bRecording.store(false);
+    ThreadProfiler::updateTimers();
+    vector<ThreadTrace>::iterator it;
+    for (it = m_Threads.begin(); it != m_Threads.end(); ++it) {
+        // Events recorded between flush() and here belong to the trace as well.
+        TraceBufferPtr pBuffer = it->m_pBuffer;
+        pBuffer->deactivate();
+        flushThread(*it);
+        m_NumDroppedEvents += pBuffer->getNumDroppedEvents();
+    }
+    m_Threads.clear();
+    m_File << "]}" << endl;
+    m_File.close();
+    if (m_NumDroppedEvents > 0) {
+        AVG_LOG_WARNING("Trace buffers overflowed, " << m_NumDroppedEvents <<
+                " events were dropped. Flush more often or increase the buffer size.");
+    }
+    AVG_TRACE(Logger::category::PROFILE, Logger::severity::INFO,
+            "Trace written to " << m_sFilename);
+}
+
+int TraceRecorder::getNumDroppedEvents() const
+{
+    boost::mutex::scoped_lock lock(m_Mutex);
+    int numDropped = m_NumDroppedEvents;
+    vector<ThreadTrace>::const_iterator it;
+    for (it = m_Threads.begin(); it != m_Threads.end(); ++it) {
+        numDropped += it->m_pBuffer->getNumDroppedEvents();
+    }
+    return numDropped;
+}
+
+TraceBufferPtr TraceRecorder::createBuffer(const string& sThreadName)
+{
+    boost::mutex::scoped_lock lock(m_Mutex);
+    TraceBufferPtr pBuffer(new TraceBuffer(m_NextThreadID, m_EventsPerThread));
+    m_NextThreadID++;
+    pBuffer->setThreadName(sThreadName);
+    if (isRecording()) {
+        ThreadTrace thread;
+        thread.m_pBuffer = pBuffer;
+        m_Threads.push_back(thread);
+    } else {
+        // Tracing stopped in the meantime.
+        pBuffer->deactivate();
+    }
+    return pBuffer;
+}
+
+static string escapeJSON(const string& s)
+{
+    string sEscaped;
+    for (unsigned i=0; i<s.length(); ++i) {
+        char c = s[i];
+        if (c == '"' || c == '\\') {
+            sEscaped += '\\';
+            sEscaped += c;
+        } else if ((unsigned char)c < 0x20) {
+            sEscaped += ' ';
+        } else {
+            sEscaped += c;
+        }
+    }
+    return sEscaped;
+}
+
+void TraceRecorder::flushThread(ThreadTrace& thread)
+{
+    TraceBufferPtr pBuffer = thread.m_pBuffer;
+    int tid = pBuffer->getThreadID();
+    string sName = pBuffer->getThreadName();
+    if (sName == "") {
+        sName = "Thread " + toString(tid);
+    }
+    if (sName != thread.m_sWrittenName) {
+        writeEventStart();
+        m_File << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << tid
+                << ",\"args\":{\"name\":\"" << escapeJSON(sName) << "\"}}";
+        thread.m_sWrittenName = sName;
+    }
+
+    m_Events.clear();
+    pBuffer->drain(m_Events);
+    vector<TraceBuffer::Event>::iterator it;
+    for (it = m_Events.begin(); it != m_Events.end(); ++it) {
+        writeEventStart();
+        m_File << "{\"name\":\"" << escapeJSON(it->m_pZoneID->getName())
+                << "\",\"ph\":\"" << (it->m_bBegin ? 'B' : 'E')
+                << "\",\"ts\":" << it->m_Time << ",\"pid\":1,\"tid\":" << tid << "}";
+    }
+}
+
+void TraceRecorder::writeEventStart()
+{
+    if (m_bFirstEvent) {
+        m_bFirstEvent = false;
+    } else {
+        m_File << ",";
+    }
+    m_File << "\n";
+}
+
+}
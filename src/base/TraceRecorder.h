@@ -0,0 +1,149 @@
+//
+//  libavg - Media Playback Engine.
+//  Copyright (C) 2003-2014 Ulrich von Zadow
+//
+//  This library is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU Lesser General Public
+//  License as published by the Free Software Foundation; either
+//  version 2 of the License, or (at your option) any later version.
+//
+//  This library is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//  Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public
+//  License along with this library; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+//  Current versions can be found at www.libavg.de
+//
+
+
+#ifndef _TraceRecorder_H_
+#define _TraceRecorder_H_
+
+#include "../api.h"
+
+#include <boost/shared_ptr.hpp>
+#include <boost/atomic.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include <string>
+#include <vector>
+#include <fstream>
+
+namespace avg {
+
+class ProfilingZoneID;
+
+// Fixed-size ring of zone begin/end events written by a single thread. The owning
+// thread records events without locking; TraceRecorder drains them from another
+// thread. If the ring is full, events are dropped and counted.
+class AVG_API TraceBuffer
+{
+public:
+    struct Event {
+        const ProfilingZoneID* m_pZoneID;
+        long long m_Time;
+        bool m_bBegin;
+    };
+
+    TraceBuffer(int threadID, int numEvents);
+    virtual ~TraceBuffer();
+
+    void addEvent(const ProfilingZoneID* pZoneID, long long time, bool bBegin);
+    // Moves all events recorded so far to events. Only called by TraceRecorder.
+    void drain(std::vector<Event>& events);
+
+    int getThreadID() const;
+    std::string getThreadName() const;
+    void setThreadName(const std::string& sName);
+    int getNumDroppedEvents() const;
+
+    // A buffer is active from creation until the trace is stopped. Inactive buffers
+    // are replaced when the next trace starts.
+    bool isActive() const
+    {
+        return m_bActive.load(boost::memory_order_relaxed);
+    };
+    void deactivate();
+    bool isThreadAlive() const;
+    void setThreadDead();
+
+private:
+    std::vector<Event> m_Events;
+    size_t m_Mask;
+    char m_Pad0[64];
+    boost::atomic<size_t> m_WritePos;
+    char m_Pad1[64];
+    boost::atomic<size_t> m_ReadPos;
+    char m_Pad2[64];
+    boost::atomic<int> m_NumDroppedEvents;
+
+    int m_ThreadID;
+    std::string m_sThreadName;
+    mutable boost::mutex m_NameMutex;
+    boost::atomic<bool> m_bActive;
+    boost::atomic<bool> m_bThreadAlive;
+};
+
+typedef boost::shared_ptr<TraceBuffer> TraceBufferPtr;
+
+// Records ScopeTimer zones of all threads into a timeline that can be loaded into
+// chrome://tracing or the Perfetto UI (Chrome trace-event JSON format).
+// While tracing is active, ScopeTimers are enabled regardless of the PROFILE log
+// category and each ThreadProfiler writes into its own TraceBuffer. Buffers are
+// written to the file on flush() and stop(); call flush() periodically in long
+// sessions to keep the buffers from overflowing.
+// Zone names are looked up when the events are written, so all ProfilingZoneIDs
+// must outlive the trace (they are static in libavg).
+class AVG_API TraceRecorder
+{
+public:
+    static const int DEFAULT_BUFFER_SIZE = 65536;
+
+    static TraceRecorder* get();
+    virtual ~TraceRecorder();
+
+    void start(const std::string& sFilename, int eventsPerThread=DEFAULT_BUFFER_SIZE);
+    void flush();
+    void stop();
+    static bool isRecording()
+    {
+        return s_bRecording.load(boost::memory_order_relaxed);
+    };
+    int getNumDroppedEvents() const;
+
+    // Called by ThreadProfiler.
+    TraceBufferPtr createBuffer(const std::string& sThreadName);
+
+private:
+    TraceRecorder();
+    friend void deleteTraceRecorder();
+
+    struct ThreadTrace {
+        TraceBufferPtr m_pBuffer;
+        std::string m_sWrittenName;
+    };
+
+    void flushThread(ThreadTrace& thread);
+    void writeEventStart();
+
+    std::vector<ThreadTrace> m_Threads;
+    std::vector<TraceBuffer::Event> m_Events;
+    std::ofstream m_File;
+    std::string m_sFilename;
+    bool m_bFirstEvent;
+    int m_EventsPerThread;
+    int m_NextThreadID;
+    int m_NumDroppedEvents;
+    mutable boost::mutex m_Mutex;
+
+    static boost::atomic<bool> s_bRecording;
+    static TraceRecorder* s_pTraceRecorder;
+};
+
+}
+
+#endif
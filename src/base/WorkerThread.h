@@ -28,20 +28,25 @@
 #include "Logger.h"
 #include "ThreadProfiler.h"
 #include "CmdQueue.h"
+#include "TaskScheduler.h"
 
 #include <boost/shared_ptr.hpp>
+#include <boost/bind.hpp>
 
 #include <iostream>
+#include <deque>
 
 namespace avg {
 
 
-template<class DERIVED_THREAD>
+// BASE_QUEUE selects the implementation of the command queue (Queue or LockFreeQueue,
+// see CmdQueue).
+template<class DERIVED_THREAD, template<class> class BASE_QUEUE = Queue>
 class AVG_TEMPLATE_API WorkerThread {
 public:
     typedef Command<DERIVED_THREAD> Cmd;
     typedef typename boost::shared_ptr<Cmd> CmdPtr;
-    typedef CmdQueue<DERIVED_THREAD> CQueue;
+    typedef CmdQueue<DERIVED_THREAD, BASE_QUEUE> CQueue;
     typedef typename boost::shared_ptr<CQueue> CQueuePtr;
 
     WorkerThread(const std::string& sName, CQueue& CmdQ,
@@ -53,8 +58,19 @@ public:
     void waitForCommand();
     void stop();
 
+    // Runs a copy of thread as a cooperative task on the TaskScheduler instead of 
+    // in its own OS thread. work() is called once per task slice. waitForCommand()
+    // doesn't block in this mode; instead, the task is suspended until the next command
+    // arrives. The returned task is done when the thread has stopped.
+    static TaskPtr startAsTask(const DERIVED_THREAD& thread, 
+            Task::Priority priority=Task::NORMAL);
+
 protected:
     int getNumCmdsInQueue() const;
+    // Limits the number of commands taken from the queue at once. By default, all
+    // pending commands are taken under a single lock. Threads that share a queue with
+    // other threads should set a small limit so the others can pull work in parallel.
+    void setMaxCmdBatchSize(int maxNum);
 
 private:
     virtual bool init();
@@ -62,39 +78,104 @@ private:
     virtual void deinit() {};
 
     void processCommands();
+    bool runSlice();
 
     std::string m_sName;
     bool m_bShouldStop;
     CQueue& m_CmdQ;
     category_t m_LogCategory;
+    int m_MaxCmdBatchSize;
+
+    bool m_bIsTask;
+    bool m_bInitialized;
+    bool m_bWaitingForCommand;
+
+    template<class THREAD> friend class WorkerTask;
 };
 
 template<class DERIVED_THREAD>
-WorkerThread<DERIVED_THREAD>::WorkerThread(const std::string& sName, CQueue& CmdQ, 
-        category_t logCategory)
+class WorkerTask
+{
+public:
+    WorkerTask(const DERIVED_THREAD& thread, Task::Priority priority)
+        : m_pThread(new DERIVED_THREAD(thread)),
+          m_Priority(priority),
+          m_pDoneTask(new Task(TaskFunc(), priority))
+    {
+        m_pThread->m_bIsTask = true;
+    }
+
+    TaskPtr getDoneTask()
+    {
+        return m_pDoneTask;
+    }
+
+    static void schedule(boost::shared_ptr<WorkerTask> pWorkerTask)
+    {
+        TaskScheduler::get()->submit(boost::bind(&WorkerTask::runSlice, pWorkerTask),
+                pWorkerTask->m_Priority);
+    }
+
+private:
+    static void runSlice(boost::shared_ptr<WorkerTask> pWorkerTask)
+    {
+        DERIVED_THREAD* pThread = pWorkerTask->m_pThread.get();
+        bool bRunning;
+        try {
+            bRunning = pThread->runSlice();
+        } catch (const Exception& e) {
+            AVG_LOG_ERROR("Uncaught exception in thread " << pThread->m_sName << ": " 
+                    << e.getStr());
+            bRunning = false;
+        }
+        if (!bRunning) {
+            TaskScheduler::get()->submit(pWorkerTask->m_pDoneTask);
+        } else if (pThread->m_bWaitingForCommand) {
+            pThread->m_CmdQ.notifyOnCmd(boost::bind(&WorkerTask::schedule, pWorkerTask));
+        } else {
+            schedule(pWorkerTask);
+        }
+    }
+
+    boost::shared_ptr<DERIVED_THREAD> m_pThread;
+    Task::Priority m_Priority;
+    TaskPtr m_pDoneTask;
+};
+
+template<class DERIVED_THREAD, template<class> class BASE_QUEUE>
+WorkerThread<DERIVED_THREAD, BASE_QUEUE>::WorkerThread(const std::string& sName, 
+        CQueue& CmdQ, category_t logCategory)
     : m_sName(sName),
       m_bShouldStop(false),
       m_CmdQ(CmdQ),
-      m_LogCategory(logCategory)
+      m_LogCategory(logCategory),
+      m_MaxCmdBatchSize(-1),
+      m_bIsTask(false),
+      m_bInitialized(false),
+      m_bWaitingForCommand(false)
 {
 }
 
-template<class DERIVED_THREAD>
-WorkerThread<DERIVED_THREAD>::WorkerThread(WorkerThread const& other)
+template<class DERIVED_THREAD, template<class> class BASE_QUEUE>
+WorkerThread<DERIVED_THREAD, BASE_QUEUE>::WorkerThread(WorkerThread const& other)
     : m_CmdQ(other.m_CmdQ)
 {
     m_sName = other.m_sName;
     m_bShouldStop = other.m_bShouldStop;
     m_LogCategory = other.m_LogCategory;
+    m_MaxCmdBatchSize = other.m_MaxCmdBatchSize;
+    m_bIsTask = other.m_bIsTask;
+    m_bInitialized = other.m_bInitialized;
+    m_bWaitingForCommand = other.m_bWaitingForCommand;
 }
 
-template<class DERIVED_THREAD>
-WorkerThread<DERIVED_THREAD>::~WorkerThread()
+template<class DERIVED_THREAD, template<class> class BASE_QUEUE>
+WorkerThread<DERIVED_THREAD, BASE_QUEUE>::~WorkerThread()
 {
 }
 
-template<class DERIVED_THREAD>
-void WorkerThread<DERIVED_THREAD>::operator()()
+template<class DERIVED_THREAD, template<class> class BASE_QUEUE>
+void WorkerThread<DERIVED_THREAD, BASE_QUEUE>::operator()()
 {
     try {
         setAffinityMask(false);
@@ -125,41 +206,97 @@ void WorkerThread<DERIVED_THREAD>::operator()()
     }
 }
 
-template<class DERIVED_THREAD>
-void WorkerThread<DERIVED_THREAD>::waitForCommand() 
+template<class DERIVED_THREAD, template<class> class BASE_QUEUE>
+void WorkerThread<DERIVED_THREAD, BASE_QUEUE>::waitForCommand() 
 {
-    CmdPtr pCmd = m_CmdQ.pop(true);
-    pCmd->execute(dynamic_cast<DERIVED_THREAD*>(this));
+    CmdPtr pCmd = m_CmdQ.pop(!m_bIsTask);
+    if (pCmd) {
+        pCmd->execute(dynamic_cast<DERIVED_THREAD*>(this));
+    } else {
+        m_bWaitingForCommand = true;
+    }
 }
 
-template<class DERIVED_THREAD>
-void WorkerThread<DERIVED_THREAD>::stop() 
+template<class DERIVED_THREAD, template<class> class BASE_QUEUE>
+void WorkerThread<DERIVED_THREAD, BASE_QUEUE>::stop() 
 {
     m_bShouldStop = true;
 }
 
-template<class DERIVED_THREAD>
-int WorkerThread<DERIVED_THREAD>::getNumCmdsInQueue() const
+template<class DERIVED_THREAD, template<class> class BASE_QUEUE>
+TaskPtr WorkerThread<DERIVED_THREAD, BASE_QUEUE>::startAsTask(
+        const DERIVED_THREAD& thread, Task::Priority priority)
+{
+    boost::shared_ptr<WorkerTask<DERIVED_THREAD> > pWorkerTask(
+            new WorkerTask<DERIVED_THREAD>(thread, priority));
+    WorkerTask<DERIVED_THREAD>::schedule(pWorkerTask);
+    return pWorkerTask->getDoneTask();
+}
+
+template<class DERIVED_THREAD, template<class> class BASE_QUEUE>
+int WorkerThread<DERIVED_THREAD, BASE_QUEUE>::getNumCmdsInQueue() const
 {
     return m_CmdQ.size();
 }
 
-template<class DERIVED_THREAD>
-bool WorkerThread<DERIVED_THREAD>::init()
+template<class DERIVED_THREAD, template<class> class BASE_QUEUE>
+void WorkerThread<DERIVED_THREAD, BASE_QUEUE>::setMaxCmdBatchSize(int maxNum)
+{
+    m_MaxCmdBatchSize = maxNum;
+}
+
+template<class DERIVED_THREAD, template<class> class BASE_QUEUE>
+bool WorkerThread<DERIVED_THREAD, BASE_QUEUE>::init()
 {
     return true;
 }
 
-template<class DERIVED_THREAD>
-void WorkerThread<DERIVED_THREAD>::processCommands()
+template<class DERIVED_THREAD, template<class> class BASE_QUEUE>
+void WorkerThread<DERIVED_THREAD, BASE_QUEUE>::processCommands()
 {
-    CmdPtr pCmd = m_CmdQ.pop(false);
-    while (pCmd && !m_bShouldStop) {
-        pCmd->execute(dynamic_cast<DERIVED_THREAD*>(this));
+    int numCmds = 0;
+    std::deque<CmdPtr> pCmds;
+    m_CmdQ.popBatch(pCmds, m_MaxCmdBatchSize);
+    while (!pCmds.empty() && !m_bShouldStop) {
+        while (!pCmds.empty() && !m_bShouldStop) {
+            CmdPtr pCmd = pCmds.front();
+            pCmds.pop_front();
+            pCmd->execute(dynamic_cast<DERIVED_THREAD*>(this));
+            numCmds++;
+        }
         if (!m_bShouldStop) {
-            pCmd = m_CmdQ.pop(false);
+            // Commands that were pushed while the batch was being processed.
+            m_CmdQ.popBatch(pCmds, m_MaxCmdBatchSize);
+        }
+    }
+    // If the thread was stopped, the rest of the batch belongs to other threads 
+    // sharing the queue (e.g. their stop commands), so it goes back to the front of 
+    // the queue.
+    m_CmdQ.requeueCmds(pCmds);
+    ThreadProfiler::get()->addCmdWakeup(numCmds);
+}
+
+template<class DERIVED_THREAD, template<class> class BASE_QUEUE>
+bool WorkerThread<DERIVED_THREAD, BASE_QUEUE>::runSlice()
+{
+    if (!m_bInitialized) {
+        m_bInitialized = true;
+        if (!init()) {
+            return false;
         }
     }
+    m_bWaitingForCommand = false;
+    if (!work()) {
+        m_bShouldStop = true;
+    }
+    if (!m_bShouldStop) {
+        processCommands();
+    }
+    if (m_bShouldStop) {
+        deinit();
+        return false;
+    }
+    return true;
 }
 
 }
@@ -0,0 +1,153 @@
+//
+//  libavg - Media Playback Engine.
+//  Copyright (C) 2003-2014 Ulrich von Zadow
+//
+//  This library is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU Lesser General Public
+//  License as published by the Free Software Foundation; either
+//  version 2 of the License, or (at your option) any later version.
+//
+//  This library is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//  Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public
+//  License along with this library; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+//  Current versions can be found at www.libavg.de
+//
+
+#include "Queue.h"
+#include "LockFreeQueue.h"
+#include "TimeSource.h"
+#include "ObjectCounter.h"
+
+#include <boost/thread/thread.hpp>
+#include <boost/bind.hpp>
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+
+using namespace avg;
+using namespace std;
+
+// Contention benchmark: numProducers threads push small messages into a bounded
+// queue, a single consumer (like the main thread polling decoder messages) pops
+// them.
+template<class QUEUE>
+class QueuePerfTest {
+public:
+    typedef typename QUEUE::QElementPtr ElemPtr;
+
+    QueuePerfTest(const string& sName, int numProducers, int queueSize)
+        : m_sName(sName),
+          m_NumProducers(numProducers),
+          m_Queue(queueSize)
+    {
+    }
+
+    void run(int numMsgs)
+    {
+        int msgsPerProducer = numMsgs/m_NumProducers;
+        long long startTime = TimeSource::get()->getCurrentMicrosecs();
+        vector<boost::thread*> pProducers;
+        for (int i=0; i<m_NumProducers; ++i) {
+            pProducers.push_back(new boost::thread(
+                    boost::bind(&QueuePerfTest::produce, this, msgsPerProducer)));
+        }
+        consume(msgsPerProducer*m_NumProducers);
+        for (unsigned i=0; i<pProducers.size(); ++i) {
+            pProducers[i]->join();
+            delete pProducers[i];
+        }
+        float activeTime = (TimeSource::get()->getCurrentMicrosecs()-startTime)/1000.f;
+        cerr << setw(30) << left << m_sName << setw(3) << right << m_NumProducers
+                << " producers: " << setw(8) << activeTime << " ms, " 
+                << (activeTime*1000000)/(msgsPerProducer*m_NumProducers) << " ns/msg"
+                << endl;
+    }
+
+private:
+    void produce(int numMsgs)
+    {
+        for (int i=0; i<numMsgs; ++i) {
+            m_Queue.push(ElemPtr(new int(i)));
+        }
+    }
+
+    void consume(int numMsgs)
+    {
+        for (int i=0; i<numMsgs; ++i) {
+            m_Queue.pop(true);
+        }
+    }
+
+    string m_sName;
+    int m_NumProducers;
+    QUEUE m_Queue;
+};
+
+template<class QUEUE>
+void runQueuePerfTest(const string& sName, int numProducers, int numMsgs=200000)
+{
+    QueuePerfTest<QUEUE> test(sName, numProducers, 64);
+    test.run(numMsgs);
+}
+
+// Object accounting overhead: numThreads threads create and destroy counted objects.
+class CountedObject {
+public:
+    CountedObject()
+    {
+        ObjectCounter::get()->incRef(&typeid(*this));
+    }
+
+    virtual ~CountedObject()
+    {
+        ObjectCounter::get()->decRef(&typeid(*this));
+    }
+};
+
+void countObjects(int numObjects)
+{
+    for (int i=0; i<numObjects; ++i) {
+        CountedObject obj;
+    }
+}
+
+void runObjectCounterPerfTest(int numThreads, int numObjects=1000000)
+{
+    int objectsPerThread = numObjects/numThreads;
+    long long startTime = TimeSource::get()->getCurrentMicrosecs();
+    boost::thread_group threads;
+    for (int i=0; i<numThreads; ++i) {
+        threads.create_thread(boost::bind(&countObjects, objectsPerThread));
+    }
+    threads.join_all();
+    float activeTime = (TimeSource::get()->getCurrentMicrosecs()-startTime)/1000.f;
+    cerr << setw(30) << left << "ObjectCounter" << setw(3) << right << numThreads
+            << " threads:   " << setw(8) << activeTime << " ms, " 
+            << (activeTime*1000000)/(objectsPerThread*numThreads) << " ns/object"
+            << endl;
+}
+
+void runPerformanceTests()
+{
+    int numProducers[] = {1, 2, 4, 12};
+    for (unsigned i=0; i<sizeof(numProducers)/sizeof(int); ++i) {
+        runQueuePerfTest<Queue<int> >("Queue", numProducers[i]);
+        runQueuePerfTest<LockFreeQueue<int> >("LockFreeQueue", numProducers[i]);
+    }
+    for (unsigned i=0; i<sizeof(numProducers)/sizeof(int); ++i) {
+        runObjectCounterPerfTest(numProducers[i]);
+    }
+}
+
+int main(int nargs, char** args)
+{
+    runPerformanceTests();
+}
@@ -21,8 +21,15 @@
 
 #include "DAG.h"
 #include "Queue.h"
+#include "LockFreeQueue.h"
 #include "Command.h"
 #include "WorkerThread.h"
+#include "TaskScheduler.h"
+#include "TraceRecorder.h"
+#include "LatencyHistogram.h"
+#include "FrameArena.h"
+#include "ProfilingZone.h"
+#include "ScopeTimer.h"
 #include "ObjectCounter.h"
 #include "triangulate/Triangulate.h"
 #include "GLMHelper.h"
@@ -42,13 +49,16 @@
 #include "TimeSource.h"
 #include "XMLHelper.h"
 #include "Logger.h"
+#include "AsyncLogSink.h"
 
 #include <boost/thread/thread.hpp>
+#include <boost/atomic.hpp>
 
 #include <boost/bind.hpp>
 
 #include <iostream>
 #include <sstream>
+#include <algorithm>
 #include <stdio.h>
 #include <stdlib.h>
 
@@ -152,11 +162,12 @@ private:
     }
 };
 
+template<template<class> class QUEUE>
 class QueueTest: public Test
 {
 public:
-    QueueTest()
-        : Test("QueueTest", 2)
+    QueueTest(const string& sName)
+        : Test(sName, 2)
     {
     }
 
@@ -167,12 +178,13 @@ public:
     }
 
 private:
-    typedef Queue<int>::QElementPtr ElemPtr;
+    typedef QUEUE<int> IntQueue;
+    typedef typename IntQueue::QElementPtr ElemPtr;
     
     void runSingleThreadTests()
     {
-        Queue<string> q;
-        typedef Queue<string>::QElementPtr ElemPtr;
+        QUEUE<string> q;
+        typedef typename QUEUE<string>::QElementPtr ElemPtr;
         TEST(q.empty());
         q.push(ElemPtr(new string("1")));
         TEST(q.size() == 1);
@@ -189,12 +201,34 @@ private:
         TEST(q.empty());
         ElemPtr pElem = q.pop(false);
         TEST(!pElem);
+
+        for (int i=0; i<5; ++i) {
+            q.push(ElemPtr(new string(toString(i))));
+        }
+        std::deque<ElemPtr> pElems;
+        q.popBatch(pElems, 2);
+        TEST(pElems.size() == 2 && *pElems[1] == "1");
+        TEST(q.size() == 3);
+        q.popBatch(pElems);
+        TEST(pElems.size() == 5 && *pElems[4] == "4");
+        TEST(q.empty());
+
+        q.push(ElemPtr(new string("5")));
+        pElems.erase(pElems.begin(), pElems.begin()+3);
+        q.pushFront(pElems);
+        TEST(q.size() == 3);
+        TEST(*q.peek() == "3");
+        TEST(*q.pop() == "3");
+        pElems.clear();
+        q.popBatch(pElems);
+        TEST(pElems.size() == 2 && *pElems[0] == "4" && *pElems[1] == "5");
+        TEST(q.empty());
     }
 
     void runMultiThreadTests()
     {
         {
-            Queue<int> q(10);
+            IntQueue q(10);
             thread pusher(boost::bind(&pushThread, &q, 100));
             thread popper(boost::bind(&popThread, &q, 100));
             pusher.join();
@@ -202,7 +236,7 @@ private:
             TEST(q.empty());
         }
         {
-            Queue<int> q(10);
+            IntQueue q(10);
             thread pusher1(boost::bind(&pushThread, &q, 100));
             thread pusher2(boost::bind(&pushThread, &q, 100));
             thread popper(boost::bind(&popThread, &q, 200));
@@ -212,7 +246,7 @@ private:
             TEST(q.empty());
         }
         {
-            Queue<int> q(10);
+            IntQueue q(10);
             thread pusher(boost::bind(&pushClearThread, &q, 100));
             thread popper(boost::bind(&popClearThread, &q));
             pusher.join();
@@ -221,7 +255,7 @@ private:
         }
     }
 
-    static void pushThread(Queue<int>* pq, int numPushes)
+    static void pushThread(IntQueue* pq, int numPushes)
     {
         for (int i=0; i<numPushes; ++i) {
             pq->push(ElemPtr(new int(i)));
@@ -229,7 +263,7 @@ private:
         }
     }
 
-    static void popThread(Queue<int>* pq, int numPops)
+    static void popThread(IntQueue* pq, int numPops)
     {
         for (int i=0; i<numPops; ++i) {
             pq->peek();
@@ -238,9 +272,8 @@ private:
         }
     }
 
-    static void pushClearThread(Queue<int>* pq, int numPushes)
+    static void pushClearThread(IntQueue* pq, int numPushes)
     {
-        typedef Queue<int>::QElementPtr ElemPtr;
         for (int i=0; i<numPushes; ++i) {
             pq->push(ElemPtr(new int(i)));
             if (i%7 == 0) {
@@ -251,7 +284,7 @@ private:
         pq->push(ElemPtr(new int(-1)));
     }
 
-    static void popClearThread(Queue<int>* pq)
+    static void popClearThread(IntQueue* pq)
     {
         ElemPtr pElem;
         do {
@@ -260,6 +293,42 @@ private:
     }
 };
 
+class LockFreeQueueTest: public QueueTest<LockFreeQueue>
+{
+public:
+    LockFreeQueueTest()
+        : QueueTest<LockFreeQueue>("LockFreeQueueTest")
+    {
+    }
+
+    void runTests() 
+    {
+        QueueTest<LockFreeQueue>::runTests();
+        runBoundsTests();
+    }
+
+private:
+    void runBoundsTests()
+    {
+        typedef LockFreeQueue<int>::QElementPtr ElemPtr;
+        LockFreeQueue<int> q(3);
+        TEST(q.getMaxSize() == 3);
+        for (int i=0; i<3; ++i) {
+            q.push(ElemPtr(new int(i)));
+        }
+        TEST(q.size() == 3);
+        // Wraparound
+        for (int i=3; i<20; ++i) {
+            ElemPtr pElem = q.pop();
+            QUIET_TEST(*pElem == i-3);
+            q.push(ElemPtr(new int(i)));
+        }
+        q.clear();
+        TEST(q.empty());
+        TEST(!q.pop(false));
+    }
+};
+
 class TestWorkerThread: public WorkerThread<TestWorkerThread>
 {
 public:
@@ -302,6 +371,30 @@ private:
     std::string * m_pStringParam;
 };
 
+class LockFreeWorkerThread: public WorkerThread<LockFreeWorkerThread, LockFreeQueue>
+{
+public:
+    LockFreeWorkerThread(CQueue& cmdQ, boost::atomic<int>* pSum)
+        : WorkerThread<LockFreeWorkerThread, LockFreeQueue>("LockFreeThread", cmdQ),
+          m_pSum(pSum)
+    {
+    }
+
+    bool work()
+    {
+        waitForCommand();
+        return true;
+    }
+
+    void addToSum(int i)
+    {
+        m_pSum->fetch_add(i);
+    }
+
+private:
+    boost::atomic<int> * m_pSum;
+};
+
 
 class WorkerThreadTest: public Test
 {
@@ -327,6 +420,318 @@ public:
         TEST(numFuncCalls == 3);
         TEST(intParam == 23);
         TEST(stringParam == "foo");
+        TEST(cmdQ.empty());
+
+        // Two threads sharing a queue: The first thread to process the stop commands
+        // must leave the second one for the other thread.
+        int numFuncCalls2 = 0;
+        int intParam2 = 0;
+        std::string stringParam2;
+        cmdQ.pushCmd(boost::bind(&TestWorkerThread::stop, _1));
+        cmdQ.pushCmd(boost::bind(&TestWorkerThread::stop, _1));
+        boost::thread thread1(TestWorkerThread(cmdQ, &numFuncCalls, &intParam, 
+                &stringParam));
+        boost::thread thread2(TestWorkerThread(cmdQ, &numFuncCalls2, &intParam2, 
+                &stringParam2));
+        thread1.join();
+        thread2.join();
+        TEST(cmdQ.empty());
+
+        // Requeued commands go in front of commands that were pushed later.
+        cmdQ.pushCmd(boost::bind(&TestWorkerThread::doSomething, _1, 42, "bar"));
+        std::deque<TestWorkerThread::CmdPtr> pCmds;
+        cmdQ.popBatch(pCmds);
+        cmdQ.pushCmd(boost::bind(&TestWorkerThread::stop, _1));
+        cmdQ.requeueCmds(pCmds);
+        TEST(cmdQ.size() == 2);
+        boost::thread thread3(TestWorkerThread(cmdQ, &numFuncCalls, &intParam, 
+                &stringParam));
+        thread3.join();
+        TEST(intParam == 42);
+        TEST(stringParam == "bar");
+        TEST(cmdQ.empty());
+
+        // Two threads sharing a lock-free command queue.
+        LockFreeWorkerThread::CQueue lockFreeCmdQ;
+        boost::atomic<int> sum(0);
+        for (int i=1; i<=4; ++i) {
+            lockFreeCmdQ.pushCmd(boost::bind(&LockFreeWorkerThread::addToSum, _1, i));
+        }
+        lockFreeCmdQ.pushCmd(boost::bind(&LockFreeWorkerThread::stop, _1));
+        lockFreeCmdQ.pushCmd(boost::bind(&LockFreeWorkerThread::stop, _1));
+        boost::thread lockFreeThread1(LockFreeWorkerThread(lockFreeCmdQ, &sum));
+        boost::thread lockFreeThread2(LockFreeWorkerThread(lockFreeCmdQ, &sum));
+        lockFreeThread1.join();
+        lockFreeThread2.join();
+        TEST(sum == 10);
+        TEST(lockFreeCmdQ.empty());
+    }
+};
+
+
+class TaskSchedulerTest: public Test
+{
+public:
+    TaskSchedulerTest()
+        : Test("TaskSchedulerTest", 2)
+    {
+    }
+
+    void runTests() 
+    {
+        TaskScheduler* pScheduler = TaskScheduler::get();
+        TEST(pScheduler->getNumThreads() >= 1);
+        TEST(!pScheduler->isSchedulerThread());
+        {
+            // Many small tasks
+            int results[100];
+            vector<TaskPtr> pTasks;
+            for (int i=0; i<100; ++i) {
+                results[i] = 0;
+                pTasks.push_back(pScheduler->submit(boost::bind(&setInt, &results[i], i),
+                        Task::Priority(i%Task::NUM_PRIORITIES)));
+            }
+            bool bOK = true;
+            for (int i=0; i<100; ++i) {
+                pTasks[i]->wait();
+                TEST(pTasks[i]->isDone());
+                bOK &= (results[i] == i);
+            }
+            TEST(bOK);
+        }
+        {
+            // Continuations
+            int result = 0;
+            TaskPtr pTask = pScheduler->submit(boost::bind(&setInt, &result, 1));
+            TaskPtr pCont = pTask->then(boost::bind(&incIfEqual, &result, 1));
+            pCont->wait();
+            TEST(result == 2);
+            TaskPtr pCont2 = pTask->then(boost::bind(&incIfEqual, &result, 2));
+            pCont2->wait();
+            TEST(result == 3);
+        }
+        {
+            // Tasks waiting for tasks
+            int result = 0;
+            TaskPtr pTask = pScheduler->submit(boost::bind(&spawnAndWait, &result));
+            pTask->wait();
+            TEST(result == 42);
+        }
+        {
+            // Exceptions
+            TaskPtr pTask = pScheduler->submit(&throwException);
+            bool bExceptionThrown = false;
+            try {
+                pTask->wait();
+            } catch (const Exception& e) {
+                bExceptionThrown = (e.getCode() == AVG_ERR_UNSUPPORTED);
+            }
+            TEST(bExceptionThrown);
+        }
+        {
+            // Cooperative WorkerThread
+            TestWorkerThread::CQueue cmdQ;
+            int numFuncCalls = 0;
+            int intParam = 0;
+            std::string stringParam;
+            TaskPtr pTask = TestWorkerThread::startAsTask(TestWorkerThread(cmdQ, 
+                    &numFuncCalls, &intParam, &stringParam));
+            msleep(10);
+            TEST(!pTask->isDone());
+            cmdQ.pushCmd(boost::bind(&TestWorkerThread::doSomething, _1, 23, "foo"));
+            cmdQ.pushCmd(boost::bind(&TestWorkerThread::stop, _1));
+            pTask->wait();
+            TEST(intParam == 23);
+            TEST(stringParam == "foo");
+        }
+    }
+
+private:
+    static void setInt(int* pInt, int i)
+    {
+        *pInt = i;
+    }
+
+    static void incIfEqual(int* pInt, int expected)
+    {
+        if (*pInt == expected) {
+            (*pInt)++;
+        }
+    }
+
+    static void spawnAndWait(int* pInt)
+    {
+        TaskPtr pTask = TaskScheduler::get()->submit(boost::bind(&setInt, pInt, 42));
+        pTask->wait();
+    }
+
+    static void throwException()
+    {
+        throw Exception(AVG_ERR_UNSUPPORTED, "Test exception");
+    }
+};
+
+
+static ProfilingZoneID TraceTestProfilingZone("TraceTestZone");
+static ProfilingZoneID TraceThreadProfilingZone("TraceThreadZone", true);
+
+class TraceRecorderTest: public Test
+{
+public:
+    TraceRecorderTest()
+        : Test("TraceRecorderTest", 2)
+    {
+    }
+
+    void runTests() 
+    {
+        const string sFilename = "testtrace.json";
+        TraceRecorder* pRecorder = TraceRecorder::get();
+        TEST(!TraceRecorder::isRecording());
+        pRecorder->start(sFilename);
+        TEST(TraceRecorder::isRecording());
+        for (int i=0; i<10; ++i) {
+            ScopeTimer timer(TraceTestProfilingZone);
+        }
+        boost::thread thread(&runTracedThread);
+        thread.join();
+        pRecorder->flush();
+        {
+            ScopeTimer timer(TraceTestProfilingZone);
+        }
+        pRecorder->stop();
+        TEST(!TraceRecorder::isRecording());
+        TEST(pRecorder->getNumDroppedEvents() == 0);
+
+        string sTrace;
+        readWholeFile(sFilename, sTrace);
+        TEST(sTrace.find("{\"traceEvents\":[") == 0);
+        TEST(sTrace.find("]}") != string::npos);
+        TEST(countSubstr(sTrace, "\"name\":\"TraceTestZone\",\"ph\":\"B\"") == 11);
+        TEST(countSubstr(sTrace, "\"name\":\"TraceTestZone\",\"ph\":\"E\"") == 11);
+        TEST(countSubstr(sTrace, "\"name\":\"TraceThreadZone\",\"ph\":\"B\"") == 5);
+        TEST(countSubstr(sTrace, "\"name\":\"TraceThreadZone\",\"ph\":\"E\"") == 5);
+        TEST(countSubstr(sTrace, "\"args\":{\"name\":\"TracedThread\"}") == 1);
+
+        // Overflow
+        pRecorder->start(sFilename, 16);
+        for (int i=0; i<10; ++i) {
+            ScopeTimer timer(TraceTestProfilingZone);
+        }
+        TEST(pRecorder->getNumDroppedEvents() == 4);
+        pRecorder->stop();
+        readWholeFile(sFilename, sTrace);
+        TEST(countSubstr(sTrace, "\"ph\":\"B\"") == 8);
+        remove(sFilename.c_str());
+    }
+
+private:
+    static void runTracedThread()
+    {
+        ThreadProfiler::get()->setName("TracedThread");
+        for (int i=0; i<5; ++i) {
+            ScopeTimer timer(TraceThreadProfilingZone);
+        }
+        ThreadProfiler::kill();
+    }
+
+    static int countSubstr(const string& s, const string& sSubstr)
+    {
+        int count = 0;
+        string::size_type pos = s.find(sSubstr);
+        while (pos != string::npos) {
+            count++;
+            pos = s.find(sSubstr, pos+1);
+        }
+        return count;
+    }
+};
+
+
+static ProfilingZoneID StatsTestProfilingZone("StatsTestZone");
+
+class LatencyHistogramTest: public Test
+{
+public:
+    LatencyHistogramTest()
+        : Test("LatencyHistogramTest", 2)
+    {
+    }
+
+    void runTests() 
+    {
+        LatencyHistogram histogram;
+        TEST(histogram.getNumValues() == 0);
+        TEST(histogram.getPercentile(50) == 0);
+        for (int i=1; i<=1000; ++i) {
+            histogram.addValue(i);
+        }
+        TEST(histogram.getNumValues() == 1000);
+        TEST(histogram.getMin() == 1);
+        TEST(histogram.getMax() == 1000);
+        TEST(histogram.getAvg() == 500);
+        TEST(isWithinPrecision(histogram.getPercentile(50), 500));
+        TEST(isWithinPrecision(histogram.getPercentile(95), 950));
+        TEST(isWithinPrecision(histogram.getPercentile(99), 990));
+        TEST(histogram.getPercentile(100) == 1000);
+        TEST(histogram.getPercentile(0) == 1);
+
+        // Small values are exact.
+        histogram.clear();
+        for (int i=0; i<10; ++i) {
+            histogram.addValue(i);
+        }
+        TEST(histogram.getPercentile(50) == 4);
+        
+        // Rare outliers
+        histogram.clear();
+        for (int i=0; i<999; ++i) {
+            histogram.addValue(300);
+        }
+        histogram.addValue(25000);
+        TEST(isWithinPrecision(histogram.getPercentile(50), 300));
+        TEST(isWithinPrecision(histogram.getPercentile(99), 300));
+        TEST(histogram.getMax() == 25000);
+        TEST(histogram.getPercentile(100) == 25000);
+
+        // Values out of range
+        histogram.clear();
+        histogram.addValue(1LL << 50);
+        histogram.addValue(-5);
+        TEST(histogram.getNumValues() == 2);
+        TEST(histogram.getMin() == 0);
+        TEST(histogram.getMax() == 1LL << 50);
+
+        // Per-frame zone statistics
+        ThreadProfiler::enableZoneStats(true);
+        TEST(ThreadProfiler::areZoneStatsEnabled());
+        ThreadProfiler* pProfiler = ThreadProfiler::get();
+        for (int i=0; i<5; ++i) {
+            {
+                ScopeTimer timer(StatsTestProfilingZone);
+            }
+            pProfiler->reset();
+        }
+        pProfiler->reset();
+        vector<ProfilingZoneStats> stats = pProfiler->getZoneStats();
+        bool bFound = false;
+        for (unsigned i=0; i<stats.size(); ++i) {
+            if (stats[i].m_sName == "StatsTestZone") {
+                bFound = true;
+                TEST(stats[i].m_NumFrames == 5);
+                TEST(stats[i].m_P50Time <= stats[i].m_P99Time);
+                TEST(stats[i].m_P99Time <= stats[i].m_MaxTime);
+            }
+        }
+        TEST(bFound);
+        ThreadProfiler::enableZoneStats(false);
+    }
+
+private:
+    bool isWithinPrecision(long long value, long long expected)
+    {
+        return value >= expected && 
+                value <= expected+expected/LatencyHistogram::NUM_SUB_BUCKETS;
     }
 };
 
@@ -348,6 +753,139 @@ public:
 };
 
 
+class FrameArenaTest: public Test
+{
+public:
+    FrameArenaTest()
+        : Test("FrameArenaTest", 2)
+    {
+    }
+
+    void runTests() 
+    {
+        FrameArena arena(256);
+        TEST(arena.getNumHeapAllocs() == 1);
+        char* p1 = (char*)arena.allocate(10);
+        char* p2 = (char*)arena.allocate(1);
+        TEST(p2-p1 == int(FrameArena::ALIGNMENT));
+        TEST(arena.getNumBytesUsed() == 2*FrameArena::ALIGNMENT);
+        arena.reset();
+        TEST(arena.getNumBytesUsed() == 0);
+        TEST(arena.allocate(10) == p1);
+
+        // Allocations that don't fit go to the heap until the next reset() grows the
+        // block.
+        arena.reset();
+        for (int i=0; i<4; ++i) {
+            arena.allocate(128);
+        }
+        TEST(arena.getNumHeapAllocs() == 3);
+        TEST(arena.getNumBytesUsed() == 512);
+        arena.reset();
+        TEST(arena.getBlockSize() == 512);
+        int numHeapAllocs = arena.getNumHeapAllocs();
+        for (int i=0; i<4; ++i) {
+            arena.allocate(128);
+        }
+        arena.reset();
+        TEST(arena.getNumHeapAllocs() == numHeapAllocs);
+        TEST(arena.getNumBytesAllocated() == 2*16+16+2*512);
+
+        // Containers
+        {
+            FrameVector<string>::type strings =
+                    FrameVector<string>::type(FrameArenaAllocator<string>(arena));
+            for (int i=0; i<100; ++i) {
+                strings.push_back(toString(i));
+            }
+            TEST(strings.size() == 100);
+            TEST(strings[99] == "99");
+            FrameVector<string>::type stringsCopy = strings;
+            TEST(stringsCopy[50] == "50");
+        }
+        TEST(arena.getNumBytesUsed() > 100*sizeof(string));
+        arena.reset();
+    }
+};
+
+class TimeSourceTest: public Test
+{
+public:
+    TimeSourceTest()
+        : Test("TimeSourceTest", 2)
+    {
+    }
+
+    void runTests() 
+    {
+        TimeSource* pTimeSource = TimeSource::get();
+        long long lastTime = pTimeSource->getCurrentMicrosecs();
+        bool bMonotonic = true;
+        for (int i=0; i<10000; ++i) {
+            long long curTime = pTimeSource->getCurrentMicrosecs();
+            if (curTime < lastTime) {
+                bMonotonic = false;
+            }
+            lastTime = curTime;
+        }
+        TEST(bMonotonic);
+        long long startTime = pTimeSource->getCurrentMillisecs();
+        msleep(20);
+        long long elapsed = pTimeSource->getCurrentMillisecs()-startTime;
+        TEST(elapsed >= 19 && elapsed < 200);
+
+        pTimeSource->setFrameStartTime();
+        long long frameStartTime = pTimeSource->getFrameStartMicrosecs();
+        TEST(frameStartTime >= lastTime);
+        msleep(2);
+        TEST(pTimeSource->getFrameStartMicrosecs() == frameStartTime);
+        TEST(pTimeSource->getFrameStartMillisecs() == frameStartTime/1000);
+        pTimeSource->setFrameStartTime();
+        TEST(pTimeSource->getFrameStartMicrosecs() > frameStartTime);
+
+        // Per-call cost of the different clocks.
+#if !defined(_WIN32) && !defined(__APPLE__)
+        benchmark("clock_gettime(CLOCK_MONOTONIC)", &getMonotonicClock);
+#endif
+        benchmark("TimeSource::getCurrentMicrosecs", &getTimeSourceClock);
+        benchmark("TimeSource::getFrameStartMicrosecs", &getFrameStartTime);
+    }
+
+private:
+    void benchmark(const string& sName, long long (*pFunc)())
+    {
+        const int NUM_CALLS = 1000000;
+        long long startTime = TimeSource::get()->getCurrentMicrosecs();
+        long long sum = 0;
+        for (int i=0; i<NUM_CALLS; ++i) {
+            sum += pFunc();
+        }
+        long long time = TimeSource::get()->getCurrentMicrosecs()-startTime;
+        TEST(sum != 0);
+        cerr << "    " << sName << ": " << (time*1000.f)/NUM_CALLS << " ns/call"
+                << endl;
+    }
+
+#if !defined(_WIN32) && !defined(__APPLE__)
+    static long long getMonotonicClock()
+    {
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        return ((long long)now.tv_sec)*1000000+now.tv_nsec/1000;
+    }
+#endif
+
+    static long long getTimeSourceClock()
+    {
+        return TimeSource::get()->getCurrentMicrosecs();
+    }
+
+    static long long getFrameStartTime()
+    {
+        return TimeSource::get()->getFrameStartMicrosecs();
+    }
+};
+
 class ObjectCounterTest: public Test {
 public:
     ObjectCounterTest()
@@ -364,6 +902,51 @@ public:
             TEST(ObjectCounter::get()->getCount(&typeid(dummy1)) == 2);
         }
         TEST(ObjectCounter::get()->getCount(&typeid(DummyClass)) == 0);
+
+        // Objects created and deleted in different threads.
+        vector<DummyClass*> pDummies;
+        boost::thread createThread(boost::bind(&ObjectCounterTest::createDummies,
+                &pDummies, 100));
+        createThread.join();
+        TEST(ObjectCounter::get()->getCount(&typeid(DummyClass)) == 100);
+        TEST(ObjectCounter::get()->getObjectCount()[&typeid(DummyClass)] == 100);
+        boost::thread deleteThread(boost::bind(&ObjectCounterTest::deleteDummies,
+                &pDummies));
+        deleteThread.join();
+        TEST(ObjectCounter::get()->getCount(&typeid(DummyClass)) == 0);
+
+        // Many threads concurrently.
+        boost::thread_group threads;
+        for (int i=0; i<8; ++i) {
+            threads.create_thread(&ObjectCounterTest::createAndDeleteDummies);
+        }
+        threads.join_all();
+        TEST(ObjectCounter::get()->getCount(&typeid(DummyClass)) == 0);
+    }
+
+private:
+    static void createDummies(vector<DummyClass*>* pDummies, int numDummies)
+    {
+        for (int i=0; i<numDummies; ++i) {
+            pDummies->push_back(new DummyClass);
+        }
+    }
+
+    static void deleteDummies(vector<DummyClass*>* pDummies)
+    {
+        for (unsigned i=0; i<pDummies->size(); ++i) {
+            delete (*pDummies)[i];
+        }
+        pDummies->clear();
+    }
+
+    static void createAndDeleteDummies()
+    {
+        vector<DummyClass*> pDummies;
+        for (int i=0; i<1000; ++i) {
+            createDummies(&pDummies, 10);
+            deleteDummies(&pDummies);
+        }
     }
 };
 
@@ -979,6 +1562,100 @@ public:
                 TEST(buffer.str().find(msg_critical) != string::npos);
             buffer.str(string());
         }
+        {
+            category_t CUSTOM_CAT = logger->configureCategory("CUSTOM_CAT 2",
+                    Logger::severity::DEBUG);
+            TEST(logger->shouldLog(CUSTOM_CAT, Logger::severity::DEBUG));
+            TEST(!logger->shouldLog(Logger::category::NONE, Logger::severity::DEBUG));
+            logger->configureCategory(CUSTOM_CAT, Logger::severity::ERROR);
+            TEST(!logger->shouldLog(CUSTOM_CAT, Logger::severity::WARNING));
+            TEST(logger->shouldLog(CUSTOM_CAT, Logger::severity::ERROR));
+            TEST(logger->getCategories()[CUSTOM_CAT] == Logger::severity::ERROR);
+            int customCatIndex = logger->getCategoryIndex(CUSTOM_CAT);
+            TEST(logger->getCategoryName(customCatIndex) == CUSTOM_CAT);
+            TEST(!logger->shouldLog(customCatIndex, Logger::severity::WARNING));
+            TEST(logger->shouldLog(customCatIndex, Logger::severity::ERROR));
+            bool bExceptionThrown = false;
+            try {
+                logger->shouldLog("UNKNOWN_CAT", Logger::severity::CRITICAL);
+            } catch (const Exception& e) {
+                bExceptionThrown = (e.getCode() == AVG_ERR_INVALID_ARGS);
+            }
+            TEST(bExceptionThrown);
+        }
+    }
+};
+
+
+class TestLogSink: public ILogSink
+{
+public:
+    virtual void logMessage(const tm* pTime, unsigned millis, const category_t& category,
+            severity_t severity, const UTF8String& sMsg)
+    {
+        boost::mutex::scoped_lock lock(m_Mutex);
+        m_sMsgs.push_back(sMsg);
+    }
+
+    vector<string> m_sMsgs;
+    boost::mutex m_Mutex;
+};
+
+typedef boost::shared_ptr<TestLogSink> TestLogSinkPtr;
+
+
+class AsyncLogSinkTest: public Test
+{
+public:
+    AsyncLogSinkTest()
+      : Test("AsyncLogSinkTest", 2)
+    {
+    }
+
+    void runTests()
+    {
+        time_t now = time(0);
+        tm* pTime = localtime(&now);
+        {
+            TestLogSinkPtr pTestSink(new TestLogSink);
+            {
+                AsyncLogSink asyncSink(pTestSink);
+                for (int i=0; i<100; ++i) {
+                    asyncSink.logMessage(pTime, 0, Logger::category::APP, 
+                            Logger::severity::INFO, toString(i));
+                }
+                TEST(asyncSink.getNumDroppedMessages() == 0);
+            }
+            TEST(pTestSink->m_sMsgs.size() == 100);
+            bool bInOrder = true;
+            for (unsigned i=0; i<pTestSink->m_sMsgs.size(); ++i) {
+                bInOrder &= (pTestSink->m_sMsgs[i] == toString(i));
+            }
+            TEST(bInOrder);
+        }
+        {
+            // Blocked sink: messages must be dropped instead of blocking the caller.
+            TestLogSinkPtr pTestSink(new TestLogSink);
+            int numDropped;
+            {
+                AsyncLogSink asyncSink(pTestSink, 4);
+                {
+                    boost::mutex::scoped_lock lock(pTestSink->m_Mutex);
+                    for (int i=0; i<20; ++i) {
+                        asyncSink.logMessage(pTime, 0, Logger::category::APP,
+                                Logger::severity::INFO, "msg");
+                    }
+                    numDropped = asyncSink.getNumDroppedMessages();
+                    TEST(numDropped > 0);
+                }
+            }
+            vector<string>& sMsgs = pTestSink->m_sMsgs;
+            int numDelivered = count(sMsgs.begin(), sMsgs.end(), "msg");
+            TEST(numDelivered + numDropped == 20);
+            string sNotice = "Log queue full, " + toString(numDropped) + 
+                    " messages dropped.";
+            TEST(count(sMsgs.begin(), sMsgs.end(), sNotice) == 1);
+        }
     }
 };
 
@@ -989,8 +1666,14 @@ public:
         : TestSuite("BaseTestSuite")
     {
         addTest(TestPtr(new DAGTest));
-        addTest(TestPtr(new QueueTest));
+        addTest(TestPtr(new QueueTest<Queue>("QueueTest")));
+        addTest(TestPtr(new LockFreeQueueTest));
         addTest(TestPtr(new WorkerThreadTest));
+        addTest(TestPtr(new TaskSchedulerTest));
+        addTest(TestPtr(new TraceRecorderTest));
+        addTest(TestPtr(new LatencyHistogramTest));
+        addTest(TestPtr(new FrameArenaTest));
+        addTest(TestPtr(new TimeSourceTest));
         addTest(TestPtr(new ObjectCounterTest));
         addTest(TestPtr(new GeomTest));
         addTest(TestPtr(new TriangleTest));
@@ -1004,6 +1687,7 @@ public:
         addTest(TestPtr(new PolygonTest));
         addTest(TestPtr(new XmlParserTest));
         addTest(TestPtr(new StandardLoggerTest));
+        addTest(TestPtr(new AsyncLogSinkTest));
     }
 };
 
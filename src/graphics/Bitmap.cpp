@@ -24,6 +24,9 @@
 #include "Pixel16.h"
 #include "Pixel8.h"
 #include "Filter3x3.h"
+#include "PixelKernels.h"
+#include "ImageStats.h"
+#include "BitmapCache.h"
 
 #include "../base/Exception.h"
 #include "../base/Logger.h"
@@ -32,9 +35,12 @@
 #include "../base/MathHelper.h"
 #include "../base/FileHelper.h"
 #include "../base/OSHelper.h"
+#include "../base/TaskScheduler.h"
 
 #include <gdk-pixbuf/gdk-pixbuf.h>
 
+#include <boost/bind.hpp>
+
 #include <cstring>
 #include <iostream>
 #include <iomanip>
@@ -47,11 +53,14 @@ namespace avg {
 template<class Pixel>
 void createTrueColorCopy(Bitmap& destBmp, const Bitmap & srcBmp);
 
+// Minimum number of pixels per band when converting YUV frames in parallel.
+static const int MIN_PARALLEL_YUV_PIXELS = 1920*1088;
+
 Bitmap::Bitmap(glm::vec2 size, PixelFormat pf, const UTF8String& sName, int stride)
     : m_Size(size),
       m_PF(pf),
       m_pBits(0),
-      m_bOwnsBits(true),
+      m_bIsView(false),
       m_sName(sName)
 {
     ObjectCounter::get()->incRef(&typeid(*this));
@@ -62,7 +71,7 @@ Bitmap::Bitmap(IntPoint size, PixelFormat pf, const UTF8String& sName, int strid
     : m_Size(size),
       m_PF(pf),
       m_pBits(0),
-      m_bOwnsBits(true),
+      m_bIsView(false),
       m_sName(sName)
 {
     ObjectCounter::get()->incRef(&typeid(*this));
@@ -74,43 +83,71 @@ Bitmap::Bitmap(IntPoint size, PixelFormat pf, unsigned char* pBits,
     : m_Size(size),
       m_PF(pf),
       m_pBits(0),
+      m_bIsView(false),
       m_sName(sName)
 {
     ObjectCounter::get()->incRef(&typeid(*this));
     initWithData(pBits, stride, bCopyBits);
 }
 
+Bitmap::Bitmap(IntPoint size, PixelFormat pf, PixelBufferPtr pBuffer,
+        unsigned char* pBits, int stride, const UTF8String& sName)
+    : m_Size(size),
+      m_Stride(stride),
+      m_PF(pf),
+      m_pBits(pBits),
+      m_pBuffer(pBuffer),
+      m_bIsView(false),
+      m_sName(sName)
+{
+    ObjectCounter::get()->incRef(&typeid(*this));
+    AVG_ASSERT(pBuffer);
+    if (!m_pBits) {
+        m_pBits = pBuffer->getBits();
+    }
+    AVG_ASSERT(m_pBits >= pBuffer->getBits());
+    AVG_ASSERT(m_pBits+size_t(m_Stride)*(m_Size.y-1)+getLineLen() <=
+            pBuffer->getBits()+pBuffer->getSize());
+}
+
 Bitmap::Bitmap(const Bitmap& origBmp)
     : m_Size(origBmp.getSize()),
       m_PF(origBmp.getPixelFormat()),
       m_pBits(0),
-      m_bOwnsBits(origBmp.m_bOwnsBits),
+      m_bIsView(false),
       m_sName(origBmp.getName()+" copy")
 {
     ObjectCounter::get()->incRef(&typeid(*this));
-    initWithData(const_cast<unsigned char *>(origBmp.getPixels()), origBmp.getStride(), 
-            m_bOwnsBits);
+    initFromBitmap(origBmp);
 }
 
 Bitmap::Bitmap(const Bitmap& origBmp, bool bOwnsBits)
     : m_Size(origBmp.getSize()),
       m_PF(origBmp.getPixelFormat()),
       m_pBits(0),
-      m_bOwnsBits(bOwnsBits),
+      m_bIsView(false),
       m_sName(origBmp.getName()+" copy")
 {
     ObjectCounter::get()->incRef(&typeid(*this));
-    initWithData(const_cast<unsigned char *>(origBmp.getPixels()), origBmp.getStride(), 
-            m_bOwnsBits);
+    if (bOwnsBits) {
+        if (origBmp.m_pBuffer) {
+            initFromBitmap(origBmp);
+        } else {
+            initWithData(const_cast<unsigned char *>(origBmp.getPixels()),
+                    origBmp.getStride(), true);
+        }
+    } else {
+        initView(origBmp, const_cast<unsigned char *>(origBmp.getPixels()));
+    }
 }
 
-// Creates a bitmap that is a rectangle in another bitmap. The pixels are
-// still owned by the original bitmap.
+// Creates a bitmap that is a rectangle in another bitmap. The pixels are shared
+// with the original bitmap.
 Bitmap::Bitmap(Bitmap& origBmp, const IntRect& rect)
     : m_Size(rect.size()),
       m_PF(origBmp.getPixelFormat()),
       m_pBits(0),
-      m_bOwnsBits(false)
+      m_bIsView(false)
 {
     ObjectCounter::get()->incRef(&typeid(*this));
     AVG_ASSERT(rect.br.x <= origBmp.getSize().x);
@@ -124,31 +161,25 @@ Bitmap::Bitmap(Bitmap& origBmp, const IntRect& rect)
     }
     unsigned char * pRegionStart = origBmp.getPixels()
             + size_t(rect.tl.y)*origBmp.getStride() + rect.tl.x*getBytesPerPixel();
-    initWithData(pRegionStart, origBmp.getStride(), false);
+    initView(origBmp, pRegionStart);
 }
 
 Bitmap::~Bitmap()
 {
     ObjectCounter::get()->decRef(&typeid(*this));
-    if (m_bOwnsBits) {
-        delete[] m_pBits;
-        m_pBits = 0;
-    }
+    releaseBits();
 }
 
 Bitmap &Bitmap::operator =(const Bitmap& origBmp)
 {
     if (this != &origBmp) {
-        if (m_bOwnsBits) {
-            delete[] m_pBits;
-            m_pBits = 0;
-        }
+        // Keeps the pixels alive if origBmp is a view of this bitmap.
+        PixelBufferPtr pOldBuffer = m_pBuffer;
+        releaseBits();
         m_Size = origBmp.getSize();
         m_PF = origBmp.getPixelFormat();
-        m_bOwnsBits = origBmp.m_bOwnsBits;
         m_sName = origBmp.getName();
-        initWithData(const_cast<unsigned char *>(origBmp.getPixels()),
-                origBmp.getStride(), m_bOwnsBits);
+        initFromBitmap(origBmp);
     }
     return *this;
 }
@@ -157,6 +188,7 @@ void Bitmap::copyPixels(const Bitmap& origBmp)
 {
 //    cerr << "Bitmap::copyPixels(): " << getPixelFormatString(origBmp.getPixelFormat())
 //            << "->" << getPixelFormatString(m_PF) << endl;
+    makeWritable();
     if (&origBmp == this || origBmp.getPixels() == m_pBits) {
         return;
     }
@@ -304,214 +336,102 @@ void Bitmap::copyPixels(const Bitmap& origBmp)
     }
 }
 
-#if defined(__SSE__) || defined(_WIN32)
-ostream& operator<<(ostream& os, const __m64 &val)
+void Bitmap::copyPixelsSwapRB(const Bitmap& origBmp)
 {
-    unsigned char * pVal = (unsigned char *)(&val);
-    for (int i = 0; i < 8; ++i) {
-        os << hex << setw(2) << setfill('0') << int(pVal[i]);
-        if (i%2 == 1) {
-            os << " ";
+    int srcBPP = origBmp.getBytesPerPixel();
+    int destBPP = getBytesPerPixel();
+    AVG_ASSERT(srcBPP == 3 || srcBPP == 4);
+    bool bInPlace = (&origBmp == this || origBmp.getPixels() == m_pBits);
+    AVG_ASSERT(!bInPlace || srcBPP == destBPP);
+    makeWritable();
+    const PixelKernels& kernels = getPixelKernels();
+    const unsigned char * pSrcLine = origBmp.getPixels();
+    unsigned char * pDestLine = m_pBits;
+    int height = min(origBmp.getSize().y, m_Size.y);
+    int width = min(origBmp.getSize().x, m_Size.x);
+    int srcStride = origBmp.getStride();
+    if (srcBPP == 4 && destBPP == 4) {
+        for (int y = 0; y < height; ++y) {
+            kernels.m_SwapRB32Line(pSrcLine, pDestLine, width);
+            pSrcLine += srcStride;
+            pDestLine += m_Stride;
         }
-        if (i%4 == 3) {
-            os << " ";
+    } else if (srcBPP == 3 && destBPP == 3) {
+        for (int y = 0; y < height; ++y) {
+            kernels.m_SwapRB24Line(pSrcLine, pDestLine, width);
+            pSrcLine += srcStride;
+            pDestLine += m_Stride;
         }
+    } else if (srcBPP == 4 && destBPP == 3) {
+        for (int y = 0; y < height; ++y) {
+            kernels.m_Color32to24Line(pSrcLine, pDestLine, width, true);
+            pSrcLine += srcStride;
+            pDestLine += m_Stride;
+        }
+    } else if (srcBPP == 3 && destBPP == 4) {
+        for (int y = 0; y < height; ++y) {
+            kernels.m_Color24to32Line(pSrcLine, pDestLine, width, true);
+            pSrcLine += srcStride;
+            pDestLine += m_Stride;
+        }
+    } else if (srcBPP == 4 && destBPP == 2) {
+        for (int y = 0; y < height; ++y) {
+            kernels.m_Color32to16Line(pSrcLine, (unsigned short*)pDestLine, width, 
+                    true);
+            pSrcLine += srcStride;
+            pDestLine += m_Stride;
+        }
+    } else {
+        // No fused kernel for this combination.
+        Bitmap tempBmp(origBmp.getSize(), origBmp.getPixelFormat(), "TempSwapRB");
+        tempBmp.copyPixelsSwapRB(origBmp);
+        copyPixels(tempBmp);
     }
-    return os;
-}
-#endif
-
-#define YUV_TO_RGB_UNPACK    \
-    /* Input: r, g, b contain 4 words each of the u and v inputs for the color */    \
-    /* channels. ylo and yhi contain 4 words each of the y input. */    \
-\
-    /* duplicate u and v channels and add y    \
-     * each of r,g, b in the form [s1(16), s2(16), s3(16), s4(16)]    \
-     * first interleave, so tmp is [s1(16), s1(16), s2(16), s2(16)]    \
-     * then add y, then interleave again    \
-     * then pack with saturation, to get the desired output of    \
-     *   [s1(8), s1(8), s2(8), s2(8), s3(8), s3(8), s4(8), s4(8)]    \
-     */    \
-    tmp = _m_punpckhwd(r, r);    \
-    tmp = _m_paddsw(tmp, yhi);    \
-    tmp2 = _m_punpcklwd(r, r);    \
-    tmp2 = _m_paddsw(tmp2, ylo);    \
-    r = _m_packuswb(tmp2, tmp);    \
-    \
-    tmp = _m_punpckhwd(g, g);    \
-    tmp2 = _m_punpcklwd(g, g);    \
-    tmp = _m_paddsw(tmp, yhi);    \
-    tmp2 = _m_paddsw(tmp2, ylo);    \
-    g = _m_packuswb(tmp2, tmp);    \
-    \
-    tmp = _m_punpckhwd(b, b);    \
-    tmp2 = _m_punpcklwd(b, b);    \
-    tmp = _m_paddsw(tmp, yhi);    \
-    tmp2 = _m_paddsw(tmp2, ylo);    \
-    b = _m_packuswb(tmp2, tmp);    \
-    \
-    /* now we have 8 8-bit r, g and b samples.  we want these to be packed    \
-     * into 32-bit values.    \
-     */    \
-    imm = _mm_set1_pi32(0xFFFFFFFF);    \
-    tmp = _m_punpcklbw(b, r);    \
-    tmp2 = _m_punpcklbw(g, imm);    \
-    *o++ = _m_punpcklbw(tmp, tmp2);    \
-    *o++ = _m_punpckhbw(tmp, tmp2);    \
-    tmp = _m_punpckhbw(b, r);    \
-    tmp2 = _m_punpckhbw(g, imm);    \
-    *o++ = _m_punpcklbw(tmp, tmp2);    \
-    *o++ = _m_punpckhbw(tmp, tmp2);
-
+}
 
 void Bitmap::copyYUVPixels(const Bitmap& yBmp, const Bitmap& uBmp, const Bitmap& vBmp,
-        bool bJPEG)
+        bool bJPEG, bool bChroma422)
 {
+    AVG_ASSERT(getBytesPerPixel() == 4);
+    makeWritable();
     int height = min(yBmp.getSize().y, m_Size.y);
     int width = min(yBmp.getSize().x, m_Size.x);
 
-    int yStride = yBmp.getStride();
-    int uStride = uBmp.getStride();
-    int vStride = vBmp.getStride();
-    int destStride = m_Stride/getBytesPerPixel();
-    Pixel32 * pDestLine = (Pixel32*)m_pBits;
-
-#if defined(__SSE__) || defined(_WIN32)
-#pragma pack(16)
-    // Original SSE conversion code taken from liboggplay: oggplay_sse_x86.c
-    int               i;     
-    const unsigned char   * ptry;
-    const unsigned char   * ptru;
-    const unsigned char   * ptrv;
-
-    register __m64    *o;
-    register __m64    y, ylo, yhi;
-    register __m64    zero, ut, vt, imm;
-    register __m64    r, g, b;
-    register __m64    tmp, tmp2;
-
-    zero = _mm_setzero_si64(); 
-
-    ptry = yBmp.getPixels();
-    ptru = uBmp.getPixels();
-    ptrv = vBmp.getPixels();
-
-    for (i = 0; i < height; i++) {
-        int j;
-        o = (__m64*)pDestLine;
-        pDestLine += destStride;
-        if (bJPEG) {
-            for (j = 0; j < width; j += 8) {
-                // ylo and yhi contain 4 pixels each
-                y = *(__m64*)(&(ptry[j]));
-                ylo = _m_punpcklbw(y, zero);
-               
-                yhi = _m_punpckhbw(y, zero);
-
-                ut = _m_from_int(*(int *)(ptru + j/2));
-                vt = _m_from_int(*(int *)(ptrv + j/2));
-
-                ut = _m_punpcklbw(ut, zero);
-                vt = _m_punpcklbw(vt, zero);
-
-                /* subtract 128 from u and v */ 
-                imm = _mm_set1_pi16(128);
-                ut = _m_psubw(ut, imm);
-                vt = _m_psubw(vt, imm);
-
-                /* transfer and multiply into r, g, b registers */
-                imm = _mm_set1_pi16(-44);
-                g = _m_pmullw(ut, imm);
-                imm = _mm_set1_pi16(113);
-                b = _m_pmullw(ut, imm);
-                imm = _mm_set1_pi16(179);
-                r = _m_pmullw(vt, imm);
-                imm = _mm_set1_pi16(-91);
-                imm = _m_pmullw(vt, imm);
-                g = _m_paddsw(g, imm);
-
-                /* shift r, g and b registers to the right */
-                r = _m_psrawi(r, 7);
-                g = _m_psrawi(g, 7);
-                b = _m_psrawi(b, 6);
-                YUV_TO_RGB_UNPACK
-
-            }
-        } else {
-            for (j = 0; j < width; j += 8) {
-
-                // y' = (298*(y-16))
-                // ylo and yhi contain 4 pixels each
-                y = *(__m64*)(&(ptry[j]));
-                ylo = _m_punpcklbw(y, zero);
-                imm = _mm_set1_pi16(16);
-                ylo = _m_psubusw(ylo, imm);
-                imm = _mm_set1_pi16(149);
-                ylo = _m_pmullw(ylo, imm);
-                ylo = _mm_srli_pi16(ylo, 7);
-               
-                yhi = _m_punpckhbw(y, zero);
-                imm = _mm_set1_pi16(16);
-                yhi = _m_psubusw(yhi, imm);
-                imm = _mm_set1_pi16(149);
-                yhi = _m_pmullw(yhi, imm);
-                yhi = _mm_srli_pi16(yhi, 7);
-
-                ut = _m_from_int(*(int *)(ptru + j/2));
-                vt = _m_from_int(*(int *)(ptrv + j/2));
-
-                ut = _m_punpcklbw(ut, zero);
-                vt = _m_punpcklbw(vt, zero);
-
-                /* subtract 128 from u and v */ 
-                imm = _mm_set1_pi16(128);
-                ut = _m_psubw(ut, imm);
-                vt = _m_psubw(vt, imm);
-
-                /* transfer and multiply into r, g, b registers */
-                imm = _mm_set1_pi16(-50);
-                g = _m_pmullw(ut, imm);
-                imm = _mm_set1_pi16(129);
-                b = _m_pmullw(ut, imm);
-                imm = _mm_set1_pi16(204);
-                r = _m_pmullw(vt, imm);
-                imm = _mm_set1_pi16(-104);
-                imm = _m_pmullw(vt, imm);
-                g = _m_paddsw(g, imm);
-
-                /* shift r, g and b registers to the right */
-                r = _m_psrawi(r, 7);
-                g = _m_psrawi(g, 7);
-                b = _m_psrawi(b, 6);
-                YUV_TO_RGB_UNPACK
-            }
+    // Large frames are split into bands of lines that are converted in parallel.
+    // Band boundaries are on even lines so 4:2:0 chroma lines aren't shared.
+    int numBands = min(TaskScheduler::get()->getNumThreads()+1,
+            width*height/MIN_PARALLEL_YUV_PIXELS);
+    if (numBands > 1) {
+        int bandHeight = (height/numBands) & ~1;
+        vector<TaskPtr> pTasks;
+        for (int i = 1; i < numBands; ++i) {
+            int endLine = (i == numBands-1) ? height : (i+1)*bandHeight;
+            pTasks.push_back(TaskScheduler::get()->submit(boost::bind(
+                    &Bitmap::copyYUVLines, this, boost::cref(yBmp), boost::cref(uBmp),
+                    boost::cref(vBmp), bJPEG, bChroma422, i*bandHeight, endLine),
+                    Task::HIGH));
         }
-        if (i & 0x1) {
-            ptru += uStride;
-            ptrv += vStride;
+        copyYUVLines(yBmp, uBmp, vBmp, bJPEG, bChroma422, 0, bandHeight);
+        for (unsigned i = 0; i < pTasks.size(); ++i) {
+            pTasks[i]->wait();
         }
-        ptry += yStride;
+    } else {
+        copyYUVLines(yBmp, uBmp, vBmp, bJPEG, bChroma422, 0, height);
     }
-    _m_empty();
-#pragma pack()
-#else
-    AVG_ASSERT(m_PF==B8G8R8X8);
-    const unsigned char * pYSrc = yBmp.getPixels();
-    const unsigned char * pUSrc = uBmp.getPixels();
-    const unsigned char * pVSrc = vBmp.getPixels();
+}
 
-    for (int y = 0; y < height; ++y) {
-        for (int x = 0; x < width; ++x) {
-            YUVtoBGR32Pixel(pDestLine + x, pYSrc[x], pUSrc[x/2], pVSrc[x/2]);
-        }
-        pDestLine += destStride;
-        pYSrc += yStride;
-        if (y % 2 == 1) {
-            pUSrc += uStride;
-            pVSrc += vStride;
-        }
+void Bitmap::copyYUVLines(const Bitmap& yBmp, const Bitmap& uBmp, const Bitmap& vBmp,
+        bool bJPEG, bool bChroma422, int startLine, int endLine)
+{
+    int width = min(yBmp.getSize().x, m_Size.x);
+    const PixelKernels& kernels = getPixelKernels();
+    for (int y = startLine; y < endLine; ++y) {
+        int chromaLine = bChroma422 ? y : y/2;
+        kernels.m_PlanarYUVtoBGR32Line(yBmp.getPixels()+y*yBmp.getStride(),
+                uBmp.getPixels()+chromaLine*uBmp.getStride(),
+                vBmp.getPixels()+chromaLine*vBmp.getStride(),
+                m_pBits+y*m_Stride, width, bJPEG);
     }
-#endif
 }
 
 void Bitmap::save(const UTF8String& sFilename)
@@ -579,6 +499,8 @@ void Bitmap::save(const UTF8String& sFilename)
     gboolean bOk = gdk_pixbuf_save(pPixBuf, sFilename.c_str(), sExt.c_str(), &pError, 
             NULL);
     g_object_unref(pPixBuf);
+    // Don't rely on the file time to notice that the file has changed.
+    BitmapCache::get()->invalidate(sFilename);
     if (!bOk) {
         string sErr = pError->message;
         g_error_free(pError);
@@ -610,6 +532,7 @@ void Bitmap::setPixelFormat(PixelFormat pf)
 
 unsigned char* Bitmap::getPixels()
 {
+    makeWritable();
     return m_pBits;
 }
 
@@ -620,6 +543,7 @@ const unsigned char* Bitmap::getPixels() const
 
 void Bitmap::setPixels(const unsigned char* pPixels)
 {
+    makeWritable();
     memcpy(m_pBits, pPixels, getMemNeeded());
 }
 
@@ -630,9 +554,16 @@ const string& Bitmap::getName() const
 
 bool Bitmap::ownsBits() const
 {
-    return m_bOwnsBits;
+    return m_pBuffer && !m_bIsView;
+}
+
+bool Bitmap::isShared() const
+{
+    return m_pBuffer && !m_bIsView && !m_pBuffer.unique() && 
+            m_pBuffer->getNumViews() == 0;
 }
 
+
 int Bitmap::getBytesPerPixel() const
 {
     return avg::getBytesPerPixel(m_PF);
@@ -661,44 +592,22 @@ bool Bitmap::hasAlpha() const
 HistogramPtr Bitmap::getHistogram(int stride) const
 {
     AVG_ASSERT (getBytesPerPixel() == 1);
-    HistogramPtr pHist(new Histogram(256,0));
-    const unsigned char * pSrcLine = m_pBits;
-    for (int y = 0; y < m_Size.y; y += stride) {
-        const unsigned char * pSrc = pSrcLine;
-        for (int x = 0; x < m_Size.x; x += stride) {
-            (*pHist)[(*pSrc)]++;
-            pSrc += stride;
-        }
-        pSrcLine += m_Stride*stride;
-    }
-    return pHist;
+    return ImageStats(*this, stride).getHistogram();
 }
 
 void Bitmap::getMinMax(int stride, int& min, int& max) const
 {
     AVG_ASSERT (getBytesPerPixel() == 1);
-    const unsigned char * pSrcLine = m_pBits;
-    min = 255;
-    max = 0;
-    for (int y = 0; y < m_Size.y; y += stride) {
-        const unsigned char * pSrc = pSrcLine;
-        for (int x = 0; x < m_Size.x; x += stride) {
-            if (*pSrc < min) {
-                min = *pSrc;
-            }
-            if (*pSrc > max) {
-                max = *pSrc;
-            }
-            pSrc += stride;
-        }
-        pSrcLine += m_Stride*stride;
-    }
+    ImageStats stats(*this, stride);
+    min = stats.getMin();
+    max = stats.getMax();
 }
 
 void Bitmap::setAlpha(const Bitmap& alphaBmp)
 {
     AVG_ASSERT(hasAlpha());
     AVG_ASSERT(alphaBmp.getBytesPerPixel() == 1);
+    makeWritable();
     unsigned char * pLine = m_pBits;
     const unsigned char * pAlphaLine = alphaBmp.getPixels();
     for (int y = 0; y < m_Size.y; y++) {
@@ -798,7 +707,6 @@ BitmapPtr Bitmap::subtract(const Bitmap& otherBmp)
     const unsigned char * pSrcLine1 = otherBmp.getPixels();
     const unsigned char * pSrcLine2 = m_pBits;
     unsigned char * pDestLine = pResultBmp->getPixels();
-    int stride = getStride();
     int lineLen = getLineLen();
 
     for (int y = 0; y < getSize().y; ++y) {
@@ -829,9 +737,9 @@ BitmapPtr Bitmap::subtract(const Bitmap& otherBmp)
                     }
                 }
         }
-        pSrcLine1 += stride;
-        pSrcLine2 += stride;
-        pDestLine += stride;
+        pSrcLine1 += otherBmp.getStride();
+        pSrcLine2 += m_Stride;
+        pDestLine += pResultBmp->getStride();
     }
     return pResultBmp;
 }
@@ -1041,7 +949,8 @@ void Bitmap::dump(bool bDumpPixels) const
     cerr << "  m_Stride: " << m_Stride << endl;
     cerr << "  m_PF: " << getPixelFormatString(m_PF) << endl;
     cerr << "  m_pBits: " << (void *)m_pBits << endl;
-    cerr << "  m_bOwnsBits: " << m_bOwnsBits << endl;
+    cerr << "  ownsBits: " << ownsBits() << ", view: " << m_bIsView << ", shared: "
+            << isShared() << endl;
     IntPoint max;
     if (bDumpPixels) {
         max = m_Size;
@@ -1104,14 +1013,55 @@ void Bitmap::initWithData(unsigned char * pBits, int stride, bool bCopyBits)
                 memcpy(m_pBits+m_Stride*y, pBits+stride*y, m_Stride);
             }
         }
-        m_bOwnsBits = true;
     } else {
         m_pBits = pBits;
         m_Stride = stride;
-        m_bOwnsBits = false;
     }
 }
 
+void Bitmap::initFromBitmap(const Bitmap& origBmp)
+{
+    if (!origBmp.m_pBuffer) {
+        // origBmp doesn't own its pixels, so neither does the copy.
+        initWithData(const_cast<unsigned char *>(origBmp.getPixels()),
+                origBmp.getStride(), false);
+    } else if (origBmp.m_bIsView || origBmp.m_pBuffer->getNumViews() > 0) {
+        // Buffers with views are modified in place, so they can't be shared by copies.
+        initWithData(const_cast<unsigned char *>(origBmp.getPixels()),
+                origBmp.getStride(), true);
+    } else {
+        m_pBuffer = origBmp.m_pBuffer;
+        m_pBits = origBmp.m_pBits;
+        m_Stride = origBmp.m_Stride;
+    }
+}
+
+void Bitmap::initView(const Bitmap& origBmp, unsigned char* pBits)
+{
+    m_Stride = origBmp.getStride();
+    m_pBits = pBits;
+    if (origBmp.m_pBuffer) {
+        // The view must see changes made through origBmp, so origBmp can't keep
+        // sharing its pixels with copies.
+        ptrdiff_t offset = pBits - origBmp.m_pBits;
+        const_cast<Bitmap&>(origBmp).makeWritable();
+        m_pBits = origBmp.m_pBits + offset;
+        m_pBuffer = origBmp.m_pBuffer;
+        m_pBuffer->addView();
+        m_bIsView = true;
+    }
+}
+
+void Bitmap::releaseBits()
+{
+    if (m_bIsView) {
+        m_pBuffer->removeView();
+        m_bIsView = false;
+    }
+    m_pBuffer = PixelBufferPtr();
+    m_pBits = 0;
+}
+
 void Bitmap::allocBits(int stride)
 {
     AVG_ASSERT(!m_pBits);
@@ -1135,80 +1085,23 @@ void Bitmap::allocBits(int stride)
         //XXX: We allocate more than nessesary here because ffmpeg seems to
         // overwrite memory after the bits - probably during yuv conversion.
         // Yuck.
-        m_pBits = new unsigned char[size_t(m_Stride+1)*(m_Size.y+1)];
+        m_pBuffer = PixelBufferPtr(new PixelBuffer(size_t(m_Stride+1)*(m_Size.y+1)));
     } else {
-        m_pBits = new unsigned char[size_t(m_Stride)*m_Size.y];
+        m_pBuffer = PixelBufferPtr(new PixelBuffer(size_t(m_Stride)*m_Size.y));
     }
+    m_pBits = m_pBuffer->getBits();
 }
 
-void YUYV422toBGR32Line(const unsigned char* pSrcLine, Pixel32* pDestLine, int width)
+void Bitmap::detach()
 {
-    Pixel32 * pDestPixel = pDestLine;
-    
-    // We need the previous and next values to interpolate between the
-    // sampled u and v values.
-    int v = *(pSrcLine+3);
-    int v0; // Previous v
-    int u;
-    int u1; // Next u;
-    const unsigned char * pSrcPixels = pSrcLine;
-
-    for (int x = 0; x < width/2-1; x++) {
-        // Two pixels at a time.
-        // Source format is YUYV.
-        u = pSrcPixels[1];
-        v0 = v;
-        v = pSrcPixels[3];
-        u1 = pSrcPixels[5];
-
-        YUVtoBGR32Pixel(pDestPixel, pSrcPixels[0], u, (v0+v)/2);
-        YUVtoBGR32Pixel(pDestPixel+1, pSrcPixels[2], (u+u1)/2, v);
-
-        pSrcPixels+=4;
-        pDestPixel+=2;
-    }
-    // Last pixels.
-    u = pSrcPixels[1];
-    v0 = v;
-    v = pSrcPixels[3];
-    YUVtoBGR32Pixel(pDestPixel, pSrcPixels[0], u, v0/2+v/2);
-    YUVtoBGR32Pixel(pDestPixel+1, pSrcPixels[2], u, v);
+    // Gives this bitmap its own copy of a shared pixel buffer.
+    PixelBufferPtr pOldBuffer = m_pBuffer;
+    const unsigned char* pOldBits = m_pBits;
+    m_pBits = 0;
+    allocBits(m_Stride);
+    memcpy(m_pBits, pOldBits, size_t(m_Stride)*(m_Size.y-1)+getLineLen());
 }
- 
-void UYVY422toBGR32Line(const unsigned char* pSrcLine, Pixel32* pDestLine, int width)
-{
-    Pixel32 * pDestPixel = pDestLine;
-    
-    // We need the previous and next values to interpolate between the
-    // sampled u and v values.
-    int v = *(pSrcLine+2);
-    int v0; // Previous v
-    int u;
-    int u1; // Next u;
-    const unsigned char * pSrcPixels = pSrcLine;
-
-    for (int x = 0; x < width/2-1; x++) {
-        // Two pixels at a time.
-        // Source format is UYVY.
-        u = pSrcPixels[0];
-        v0 = v;
-        v = pSrcPixels[2];
-        u1 = pSrcPixels[4];
-
-        YUVtoBGR32Pixel(pDestPixel, pSrcPixels[1], u, (v0+v)/2);
-        YUVtoBGR32Pixel(pDestPixel+1, pSrcPixels[3], (u+u1)/2, v);
 
-        pSrcPixels+=4;
-        pDestPixel+=2;
-    }
-    // Last pixels.
-    u = pSrcPixels[0];
-    v0 = v;
-    v = pSrcPixels[2];
-    YUVtoBGR32Pixel(pDestPixel, pSrcPixels[1], u, v0/2+v/2);
-    YUVtoBGR32Pixel(pDestPixel+1, pSrcPixels[3], u, v);
-}
- 
 void YUV411toBGR32Line(const unsigned char* pSrcLine, Pixel32* pDestLine, int width)
 {
     Pixel32 * pDestPixel = pDestLine;
@@ -1258,14 +1151,16 @@ void Bitmap::YCbCrtoBGR(const Bitmap& origBmp)
     switch(origBmp.m_PF) {
         case YCbCr422:
             for (int y = 0; y < height; ++y) {
-                UYVY422toBGR32Line(pSrc, pDest, width);
+                getPixelKernels().m_UYVY422toBGR32Line(pSrc, (unsigned char*)pDest, 
+                        width);
                 pDest += StrideInPixels;
                 pSrc += origBmp.getStride();
             }
             break;
         case YUYV422:
             for (int y = 0; y < height; ++y) {
-                YUYV422toBGR32Line(pSrc, pDest, width);
+                getPixelKernels().m_YUYV422toBGR32Line(pSrc, (unsigned char*)pDest, 
+                        width);
                 pDest += StrideInPixels;
                 pSrc += origBmp.getStride();
             }
@@ -1351,12 +1246,9 @@ void Bitmap::I16toI8(const Bitmap& origBmp)
     int height = min(origBmp.getSize().y, m_Size.y);
     int width = min(origBmp.getSize().x, m_Size.x);
     int srcStrideInPixels = origBmp.getStride()/origBmp.getBytesPerPixel();
+    const PixelKernels& kernels = getPixelKernels();
     for (int y = 0; y < height; ++y) {
-        const unsigned short * pSrcPixel = pSrc;
-        unsigned char * pDestPixel = pDest;
-        for (int x=0; x<width; ++x) {
-            *pDestPixel++ = *pSrcPixel++ >> 8;
-        }
+        kernels.m_I16toI8Line(pSrc, pDest, width);
         pDest += m_Stride;
         pSrc += srcStrideInPixels;
     }
@@ -1371,12 +1263,9 @@ void Bitmap::I8toI16(const Bitmap& origBmp)
     int height = min(origBmp.getSize().y, m_Size.y);
     int width = min(origBmp.getSize().x, m_Size.x);
     int destStrideInPixels = m_Stride/getBytesPerPixel();
+    const PixelKernels& kernels = getPixelKernels();
     for (int y=0; y<height; ++y) {
-        const unsigned char * pSrcPixel = pSrc;
-        unsigned short * pDestPixel = pDest;
-        for (int x=0; x<width; ++x) {
-            *pDestPixel++ = *pSrcPixel++ << 8;
-        }
+        kernels.m_I8toI16Line(pSrc, pDest, width);
         pDest += destStrideInPixels;
         pSrc += origBmp.getStride();
     }
@@ -1389,35 +1278,16 @@ void Bitmap::I8toRGB(const Bitmap& origBmp)
     const unsigned char * pSrc = origBmp.getPixels();
     int height = min(origBmp.getSize().y, m_Size.y);
     int width = min(origBmp.getSize().x, m_Size.x);
-    if (getBytesPerPixel() == 4) {
-        unsigned int * pDest = (unsigned int *)m_pBits;
-        int destStrideInPixels = m_Stride/getBytesPerPixel();
-        for (int y = 0; y < height; ++y) {
-            const unsigned char * pSrcPixel = pSrc;
-            unsigned int * pDestPixel = pDest;
-            for (int x = 0; x < width; ++x) {
-                *pDestPixel = (((((255 << 8)+(*pSrcPixel)) << 8)+
-                        *pSrcPixel) << 8) +(*pSrcPixel);
-                pDestPixel ++;
-                pSrcPixel++;
-            }
-            pDest += destStrideInPixels;
-            pSrc += origBmp.getStride();
-        }
-    } else {
-        unsigned char * pDest = m_pBits;
-        for (int y = 0; y < height; ++y) {
-            const unsigned char * pSrcPixel = pSrc;
-            unsigned char * pDestPixel = pDest;
-            for (int x = 0; x < width; ++x) {
-                *pDestPixel++ = *pSrcPixel;
-                *pDestPixel++ = *pSrcPixel;
-                *pDestPixel++ = *pSrcPixel;
-                pSrcPixel++;
-            }
-            pDest += getStride();
-            pSrc += origBmp.getStride();
+    const PixelKernels& kernels = getPixelKernels();
+    unsigned char * pDest = m_pBits;
+    for (int y = 0; y < height; ++y) {
+        if (getBytesPerPixel() == 4) {
+            kernels.m_I8toGray32Line(pSrc, pDest, width);
+        } else {
+            kernels.m_I8toGray24Line(pSrc, pDest, width);
         }
+        pDest += getStride();
+        pSrc += origBmp.getStride();
     }
 }
 
@@ -1429,14 +1299,9 @@ void Bitmap::ByteRGBAtoFloatRGBA(const Bitmap& origBmp)
     int height = min(origBmp.getSize().y, m_Size.y);
     int width = min(origBmp.getSize().x, m_Size.x);
     float * pDest = (float *)m_pBits;
+    const PixelKernels& kernels = getPixelKernels();
     for (int y = 0; y < height; ++y) {
-        const unsigned char * pSrcPixel = pSrc;
-        float * pDestPixel = pDest;
-        for (int x = 0; x < width*4; ++x) {
-            *pDestPixel = float(*pSrcPixel)/255;
-            pDestPixel ++;
-            pSrcPixel++;
-        }
+        kernels.m_ByteToFloatLine(pSrc, pDest, width*4);
         pDest += m_Stride/sizeof(float);
         pSrc += origBmp.getStride();
     }
@@ -1450,14 +1315,9 @@ void Bitmap::FloatRGBAtoByteRGBA(const Bitmap& origBmp)
     int height = min(origBmp.getSize().y, m_Size.y);
     int width = min(origBmp.getSize().x, m_Size.x);
     unsigned char * pDest = m_pBits;
+    const PixelKernels& kernels = getPixelKernels();
     for (int y = 0; y < height; ++y) {
-        const float * pSrcPixel = pSrc;
-        unsigned char * pDestPixel = pDest;
-        for (int x = 0; x < width*4; ++x) {
-            *pDestPixel = (unsigned char)(*pSrcPixel*255+0.5);
-            pDestPixel++;
-            pSrcPixel++;
-        }
+        kernels.m_FloatToByteLine(pSrc, pDest, width*4);
         pDest += m_Stride;
         pSrc += origBmp.getStride()/sizeof(float);
     }
@@ -1706,31 +1566,67 @@ void createTrueColorCopy(Bitmap& destBmp, const Bitmap& srcBmp)
     }
 }
 
-template<>
-void createTrueColorCopy<Pixel32, Pixel8>(Bitmap& destBmp, const Bitmap& srcBmp)
+// Conversions that have optimized line kernels.
+template<class DESTTYPE, class SRCTYPE>
+void convertLines(Bitmap& destBmp, const Bitmap& srcBmp,
+        void (*pLineFunc)(const SRCTYPE*, DESTTYPE*, int))
 {
     const unsigned char * pSrcLine = srcBmp.getPixels();
     unsigned char * pDestLine = destBmp.getPixels();
     int height = min(srcBmp.getSize().y, destBmp.getSize().y);
     int width = min(srcBmp.getSize().x, destBmp.getSize().x);
-    int srcStride = srcBmp.getStride();
-    int destStride = destBmp.getStride();
     for (int y = 0; y < height; ++y) {
-        const unsigned char * pSrcPixel = pSrcLine;
-        unsigned char * pDestPixel = pDestLine;
-        for (int x = 0; x < width; ++x) {
-            pDestPixel[0] =
-            pDestPixel[1] =
-            pDestPixel[2] = *pSrcPixel;
-            pDestPixel[3] = 255;
-            ++pSrcPixel;
-            pDestPixel+=4;
-        }
-        pSrcLine = pSrcLine + srcStride;
-        pDestLine = pDestLine + destStride;
+        pLineFunc((const SRCTYPE*)pSrcLine, (DESTTYPE*)pDestLine, width);
+        pSrcLine += srcBmp.getStride();
+        pDestLine += destBmp.getStride();
+    }
+}
+
+template<class DESTTYPE, class SRCTYPE>
+void convertLines(Bitmap& destBmp, const Bitmap& srcBmp,
+        void (*pLineFunc)(const SRCTYPE*, DESTTYPE*, int, bool))
+{
+    const unsigned char * pSrcLine = srcBmp.getPixels();
+    unsigned char * pDestLine = destBmp.getPixels();
+    int height = min(srcBmp.getSize().y, destBmp.getSize().y);
+    int width = min(srcBmp.getSize().x, destBmp.getSize().x);
+    for (int y = 0; y < height; ++y) {
+        pLineFunc((const SRCTYPE*)pSrcLine, (DESTTYPE*)pDestLine, width, false);
+        pSrcLine += srcBmp.getStride();
+        pDestLine += destBmp.getStride();
     }
 }
 
+template<>
+void createTrueColorCopy<Pixel32, Pixel8>(Bitmap& destBmp, const Bitmap& srcBmp)
+{
+    convertLines(destBmp, srcBmp, getPixelKernels().m_I8toGray32Line);
+}
+
+template<>
+void createTrueColorCopy<Pixel24, Pixel8>(Bitmap& destBmp, const Bitmap& srcBmp)
+{
+    convertLines(destBmp, srcBmp, getPixelKernels().m_I8toGray24Line);
+}
+
+template<>
+void createTrueColorCopy<Pixel24, Pixel32>(Bitmap& destBmp, const Bitmap& srcBmp)
+{
+    convertLines(destBmp, srcBmp, getPixelKernels().m_Color32to24Line);
+}
+
+template<>
+void createTrueColorCopy<Pixel32, Pixel24>(Bitmap& destBmp, const Bitmap& srcBmp)
+{
+    convertLines(destBmp, srcBmp, getPixelKernels().m_Color24to32Line);
+}
+
+template<>
+void createTrueColorCopy<Pixel16, Pixel32>(Bitmap& destBmp, const Bitmap& srcBmp)
+{
+    convertLines(destBmp, srcBmp, getPixelKernels().m_Color32to16Line);
+}
+
 template<>
 void createTrueColorCopy<Pixel8, Pixel32>(Bitmap& destBmp, const Bitmap& srcBmp)
 {
@@ -1742,28 +1638,14 @@ void createTrueColorCopy<Pixel8, Pixel32>(Bitmap& destBmp, const Bitmap& srcBmp)
     int destStride = destBmp.getStride();
     bool bRedFirst = (srcBmp.getPixelFormat() == R8G8B8A8) || 
             (srcBmp.getPixelFormat() == R8G8B8X8);
+    const PixelKernels& kernels = getPixelKernels();
     for (int y = 0; y<height; ++y) {
-        const unsigned char * pSrcPixel = pSrcLine;
-        unsigned char * pDestPixel = pDestLine;
-        if (bRedFirst) {
-            for (int x = 0; x < width; ++x) {
-                *pDestPixel = ((pSrcPixel[0]*54+pSrcPixel[1]*183+pSrcPixel[2]*19)/256);
-                pSrcPixel+=4;
-                ++pDestPixel;
-            }
-        } else {
-            for (int x = 0; x < width; ++x) {
-                *pDestPixel = ((pSrcPixel[0]*19+pSrcPixel[1]*183+pSrcPixel[2]*54)/256);
-                pSrcPixel+=4;
-                ++pDestPixel;
-            }
-        }
+        kernels.m_Color32toI8Line(pSrcLine, pDestLine, width, bRedFirst);
         pSrcLine = pSrcLine + srcStride;
         pDestLine = pDestLine + destStride;
     }
 }
 
-
 template<class PIXEL>
 void createTrueColorCopy(Bitmap& destBmp, const Bitmap& srcBmp)
 {
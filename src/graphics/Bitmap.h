@@ -25,6 +25,7 @@
 #include "../api.h"
 #include "Pixel32.h"
 #include "PixelFormat.h"
+#include "PixelBuffer.h"
 
 #include "../base/Rect.h"
 #include "../base/GLMHelper.h"
@@ -32,10 +33,6 @@
 
 #include <boost/shared_ptr.hpp>
 
-#if defined(__SSE__) || defined(_WIN32)
-#include <xmmintrin.h>
-#endif
-
 #include <stdlib.h>
 #include <string>
 #include <vector>
@@ -57,8 +54,17 @@ public:
     Bitmap(IntPoint size, PixelFormat pf, const UTF8String& sName="", int stride=0);
     Bitmap(IntPoint size, PixelFormat pf, unsigned char * pBits, 
             int stride, bool bCopyBits, const UTF8String& sName="");
+    // Creates a bitmap that uses the pixels in pBuffer, starting at pBits (or at the
+    // start of the buffer if pBits is 0).
+    Bitmap(IntPoint size, PixelFormat pf, PixelBufferPtr pBuffer, unsigned char * pBits,
+            int stride, const UTF8String& sName="");
+    // Copies share the pixel buffer until one of them is modified. If origBmp doesn't
+    // own its pixels, the copy refers to the same pixels.
     Bitmap(const Bitmap& origBmp);
+    // If bOwnsBits is false, the new bitmap is a view that refers to the pixels of
+    // origBmp and sees all changes made to them.
     Bitmap(const Bitmap& origBmp, bool bOwnsBits);
+    // View of a rectangle in origBmp. Keeps the pixels of origBmp alive.
     Bitmap(Bitmap& origBmp, const IntRect& rect);
     virtual ~Bitmap();
 
@@ -66,8 +72,15 @@ public:
     
     // Does pixel format conversion if nessesary.
     void copyPixels(const Bitmap& origBmp);
+    // Like copyPixels, but also exchanges the first and third channel of every pixel
+    // (e.g. R8G8B8A8 -> B8G8R8A8 or R8G8B8X8 -> B5G6R5) in the same pass. origBmp
+    // must have 24 or 32 bpp. origBmp may be this bitmap.
+    void copyPixelsSwapRB(const Bitmap& origBmp);
+    // Converts planar YUV with 4:2:0 (or, if bChroma422 is set, 4:2:2) chroma
+    // subsampling to 32 bpp BGR. Frames larger than 1080p are converted by several
+    // threads.
     void copyYUVPixels(const Bitmap& yBmp, const Bitmap& uBmp, const Bitmap& vBmp,
-            bool bJPEG);
+            bool bJPEG, bool bChroma422=false);
     void save(const UTF8String& sName);
     
     IntPoint getSize() const;
@@ -78,6 +91,8 @@ public:
     const unsigned char* getPixels() const;
     void setPixels(const unsigned char* pPixels);
     bool ownsBits() const;
+    // True if the pixels are currently shared with a copy of this bitmap.
+    bool isShared() const;
     const std::string& getName() const;
     int getBytesPerPixel() const;
     int getLineLen() const;
@@ -106,7 +121,14 @@ public:
 
 private:
     void initWithData(unsigned char* pBits, int stride, bool bCopyBits);
+    void initFromBitmap(const Bitmap& origBmp);
+    void initView(const Bitmap& origBmp, unsigned char* pBits);
+    void releaseBits();
     void allocBits(int stride=0);
+    void makeWritable();
+    void detach();
+    void copyYUVLines(const Bitmap& yBmp, const Bitmap& uBmp, const Bitmap& vBmp,
+            bool bJPEG, bool bChroma422, int startLine, int endLine);
     void YCbCrtoBGR(const Bitmap& origBmp);
     void YCbCrtoI8(const Bitmap& origBmp);
     void I8toI16(const Bitmap& origBmp);
@@ -122,7 +144,9 @@ private:
     int m_Stride;
     PixelFormat m_PF;
     unsigned char* m_pBits;
-    bool m_bOwnsBits;
+    // Null if the pixels are owned by someone else.
+    PixelBufferPtr m_pBuffer;
+    bool m_bIsView;
     UTF8String m_sName;
 
     static bool s_bMagickInitialized;
@@ -131,9 +155,19 @@ private:
 
 BitmapPtr YCbCr2RGBBitmap(BitmapPtr pYBmp, BitmapPtr pUBmp, BitmapPtr pVBmp);
 
+inline void Bitmap::makeWritable()
+{
+    // Views and buffers that have views are always written in place.
+    if (m_pBuffer && !m_bIsView && !m_pBuffer.unique() && m_pBuffer->getNumViews() == 0)
+    {
+        detach();
+    }
+}
+
 template<class PIXEL>
 void Bitmap::setPixel(const IntPoint& p, PIXEL color)
 {
+    makeWritable();
     *(PIXEL*)(&(m_pBits[p.y*m_Stride+p.x*getBytesPerPixel()])) = color;
 }
 
@@ -141,6 +175,7 @@ void Bitmap::setPixel(const IntPoint& p, PIXEL color)
 template<class PIXEL>
 void Bitmap::drawLine(IntPoint p0, IntPoint p1, PIXEL color)
 {
+    makeWritable();
     IntRect BmpRect(IntPoint(0,0), m_Size);
     p0 = BmpRect.cropPoint(p0);
     p1 = BmpRect.cropPoint(p1);
@@ -176,9 +211,6 @@ void Bitmap::drawLine(IntPoint p0, IntPoint p1, PIXEL color)
         }
     }
 }
-#if defined(__SSE__) || defined(_WIN32)
-std::ostream& operator<<(std::ostream& os, const __m64 &val);
-#endif
 
 }
 #endif
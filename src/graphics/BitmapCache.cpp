@@ -0,0 +1,236 @@
+//
+//  libavg - Media Playback Engine.
+//  Copyright (C) 2003-2014 Ulrich von Zadow
+//
+//  This library is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU Lesser General Public
+//  License as published by the Free Software Foundation; either
+//  version 2 of the License, or (at your option) any later version.
+//
+//  This library is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//  Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public
+//  License along with this library; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+//  Current versions can be found at www.libavg.de
+//
+
+#include "BitmapCache.h"
+
+#include "../base/Exception.h"
+#include "../base/ThreadHelper.h"
+
+#include <boost/thread/once.hpp>
+
+#include <climits>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+using namespace std;
+
+namespace avg {
+
+BitmapCacheStats::BitmapCacheStats()
+    : m_NumHits(0),
+      m_NumMisses(0),
+      m_NumEvictions(0),
+      m_NumBitmaps(0),
+      m_BytesUsed(0),
+      m_MaxBytes(0)
+{
+}
+
+static BitmapCache* s_pBitmapCache = 0;
+static boost::once_flag s_BitmapCacheOnceFlag = BOOST_ONCE_INIT;
+
+static bool getFileStamp(const string& sFilename, long long& modTime, 
+        long long& fileSize)
+{
+    struct stat fileStat;
+    if (stat(sFilename.c_str(), &fileStat) == -1) {
+        return false;
+    }
+    // Sub-second resolution where available, so files rewritten in quick succession
+    // are noticed.
+    modTime = (long long)(fileStat.st_mtime)*1000000000;
+#if defined(__linux__)
+    modTime += fileStat.st_mtim.tv_nsec;
+#elif defined(__APPLE__)
+    modTime += fileStat.st_mtimespec.tv_nsec;
+#endif
+    fileSize = fileStat.st_size;
+    return true;
+}
+
+BitmapCache* BitmapCache::get()
+{
+    boost::call_once(s_BitmapCacheOnceFlag, &BitmapCache::createInstance);
+    return s_pBitmapCache;
+}
+
+void BitmapCache::createInstance()
+{
+    s_pBitmapCache = new BitmapCache;
+}
+
+BitmapCache::BitmapCache()
+{
+    m_Stats.m_MaxBytes = DEFAULT_MAX_BYTES;
+}
+
+BitmapCache::~BitmapCache()
+{
+}
+
+BitmapPtr BitmapCache::find(const string& sFilename, PixelFormat pf,
+        const IntPoint& maxDecodeSize)
+{
+    long long modTime = 0;
+    long long fileSize = 0;
+    bool bFileExists = getFileStamp(sFilename, modTime, fileSize);
+
+    lock_guard lock(m_Mutex);
+    EntryMap::iterator it = m_Entries.find(Key(sFilename, pf, maxDecodeSize));
+    if (it == m_Entries.end()) {
+        m_Stats.m_NumMisses++;
+        return BitmapPtr();
+    }
+    Entry& entry = it->second;
+    if (!bFileExists || entry.m_ModTime != modTime || entry.m_FileSize != fileSize) {
+        eraseLocked(it);
+        m_Stats.m_NumMisses++;
+        return BitmapPtr();
+    }
+    m_LRUKeys.splice(m_LRUKeys.begin(), m_LRUKeys, entry.m_LRUPos);
+    m_Stats.m_NumHits++;
+    return BitmapPtr(new Bitmap(*entry.m_pBmp));
+}
+
+void BitmapCache::insert(const string& sFilename, PixelFormat pf, BitmapPtr pBmp,
+        const IntPoint& maxDecodeSize)
+{
+    long long modTime;
+    long long fileSize;
+    if (!getFileStamp(sFilename, modTime, fileSize)) {
+        return;
+    }
+    size_t numBytes = pBmp->getMemNeeded();
+    // The cache keeps its own copy so the caller can change or reuse pBmp. The pixels
+    // are shared until one of them is modified.
+    BitmapPtr pCachedBmp(new Bitmap(*pBmp));
+
+    lock_guard lock(m_Mutex);
+    if (numBytes > m_Stats.m_MaxBytes) {
+        return;
+    }
+    Key key(sFilename, pf, maxDecodeSize);
+    EntryMap::iterator it = m_Entries.find(key);
+    if (it != m_Entries.end()) {
+        eraseLocked(it);
+    }
+    trimLocked(m_Stats.m_MaxBytes - numBytes);
+    m_LRUKeys.push_front(key);
+    Entry& entry = m_Entries[key];
+    entry.m_pBmp = pCachedBmp;
+    entry.m_ModTime = modTime;
+    entry.m_FileSize = fileSize;
+    entry.m_NumBytes = numBytes;
+    entry.m_LRUPos = m_LRUKeys.begin();
+    m_Stats.m_BytesUsed += numBytes;
+    m_Stats.m_NumBitmaps++;
+}
+
+void BitmapCache::invalidate(const string& sFilename)
+{
+    lock_guard lock(m_Mutex);
+    EntryMap::iterator it = m_Entries.lower_bound(Key(sFilename, PixelFormat(0), 
+            IntPoint(INT_MIN, INT_MIN)));
+    while (it != m_Entries.end() && it->first.m_sFilename == sFilename) {
+        EntryMap::iterator nextIt = it;
+        ++nextIt;
+        eraseLocked(it);
+        it = nextIt;
+    }
+}
+
+void BitmapCache::clear()
+{
+    lock_guard lock(m_Mutex);
+    m_Entries.clear();
+    m_LRUKeys.clear();
+    m_Stats.m_BytesUsed = 0;
+    m_Stats.m_NumBitmaps = 0;
+}
+
+void BitmapCache::setMaxBytes(size_t numBytes)
+{
+    lock_guard lock(m_Mutex);
+    m_Stats.m_MaxBytes = numBytes;
+    trimLocked(numBytes);
+}
+
+size_t BitmapCache::getMaxBytes() const
+{
+    lock_guard lock(m_Mutex);
+    return m_Stats.m_MaxBytes;
+}
+
+BitmapCacheStats BitmapCache::getStats() const
+{
+    lock_guard lock(m_Mutex);
+    return m_Stats;
+}
+
+void BitmapCache::resetStats()
+{
+    lock_guard lock(m_Mutex);
+    m_Stats.m_NumHits = 0;
+    m_Stats.m_NumMisses = 0;
+    m_Stats.m_NumEvictions = 0;
+}
+
+BitmapCache::Key::Key(const string& sFilename, PixelFormat pf, 
+        const IntPoint& maxDecodeSize)
+    : m_sFilename(sFilename),
+      m_PF(pf),
+      m_MaxDecodeSize(maxDecodeSize)
+{
+}
+
+bool BitmapCache::Key::operator <(const Key& other) const
+{
+    if (m_sFilename != other.m_sFilename) {
+        return m_sFilename < other.m_sFilename;
+    }
+    if (m_PF != other.m_PF) {
+        return m_PF < other.m_PF;
+    }
+    if (m_MaxDecodeSize.x != other.m_MaxDecodeSize.x) {
+        return m_MaxDecodeSize.x < other.m_MaxDecodeSize.x;
+    }
+    return m_MaxDecodeSize.y < other.m_MaxDecodeSize.y;
+}
+
+void BitmapCache::eraseLocked(EntryMap::iterator it)
+{
+    m_Stats.m_BytesUsed -= it->second.m_NumBytes;
+    m_Stats.m_NumBitmaps--;
+    m_LRUKeys.erase(it->second.m_LRUPos);
+    m_Entries.erase(it);
+}
+
+void BitmapCache::trimLocked(size_t maxBytes)
+{
+    while (m_Stats.m_BytesUsed > maxBytes) {
+        AVG_ASSERT(!m_LRUKeys.empty());
+        eraseLocked(m_Entries.find(m_LRUKeys.back()));
+        m_Stats.m_NumEvictions++;
+    }
+}
+
+}
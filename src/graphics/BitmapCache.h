@@ -0,0 +1,119 @@
+//
+//  libavg - Media Playback Engine.
+//  Copyright (C) 2003-2014 Ulrich von Zadow
+//
+//  This library is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU Lesser General Public
+//  License as published by the Free Software Foundation; either
+//  version 2 of the License, or (at your option) any later version.
+//
+//  This library is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//  Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public
+//  License along with this library; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+//  Current versions can be found at www.libavg.de
+//
+
+#ifndef _BitmapCache_H_
+#define _BitmapCache_H_
+
+#include "../api.h"
+
+#include "Bitmap.h"
+#include "PixelFormat.h"
+
+#include <boost/thread/mutex.hpp>
+
+#include <string>
+#include <map>
+#include <list>
+#include <cstddef>
+
+namespace avg {
+
+struct AVG_API BitmapCacheStats
+{
+    BitmapCacheStats();
+
+    long long m_NumHits;
+    long long m_NumMisses;
+    // Entries dropped to stay within the budget.
+    long long m_NumEvictions;
+    int m_NumBitmaps;
+    size_t m_BytesUsed;
+    size_t m_MaxBytes;
+};
+
+// Process-wide cache of decoded image files, used by BitmapLoader for synchronous
+// and BitmapManager loads alike. Entries are keyed by file name, requested pixel
+// format and maximum decode size. The file's modification time and size are checked
+// on every lookup, so a file that changes on disk is decoded again. When the cache
+// grows beyond MaxBytes, the least recently used entries are dropped.
+// Cached bitmaps are handed out as copy-on-write copies, so callers may modify them
+// freely. Thread-safe.
+class AVG_API BitmapCache
+{
+public:
+    static const size_t DEFAULT_MAX_BYTES = 64*1024*1024;
+
+    static BitmapCache* get();
+
+    // Returns an empty pointer if the file isn't cached or has changed since it was
+    // cached.
+    BitmapPtr find(const std::string& sFilename, PixelFormat pf,
+            const IntPoint& maxDecodeSize=IntPoint(0,0));
+    void insert(const std::string& sFilename, PixelFormat pf, BitmapPtr pBmp,
+            const IntPoint& maxDecodeSize=IntPoint(0,0));
+    // Drops all entries for sFilename.
+    void invalidate(const std::string& sFilename);
+    void clear();
+
+    void setMaxBytes(size_t numBytes);
+    size_t getMaxBytes() const;
+
+    BitmapCacheStats getStats() const;
+    void resetStats();
+
+private:
+    struct Key {
+        Key(const std::string& sFilename, PixelFormat pf, const IntPoint& maxDecodeSize);
+        bool operator <(const Key& other) const;
+
+        std::string m_sFilename;
+        PixelFormat m_PF;
+        IntPoint m_MaxDecodeSize;
+    };
+    typedef std::list<Key> KeyList;
+
+    struct Entry {
+        BitmapPtr m_pBmp;
+        long long m_ModTime;
+        long long m_FileSize;
+        size_t m_NumBytes;
+        // Position in m_LRUKeys.
+        KeyList::iterator m_LRUPos;
+    };
+    typedef std::map<Key, Entry> EntryMap;
+
+    BitmapCache();
+    virtual ~BitmapCache();
+    static void createInstance();
+
+    void eraseLocked(EntryMap::iterator it);
+    void trimLocked(size_t maxBytes);
+
+    EntryMap m_Entries;
+    // Most recently used first.
+    KeyList m_LRUKeys;
+    BitmapCacheStats m_Stats;
+    mutable boost::mutex m_Mutex;
+};
+
+}
+
+#endif
@@ -22,12 +22,26 @@
 #include "BitmapLoader.h"
 
 #include "PixelFormat.h"
-#include "Filterfliprgb.h"
+#include "BitmapCache.h"
+#include "FilterResample.h"
+#include "GdkPixbufDecoder.h"
+#include "ImageContainer.h"
+#ifdef AVG_ENABLE_LIBJPEG
+#include "JPEGDecoder.h"
+#endif
+#ifdef AVG_ENABLE_LIBPNG
+#include "PNGDecoder.h"
+#endif
+#ifdef AVG_ENABLE_LIBWEBP
+#include "WebPDecoder.h"
+#endif
 
 #include "../base/Exception.h"
 #include "../base/ScopeTimer.h"
+#include "../base/ThreadHelper.h"
 
 #include <gdk-pixbuf/gdk-pixbuf.h>
+#include <stdio.h>
 #include <iostream>
 
 using namespace std;
@@ -47,6 +61,8 @@ void BitmapLoader::init(bool bBlueFirst)
         delete s_pBitmapLoader;
     }
     s_pBitmapLoader = new BitmapLoader(bBlueFirst);
+    // The default pixel formats depend on bBlueFirst.
+    BitmapCache::get()->clear();
 }
 
 BitmapLoader* BitmapLoader::get() 
@@ -56,8 +72,19 @@ BitmapLoader* BitmapLoader::get()
 }
 
 BitmapLoader::BitmapLoader(bool bBlueFirst)
-    : m_bBlueFirst(bBlueFirst)
+    : m_bBlueFirst(bBlueFirst),
+      m_pFallbackDecoder(new GdkPixbufDecoder())
 {
+    registerDecoder(ImageDecoderPtr(new ImageContainerDecoder()));
+#ifdef AVG_ENABLE_LIBJPEG
+    registerDecoder(ImageDecoderPtr(new JPEGDecoder()));
+#endif
+#ifdef AVG_ENABLE_LIBPNG
+    registerDecoder(ImageDecoderPtr(new PNGDecoder()));
+#endif
+#ifdef AVG_ENABLE_LIBWEBP
+    registerDecoder(ImageDecoderPtr(new WebPDecoder()));
+#endif
 }
 
 BitmapLoader::~BitmapLoader() 
@@ -86,70 +113,89 @@ PixelFormat BitmapLoader::getDefaultPixelFormat(bool bAlpha)
     } 
 }
 
-static ProfilingZoneID GDKPixbufProfilingZone("gdk_pixbuf load", true);
-static ProfilingZoneID ConvertProfilingZone("Format conversion", true);
-static ProfilingZoneID RGBFlipProfilingZone("RGB<->BGR flip", true);
-
-BitmapPtr BitmapLoader::load(const UTF8String& sFName, PixelFormat pf) const
+BitmapPtr BitmapLoader::load(const UTF8String& sFName, PixelFormat pf,
+        const IntPoint& maxDecodeSize) const
 {
     AVG_ASSERT(s_pBitmapLoader != 0);
-    GError* pError = 0;
-    GdkPixbuf* pPixBuf;
-    {
-        ScopeTimer timer(GDKPixbufProfilingZone);
-        pPixBuf = gdk_pixbuf_new_from_file(sFName.c_str(), &pError);
+    BitmapPtr pBmp = BitmapCache::get()->find(sFName, pf, maxDecodeSize);
+    if (!pBmp) {
+        pBmp = decode(sFName, pf, maxDecodeSize);
+        BitmapCache::get()->insert(sFName, pf, pBmp, maxDecodeSize);
     }
-    if (!pPixBuf) {
-        string sErr = pError->message;
-        g_error_free(pError);
-        throw Exception(AVG_ERR_FILEIO, sErr);
+    return pBmp;
+}
+
+void BitmapLoader::registerDecoder(ImageDecoderPtr pDecoder)
+{
+    lock_guard lock(m_DecoderMutex);
+    m_pDecoders.push_back(pDecoder);
+}
+
+vector<string> BitmapLoader::getDecoderNames() const
+{
+    vector<ImageDecoderPtr> pDecoders = getDecoders();
+    vector<string> sNames;
+    for (unsigned i = 0; i < pDecoders.size(); ++i) {
+        sNames.push_back(pDecoders[i]->getName());
     }
-    IntPoint size = IntPoint(gdk_pixbuf_get_width(pPixBuf), 
-            gdk_pixbuf_get_height(pPixBuf));
-    
-    PixelFormat srcPF;
-    if (gdk_pixbuf_get_has_alpha(pPixBuf)) {
-        srcPF = R8G8B8A8;
-    } else {
-        srcPF = R8G8B8;
+    sNames.push_back(m_pFallbackDecoder->getName());
+    return sNames;
+}
+
+vector<ImageDecoderPtr> BitmapLoader::getDecoders() const
+{
+    lock_guard lock(m_DecoderMutex);
+    return m_pDecoders;
+}
+
+static ProfilingZoneID PrescaleProfilingZone("Decode prescale", true);
+
+BitmapPtr BitmapLoader::decode(const UTF8String& sFName, PixelFormat pf,
+        const IntPoint& maxDecodeSize) const
+{
+    BitmapPtr pBmp = decodeFile(sFName, pf, maxDecodeSize);
+    int factor = ImageDecoder::getReductionFactor(pBmp->getSize(), maxDecodeSize);
+    int bpp = pBmp->getBytesPerPixel();
+    if (factor > 1 && (bpp == 1 || bpp == 3 || bpp == 4)) {
+        // The decoder couldn't shrink the image (enough) by itself.
+        ScopeTimer timer(PrescaleProfilingZone);
+        IntPoint size = pBmp->getSize();
+        pBmp = FilterResample(IntPoint(size.x/factor, size.y/factor), 
+                FilterResample::BOX).apply(pBmp);
     }
-    if (pf == NO_PIXELFORMAT) {
-        if (m_bBlueFirst) {
-            if (srcPF == R8G8B8A8) {
-                pf = B8G8R8A8;
-            } else if (srcPF == R8G8B8) {
-                pf = B8G8R8X8;
-            }
-        } else {
-            if (srcPF == R8G8B8A8) {
-                pf = R8G8B8A8;
-            } else if (srcPF == R8G8B8) {
-                pf = R8G8B8X8;
-            }
-        }
+    return pBmp;
+}
+
+BitmapPtr BitmapLoader::decodeFile(const UTF8String& sFName, PixelFormat pf,
+        const IntPoint& maxDecodeSize) const
+{
+    unsigned char header[ImageDecoder::HEADER_SIZE];
+    int headerLen = 0;
+    FILE* pFile = fopen(sFName.c_str(), "rb");
+    if (pFile) {
+        headerLen = int(fread(header, 1, ImageDecoder::HEADER_SIZE, pFile));
+        fclose(pFile);
     }
-    BitmapPtr pBmp(new Bitmap(size, pf, sFName));
-    {
-        ScopeTimer timer(ConvertProfilingZone);
-
-        int stride = gdk_pixbuf_get_rowstride(pPixBuf);
-        guchar* pSrc = gdk_pixbuf_get_pixels(pPixBuf);
-        BitmapPtr pSrcBmp(new Bitmap(size, srcPF, pSrc, stride, false));
-        {
-            ScopeTimer timer(RGBFlipProfilingZone);
-            if (pixelFormatIsBlueFirst(pf) != pixelFormatIsBlueFirst(srcPF)) {
-                FilterFlipRGB().applyInPlace(pSrcBmp);
+    if (headerLen > 0) {
+        vector<ImageDecoderPtr> pDecoders = getDecoders();
+        for (unsigned i = 0; i < pDecoders.size(); ++i) {
+            if (pDecoders[i]->canDecode(header, headerLen)) {
+                BitmapPtr pBmp = pDecoders[i]->decode(sFName, pf, maxDecodeSize);
+                if (pBmp) {
+                    return pBmp;
+                }
             }
         }
-        pBmp->copyPixels(*pSrcBmp);
     }
-    g_object_unref(pPixBuf);
-    return pBmp;
+    // The fallback decoder also generates the error messages for files that can't
+    // be opened.
+    return m_pFallbackDecoder->decode(sFName, pf, maxDecodeSize);
 }
 
-BitmapPtr loadBitmap(const UTF8String& sFName, PixelFormat pf)
+BitmapPtr loadBitmap(const UTF8String& sFName, PixelFormat pf,
+        const IntPoint& maxDecodeSize)
 {
-    return BitmapLoader::get()->load(sFName, pf);
+    return BitmapLoader::get()->load(sFName, pf, maxDecodeSize);
 }
 
 }
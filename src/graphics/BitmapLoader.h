@@ -27,8 +27,12 @@
 
 #include "Bitmap.h"
 #include "PixelFormat.h"
+#include "ImageDecoder.h"
+
+#include <boost/thread/mutex.hpp>
 
 #include <string>
+#include <vector>
 
 namespace avg {
 
@@ -38,17 +42,38 @@ public:
     static BitmapLoader* get();
     bool isBlueFirst() const;
     PixelFormat getDefaultPixelFormat(bool bAlpha);
-    BitmapPtr load(const UTF8String& sFName, PixelFormat pf=NO_PIXELFORMAT) const;
+    // Decoded files are kept in the BitmapCache, so loading the same file again is
+    // cheap as long as it hasn't changed.
+    // If maxDecodeSize is set, images are shrunk by power-of-two factors as long as
+    // they stay at least that large. JPEGs are decoded at the smaller size directly;
+    // other images are box-filtered after decoding.
+    BitmapPtr load(const UTF8String& sFName, PixelFormat pf=NO_PIXELFORMAT,
+            const IntPoint& maxDecodeSize=IntPoint(0,0)) const;
+
+    // Decoders are tried in the order they were registered. Files no registered
+    // decoder recognizes are loaded using gdk-pixbuf. init() resets the list to the
+    // built-in decoders.
+    void registerDecoder(ImageDecoderPtr pDecoder);
+    std::vector<std::string> getDecoderNames() const;
 
 private:
     BitmapLoader(bool bBlueFirst);
     virtual ~BitmapLoader();
+    BitmapPtr decode(const UTF8String& sFName, PixelFormat pf,
+            const IntPoint& maxDecodeSize) const;
+    BitmapPtr decodeFile(const UTF8String& sFName, PixelFormat pf,
+            const IntPoint& maxDecodeSize) const;
+    std::vector<ImageDecoderPtr> getDecoders() const;
 
     bool m_bBlueFirst;
+    std::vector<ImageDecoderPtr> m_pDecoders;
+    ImageDecoderPtr m_pFallbackDecoder;
+    mutable boost::mutex m_DecoderMutex;
     static BitmapLoader * s_pBitmapLoader;
 };
 
-BitmapPtr AVG_API loadBitmap(const UTF8String& sFName, PixelFormat pf=NO_PIXELFORMAT);
+BitmapPtr AVG_API loadBitmap(const UTF8String& sFName, PixelFormat pf=NO_PIXELFORMAT,
+        const IntPoint& maxDecodeSize=IntPoint(0,0));
 
 }
 
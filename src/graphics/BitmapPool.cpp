@@ -0,0 +1,207 @@
+//
+//  libavg - Media Playback Engine.
+//  Copyright (C) 2003-2014 Ulrich von Zadow
+//
+//  This library is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU Lesser General Public
+//  License as published by the Free Software Foundation; either
+//  version 2 of the License, or (at your option) any later version.
+//
+//  This library is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//  Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public
+//  License along with this library; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+//  Current versions can be found at www.libavg.de
+//
+
+#include "BitmapPool.h"
+
+#include "../base/ThreadHelper.h"
+
+#include <boost/thread/once.hpp>
+
+#include <cstdlib>
+#include <new>
+
+using namespace std;
+
+namespace avg {
+
+// Smallest size class. Four classes per power of two above this.
+static const size_t MIN_CLASS_SIZE = 256;
+
+// Stored directly in front of every block handed out.
+struct BlockHeader
+{
+    void* m_pRaw;
+    int m_SizeClass;
+};
+
+BitmapPoolStats::BitmapPoolStats()
+    : m_NumHits(0),
+      m_NumMisses(0),
+      m_BytesRetained(0),
+      m_BytesInUse(0),
+      m_MaxBytesRetained(0)
+{
+}
+
+static BitmapPool* s_pBitmapPool = 0;
+static boost::once_flag s_BitmapPoolOnceFlag = BOOST_ONCE_INIT;
+
+static void trimBitmapPoolAtExit()
+{
+    // The pool itself is never deleted because static bitmaps may still be freed
+    // after this. Later frees go straight back to the heap.
+    s_pBitmapPool->setMaxBytesRetained(0);
+}
+
+BitmapPool* BitmapPool::get()
+{
+    boost::call_once(s_BitmapPoolOnceFlag, &BitmapPool::createInstance);
+    return s_pBitmapPool;
+}
+
+void BitmapPool::createInstance()
+{
+    s_pBitmapPool = new BitmapPool;
+    atexit(trimBitmapPoolAtExit);
+}
+
+BitmapPool::BitmapPool()
+{
+    m_Stats.m_MaxBytesRetained = DEFAULT_MAX_BYTES_RETAINED;
+}
+
+BitmapPool::~BitmapPool()
+{
+    trimLocked(0);
+}
+
+unsigned char* BitmapPool::alloc(size_t numBytes)
+{
+    int sizeClass = getSizeClass(numBytes);
+    size_t classSize = getClassSize(sizeClass);
+    {
+        lock_guard lock(m_Mutex);
+        m_Stats.m_BytesInUse += classSize;
+        if (sizeClass < int(m_pFreeBlocks.size()) && !m_pFreeBlocks[sizeClass].empty()) {
+            unsigned char* pBits = m_pFreeBlocks[sizeClass].back();
+            m_pFreeBlocks[sizeClass].pop_back();
+            m_Stats.m_BytesRetained -= classSize;
+            m_Stats.m_NumHits++;
+            return pBits;
+        }
+        m_Stats.m_NumMisses++;
+    }
+    unsigned char* pRaw = (unsigned char*)malloc(classSize + 2*ALIGNMENT);
+    if (!pRaw) {
+        lock_guard lock(m_Mutex);
+        m_Stats.m_BytesInUse -= classSize;
+        throw std::bad_alloc();
+    }
+    unsigned char* pBits = (unsigned char*)
+            ((size_t(pRaw) + 2*ALIGNMENT-1) & ~(ALIGNMENT-1));
+    BlockHeader* pHeader = (BlockHeader*)pBits - 1;
+    pHeader->m_pRaw = pRaw;
+    pHeader->m_SizeClass = sizeClass;
+    return pBits;
+}
+
+void BitmapPool::free(unsigned char* pBits)
+{
+    if (!pBits) {
+        return;
+    }
+    BlockHeader* pHeader = (BlockHeader*)pBits - 1;
+    int sizeClass = pHeader->m_SizeClass;
+    size_t classSize = getClassSize(sizeClass);
+    {
+        lock_guard lock(m_Mutex);
+        m_Stats.m_BytesInUse -= classSize;
+        if (m_Stats.m_BytesRetained + classSize <= m_Stats.m_MaxBytesRetained) {
+            if (sizeClass >= int(m_pFreeBlocks.size())) {
+                m_pFreeBlocks.resize(sizeClass+1);
+            }
+            m_pFreeBlocks[sizeClass].push_back(pBits);
+            m_Stats.m_BytesRetained += classSize;
+            return;
+        }
+    }
+    ::free(pHeader->m_pRaw);
+}
+
+void BitmapPool::setMaxBytesRetained(size_t numBytes)
+{
+    lock_guard lock(m_Mutex);
+    m_Stats.m_MaxBytesRetained = numBytes;
+    trimLocked(numBytes);
+}
+
+size_t BitmapPool::getMaxBytesRetained() const
+{
+    lock_guard lock(m_Mutex);
+    return m_Stats.m_MaxBytesRetained;
+}
+
+void BitmapPool::trim(size_t maxBytesRetained)
+{
+    lock_guard lock(m_Mutex);
+    trimLocked(maxBytesRetained);
+}
+
+BitmapPoolStats BitmapPool::getStats() const
+{
+    lock_guard lock(m_Mutex);
+    return m_Stats;
+}
+
+void BitmapPool::resetStats()
+{
+    lock_guard lock(m_Mutex);
+    m_Stats.m_NumHits = 0;
+    m_Stats.m_NumMisses = 0;
+}
+
+int BitmapPool::getSizeClass(size_t numBytes)
+{
+    if (numBytes <= MIN_CLASS_SIZE) {
+        return 0;
+    }
+    int group = 0;
+    size_t groupSize = MIN_CLASS_SIZE;
+    while (groupSize*2 < numBytes) {
+        groupSize *= 2;
+        group++;
+    }
+    // numBytes is in (groupSize, 2*groupSize]: round up to the next quarter step.
+    int step = int(((numBytes-groupSize)*4 + groupSize-1)/groupSize);
+    return group*4 + step;
+}
+
+size_t BitmapPool::getClassSize(int sizeClass)
+{
+    size_t groupSize = MIN_CLASS_SIZE << (sizeClass/4);
+    return groupSize + groupSize/4*(sizeClass%4);
+}
+
+void BitmapPool::trimLocked(size_t maxBytesRetained)
+{
+    // Largest blocks go first.
+    for (int i = int(m_pFreeBlocks.size())-1; i >= 0; --i) {
+        vector<unsigned char*>& pBlocks = m_pFreeBlocks[i];
+        while (m_Stats.m_BytesRetained > maxBytesRetained && !pBlocks.empty()) {
+            BlockHeader* pHeader = (BlockHeader*)pBlocks.back() - 1;
+            ::free(pHeader->m_pRaw);
+            pBlocks.pop_back();
+            m_Stats.m_BytesRetained -= getClassSize(i);
+        }
+    }
+}
+
+}
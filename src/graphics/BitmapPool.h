@@ -0,0 +1,91 @@
+//
+//  libavg - Media Playback Engine.
+//  Copyright (C) 2003-2014 Ulrich von Zadow
+//
+//  This library is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU Lesser General Public
+//  License as published by the Free Software Foundation; either
+//  version 2 of the License, or (at your option) any later version.
+//
+//  This library is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//  Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public
+//  License along with this library; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+//  Current versions can be found at www.libavg.de
+//
+
+#ifndef _BitmapPool_H_
+#define _BitmapPool_H_
+
+#include "../api.h"
+
+#include <boost/thread/mutex.hpp>
+
+#include <vector>
+#include <cstddef>
+
+namespace avg {
+
+struct AVG_API BitmapPoolStats
+{
+    BitmapPoolStats();
+
+    // Allocations served from retained blocks.
+    long long m_NumHits;
+    // Allocations that had to go to the heap.
+    long long m_NumMisses;
+    // Bytes in free blocks kept for reuse.
+    size_t m_BytesRetained;
+    // Bytes in blocks currently handed out.
+    size_t m_BytesInUse;
+    size_t m_MaxBytesRetained;
+};
+
+// Recycles bitmap pixel memory. Blocks are grouped into size classes, four per
+// power of two, and a freed block is kept for the next allocation of the same
+// class. This makes repeatedly creating same-sized bitmaps (filter temporaries,
+// video frames, camera images) essentially free. Freed blocks are released to the
+// heap once the retained memory would exceed the high-water limit. All blocks are
+// ALIGNMENT-byte aligned. Thread-safe.
+class AVG_API BitmapPool
+{
+public:
+    static const size_t ALIGNMENT = 64;
+    static const size_t DEFAULT_MAX_BYTES_RETAINED = 128*1024*1024;
+
+    static BitmapPool* get();
+
+    unsigned char* alloc(size_t numBytes);
+    void free(unsigned char* pBits);
+
+    void setMaxBytesRetained(size_t numBytes);
+    size_t getMaxBytesRetained() const;
+    // Releases retained blocks until at most maxBytesRetained bytes are left.
+    void trim(size_t maxBytesRetained=0);
+
+    BitmapPoolStats getStats() const;
+    void resetStats();
+
+    static int getSizeClass(size_t numBytes);
+    static size_t getClassSize(int sizeClass);
+
+private:
+    BitmapPool();
+    virtual ~BitmapPool();
+    static void createInstance();
+
+    void trimLocked(size_t maxBytesRetained);
+
+    std::vector<std::vector<unsigned char*> > m_pFreeBlocks;
+    BitmapPoolStats m_Stats;
+    mutable boost::mutex m_Mutex;
+};
+
+}
+
+#endif
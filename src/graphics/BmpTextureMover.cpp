@@ -24,7 +24,6 @@
 #include "Bitmap.h"
 #include "GLTexture.h"
 #include "FBO.h"
-#include "Filterfliprgb.h"
 
 #include "../base/Logger.h"
 #include "../base/Exception.h"
@@ -55,13 +54,16 @@ void BmpTextureMover::moveBmpToTexture(BitmapPtr pBmp, GLTexture& tex)
     AVG_ASSERT(getSize() == pBmp->getSize());
     AVG_ASSERT(pBmp->getPixelFormat() == getPF());
     tex.activate();
-    unsigned char * pStartPos = pBmp->getPixels();
+    // Read-only access: pBmp may share its pixels with other bitmaps.
+    const Bitmap& bmp = *pBmp;
+    const unsigned char * pStartPos = bmp.getPixels();
     IntPoint size = tex.getSize();
     glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, size.x, size.y,
             tex.getGLFormat(getPF()), tex.getGLType(getPF()), 
             pStartPos);
     tex.generateMipmaps();
     GLContext::checkError("BmpTextureMover::moveBmpToTexture: glTexSubImage2D()");
+    addBytesUploaded(pBmp->getMemNeeded());
 }
 
 BitmapPtr BmpTextureMover::moveTextureToBmp(GLTexture& tex, int mipmapLevel)
@@ -77,8 +79,7 @@ BitmapPtr BmpTextureMover::moveTextureToBmp(GLTexture& tex, int mipmapLevel)
     if (GLContext::getCurrent()->isGLES() && getPF() == B5G6R5) {
         BitmapPtr pTmpBmp(new Bitmap(size, R8G8B8A8));
         glReadPixels(0, 0, size.x, size.y, GL_RGBA, GL_UNSIGNED_BYTE, pTmpBmp->getPixels());
-        FilterFlipRGB().applyInPlace(pTmpBmp);
-        pBmp->copyPixels(*pTmpBmp);
+        pBmp->copyPixelsSwapRB(*pTmpBmp);
     } else {
         int glPixelFormat = tex.getGLFormat(getPF());
         glReadPixels(0, 0, size.x, size.y, glPixelFormat, tex.getGLType(getPF()), 
@@ -23,13 +23,26 @@
 #include "Bitmap.h"
 
 #include "../base/ObjectCounter.h"
+#include "../base/Exception.h"
+#include "../base/TaskScheduler.h"
+#include "../base/ProfilingZoneID.h"
+
+#include <boost/bind.hpp>
 
 #include <iostream>
+#include <vector>
 
 using namespace std;
 
 namespace avg {
 
+// Bands need to be at least this many times higher than the halo.
+static const int MIN_BAND_HALO_RATIO = 4;
+
+static ProfilingZoneID FilterBandProfilingZone("Filter band", true);
+
+int Filter::s_MinBandPixels = 64*1024;
+
 Filter::Filter()
 {
     ObjectCounter::get()->incRef(&typeid(*this));
@@ -52,4 +65,49 @@ BitmapPtr Filter::apply(BitmapPtr pBmpSource)
     return pBmpDest;
 }
 
+void Filter::setMinBandPixels(int numPixels)
+{
+    AVG_ASSERT(numPixels > 0);
+    s_MinBandPixels = numPixels;
+}
+
+int Filter::getMinBandPixels()
+{
+    return s_MinBandPixels;
+}
+
+static void waitForTasks(const vector<TaskPtr>& pTasks)
+{
+    for (unsigned i = 0; i < pTasks.size(); ++i) {
+        pTasks[i]->wait();
+    }
+}
+
+void Filter::applyBands(const BandFunc& bandFunc, const IntPoint& destSize,
+        int haloLines)
+{
+    int numBands = min(TaskScheduler::get()->getNumThreads()+1,
+            destSize.x*destSize.y/s_MinBandPixels);
+    numBands = min(numBands, destSize.y/max(1, MIN_BAND_HALO_RATIO*haloLines));
+    if (numBands > 1) {
+        int bandHeight = destSize.y/numBands;
+        vector<TaskPtr> pTasks;
+        for (int i = 1; i < numBands; ++i) {
+            int endLine = (i == numBands-1) ? destSize.y : (i+1)*bandHeight;
+            pTasks.push_back(TaskScheduler::get()->submit(boost::bind(bandFunc,
+                    i*bandHeight, endLine), Task::HIGH, &FilterBandProfilingZone));
+        }
+        try {
+            bandFunc(0, bandHeight);
+        } catch (...) {
+            // The other bands reference the bitmaps, so they need to finish first.
+            waitForTasks(pTasks);
+            throw;
+        }
+        waitForTasks(pTasks);
+    } else {
+        bandFunc(0, destSize.y);
+    }
+}
+
 }
@@ -26,6 +26,7 @@
 #include "Bitmap.h"
 
 #include <boost/shared_ptr.hpp>
+#include <boost/function.hpp>
 
 namespace avg {
 
@@ -47,6 +48,29 @@ public:
     // The base-class version copies the bitmap before calling
     // applyInPlace.
     virtual BitmapPtr apply(BitmapPtr pBmpSource);
+
+    // Bitmaps smaller than this are never split into bands.
+    static void setMinBandPixels(int numPixels);
+    static int getMinBandPixels();
+
+protected:
+    // Computes destination lines [startLine, endLine). Called concurrently for
+    // different bands.
+    typedef boost::function<void (int startLine, int endLine)> BandFunc;
+
+    // Support for filters that compute each destination line independently from a
+    // source bitmap. Such filters call applyBands() from apply() with a BandFunc that
+    // is usually bound to a member function and the bitmaps. applyBands() splits the 
+    // lines of a bitmap of destSize into bands and, if the bitmap is large enough, 
+    // runs them in parallel on the TaskScheduler. The source is shared read-only 
+    // between bands. haloLines is the number of lines beyond its own that a band reads
+    // or recomputes (e.g. half the kernel height); bands are kept high enough that 
+    // the halo overhead stays small.
+    static void applyBands(const BandFunc& bandFunc, const IntPoint& destSize,
+            int haloLines=0);
+
+private:
+    static int s_MinBandPixels;
 };
 
 typedef boost::shared_ptr<Filter> FilterPtr;
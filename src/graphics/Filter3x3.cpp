@@ -24,6 +24,7 @@
 
 #include "../base/Exception.h"
 
+#include <boost/bind.hpp>
 
 namespace avg {
     
@@ -44,25 +45,34 @@ Filter3x3::~Filter3x3()
 
 BitmapPtr Filter3x3::apply(BitmapPtr pBmpSource) 
 {
+    AVG_ASSERT(pBmpSource->getBytesPerPixel() == 4 || 
+            pBmpSource->getBytesPerPixel() == 3);
     IntPoint newSize(pBmpSource->getSize().x-2, pBmpSource->getSize().y-2);
     BitmapPtr pNewBmp(new Bitmap(newSize, pBmpSource->getPixelFormat(),
             pBmpSource->getName()+"_filtered"));
-            
-    for (int y = 0; y < newSize.y; y++) {
-        const unsigned char * pSrc = pBmpSource->getPixels()+y*pBmpSource->getStride();
-        unsigned char * pDest = pNewBmp->getPixels()+y*pNewBmp->getStride();
-        switch (pBmpSource->getBytesPerPixel()) {
+    applyBands(boost::bind(&Filter3x3::applyBand, this, boost::cref(*pBmpSource),
+            boost::ref(*pNewBmp), _1, _2), newSize, 1);
+    return pNewBmp;
+}
+
+void Filter3x3::applyBand(const Bitmap& srcBmp, Bitmap& destBmp, int startLine,
+        int endLine) const
+{
+    int lineLen = destBmp.getSize().x;
+    for (int y = startLine; y < endLine; y++) {
+        const unsigned char * pSrc = srcBmp.getPixels()+y*srcBmp.getStride();
+        unsigned char * pDest = destBmp.getPixels()+y*destBmp.getStride();
+        switch (srcBmp.getBytesPerPixel()) {
             case 4:
-                convolveLine<Pixel32>(pSrc, pDest, newSize.x, pBmpSource->getStride());
+                convolveLine<Pixel32>(pSrc, pDest, lineLen, srcBmp.getStride());
                 break;
             case 3:
-                convolveLine<Pixel24>(pSrc, pDest, newSize.x, pBmpSource->getStride());
+                convolveLine<Pixel24>(pSrc, pDest, lineLen, srcBmp.getStride());
                 break;
             default:
                 AVG_ASSERT(false);
         }
     }
-    return pNewBmp;
 }
 
 }
@@ -42,6 +42,8 @@ public:
     virtual BitmapPtr apply(BitmapPtr pBmpSource);
 
 private:
+    void applyBand(const Bitmap& srcBmp, Bitmap& destBmp, int startLine,
+            int endLine) const;
     template<class PIXEL>
     void convolveLine(const unsigned char * pSrc, unsigned char * pDest,
             int lineLen, int stride) const;
@@ -27,6 +27,8 @@
 
 #include "../base/Exception.h"
 
+#include <boost/bind.hpp>
+
 #include <cstring>
 #include <iostream>
 #include <sstream>
@@ -48,13 +50,29 @@ BitmapPtr FilterFastBandpass::apply(BitmapPtr pBmpSrc)
     AVG_ASSERT(pBmpSrc->getPixelFormat() == I8);
     BitmapPtr pBmpDest = BitmapPtr(new Bitmap(pBmpSrc->getSize(), I8,
             pBmpSrc->getName()));
-    int srcStride = pBmpSrc->getStride();
-    int destStride = pBmpDest->getStride();
-    unsigned char * pSrcLine = pBmpSrc->getPixels()+3*srcStride;
-    unsigned char * pDestLine = pBmpDest->getPixels()+3*destStride;
-    IntPoint size = pBmpDest->getSize();
-    for (int y = 3; y < size.y-3; ++y) {
-        unsigned char * pSrcPixel = pSrcLine+3;
+    applyBands(boost::bind(&FilterFastBandpass::applyBand, this, boost::cref(*pBmpSrc),
+            boost::ref(*pBmpDest), _1, _2), pBmpDest->getSize(), 3);
+    return pBmpDest;
+}
+
+void FilterFastBandpass::applyBand(const Bitmap& srcBmp, Bitmap& destBmp,
+        int startLine, int endLine) const
+{
+    int srcStride = srcBmp.getStride();
+    int destStride = destBmp.getStride();
+    IntPoint size = destBmp.getSize();
+    // Set top and bottom borders.
+    for (int y = startLine; y < endLine; ++y) {
+        if (y < 3 || y >= size.y-3) {
+            memset(destBmp.getPixels()+y*destStride, 128, destStride);
+        }
+    }
+    int firstLine = max(startLine, 3);
+    int lastLine = min(endLine, size.y-3);
+    const unsigned char * pSrcLine = srcBmp.getPixels()+firstLine*srcStride;
+    unsigned char * pDestLine = destBmp.getPixels()+firstLine*destStride;
+    for (int y = firstLine; y < lastLine; ++y) {
+        const unsigned char * pSrcPixel = pSrcLine+3;
         unsigned char * pDstPixel = pDestLine;
         *pDstPixel++ = 128;
         *pDstPixel++ = 128;
@@ -83,10 +101,6 @@ BitmapPtr FilterFastBandpass::apply(BitmapPtr pBmpSrc)
         pSrcLine += srcStride;
         pDestLine += destStride;
     }
-    // Set top and bottom borders.
-    memset(pBmpDest->getPixels(), 128, destStride*3);
-    memset(pBmpDest->getPixels()+destStride*(size.y-3), 128, destStride*3);
-    return pBmpDest;
 }
 
 }
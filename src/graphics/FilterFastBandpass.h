@@ -39,6 +39,8 @@ class AVG_API FilterFastBandpass: public Filter{
         virtual BitmapPtr apply(BitmapPtr pBmpSrc);
 
     private:
+        void applyBand(const Bitmap& srcBmp, Bitmap& destBmp, int startLine,
+                int endLine) const;
 };
 
 typedef boost::shared_ptr<FilterFastBandpass> FilterFastBandpassPtr;
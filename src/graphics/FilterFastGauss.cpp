@@ -0,0 +1,278 @@
+//
+//  libavg - Media Playback Engine.
+//  Copyright (C) 2003-2014 Ulrich von Zadow
+//
+//  This library is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU Lesser General Public
+//  License as published by the Free Software Foundation; either
+//  version 2 of the License, or (at your option) any later version.
+//
+//  This library is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//  Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public
+//  License along with this library; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+//  Current versions can be found at www.libavg.de
+//
+#include "FilterFastGauss.h"
+#include "PixelKernels.h"
+
+#include "../base/Exception.h"
+
+#include <boost/bind.hpp>
+
+#include <algorithm>
+#include <sstream>
+#include <math.h>
+
+using namespace std;
+
+namespace avg {
+
+// Standard deviations above this are approximated by box blurs.
+static const float MAX_KERNEL_STD_DEV = 2.5f;
+
+// Number of source lines that are blurred together (see blurBand()).
+static const int BLOCK_LINES = 8;
+
+FilterFastGauss::FilterFastGauss(float stdDev, Method method)
+    : m_StdDev(stdDev),
+      m_Method(method)
+{
+    AVG_ASSERT(stdDev > 0);
+    if (m_Method == AUTO) {
+        if (stdDev > MAX_KERNEL_STD_DEV) {
+            m_Method = BOX;
+        } else {
+            m_Method = KERNEL;
+        }
+    }
+    if (m_Method == KERNEL) {
+        calcKernel();
+    } else {
+        calcBoxRadii();
+    }
+}
+
+FilterFastGauss::~FilterFastGauss()
+{
+}
+
+BitmapPtr FilterFastGauss::apply(BitmapPtr pBmpSrc)
+{
+    PixelFormat pf = pBmpSrc->getPixelFormat();
+    AVG_ASSERT(pf == I8 || pf == A8 || pf == B8G8R8A8 || pf == B8G8R8X8 || 
+            pf == R8G8B8A8 || pf == R8G8B8X8);
+    IntPoint size = pBmpSrc->getSize();
+    int bpp = pBmpSrc->getBytesPerPixel();
+
+    // Transposed intermediate result: One line per source column.
+    Bitmap tempBmp(IntPoint(size.y*bpp, size.x), I16);
+    applyBands(boost::bind(&FilterFastGauss::applyBand, this, boost::cref(*pBmpSrc),
+            boost::ref(tempBmp), _1, _2), tempBmp.getSize(), m_Halo);
+    BitmapPtr pDestBmp(new Bitmap(size, pf, pBmpSrc->getName()));
+    applyBands(boost::bind(&FilterFastGauss::applyBand, this, boost::cref(tempBmp),
+            boost::ref(*pDestBmp), _1, _2), size, m_Halo);
+    return pDestBmp;
+}
+
+float FilterFastGauss::getStdDev() const
+{
+    return m_StdDev;
+}
+
+FilterFastGauss::Method FilterFastGauss::getMethod() const
+{
+    return m_Method;
+}
+
+void FilterFastGauss::applyBand(const Bitmap& srcBmp, Bitmap& destBmp, int startLine,
+        int endLine) const
+{
+    // The first pass writes the I16 intermediate bitmap, the second one reads it.
+    if (destBmp.getPixelFormat() == I16) {
+        if (srcBmp.getBytesPerPixel() == 1) {
+            blurBand<unsigned char, unsigned short, 1>(srcBmp, destBmp, startLine,
+                    endLine);
+        } else {
+            blurBand<unsigned char, unsigned short, 4>(srcBmp, destBmp, startLine,
+                    endLine);
+        }
+    } else {
+        if (destBmp.getBytesPerPixel() == 1) {
+            blurBand<unsigned short, unsigned char, 1>(srcBmp, destBmp, startLine,
+                    endLine);
+        } else {
+            blurBand<unsigned short, unsigned char, 4>(srcBmp, destBmp, startLine,
+                    endLine);
+        }
+    }
+}
+
+// Conversions between 8-bit pixel values and 16-bit intermediate values.
+inline void toIntermediate(unsigned char src, unsigned short& dest)
+{
+    dest = (unsigned short)(src << 8);
+}
+
+inline void toIntermediate(unsigned short src, unsigned short& dest)
+{
+    dest = src;
+}
+
+inline void fromIntermediate(unsigned short src, unsigned short& dest)
+{
+    dest = src;
+}
+
+inline void fromIntermediate(unsigned short src, unsigned char& dest)
+{
+    dest = (unsigned char)(min((src+128) >> 8, 255));
+}
+
+// Blurs the part of every source line that corresponds to destination lines 
+// [startLine, endLine) and writes it transposed.
+// BLOCK_LINES source lines are blurred together. Their pixels are interleaved in the
+// line buffers, so the blur processes all lines in one go and every destination line
+// gets BLOCK_LINES consecutive pixels from one buffer position.
+template<class SRCVALUE, class DESTVALUE, int BPP>
+void FilterFastGauss::blurBand(const Bitmap& srcBmp, Bitmap& destBmp, int startLine,
+        int endLine) const
+{
+    int srcWidth = destBmp.getSize().y;
+    int numSrcLines = srcBmp.getSize().y;
+    int srcStride = srcBmp.getStride()/sizeof(SRCVALUE);
+    int destStride = destBmp.getStride()/sizeof(DESTVALUE);
+    const SRCVALUE* pSrc = (const SRCVALUE*)srcBmp.getPixels();
+    DESTVALUE* pDest = (DESTVALUE*)destBmp.getPixels();
+
+    int numPixels = endLine-startLine;
+    int blockStride = BLOCK_LINES*BPP;
+    vector<unsigned short> lines((numPixels+2*m_Halo)*blockStride);
+    vector<unsigned short> tempLines(lines.size());
+    vector<unsigned short> blurredLines(numPixels*blockStride);
+    int firstPixel = startLine-m_Halo;
+    int lastPixel = endLine+m_Halo;
+    int firstInside = max(firstPixel, 0);
+    int lastInside = min(lastPixel, srcWidth);
+    for (int y0 = 0; y0 < numSrcLines; y0 += BLOCK_LINES) {
+        int numLines = min(BLOCK_LINES, numSrcLines-y0);
+        for (int i = 0; i < numLines; ++i) {
+            const SRCVALUE* pSrcLine = pSrc+(y0+i)*srcStride;
+            unsigned short* pLineValue = &lines[i*BPP];
+            for (int x = firstPixel; x < lastPixel; ++x) {
+                // Pixels outside the bitmap are copies of the edge pixels.
+                const SRCVALUE* pSrcPixel;
+                if (x < firstInside) {
+                    pSrcPixel = pSrcLine;
+                } else if (x >= lastInside) {
+                    pSrcPixel = pSrcLine+(srcWidth-1)*BPP;
+                } else {
+                    pSrcPixel = pSrcLine+x*BPP;
+                }
+                for (int c = 0; c < BPP; ++c) {
+                    toIntermediate(pSrcPixel[c], pLineValue[c]);
+                }
+                pLineValue += blockStride;
+            }
+        }
+        blurLines(&lines[0], &tempLines[0], &blurredLines[0], numPixels, BPP);
+        int numValues = numLines*BPP;
+        for (int x = 0; x < numPixels; ++x) {
+            DESTVALUE* pDestValue = pDest+(startLine+x)*destStride+y0*BPP;
+            const unsigned short* pBlurredValue = &blurredLines[x*blockStride];
+            for (int i = 0; i < numValues; ++i) {
+                fromIntermediate(pBlurredValue[i], pDestValue[i]);
+            }
+        }
+    }
+}
+
+// pLines contains numPixels+2*m_Halo pixels of BLOCK_LINES interleaved lines. 
+// pLines and pTempLines may be overwritten.
+void FilterFastGauss::blurLines(unsigned short* pLines, unsigned short* pTempLines,
+        unsigned short* pDestLines, int numPixels, int bpp) const
+{
+    int blockStride = BLOCK_LINES*bpp;
+    if (m_Method == KERNEL) {
+        int kernelSize = int(m_Kernel.size());
+        // The products are truncated, so half a unit per tap is added back.
+        getPixelKernels().m_ConvolveLine16(pLines, pDestLines, numPixels*blockStride,
+                blockStride, &m_Kernel[0], kernelSize, (unsigned short)(kernelSize/2));
+    } else {
+        unsigned short* pSrc = pLines;
+        unsigned short* pDest = pTempLines;
+        int halo = m_Halo;
+        for (int i = 0; i < 3; ++i) {
+            halo -= m_BoxRadii[i];
+            if (i == 2) {
+                pDest = pDestLines;
+            }
+            int numDestPixels = numPixels+2*halo;
+            getPixelKernels().m_BoxBlurLine16(pSrc, pDest, numDestPixels, blockStride,
+                    m_BoxRadii[i]);
+            swap(pSrc, pDest);
+        }
+    }
+}
+
+void FilterFastGauss::calcKernel()
+{
+    m_Halo = int(ceil(3*m_StdDev));
+    int kernelSize = 2*m_Halo+1;
+    if (kernelSize > PixelKernels::MAX_CONVOLVE_KERNEL_SIZE) {
+        stringstream ss;
+        ss << "FilterFastGauss: Standard deviation " << m_StdDev << 
+                " is too large for Method KERNEL.";
+        throw Exception(AVG_ERR_OUT_OF_RANGE, ss.str());
+    }
+    vector<float> floatKernel(kernelSize);
+    float sum = 0;
+    for (int i = 0; i < kernelSize; ++i) {
+        float x = float(i-m_Halo);
+        floatKernel[i] = exp(-x*x/(2*m_StdDev*m_StdDev));
+        sum += floatKernel[i];
+    }
+    // The weights add up to 1 in 16.16 fixed point. The center weight gets the
+    // rounding error.
+    m_Kernel.resize(kernelSize);
+    int intSum = 0;
+    for (int i = 0; i < kernelSize; ++i) {
+        if (i != m_Halo) {
+            m_Kernel[i] = (unsigned short)(floatKernel[i]*65536/sum+0.5f);
+            intSum += m_Kernel[i];
+        }
+    }
+    m_Kernel[m_Halo] = (unsigned short)(min(65536-intSum, 65535));
+}
+
+void FilterFastGauss::calcBoxRadii()
+{
+    // Box widths whose combined variance is closest to the gaussian's (Kutskir,
+    // "Fastest Gaussian Blur").
+    float variance = m_StdDev*m_StdDev;
+    int lowWidth = int(floor(sqrt(4*variance+1)));
+    if (lowWidth % 2 == 0) {
+        lowWidth--;
+    }
+    float numLowBoxes = (12*variance - 3*lowWidth*lowWidth - 12*lowWidth - 9)/
+            (-4*lowWidth - 4);
+    int numLow = int(floor(numLowBoxes+0.5f));
+    m_Halo = 0;
+    for (int i = 0; i < 3; ++i) {
+        int width;
+        if (i < numLow) {
+            width = lowWidth;
+        } else {
+            width = lowWidth+2;
+        }
+        m_BoxRadii[i] = (width-1)/2;
+        m_Halo += m_BoxRadii[i];
+    }
+}
+
+}
@@ -0,0 +1,79 @@
+//
+//  libavg - Media Playback Engine.
+//  Copyright (C) 2003-2014 Ulrich von Zadow
+//
+//  This library is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU Lesser General Public
+//  License as published by the Free Software Foundation; either
+//  version 2 of the License, or (at your option) any later version.
+//
+//  This library is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//  Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public
+//  License along with this library; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+//  Current versions can be found at www.libavg.de
+//
+#ifndef _FilterFastGauss_H_
+#define _FilterFastGauss_H_
+
+#include "../api.h"
+#include "Filter.h"
+#include "Bitmap.h"
+
+#include <boost/shared_ptr.hpp>
+
+#include <vector>
+
+namespace avg {
+
+// Gaussian blur for I8, A8 and 32 bpp bitmaps. The result has the size of the source;
+// pixels outside the bitmap are taken to be copies of the nearest edge pixel.
+// The blur is done in two horizontal passes. Each pass writes its result transposed,
+// so the second pass blurs the columns of the image while reading memory line by 
+// line. The intermediate result has 16 bits per channel.
+// Small standard deviations use a sampled gaussian kernel. Large ones are approximated
+// by three box blurs computed with running sums, which take constant time per pixel
+// regardless of the radius.
+class AVG_API FilterFastGauss: public Filter
+{
+public:
+    enum Method {AUTO, KERNEL, BOX};
+
+    FilterFastGauss(float stdDev, Method method=AUTO);
+    virtual ~FilterFastGauss();
+
+    virtual BitmapPtr apply(BitmapPtr pBmpSrc);
+
+    float getStdDev() const;
+    // KERNEL or BOX.
+    Method getMethod() const;
+
+private:
+    void applyBand(const Bitmap& srcBmp, Bitmap& destBmp, int startLine,
+            int endLine) const;
+    void calcKernel();
+    void calcBoxRadii();
+    template<class SRCVALUE, class DESTVALUE, int BPP>
+    void blurBand(const Bitmap& srcBmp, Bitmap& destBmp, int startLine, int endLine)
+            const;
+    void blurLines(unsigned short* pLines, unsigned short* pTempLines, 
+            unsigned short* pDestLines, int numPixels, int bpp) const;
+
+    float m_StdDev;
+    Method m_Method;
+    std::vector<unsigned short> m_Kernel;
+    int m_BoxRadii[3];
+    // Number of pixels on each side of a pixel that contribute to it.
+    int m_Halo;
+};
+
+typedef boost::shared_ptr<FilterFastGauss> FilterFastGaussPtr;
+
+}
+
+#endif
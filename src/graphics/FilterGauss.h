@@ -40,7 +40,13 @@ class AVG_API FilterGauss: public Filter{
         void dumpKernel();
 
     private:
+        void applyBand(const Bitmap& srcBmp, Bitmap& destBmp, int startLine,
+                int endLine) const;
         void calcKernel();
+        void convolveLineX(const unsigned char * pSrcPixel, unsigned char * pTempPixel,
+                int width) const;
+        void convolveLineY(const unsigned char * pTempPixel, int tempStride,
+                unsigned char * pDestPixel, int width) const;
 
         float m_Radius;
         int m_KernelWidth;
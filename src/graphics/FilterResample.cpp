@@ -0,0 +1,504 @@
+//
+//  libavg - Media Playback Engine.
+//  Copyright (C) 2003-2014 Ulrich von Zadow
+//
+//  This library is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU Lesser General Public
+//  License as published by the Free Software Foundation; either
+//  version 2 of the License, or (at your option) any later version.
+//
+//  This library is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//  Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public
+//  License along with this library; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+//  Current versions can be found at www.libavg.de
+//
+
+#include "FilterResample.h"
+#include "ContribDefs.h"
+#include "PixelKernels.h"
+
+#include "../base/Exception.h"
+#include "../base/ThreadHelper.h"
+
+#include <boost/thread/mutex.hpp>
+#include <boost/bind.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <list>
+#include <map>
+#include <string>
+#include <typeinfo>
+#include <math.h>
+
+using namespace std;
+
+namespace avg {
+
+static const int WEIGHT_ONE = 1 << PixelKernels::RESAMPLE_PRECISION_BITS;
+
+// Weight tables kept by the cache. The oldest ones are dropped first.
+static const unsigned MAX_CACHED_CONTRIBS = 64;
+
+// Identifies a weight table. Tables computed with a ContribDef are identified by
+// the type and width of the ContribDef; m_sContribDefType is empty for the
+// built-in filter types.
+struct ContribKey
+{
+    ContribKey(int srcLen, int destLen, FilterResample::FilterType filterType)
+        : m_SrcLen(srcLen),
+          m_DestLen(destLen),
+          m_FilterType(filterType),
+          m_ContribDefWidth(0)
+    {
+    }
+
+    ContribKey(int srcLen, int destLen, const ContribDef& contribDef)
+        : m_SrcLen(srcLen),
+          m_DestLen(destLen),
+          m_FilterType(FilterResample::BOX),
+          m_sContribDefType(typeid(contribDef).name()),
+          m_ContribDefWidth(contribDef.GetWidth())
+    {
+    }
+
+    bool operator <(const ContribKey& other) const
+    {
+        if (m_SrcLen != other.m_SrcLen) {
+            return m_SrcLen < other.m_SrcLen;
+        }
+        if (m_DestLen != other.m_DestLen) {
+            return m_DestLen < other.m_DestLen;
+        }
+        if (m_FilterType != other.m_FilterType) {
+            return m_FilterType < other.m_FilterType;
+        }
+        if (m_sContribDefType != other.m_sContribDefType) {
+            return m_sContribDefType < other.m_sContribDefType;
+        }
+        return m_ContribDefWidth < other.m_ContribDefWidth;
+    }
+
+    int m_SrcLen;
+    int m_DestLen;
+    FilterResample::FilterType m_FilterType;
+    std::string m_sContribDefType;
+    float m_ContribDefWidth;
+};
+
+typedef map<ContribKey, ResampleContribsPtr> ContribCache;
+static ContribCache s_ContribCache;
+static list<ContribKey> s_ContribCacheOrder;
+static boost::mutex s_ContribCacheMutex;
+
+static ResampleContribsPtr findCachedContribs(const ContribKey& key)
+{
+    lock_guard lock(s_ContribCacheMutex);
+    ContribCache::iterator it = s_ContribCache.find(key);
+    if (it != s_ContribCache.end()) {
+        return it->second;
+    } else {
+        return ResampleContribsPtr();
+    }
+}
+
+static ResampleContribsPtr cacheContribs(const ContribKey& key,
+        ResampleContribsPtr pContribs)
+{
+    lock_guard lock(s_ContribCacheMutex);
+    // Another thread might have computed the same table in the meantime.
+    pair<ContribCache::iterator, bool> result = 
+            s_ContribCache.insert(make_pair(key, pContribs));
+    if (result.second) {
+        s_ContribCacheOrder.push_back(key);
+        if (s_ContribCacheOrder.size() > MAX_CACHED_CONTRIBS) {
+            s_ContribCache.erase(s_ContribCacheOrder.front());
+            s_ContribCacheOrder.pop_front();
+        }
+    }
+    return result.first->second;
+}
+
+static double boxFilter(double x)
+{
+    return (x >= -0.5 && x < 0.5) ? 1.0 : 0.0;
+}
+
+static double bilinearFilter(double x)
+{
+    x = fabs(x);
+    return x < 1.0 ? 1.0-x : 0.0;
+}
+
+// Keys' cubic convolution with a = -0.5.
+static double bicubicFilter(double x)
+{
+    const double a = -0.5;
+    x = fabs(x);
+    if (x < 1.0) {
+        return ((a+2.0)*x - (a+3.0))*x*x + 1.0;
+    } else if (x < 2.0) {
+        return ((a*x - 5.0*a)*x + 8.0*a)*x - 4.0*a;
+    } else {
+        return 0.0;
+    }
+}
+
+static double sinc(double x)
+{
+    if (x == 0.0) {
+        return 1.0;
+    }
+    x *= M_PI;
+    return sin(x)/x;
+}
+
+static double lanczosFilter(double x)
+{
+    if (fabs(x) < 3.0) {
+        return sinc(x)*sinc(x/3.0);
+    } else {
+        return 0.0;
+    }
+}
+
+FilterResample::FilterResample(const IntPoint& newSize, FilterType filterType)
+    : m_NewSize(newSize),
+      m_FilterType(filterType),
+      m_pContribDef(0)
+{
+}
+
+FilterResample::FilterResample(const IntPoint& newSize, const ContribDef& contribDef)
+    : m_NewSize(newSize),
+      m_FilterType(BILINEAR),
+      m_pContribDef(&contribDef)
+{
+}
+
+FilterResample::~FilterResample()
+{
+}
+
+BitmapPtr FilterResample::apply(BitmapPtr pBmpSrc)
+{
+    BitmapPtr pBmpDest(new Bitmap(m_NewSize, pBmpSrc->getPixelFormat(),
+            pBmpSrc->getName()+"_resized"));
+    resample(*pBmpSrc, *pBmpDest);
+    return pBmpDest;
+}
+
+void FilterResample::resample(const Bitmap& srcBmp, Bitmap& destBmp)
+{
+    PixelFormat pf = srcBmp.getPixelFormat();
+    int bpp = srcBmp.getBytesPerPixel();
+    if (!(bpp == 1 || bpp == 3 || bpp == 4) || pf == I32F) {
+        throw Exception(AVG_ERR_UNSUPPORTED, string("FilterResample: pixel format ")
+                + getPixelFormatString(pf) + " not supported.");
+    }
+    AVG_ASSERT(destBmp.getPixelFormat() == pf);
+    AVG_ASSERT(destBmp.getSize() == m_NewSize);
+    IntPoint srcSize = srcBmp.getSize();
+    if (m_NewSize.x <= 0 || m_NewSize.y <= 0 || srcSize.x <= 0 || srcSize.y <= 0) {
+        throw Exception(AVG_ERR_OUT_OF_RANGE, 
+                "FilterResample: Can't resample empty bitmaps.");
+    }
+
+    ResampleContribsPtr pHorizContribs = calcContribs(srcSize.x, m_NewSize.x);
+    ResampleContribsPtr pVertContribs = calcContribs(srcSize.y, m_NewSize.y);
+    // Each band scales the source lines it needs horizontally, so the lines in the
+    // vertical filter window are computed twice at band boundaries.
+    int haloLines = (pVertContribs->m_WindowSize*m_NewSize.y)/(2*srcSize.y)+1;
+    applyBands(boost::bind(&FilterResample::applyBand, this, boost::cref(srcBmp),
+            boost::ref(destBmp), boost::cref(*pHorizContribs), 
+            boost::cref(*pVertContribs), _1, _2), m_NewSize, haloLines);
+}
+
+ResampleContribsPtr FilterResample::getContribs(int srcLen, int destLen, 
+        FilterType filterType)
+{
+    ContribKey key(srcLen, destLen, filterType);
+    ResampleContribsPtr pContribs = findCachedContribs(key);
+    if (!pContribs) {
+        pContribs = cacheContribs(key, calcFilterContribs(srcLen, destLen, filterType));
+    }
+    return pContribs;
+}
+
+ResampleContribsPtr FilterResample::getContribs(int srcLen, int destLen, 
+        const ContribDef& contribDef)
+{
+    ContribKey key(srcLen, destLen, contribDef);
+    ResampleContribsPtr pContribs = findCachedContribs(key);
+    if (!pContribs) {
+        pContribs = cacheContribs(key, calcLegacyContribs(srcLen, destLen, contribDef));
+    }
+    return pContribs;
+}
+
+int FilterResample::getNumCachedContribs()
+{
+    lock_guard lock(s_ContribCacheMutex);
+    return int(s_ContribCache.size());
+}
+
+void FilterResample::clearContribCache()
+{
+    lock_guard lock(s_ContribCacheMutex);
+    s_ContribCache.clear();
+    s_ContribCacheOrder.clear();
+}
+
+void FilterResample::applyBand(const Bitmap& srcBmp, Bitmap& destBmp,
+        const ResampleContribs& horizContribs, const ResampleContribs& vertContribs,
+        int startLine, int endLine) const
+{
+    const PixelKernels& kernels = getPixelKernels();
+    int bpp = srcBmp.getBytesPerPixel();
+    IntPoint srcSize = srcBmp.getSize();
+    IntPoint destSize = destBmp.getSize();
+    int srcStride = srcBmp.getStride();
+    int destLineLen = destSize.x*bpp;
+
+    // Source lines needed by this band.
+    int srcStartLine = vertContribs.m_Left[startLine];
+    int srcEndLine = srcStartLine;
+    for (int y = startLine; y < endLine; ++y) {
+        srcEndLine = max(srcEndLine, vertContribs.m_Left[y]+vertContribs.m_NumTaps[y]);
+    }
+
+    // Scale the source lines horizontally.
+    const unsigned char* pTempLines;
+    int tempStride;
+    vector<unsigned char> tempLines;
+    if (srcSize.x != destSize.x) {
+        tempStride = destLineLen;
+        tempLines.resize(size_t(srcEndLine-srcStartLine)*tempStride);
+        // The horizontal kernel reads up to m_WeightStride pixels from the left edge
+        // of the filter window. Lines where this would read beyond the end of the
+        // bitmap are copied to a larger buffer first.
+        int maxReach = (horizContribs.m_Left[destSize.x-1]+horizContribs.m_WeightStride)
+                *bpp;
+        size_t bitmapEnd = size_t(srcSize.y-1)*srcStride+srcSize.x*bpp;
+        vector<unsigned char> paddedLine;
+        for (int y = srcStartLine; y < srcEndLine; ++y) {
+            const unsigned char* pSrcLine = srcBmp.getPixels()+size_t(y)*srcStride;
+            if (size_t(y)*srcStride+maxReach > bitmapEnd) {
+                paddedLine.resize(maxReach);
+                memcpy(&paddedLine[0], pSrcLine, srcSize.x*bpp);
+                pSrcLine = &paddedLine[0];
+            }
+            kernels.m_ResampleLineH(pSrcLine, &tempLines[(y-srcStartLine)*tempStride],
+                    destSize.x, bpp, &horizContribs.m_Left[0], 
+                    &horizContribs.m_NumTaps[0], &horizContribs.m_Weights[0],
+                    horizContribs.m_WeightStride);
+        }
+        pTempLines = &tempLines[0];
+    } else {
+        tempStride = srcStride;
+        pTempLines = srcBmp.getPixels()+size_t(srcStartLine)*srcStride;
+    }
+
+    // Scale vertically into the destination.
+    vector<const unsigned char*> pSrcLines(vertContribs.m_WindowSize);
+    for (int y = startLine; y < endLine; ++y) {
+        unsigned char* pDestLine = destBmp.getPixels()+size_t(y)*destBmp.getStride();
+        if (srcSize.y != destSize.y) {
+            int left = vertContribs.m_Left[y]-srcStartLine;
+            int numTaps = vertContribs.m_NumTaps[y];
+            for (int k = 0; k < numTaps; ++k) {
+                pSrcLines[k] = pTempLines+size_t(left+k)*tempStride;
+            }
+            kernels.m_ResampleLineV(&pSrcLines[0], pDestLine, destLineLen,
+                    &vertContribs.m_Weights[y*vertContribs.m_WeightStride], numTaps);
+        } else {
+            memcpy(pDestLine, pTempLines+size_t(y-srcStartLine)*tempStride,
+                    destLineLen);
+        }
+    }
+}
+
+ResampleContribsPtr FilterResample::calcContribs(int srcLen, int destLen) const
+{
+    if (m_pContribDef) {
+        return getContribs(srcLen, destLen, *m_pContribDef);
+    } else {
+        return getContribs(srcLen, destLen, m_FilterType);
+    }
+}
+
+static void initContribs(ResampleContribs* pContribs, int srcLen, int destLen,
+        int windowSize)
+{
+    pContribs->m_SrcLen = srcLen;
+    pContribs->m_DestLen = destLen;
+    pContribs->m_WindowSize = windowSize;
+    pContribs->m_WeightStride = (windowSize+7)/8*8;
+    pContribs->m_Left.assign(destLen, 0);
+    pContribs->m_NumTaps.assign(destLen, 0);
+    pContribs->m_Weights.assign(size_t(destLen)*pContribs->m_WeightStride, 0);
+}
+
+ResampleContribsPtr FilterResample::calcFilterContribs(int srcLen, int destLen,
+        FilterType filterType)
+{
+    double (*pFilter)(double);
+    double support;
+    switch (filterType) {
+        case BOX:
+            pFilter = boxFilter;
+            support = 0.5;
+            break;
+        case BILINEAR:
+            pFilter = bilinearFilter;
+            support = 1.0;
+            break;
+        case BICUBIC:
+            pFilter = bicubicFilter;
+            support = 2.0;
+            break;
+        case LANCZOS:
+            pFilter = lanczosFilter;
+            support = 3.0;
+            break;
+        default:
+            AVG_ASSERT(false);
+            return ResampleContribsPtr();
+    }
+    double scale = double(srcLen)/destLen;
+    // When shrinking, the filter is widened to cover all source pixels.
+    double filterScale = max(scale, 1.0);
+    support *= filterScale;
+    int windowSize = int(ceil(support))*2+1;
+    if (srcLen == destLen) {
+        windowSize = 1;
+    }
+
+    ResampleContribs* pContribs = new ResampleContribs;
+    ResampleContribsPtr pResult(pContribs);
+    initContribs(pContribs, srcLen, destLen, windowSize);
+    vector<double> weights(windowSize);
+    for (int x = 0; x < destLen; ++x) {
+        short* pWeights = &pContribs->m_Weights[x*pContribs->m_WeightStride];
+        if (srcLen == destLen) {
+            pContribs->m_Left[x] = x;
+            pContribs->m_NumTaps[x] = 1;
+            pWeights[0] = WEIGHT_ONE;
+            continue;
+        }
+        double center = (x+0.5)*scale;
+        int left = max(int(floor(center-support+0.5)), 0);
+        int right = min(int(floor(center+support+0.5)), srcLen);
+        right = min(right, left+windowSize);
+        int numTaps = right-left;
+        double totalWeight = 0;
+        for (int k = 0; k < numTaps; ++k) {
+            weights[k] = pFilter((left+k-center+0.5)/filterScale);
+            totalWeight += weights[k];
+        }
+        if (numTaps == 0 || totalWeight == 0) {
+            // Can only happen if rounding makes the window miss all source pixels.
+            left = min(int(center), srcLen-1);
+            numTaps = 1;
+            weights[0] = 1;
+            totalWeight = 1;
+        }
+        pContribs->m_Left[x] = left;
+        pContribs->m_NumTaps[x] = numTaps;
+        // Round to fixed point and give the rounding error to the largest weight, so
+        // the weights always sum to exactly one.
+        int fixedSum = 0;
+        int maxTap = 0;
+        for (int k = 0; k < numTaps; ++k) {
+            int weight = int(floor(weights[k]/totalWeight*WEIGHT_ONE+0.5));
+            pWeights[k] = short(weight);
+            fixedSum += weight;
+            if (weights[k] > weights[maxTap]) {
+                maxTap = k;
+            }
+        }
+        pWeights[maxTap] = short(pWeights[maxTap]+WEIGHT_ONE-fixedSum);
+    }
+    return pResult;
+}
+
+// Weight calculation of the original two-pass scaler by Eran Yariv and Jake
+// Montgomery (posted on codeguru.com). The weights have 8 fractional bits and are
+// scaled to RESAMPLE_PRECISION_BITS. The kernels round the same way the scaler did,
+// so the results don't change.
+ResampleContribsPtr FilterResample::calcLegacyContribs(int srcLen, int destLen,
+        const ContribDef& contribDef)
+{
+    const int LEGACY_SHIFT = PixelKernels::RESAMPLE_PRECISION_BITS-8;
+    ResampleContribs* pContribs = new ResampleContribs;
+    ResampleContribsPtr pResult(pContribs);
+    if (srcLen == destLen) {
+        // The lines are copied in this case.
+        initContribs(pContribs, srcLen, destLen, 1);
+        for (int x = 0; x < destLen; ++x) {
+            pContribs->m_Left[x] = x;
+            pContribs->m_NumTaps[x] = 1;
+            pContribs->m_Weights[x*pContribs->m_WeightStride] = WEIGHT_ONE;
+        }
+        return pResult;
+    }
+
+    float scale = float(destLen)/srcLen;
+    float width;
+    float fScale = 1.0;
+    float filterWidth = contribDef.GetWidth();
+    if (scale < 1.0) {
+        width = filterWidth/scale;
+        fScale = scale;
+    } else {
+        width = filterWidth;
+    }
+    int windowSize = 2*(int)ceil(width)+1;
+    initContribs(pContribs, srcLen, destLen, windowSize);
+
+    for (int x = 0; x < destLen; ++x) {
+        short* pWeights = &pContribs->m_Weights[x*pContribs->m_WeightStride];
+        float center = (x+0.5f)/scale-0.5f;
+        int left = max(0, (int)floor(center-width));
+        int right = min((int)ceil(center+width), srcLen-1);
+        if (right-left+1 > windowSize) {
+            if (left < (srcLen-1/2)) {
+                left++;
+            } else {
+                right--;
+            }
+        }
+        pContribs->m_Left[x] = left;
+        pContribs->m_NumTaps[x] = right-left+1;
+
+        vector<int> weights(right-left+1);
+        int totalWeight = 0;
+        for (int src = left; src <= right; src++) {
+            int weight = int(fScale*(contribDef.Filter(fScale*(center-(float)src)))*256);
+            weights[src-left] = weight;
+            totalWeight += weight;
+        }
+        AVG_ASSERT(totalWeight >= 0);
+        if (totalWeight > 0) {
+            int usedWeight = 0;
+            for (int src = left; src < right; src++) {
+                int weight = (weights[src-left]*256)/totalWeight;
+                weights[src-left] = weight;
+                usedWeight += weight;
+            }
+            weights[right-left] = 256-usedWeight;
+        }
+        for (int k = 0; k <= right-left; ++k) {
+            pWeights[k] = short(weights[k]*(1 << LEGACY_SHIFT));
+        }
+    }
+    return pResult;
+}
+
+}
@@ -0,0 +1,108 @@
+//
+//  libavg - Media Playback Engine.
+//  Copyright (C) 2003-2014 Ulrich von Zadow
+//
+//  This library is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU Lesser General Public
+//  License as published by the Free Software Foundation; either
+//  version 2 of the License, or (at your option) any later version.
+//
+//  This library is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//  Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public
+//  License along with this library; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+//  Current versions can be found at www.libavg.de
+//
+
+#ifndef _FilterResample_H_
+#define _FilterResample_H_
+
+#include "../api.h"
+#include "Filter.h"
+#include "Bitmap.h"
+
+#include <boost/shared_ptr.hpp>
+
+#include <vector>
+
+namespace avg {
+
+class ContribDef;
+
+// Weights for resampling a line of m_SrcLen pixels to m_DestLen pixels. Destination
+// pixel x is the weighted sum of the m_NumTaps[x] source pixels starting at
+// m_Left[x]. Weights are fixed-point numbers with 
+// PixelKernels::RESAMPLE_PRECISION_BITS fractional bits; each destination pixel has
+// m_WeightStride of them, padded with zeros.
+struct AVG_API ResampleContribs
+{
+    int m_SrcLen;
+    int m_DestLen;
+    // Maximum number of taps.
+    int m_WindowSize;
+    // m_WindowSize rounded up to a multiple of 8.
+    int m_WeightStride;
+    std::vector<int> m_Left;
+    std::vector<int> m_NumTaps;
+    std::vector<short> m_Weights;
+};
+
+typedef boost::shared_ptr<const ResampleContribs> ResampleContribsPtr;
+
+// Resizes I8, A8, 24 bpp and 32 bpp bitmaps. The image is scaled horizontally, then
+// vertically, with an 8-bit intermediate result. Both passes use SIMD kernels, and
+// large bitmaps are split into bands that are resampled in parallel. Weight tables
+// are cached per source size, destination size and filter type, so resizing many
+// images to the same size only computes them once. A FilterResample can be used by
+// several threads at once.
+class AVG_API FilterResample: public Filter
+{
+public:
+    enum FilterType {BOX, BILINEAR, BICUBIC, LANCZOS};
+
+    FilterResample(const IntPoint& newSize, FilterType filterType=BILINEAR);
+    // Computes the weights with contribDef using the original algorithm of
+    // FilterResizeBilinear and FilterResizeGaussian, so their results stay the same.
+    // contribDef must stay valid as long as the filter is used. The weights are
+    // cached per type and width of contribDef, so ContribDef subclasses must not
+    // have other parameters that change the weights.
+    FilterResample(const IntPoint& newSize, const ContribDef& contribDef);
+    virtual ~FilterResample();
+
+    virtual BitmapPtr apply(BitmapPtr pBmpSrc);
+    // Resamples srcBmp into destBmp, which must have the new size and the pixel 
+    // format of srcBmp.
+    void resample(const Bitmap& srcBmp, Bitmap& destBmp);
+
+    static ResampleContribsPtr getContribs(int srcLen, int destLen,
+            FilterType filterType);
+    static ResampleContribsPtr getContribs(int srcLen, int destLen,
+            const ContribDef& contribDef);
+    static int getNumCachedContribs();
+    static void clearContribCache();
+
+private:
+    void applyBand(const Bitmap& srcBmp, Bitmap& destBmp,
+            const ResampleContribs& horizContribs, const ResampleContribs& vertContribs,
+            int startLine, int endLine) const;
+    ResampleContribsPtr calcContribs(int srcLen, int destLen) const;
+    static ResampleContribsPtr calcFilterContribs(int srcLen, int destLen,
+            FilterType filterType);
+    static ResampleContribsPtr calcLegacyContribs(int srcLen, int destLen,
+            const ContribDef& contribDef);
+
+    IntPoint m_NewSize;
+    FilterType m_FilterType;
+    const ContribDef* m_pContribDef;
+};
+
+typedef boost::shared_ptr<FilterResample> FilterResamplePtr;
+
+}
+
+#endif
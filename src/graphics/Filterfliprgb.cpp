@@ -20,7 +20,6 @@
 //
 
 #include "Filterfliprgb.h"
-#include "Pixeldefs.h"
 
 #include "../base/Exception.h"
 
@@ -41,51 +40,46 @@ FilterFlipRGB::~FilterFlipRGB()
 
 }
 
+BitmapPtr FilterFlipRGB::apply(BitmapPtr pBmpSource)
+{
+    AVG_ASSERT(pBmpSource->getBytesPerPixel() >= 3);
+    PixelFormat pf = pBmpSource->getPixelFormat();
+    if (m_bChangePF) {
+        pf = getFlippedPF(pf);
+    }
+    BitmapPtr pBmpDest(new Bitmap(pBmpSource->getSize(), pf, pBmpSource->getName()));
+    pBmpDest->copyPixelsSwapRB(*pBmpSource);
+    return pBmpDest;
+}
+
 void FilterFlipRGB::applyInPlace(BitmapPtr pBmp) 
 {
     AVG_ASSERT(pBmp->getBytesPerPixel() >= 3);
-    PixelFormat PF = pBmp->getPixelFormat();
     if (m_bChangePF) {
-        switch(PF) {
-            case B8G8R8A8:
-                pBmp->setPixelFormat(R8G8B8A8);
-                break;
-            case B8G8R8X8:
-                pBmp->setPixelFormat(R8G8B8X8);
-                break;
-            case R8G8B8A8:
-                pBmp->setPixelFormat(B8G8R8A8);
-                break;
-            case R8G8B8X8:
-                pBmp->setPixelFormat(B8G8R8X8);
-                break;
-            case R8G8B8:
-                pBmp->setPixelFormat(B8G8R8);
-                break;
-            case B8G8R8:
-                pBmp->setPixelFormat(R8G8B8);
-                break;
-            default:
-                // Only 24 and 32 bpp supported.
-                AVG_ASSERT(false);
-        }
+        pBmp->setPixelFormat(getFlippedPF(pBmp->getPixelFormat()));
     }
-    IntPoint size = pBmp->getSize();
-    for (int y = 0; y < size.y; y++) {
-        unsigned char * pLine = pBmp->getPixels()+y*pBmp->getStride();
-        if (pBmp->getBytesPerPixel() == 4) {
-            for (int x = 0; x < size.x; x++) { 
-                unsigned char tmp = pLine[x*4+REDPOS];
-                pLine[x*4+REDPOS] = pLine[x*4+BLUEPOS];
-                pLine[x*4+BLUEPOS] = tmp;
-            }
-        } else {
-            for (int x = 0; x < size.x; x++) { 
-                unsigned char tmp = pLine[x*3+REDPOS];
-                pLine[x*3+REDPOS] = pLine[x*3+BLUEPOS];
-                pLine[x*3+BLUEPOS] = tmp;
-            } 
-        }
+    pBmp->copyPixelsSwapRB(*pBmp);
+}
+
+PixelFormat FilterFlipRGB::getFlippedPF(PixelFormat pf)
+{
+    switch(pf) {
+        case B8G8R8A8:
+            return R8G8B8A8;
+        case B8G8R8X8:
+            return R8G8B8X8;
+        case R8G8B8A8:
+            return B8G8R8A8;
+        case R8G8B8X8:
+            return B8G8R8X8;
+        case R8G8B8:
+            return B8G8R8;
+        case B8G8R8:
+            return R8G8B8;
+        default:
+            // Only 24 and 32 bpp supported.
+            AVG_ASSERT(false);
+            return pf;
     }
 }
 
@@ -33,9 +33,13 @@ class AVG_API FilterFlipRGB : public Filter
 public:
     FilterFlipRGB(bool bChangePF = true);
     virtual ~FilterFlipRGB();
-    virtual void applyInPlace(BitmapPtr pBmp) ;
+    // Copies and swaps in one pass.
+    virtual BitmapPtr apply(BitmapPtr pBmpSource);
+    virtual void applyInPlace(BitmapPtr pBmp);
 
 private:
+    static PixelFormat getFlippedPF(PixelFormat pf);
+
     bool m_bChangePF;
 };
 
@@ -23,6 +23,8 @@
 
 #include "Pixeldefs.h"
 
+#include <boost/bind.hpp>
+
 #include <iostream>
 
 namespace avg {
@@ -47,12 +49,21 @@ BitmapPtr FilterGrayscale::apply(BitmapPtr pBmpSrc)
     }
     BitmapPtr pBmpDest = BitmapPtr(new Bitmap(pBmpSrc->getSize(), I8,
              pBmpSrc->getName()));
-    unsigned char * pSrcLine = pBmpSrc->getPixels();
-    unsigned char * pDestLine = pBmpDest->getPixels();
-    IntPoint size = pBmpDest->getSize();
-    int bpp = pBmpSrc->getBytesPerPixel();
-    for (int y = 0; y<size.y; ++y) {
-        unsigned char * pSrcPixel = pSrcLine;
+    applyBands(boost::bind(&FilterGrayscale::applyBand, this, boost::cref(*pBmpSrc),
+            boost::ref(*pBmpDest), _1, _2), pBmpDest->getSize());
+    return pBmpDest;
+}
+
+void FilterGrayscale::applyBand(const Bitmap& srcBmp, Bitmap& destBmp, int startLine,
+        int endLine) const
+{
+    PixelFormat PF = srcBmp.getPixelFormat();
+    const unsigned char * pSrcLine = srcBmp.getPixels()+startLine*srcBmp.getStride();
+    unsigned char * pDestLine = destBmp.getPixels()+startLine*destBmp.getStride();
+    IntPoint size = destBmp.getSize();
+    int bpp = srcBmp.getBytesPerPixel();
+    for (int y = startLine; y < endLine; ++y) {
+        const unsigned char * pSrcPixel = pSrcLine;
         unsigned char * pDstPixel = pDestLine;
         for (int x = 0; x < size.x; ++x) {
             // For the coefficients used, see http://www.inforamp.net/~poynton/
@@ -71,10 +82,9 @@ BitmapPtr FilterGrayscale::apply(BitmapPtr pBmpSrc)
                 ++pDstPixel;
             }
         }
-        pSrcLine = pSrcLine + pBmpSrc->getStride();
-        pDestLine = pDestLine + pBmpDest->getStride();
+        pSrcLine = pSrcLine + srcBmp.getStride();
+        pDestLine = pDestLine + destBmp.getStride();
     }
-    return pBmpDest;
 }
 
 } 
@@ -37,6 +37,8 @@ public:
   virtual BitmapPtr apply(BitmapPtr pBmpSource);
 
 private:
+  void applyBand(const Bitmap& srcBmp, Bitmap& destBmp, int startLine,
+          int endLine) const;
 };
 
 } // namespace
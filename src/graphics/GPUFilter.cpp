@@ -26,7 +26,6 @@
 #include "GLContext.h"
 #include "GLContextManager.h"
 #include "ShaderRegistry.h"
-#include "Filterfliprgb.h"
 #include "BitmapLoader.h"
 #include "MCFBO.h"
 #include "MCTexture.h"
@@ -95,23 +94,20 @@ BitmapPtr GPUFilter::apply(BitmapPtr pBmpSource)
     apply(m_pSrcTex->getCurTex());
     BitmapPtr pFilteredBmp = m_pFBOs[0]->getImage();
 
-    BitmapPtr pTmpBmp;
+    BitmapPtr pDestBmp;
     if (pixelFormatIsBlueFirst(pFilteredBmp->getPixelFormat()) !=
             pixelFormatIsBlueFirst(pBmpSource->getPixelFormat()) &&
         pFilteredBmp->getBytesPerPixel() <= 4)
     {
-        pTmpBmp = FilterFlipRGB().apply(pFilteredBmp);
-    } else {
-        pTmpBmp = pFilteredBmp;
-    }
-
-    BitmapPtr pDestBmp;
-    if (pTmpBmp->getPixelFormat() != pBmpSource->getPixelFormat()) {
         pDestBmp = BitmapPtr(new Bitmap(m_DestRect.size(),
                 pBmpSource->getPixelFormat()));
-        pDestBmp->copyPixels(*pTmpBmp);
+        pDestBmp->copyPixelsSwapRB(*pFilteredBmp);
+    } else if (pFilteredBmp->getPixelFormat() != pBmpSource->getPixelFormat()) {
+        pDestBmp = BitmapPtr(new Bitmap(m_DestRect.size(),
+                pBmpSource->getPixelFormat()));
+        pDestBmp->copyPixels(*pFilteredBmp);
     } else {
-        pDestBmp = pTmpBmp;
+        pDestBmp = pFilteredBmp;
     }
     return pDestBmp;
 }
@@ -0,0 +1,44 @@
+//
+//  libavg - Media Playback Engine.
+//  Copyright (C) 2003-2014 Ulrich von Zadow
+//
+//  This library is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU Lesser General Public
+//  License as published by the Free Software Foundation; either
+//  version 2 of the License, or (at your option) any later version.
+//
+//  This library is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//  Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public
+//  License along with this library; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+//  Current versions can be found at www.libavg.de
+//
+
+#ifndef _GdkPixbufDecoder_H_
+#define _GdkPixbufDecoder_H_
+
+#include "../api.h"
+
+#include "ImageDecoder.h"
+
+namespace avg {
+
+// Decodes all formats gdk-pixbuf has loaders for. Used for files no native decoder
+// recognizes.
+class AVG_API GdkPixbufDecoder: public ImageDecoder
+{
+public:
+    virtual std::string getName() const;
+    virtual bool canDecode(const unsigned char* pHeader, int headerLen) const;
+    virtual BitmapPtr decode(const UTF8String& sFilename, PixelFormat pf,
+            const IntPoint& maxDecodeSize) const;
+};
+
+}
+
+#endif
@@ -24,6 +24,7 @@
 #include "BitmapLoader.h"
 #include "Filterfliprgb.h"
 #include "Filtergrayscale.h"
+#include "ImageCompare.h"
 
 #include "../base/Directory.h"
 #include "../base/Exception.h"
@@ -84,6 +85,45 @@ void GraphicsTest::testEqual(Bitmap& resultBmp, const string& sFName, PixelForma
 
 void GraphicsTest::testEqual(Bitmap& resultBmp, Bitmap& baselineBmp, 
         const string& sFName, float maxAverage, float maxStdDev)
+{
+    if (!ImageCompare::isPixelFormatSupported(resultBmp.getPixelFormat())) {
+        testEqualBySubtraction(resultBmp, baselineBmp, sFName, maxAverage, maxStdDev);
+        return;
+    }
+    ImageComparePtr pCompare;
+    try {
+        pCompare = ImageComparePtr(new ImageCompare(resultBmp, baselineBmp));
+    } catch (Exception& e) {
+        TEST_FAILED("Error: " << e.getStr() << ". File: '" << sFName << "'.");
+        string sResultName = "resultimages/"+sFName;
+        resultBmp.save(sResultName+".png");
+        baselineBmp.save(sResultName+"_baseline.png");
+    }
+    if (pCompare) {
+        float average = pCompare->getAvg();
+        float stdDev = pCompare->getStdDev();
+        if (average > maxAverage || stdDev > maxStdDev) {
+            stringstream ssMaxDiffs;
+            for (int i = 0; i < pCompare->getNumChannels(); ++i) {
+                ssMaxDiffs << (i == 0 ? "" : ", ") << pCompare->getMaxDiff(i);
+            }
+            TEST_FAILED("Error: Decoded image differs from baseline '" << 
+                    sFName << "'. average=" << average << ", stdDev=" << stdDev << 
+                    ", max. channel differences=(" << ssMaxDiffs.str() << 
+                    "), differing pixels=" << pCompare->getNumMismatches());
+            string sResultName = "resultimages/"+sFName;
+            resultBmp.save(sResultName+".png");
+            baselineBmp.save(sResultName+"_baseline.png");
+            BitmapPtr pDiffBmp = resultBmp.subtract(baselineBmp);
+            pDiffBmp->save(sResultName+"_diff.png");
+            ImageCompare(resultBmp, baselineBmp, 0, true).getMismatchMask()->save(
+                    sResultName+"_mask.png");
+        }
+    }
+}
+
+void GraphicsTest::testEqualBySubtraction(Bitmap& resultBmp, Bitmap& baselineBmp, 
+        const string& sFName, float maxAverage, float maxStdDev)
 {
     BitmapPtr pDiffBmp;
     try {
@@ -100,12 +140,9 @@ void GraphicsTest::testEqual(Bitmap& resultBmp, Bitmap& baselineBmp,
         if (average > maxAverage || stdDev > maxStdDev) {
             TEST_FAILED("Error: Decoded image differs from baseline '" << 
                     sFName << "'. average=" << average << ", stdDev=" << stdDev);
-    //        resultBmp.dump();
-    //        baselineBmp.dump();
             string sResultName = "resultimages/"+sFName;
             resultBmp.save(sResultName+".png");
             baselineBmp.save(sResultName+"_baseline.png");
-            BitmapPtr pDiffBmp = resultBmp.subtract(baselineBmp);
             pDiffBmp->save(sResultName+"_diff.png");
         }
     }
@@ -44,6 +44,8 @@ protected:
     void testEqualBrightness(Bitmap& resultBmp, Bitmap& baselineBmp, float epsilon);
 
 private:
+    void testEqualBySubtraction(Bitmap& resultBmp, Bitmap& baselineBmp,
+        const std::string& sFName, float maxAverage, float maxStdDev);
     int sumPixels(Bitmap& bmp);
 
 };
@@ -0,0 +1,370 @@
+//
+//  libavg - Media Playback Engine.
+//  Copyright (C) 2003-2014 Ulrich von Zadow
+//
+//  This library is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU Lesser General Public
+//  License as published by the Free Software Foundation; either
+//  version 2 of the License, or (at your option) any later version.
+//
+//  This library is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//  Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public
+//  License along with this library; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+//  Current versions can be found at www.libavg.de
+//
+//
+
+#include "ImageCompare.h"
+#include "PixelKernels.h"
+
+#include "../base/Exception.h"
+#include "../base/TaskScheduler.h"
+#include "../base/ProfilingZoneID.h"
+
+#include <boost/bind.hpp>
+#include <boost/atomic.hpp>
+
+#include <math.h>
+#include <string.h>
+#include <stdlib.h>
+#include <sstream>
+
+using namespace std;
+
+namespace avg {
+
+static ProfilingZoneID ImageCompareProfilingZone("Image compare", true);
+
+ImageCompare::ImageCompare(const Bitmap& bmp1, const Bitmap& bmp2, int tolerance,
+        bool bCreateMismatchMask)
+{
+    compare(bmp1, bmp2, tolerance, bCreateMismatchMask, -1, -1);
+}
+
+ImageCompare::ImageCompare()
+{
+}
+
+int ImageCompare::getNumChannels() const
+{
+    return m_NumChannels;
+}
+
+int ImageCompare::getMaxDiff(int channel) const
+{
+    checkChannel(channel);
+    return m_MaxDiff[channel];
+}
+
+float ImageCompare::getMeanError(int channel) const
+{
+    checkChannel(channel);
+    return float(double(m_Sum[channel])/m_NumPixels);
+}
+
+int ImageCompare::getNumMismatches() const
+{
+    return m_NumMismatches;
+}
+
+BitmapPtr ImageCompare::getMismatchMask() const
+{
+    if (!m_pMismatchMask) {
+        throw Exception(AVG_ERR_UNSUPPORTED,
+                "ImageCompare: Mismatch mask requested but not created.");
+    }
+    return m_pMismatchMask;
+}
+
+float ImageCompare::getAvg() const
+{
+    if (m_bAlphaWeighted) {
+        return float(double(m_WeightedSum)/(4.*m_NumPixels));
+    }
+    long long sum = 0;
+    int numChannels = 0;
+    for (int i = 0; i < m_NumChannels; ++i) {
+        if (i != m_UnusedChannel) {
+            sum += m_Sum[i];
+            numChannels++;
+        }
+    }
+    return float(double(sum)/(double(numChannels)*m_NumPixels));
+}
+
+float ImageCompare::getStdDev() const
+{
+    double avg = getAvg();
+    double variance;
+    if (m_bAlphaWeighted) {
+        // Bitmap::getStdDev() only sums up the pixels with an alpha difference, but
+        // divides by the number of all values.
+        variance = (m_WeightedSqrSum - 2*avg*m_WeightedValueSum +
+                4*m_NumWeightedPixels*avg*avg) / (4.*m_NumPixels);
+    } else {
+        long long sqrSum = 0;
+        int numChannels = 0;
+        for (int i = 0; i < m_NumChannels; ++i) {
+            if (i != m_UnusedChannel) {
+                sqrSum += m_SqrSum[i];
+                numChannels++;
+            }
+        }
+        variance = double(sqrSum)/(double(numChannels)*m_NumPixels) - avg*avg;
+    }
+    return float(sqrt(max(variance, 0.)));
+}
+
+bool ImageCompare::isSimilar(const Bitmap& bmp1, const Bitmap& bmp2, float maxAvg,
+        float maxStdDev)
+{
+    ImageCompare imgCompare;
+    if (!imgCompare.compare(bmp1, bmp2, 0, false, maxAvg, maxStdDev)) {
+        return false;
+    }
+    return imgCompare.getAvg() <= maxAvg && imgCompare.getStdDev() <= maxStdDev;
+}
+
+bool ImageCompare::isPixelFormatSupported(PixelFormat pf)
+{
+    return getBytesPerPixel(pf) <= 4 && pf != I16 && pf != I32F;
+}
+
+static void compareBitmaps(const vector<BitmapPtr>& pBmps1,
+        const vector<BitmapPtr>& pBmps2, int tolerance, bool bCreateMismatchMasks,
+        vector<ImageComparePtr>& pResults, boost::atomic<int>& nextIndex)
+{
+    int i = nextIndex.fetch_add(1);
+    while (i < int(pBmps1.size())) {
+        pResults[i] = ImageComparePtr(new ImageCompare(*pBmps1[i], *pBmps2[i],
+                tolerance, bCreateMismatchMasks));
+        i = nextIndex.fetch_add(1);
+    }
+}
+
+vector<ImageComparePtr> ImageCompare::compareAll(const vector<BitmapPtr>& pBmps1,
+        const vector<BitmapPtr>& pBmps2, int tolerance, bool bCreateMismatchMasks)
+{
+    if (pBmps1.size() != pBmps2.size()) {
+        throw Exception(AVG_ERR_INVALID_ARGS,
+                "ImageCompare::compareAll: Number of bitmaps differs.");
+    }
+    vector<ImageComparePtr> pResults(pBmps1.size());
+    boost::atomic<int> nextIndex(0);
+    int numTasks = min(TaskScheduler::get()->getNumThreads(), int(pBmps1.size())-1);
+    vector<TaskPtr> pTasks;
+    for (int i = 0; i < numTasks; ++i) {
+        pTasks.push_back(TaskScheduler::get()->submit(boost::bind(&compareBitmaps,
+                boost::cref(pBmps1), boost::cref(pBmps2), tolerance,
+                bCreateMismatchMasks, boost::ref(pResults), boost::ref(nextIndex)),
+                Task::NORMAL, &ImageCompareProfilingZone));
+    }
+    try {
+        compareBitmaps(pBmps1, pBmps2, tolerance, bCreateMismatchMasks, pResults,
+                nextIndex);
+    } catch (...) {
+        // The tasks reference the vectors, so they need to finish first.
+        for (unsigned i = 0; i < pTasks.size(); ++i) {
+            try {
+                pTasks[i]->wait();
+            } catch (...) {
+            }
+        }
+        throw;
+    }
+    for (unsigned i = 0; i < pTasks.size(); ++i) {
+        pTasks[i]->wait();
+    }
+    return pResults;
+}
+
+bool ImageCompare::compare(const Bitmap& bmp1, const Bitmap& bmp2, int tolerance,
+        bool bCreateMismatchMask, float maxAvg, float maxStdDev)
+{
+    PixelFormat pf = bmp1.getPixelFormat();
+    if (pf != bmp2.getPixelFormat()) {
+        throw Exception(AVG_ERR_UNSUPPORTED,
+                string("ImageCompare: pixel formats differ (")
+                + getPixelFormatString(pf) + ", "
+                + getPixelFormatString(bmp2.getPixelFormat()) + ").");
+    }
+    IntPoint size = bmp1.getSize();
+    if (size != bmp2.getSize()) {
+        stringstream ss;
+        ss << "ImageCompare: bitmap sizes differ (" << size << ", " << bmp2.getSize()
+                << ").";
+        throw Exception(AVG_ERR_UNSUPPORTED, ss.str());
+    }
+    int bpp = bmp1.getBytesPerPixel();
+    if (!isPixelFormatSupported(pf)) {
+        throw Exception(AVG_ERR_UNSUPPORTED, string("ImageCompare: pixel format ") +
+                getPixelFormatString(pf) + " not supported.");
+    }
+    if (tolerance < 0 || tolerance > 255) {
+        throw Exception(AVG_ERR_OUT_OF_RANGE,
+                "ImageCompare: tolerance must be between 0 and 255.");
+    }
+
+    m_NumChannels = bpp;
+    switch (pf) {
+        case B8G8R8X8:
+        case R8G8B8X8:
+            m_UnusedChannel = 3;
+            break;
+        default:
+            m_UnusedChannel = -1;
+    }
+    m_bAlphaWeighted = (pf == B8G8R8A8 || pf == R8G8B8A8);
+    m_NumPixels = 0;
+    for (int i = 0; i < 4; ++i) {
+        m_MaxDiff[i] = 0;
+        m_Sum[i] = 0;
+        m_SqrSum[i] = 0;
+    }
+    m_NumMismatches = 0;
+    m_WeightedSum = 0;
+    m_WeightedValueSum = 0;
+    m_WeightedSqrSum = 0;
+    m_NumWeightedPixels = 0;
+    if (bCreateMismatchMask) {
+        m_pMismatchMask = BitmapPtr(new Bitmap(size, I8));
+    }
+
+    bool bCheckLimits = (maxAvg >= 0 && maxStdDev >= 0);
+    const PixelKernels& kernels = getPixelKernels();
+    vector<unsigned char> mismatch(bmp1.getLineLen());
+    for (int y = 0; y < size.y; ++y) {
+        const unsigned char* pLine1 = bmp1.getPixels()+y*bmp1.getStride();
+        const unsigned char* pLine2 = bmp2.getPixels()+y*bmp2.getStride();
+        long long alphaSum = m_Sum[3];
+        bool bMismatch = kernels.m_CompareLine8(pLine1, pLine2, bmp1.getLineLen(), bpp,
+                (unsigned char)tolerance, &mismatch[0], m_MaxDiff, m_Sum, m_SqrSum);
+        unsigned char* pMaskLine = 0;
+        if (m_pMismatchMask) {
+            pMaskLine = m_pMismatchMask->getPixels()+y*m_pMismatchMask->getStride();
+        }
+        if (bMismatch) {
+            countMismatches(&mismatch[0], size.x, pMaskLine);
+        } else if (pMaskLine) {
+            memset(pMaskLine, 0, size.x);
+        }
+        if (m_bAlphaWeighted && m_Sum[3] != alphaSum) {
+            accumulateWeighted(pLine1, pLine2, size.x);
+        }
+        m_NumPixels += size.x;
+        if (bCheckLimits && isOverLimits(maxAvg, maxStdDev, size.x*size.y)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void ImageCompare::countMismatches(const unsigned char* pMismatch, int width,
+        unsigned char* pMaskLine)
+{
+    if (m_NumChannels == 1) {
+        for (int x = 0; x < width; ++x) {
+            m_NumMismatches += pMismatch[x] & 1;
+        }
+        if (pMaskLine) {
+            memcpy(pMaskLine, pMismatch, width);
+        }
+    } else if (m_NumChannels == 4) {
+        unsigned char channelMask[4] = {255, 255, 255, 255};
+        if (m_UnusedChannel != -1) {
+            channelMask[m_UnusedChannel] = 0;
+        }
+        unsigned mask;
+        memcpy(&mask, channelMask, 4);
+        for (int x = 0; x < width; ++x) {
+            unsigned flags;
+            memcpy(&flags, pMismatch+x*4, 4);
+            bool bMismatch = (flags & mask) != 0;
+            m_NumMismatches += bMismatch;
+            if (pMaskLine) {
+                pMaskLine[x] = bMismatch ? 255 : 0;
+            }
+        }
+    } else {
+        for (int x = 0; x < width; ++x) {
+            const unsigned char* pPixel = pMismatch+x*m_NumChannels;
+            bool bMismatch = false;
+            for (int i = 0; i < m_NumChannels; ++i) {
+                bMismatch |= (pPixel[i] != 0);
+            }
+            m_NumMismatches += bMismatch;
+            if (pMaskLine) {
+                pMaskLine[x] = bMismatch ? 255 : 0;
+            }
+        }
+    }
+}
+
+// Bitmap::getAvg() and getStdDev() multiply the color values of R8G8B8A8 and B8G8R8A8
+// bitmaps with alpha and skip pixels with alpha 0. In the difference image, alpha is
+// the alpha difference.
+void ImageCompare::accumulateWeighted(const unsigned char* pLine1,
+        const unsigned char* pLine2, int width)
+{
+    for (int x = 0; x < width; ++x) {
+        const unsigned char* pPixel1 = pLine1+x*4;
+        const unsigned char* pPixel2 = pLine2+x*4;
+        int a = abs(int(pPixel1[3])-int(pPixel2[3]));
+        if (a > 0) {
+            int colorSum = 0;
+            for (int i = 0; i < 3; ++i) {
+                int diff = abs(int(pPixel1[i])-int(pPixel2[i]));
+                colorSum += diff;
+                int v = (diff*a)/255;
+                m_WeightedValueSum += v;
+                m_WeightedSqrSum += v*v;
+            }
+            m_WeightedSum += (colorSum*a)/255 + a;
+            m_WeightedValueSum += a;
+            m_WeightedSqrSum += a*a;
+            m_NumWeightedPixels++;
+        }
+    }
+}
+
+// The sums only grow, so once the average is too large, it stays too large. The
+// variance is at least the mean square minus twice the square of the average (which
+// includes the alpha-weighted case), so it can be bounded the same way.
+bool ImageCompare::isOverLimits(float maxAvg, float maxStdDev, int numTotalPixels) const
+{
+    double sum = 0;
+    double sqrSum = 0;
+    int valuesPerPixel = 0;
+    if (m_bAlphaWeighted) {
+        sum = double(m_WeightedSum);
+        sqrSum = double(m_WeightedSqrSum);
+        valuesPerPixel = 4;
+    } else {
+        for (int i = 0; i < m_NumChannels; ++i) {
+            if (i != m_UnusedChannel) {
+                sum += m_Sum[i];
+                sqrSum += m_SqrSum[i];
+                valuesPerPixel++;
+            }
+        }
+    }
+    double numValues = double(valuesPerPixel)*numTotalPixels;
+    return sum/numValues > maxAvg ||
+            sqrSum/numValues - 2.*maxAvg*maxAvg > double(maxStdDev)*maxStdDev;
+}
+
+void ImageCompare::checkChannel(int channel) const
+{
+    if (channel < 0 || channel >= m_NumChannels) {
+        throw Exception(AVG_ERR_OUT_OF_RANGE,
+                "ImageCompare: Channel index out of range.");
+    }
+}
+
+}
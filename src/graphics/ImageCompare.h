@@ -0,0 +1,114 @@
+//
+//  libavg - Media Playback Engine.
+//  Copyright (C) 2003-2014 Ulrich von Zadow
+//
+//  This library is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU Lesser General Public
+//  License as published by the Free Software Foundation; either
+//  version 2 of the License, or (at your option) any later version.
+//
+//  This library is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//  Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public
+//  License along with this library; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+//  Current versions can be found at www.libavg.de
+//
+//
+
+#ifndef _ImageCompare_H_
+#define _ImageCompare_H_
+
+#include "../api.h"
+#include "Bitmap.h"
+
+#include <boost/shared_ptr.hpp>
+
+#include <vector>
+
+namespace avg {
+
+class ImageCompare;
+typedef boost::shared_ptr<ImageCompare> ImageComparePtr;
+
+// Compares two bitmaps of the same size and pixel format in one pass, e.g. a test
+// result and its baseline. Works for formats with up to four bytes per pixel except
+// I16 and I32F. Channels are the bytes of a pixel in memory order.
+// Values that differ by at most tolerance are counted as equal when looking for
+// mismatches. The error statistics always use the exact differences.
+class AVG_API ImageCompare
+{
+public:
+    ImageCompare(const Bitmap& bmp1, const Bitmap& bmp2, int tolerance=0,
+            bool bCreateMismatchMask=false);
+
+    int getNumChannels() const;
+    int getMaxDiff(int channel) const;
+    float getMeanError(int channel) const;
+    // Number of pixels with a channel that differs by more than the tolerance. The
+    // unused byte of 32 bpp formats without alpha is ignored.
+    int getNumMismatches() const;
+    // I8 bitmap that is 255 where the pixels differ by more than the tolerance and 0
+    // elsewhere. Only available if bCreateMismatchMask was set.
+    BitmapPtr getMismatchMask() const;
+
+    // Average and standard deviation of the difference image, defined like
+    // Bitmap::subtract() followed by Bitmap::getAvg() and Bitmap::getStdDev(), so
+    // existing thresholds keep their meaning. For R8G8B8A8 and B8G8R8A8, this means
+    // that color differences are weighted by the alpha difference.
+    float getAvg() const;
+    float getStdDev() const;
+
+    // Returns whether getAvg() <= maxAvg and getStdDev() <= maxStdDev. Stops comparing
+    // as soon as the result is certain, so differing bitmaps are rejected early.
+    static bool isSimilar(const Bitmap& bmp1, const Bitmap& bmp2, float maxAvg,
+            float maxStdDev);
+
+    // Returns whether bitmaps of this pixel format can be compared. Callers that need
+    // to handle other formats fall back to Bitmap::subtract().
+    static bool isPixelFormatSupported(PixelFormat pf);
+
+    // Compares pBmps1[i] with pBmps2[i] for all i, distributing the comparisons over
+    // the TaskScheduler threads.
+    static std::vector<ImageComparePtr> compareAll(const std::vector<BitmapPtr>& pBmps1,
+            const std::vector<BitmapPtr>& pBmps2, int tolerance=0,
+            bool bCreateMismatchMasks=false);
+
+private:
+    ImageCompare();
+    // Returns false if the comparison was stopped because the result can't be within
+    // maxAvg and maxStdDev anymore. Negative limits disable this check.
+    bool compare(const Bitmap& bmp1, const Bitmap& bmp2, int tolerance,
+            bool bCreateMismatchMask, float maxAvg, float maxStdDev);
+    void countMismatches(const unsigned char* pMismatch, int width,
+            unsigned char* pMaskLine);
+    void accumulateWeighted(const unsigned char* pLine1, const unsigned char* pLine2,
+            int width);
+    bool isOverLimits(float maxAvg, float maxStdDev, int numTotalPixels) const;
+    void checkChannel(int channel) const;
+
+    int m_NumChannels;
+    int m_NumPixels;
+    // Channel excluded from getAvg(), getStdDev() and mismatches, -1 if there is none.
+    int m_UnusedChannel;
+    bool m_bAlphaWeighted;
+    unsigned char m_MaxDiff[4];
+    long long m_Sum[4];
+    long long m_SqrSum[4];
+    int m_NumMismatches;
+    BitmapPtr m_pMismatchMask;
+
+    // Sums over the alpha-weighted difference values for R8G8B8A8 and B8G8R8A8.
+    long long m_WeightedSum;
+    long long m_WeightedValueSum;
+    long long m_WeightedSqrSum;
+    long long m_NumWeightedPixels;
+};
+
+}
+
+#endif
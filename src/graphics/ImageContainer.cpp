@@ -0,0 +1,364 @@
+//
+//  libavg - Media Playback Engine.
+//  Copyright (C) 2003-2014 Ulrich von Zadow
+//
+//  This library is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU Lesser General Public
+//  License as published by the Free Software Foundation; either
+//  version 2 of the License, or (at your option) any later version.
+//
+//  This library is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//  Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public
+//  License along with this library; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+//  Current versions can be found at www.libavg.de
+//
+
+#include "ImageContainer.h"
+
+#include "BitmapCache.h"
+#include "FilterResample.h"
+#include "PixelBuffer.h"
+
+#include "../base/Exception.h"
+#include "../base/ScopeTimer.h"
+
+#include <boost/bind.hpp>
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include <vector>
+
+using namespace std;
+
+namespace avg {
+
+const char* ImageContainer::EXTENSION = ".avgimg";
+
+static const char MAGIC[] = "AVGIMG\r\n";
+static const int MAGIC_LEN = 8;
+static const int VERSION = 1;
+static const int PF_NAME_LEN = 16;
+// More levels than this would need an image wider than 2^31 pixels.
+static const int MAX_LEVELS = 32;
+
+static ProfilingZoneID MapProfilingZone("Image container map", true);
+
+struct LevelInfo
+{
+    unsigned long long m_Offset;
+    IntPoint m_Size;
+    int m_Stride;
+};
+
+static void writeUInt32(unsigned char* p, unsigned int i)
+{
+    for (int j = 0; j < 4; ++j) {
+        p[j] = (unsigned char)(i >> (j*8));
+    }
+}
+
+static void writeUInt64(unsigned char* p, unsigned long long i)
+{
+    writeUInt32(p, (unsigned int)(i & 0xFFFFFFFF));
+    writeUInt32(p+4, (unsigned int)(i >> 32));
+}
+
+static unsigned int readUInt32(const unsigned char* p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned int)p[3] << 24);
+}
+
+static unsigned long long readUInt64(const unsigned char* p)
+{
+    return readUInt32(p) | ((unsigned long long)readUInt32(p+4) << 32);
+}
+
+static unsigned long long align(unsigned long long offset)
+{
+    return (offset+ImageContainer::ALIGNMENT-1)/ImageContainer::ALIGNMENT*
+            ImageContainer::ALIGNMENT;
+}
+
+static void throwCorrupt(const string& sFilename)
+{
+    throw Exception(AVG_ERR_FILEIO, 
+            string("'")+sFilename+"': Corrupt precompiled image.");
+}
+
+static FILE* openTempFile(const string& sFilename, string& sTempName)
+{
+#ifdef _WIN32
+    sTempName = sFilename+".tmp";
+    FILE* pFile = fopen(sTempName.c_str(), "wb");
+#else
+    vector<char> tempName(sFilename.begin(), sFilename.end());
+    const char* pSuffix = ".XXXXXX";
+    tempName.insert(tempName.end(), pSuffix, pSuffix+strlen(pSuffix)+1);
+    FILE* pFile = 0;
+    int fd = mkstemp(&tempName[0]);
+    if (fd != -1) {
+        sTempName = &tempName[0];
+        // mkstemp() creates the file readable only by the owner.
+        fchmod(fd, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+        pFile = fdopen(fd, "wb");
+        if (!pFile) {
+            close(fd);
+            remove(sTempName.c_str());
+        }
+    }
+#endif
+    if (!pFile) {
+        throw Exception(AVG_ERR_FILEIO, string("Can't open '")+sFilename+
+                "' for writing: "+strerror(errno));
+    }
+    return pFile;
+}
+
+static bool replaceFile(const string& sSrcName, const string& sDestName)
+{
+#ifdef _WIN32
+    if (MoveFileExA(sSrcName.c_str(), sDestName.c_str(), MOVEFILE_REPLACE_EXISTING)) {
+        return true;
+    } else {
+        errno = EACCES;
+        return false;
+    }
+#else
+    return rename(sSrcName.c_str(), sDestName.c_str()) == 0;
+#endif
+}
+
+void ImageContainer::save(const string& sFilename, BitmapPtr pBmp, bool bMipmaps)
+{
+    PixelFormat pf = pBmp->getPixelFormat();
+    vector<BitmapPtr> pLevels;
+    pLevels.push_back(pBmp);
+    if (bMipmaps) {
+        int bpp = pBmp->getBytesPerPixel();
+        if (bpp != 1 && bpp != 3 && bpp != 4) {
+            throw Exception(AVG_ERR_UNSUPPORTED, 
+                    string("Can't create mipmaps for pixel format ")+
+                    getPixelFormatString(pf)+".");
+        }
+        IntPoint size = pBmp->getSize();
+        while (size.x > 1 || size.y > 1) {
+            size = IntPoint(max(size.x/2, 1), max(size.y/2, 1));
+            pLevels.push_back(FilterResample(size, FilterResample::BOX).apply(
+                    pLevels.back()));
+        }
+    }
+
+    int numLevels = int(pLevels.size());
+    int headerSize = HEADER_SIZE + numLevels*LEVEL_ENTRY_SIZE;
+    vector<unsigned char> header(headerSize, 0);
+    memcpy(&header[0], MAGIC, MAGIC_LEN);
+    writeUInt32(&header[8], VERSION);
+    writeUInt32(&header[12], headerSize);
+    writeUInt32(&header[16], pBmp->getSize().x);
+    writeUInt32(&header[20], pBmp->getSize().y);
+    string sPF = getPixelFormatString(pf);
+    AVG_ASSERT(sPF.length() < unsigned(PF_NAME_LEN));
+    memcpy(&header[24], sPF.c_str(), sPF.length());
+    writeUInt32(&header[40], numLevels);
+    unsigned long long offset = headerSize;
+    for (int i = 0; i < numLevels; ++i) {
+        unsigned char* pEntry = &header[HEADER_SIZE + i*LEVEL_ENTRY_SIZE];
+        offset = align(offset);
+        IntPoint size = pLevels[i]->getSize();
+        int stride = Bitmap::getPreferredStride(size.x, pf);
+        writeUInt64(pEntry, offset);
+        writeUInt32(pEntry+8, size.x);
+        writeUInt32(pEntry+12, size.y);
+        writeUInt32(pEntry+16, stride);
+        offset += (unsigned long long)stride*size.y;
+    }
+
+    // The file is written under a temporary name and then renamed over the target.
+    // Truncating the target in place would make existing mappings of it fault on
+    // pages that weren't touched yet, and a failed write would leave a broken file.
+    string sTempName;
+    FILE* pFile = openTempFile(sFilename, sTempName);
+    bool bOk = fwrite(&header[0], 1, headerSize, pFile) == size_t(headerSize);
+    unsigned long long filePos = headerSize;
+    vector<unsigned char> padding(ALIGNMENT, 0);
+    for (int i = 0; i < numLevels && bOk; ++i) {
+        const Bitmap& bmp = *pLevels[i];
+        size_t paddingLen = size_t(align(filePos) - filePos);
+        bOk = fwrite(&padding[0], 1, paddingLen, pFile) == paddingLen;
+        filePos += paddingLen;
+        // Lines are written with the preferred stride regardless of the stride of
+        // the bitmap, padded with zeroes.
+        int stride = Bitmap::getPreferredStride(bmp.getSize().x, pf);
+        int lineLen = bmp.getLineLen();
+        for (int y = 0; y < bmp.getSize().y && bOk; ++y) {
+            bOk = fwrite(bmp.getPixels()+y*bmp.getStride(), 1, lineLen, pFile) == 
+                    size_t(lineLen);
+            size_t linePadding = size_t(stride-lineLen);
+            bOk = bOk && fwrite(&padding[0], 1, linePadding, pFile) == linePadding;
+        }
+        filePos += (unsigned long long)stride*bmp.getSize().y;
+    }
+    bOk = (fclose(pFile) == 0) && bOk;
+    if (!bOk) {
+        remove(sTempName.c_str());
+        throw Exception(AVG_ERR_FILEIO, string("Error writing '")+sFilename+"'.");
+    }
+    if (!replaceFile(sTempName, sFilename)) {
+        string sError = strerror(errno);
+        remove(sTempName.c_str());
+        throw Exception(AVG_ERR_FILEIO, string("Can't replace '")+sFilename+"': "+
+                sError);
+    }
+    BitmapCache::get()->invalidate(sFilename);
+}
+
+string ImageContainerDecoder::getName() const
+{
+    return "avgimg";
+}
+
+bool ImageContainerDecoder::canDecode(const unsigned char* pHeader, int headerLen) const
+{
+    return headerLen >= MAGIC_LEN && memcmp(pHeader, MAGIC, MAGIC_LEN) == 0;
+}
+
+#ifdef _WIN32
+// No zero-copy loading on Windows: The file is read into a normal pixel buffer.
+static PixelBufferPtr mapFile(const string& sFilename)
+{
+    FILE* pFile = fopen(sFilename.c_str(), "rb");
+    if (!pFile) {
+        throw Exception(AVG_ERR_FILEIO, string("Can't open '")+sFilename+"': "+
+                strerror(errno));
+    }
+    fseek(pFile, 0, SEEK_END);
+    long fileSize = ftell(pFile);
+    fseek(pFile, 0, SEEK_SET);
+    if (fileSize < ImageContainer::HEADER_SIZE) {
+        fclose(pFile);
+        throwCorrupt(sFilename);
+    }
+    PixelBufferPtr pBuffer(new PixelBuffer(fileSize));
+    size_t bytesRead = fread(pBuffer->getBits(), 1, fileSize, pFile);
+    fclose(pFile);
+    if (bytesRead != size_t(fileSize)) {
+        throw Exception(AVG_ERR_FILEIO, string("Error reading '")+sFilename+"'.");
+    }
+    return pBuffer;
+}
+#else
+static void unmapFile(unsigned char* pBits, size_t size)
+{
+    munmap(pBits, size);
+}
+
+static PixelBufferPtr mapFile(const string& sFilename)
+{
+    int fd = open(sFilename.c_str(), O_RDONLY);
+    if (fd == -1) {
+        throw Exception(AVG_ERR_FILEIO, string("Can't open '")+sFilename+"': "+
+                strerror(errno));
+    }
+    struct stat fileStat;
+    if (fstat(fd, &fileStat) == -1 || fileStat.st_size < ImageContainer::HEADER_SIZE)
+    {
+        close(fd);
+        throwCorrupt(sFilename);
+    }
+    size_t fileSize = size_t(fileStat.st_size);
+    // Private mapping: Pages the application writes to are copied by the kernel.
+    void* pMem = mmap(0, fileSize, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (pMem == MAP_FAILED) {
+        throw Exception(AVG_ERR_FILEIO, string("Can't map '")+sFilename+"': "+
+                strerror(errno));
+    }
+    unsigned char* pBits = (unsigned char*)pMem;
+    return PixelBufferPtr(new PixelBuffer(pBits, fileSize, 
+            boost::bind(unmapFile, pBits, fileSize)));
+}
+#endif
+
+BitmapPtr ImageContainerDecoder::decode(const UTF8String& sFilename, PixelFormat pf,
+        const IntPoint& maxDecodeSize) const
+{
+    PixelBufferPtr pBuffer;
+    {
+        ScopeTimer timer(MapProfilingZone);
+        pBuffer = mapFile(sFilename);
+    }
+    const unsigned char* pHeader = pBuffer->getBits();
+    unsigned long long fileSize = pBuffer->getSize();
+    if (!canDecode(pHeader, int(fileSize))) {
+        throwCorrupt(sFilename);
+    }
+    if (readUInt32(pHeader+8) != unsigned(VERSION)) {
+        throw Exception(AVG_ERR_FILEIO, string("'")+sFilename+
+                "': Unsupported precompiled image version.");
+    }
+    unsigned headerSize = readUInt32(pHeader+12);
+    char szPF[PF_NAME_LEN+1];
+    memcpy(szPF, pHeader+24, PF_NAME_LEN);
+    szPF[PF_NAME_LEN] = 0;
+    PixelFormat storedPF = stringToPixelFormat(szPF);
+    int numLevels = int(readUInt32(pHeader+40));
+    if (storedPF == NO_PIXELFORMAT || numLevels < 1 || numLevels > MAX_LEVELS ||
+            headerSize != unsigned(ImageContainer::HEADER_SIZE +
+                    numLevels*ImageContainer::LEVEL_ENTRY_SIZE) ||
+            headerSize > fileSize)
+    {
+        throwCorrupt(sFilename);
+    }
+
+    vector<LevelInfo> levels(numLevels);
+    for (int i = 0; i < numLevels; ++i) {
+        const unsigned char* pEntry = pHeader + ImageContainer::HEADER_SIZE +
+                i*ImageContainer::LEVEL_ENTRY_SIZE;
+        LevelInfo& level = levels[i];
+        level.m_Offset = readUInt64(pEntry);
+        level.m_Size = IntPoint(int(readUInt32(pEntry+8)), int(readUInt32(pEntry+12)));
+        level.m_Stride = int(readUInt32(pEntry+16));
+        if (level.m_Size.x <= 0 || level.m_Size.y <= 0 ||
+                level.m_Size.x > (1 << 24) || level.m_Size.y > (1 << 24) ||
+                level.m_Stride < level.m_Size.x*int(getBytesPerPixel(storedPF)) ||
+                level.m_Offset < headerSize || level.m_Offset > fileSize ||
+                (unsigned long long)level.m_Stride*level.m_Size.y > 
+                        fileSize-level.m_Offset)
+        {
+            throwCorrupt(sFilename);
+        }
+    }
+
+    int factor = getReductionFactor(levels[0].m_Size, maxDecodeSize);
+    int levelIndex = 0;
+    while (factor > 1 && levelIndex < numLevels-1) {
+        factor /= 2;
+        levelIndex++;
+    }
+    const LevelInfo& level = levels[levelIndex];
+    BitmapPtr pBmp(new Bitmap(level.m_Size, storedPF, pBuffer, 
+            pBuffer->getBits()+level.m_Offset, level.m_Stride, sFilename));
+    if (pf == NO_PIXELFORMAT) {
+        return pBmp;
+    }
+    return convertToDestPF(pBmp, pf, sFilename);
+}
+
+}
@@ -0,0 +1,74 @@
+//
+//  libavg - Media Playback Engine.
+//  Copyright (C) 2003-2014 Ulrich von Zadow
+//
+//  This library is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU Lesser General Public
+//  License as published by the Free Software Foundation; either
+//  version 2 of the License, or (at your option) any later version.
+//
+//  This library is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//  Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public
+//  License along with this library; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+//  Current versions can be found at www.libavg.de
+//
+
+#ifndef _ImageContainer_H_
+#define _ImageContainer_H_
+
+#include "../api.h"
+
+#include "ImageDecoder.h"
+#include "Bitmap.h"
+
+#include <string>
+
+namespace avg {
+
+// Precompiled images: uncompressed pixels in a layout that can be memory-mapped and
+// used without decoding. All numbers are little-endian.
+//   Header (64 bytes): magic "AVGIMG\r\n", version, header size, width, height,
+//       pixel format name (16 bytes, zero-padded), number of levels, reserved.
+//   Level table (24 bytes per level): offset (64 bit), width, height, stride,
+//       reserved.
+//   Pixels of each level, starting at 64-byte aligned offsets.
+// Level 0 is the full image. Further levels are optional mipmaps, each half the size
+// of the previous one.
+class AVG_API ImageContainer
+{
+public:
+    static const char* EXTENSION;
+    static const int HEADER_SIZE = 64;
+    static const int LEVEL_ENTRY_SIZE = 24;
+    static const int ALIGNMENT = 64;
+
+    // Writes pBmp in its own pixel format. If bMipmaps is set, all levels down to 1x1
+    // are stored as well; this needs a pixel format with 1, 3 or 4 bytes per pixel.
+    // An existing file is replaced atomically, so mappings of it stay valid.
+    static void save(const std::string& sFilename, BitmapPtr pBmp,
+            bool bMipmaps=false);
+};
+
+// Loads precompiled images. The file is mapped into memory and the returned bitmap
+// uses the mapping directly unless a pixel format conversion is needed. The mapping
+// is private, so writing to the bitmap never changes the file.
+// If no pixel format is requested, the stored one is used as-is. If maxDecodeSize
+// is set, the smallest stored level that is still at least maxDecodeSize is returned.
+class AVG_API ImageContainerDecoder: public ImageDecoder
+{
+public:
+    virtual std::string getName() const;
+    virtual bool canDecode(const unsigned char* pHeader, int headerLen) const;
+    virtual BitmapPtr decode(const UTF8String& sFilename, PixelFormat pf,
+            const IntPoint& maxDecodeSize) const;
+};
+
+}
+
+#endif
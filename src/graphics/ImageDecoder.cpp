@@ -0,0 +1,92 @@
+//
+//  libavg - Media Playback Engine.
+//  Copyright (C) 2003-2014 Ulrich von Zadow
+//
+//  This library is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU Lesser General Public
+//  License as published by the Free Software Foundation; either
+//  version 2 of the License, or (at your option) any later version.
+//
+//  This library is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//  Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public
+//  License along with this library; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+//  Current versions can be found at www.libavg.de
+//
+
+#include "ImageDecoder.h"
+#include "BitmapLoader.h"
+
+#include "../base/ScopeTimer.h"
+
+namespace avg {
+
+static ProfilingZoneID ConvertProfilingZone("Decoder format conversion", true);
+
+ImageDecoder::~ImageDecoder()
+{
+}
+
+int ImageDecoder::getReductionFactor(const IntPoint& size, 
+        const IntPoint& maxDecodeSize)
+{
+    if (maxDecodeSize.x <= 0 && maxDecodeSize.y <= 0) {
+        return 1;
+    }
+    int factor = 1;
+    while (true) {
+        IntPoint reducedSize(size.x/(factor*2), size.y/(factor*2));
+        if (reducedSize.x < 1 || reducedSize.y < 1 || 
+                (maxDecodeSize.x > 0 && reducedSize.x < maxDecodeSize.x) ||
+                (maxDecodeSize.y > 0 && reducedSize.y < maxDecodeSize.y))
+        {
+            return factor;
+        }
+        factor *= 2;
+    }
+}
+
+PixelFormat ImageDecoder::getDestPF(PixelFormat pf, bool bAlpha)
+{
+    if (pf == NO_PIXELFORMAT) {
+        return BitmapLoader::get()->getDefaultPixelFormat(bAlpha);
+    } else {
+        return pf;
+    }
+}
+
+PixelFormat ImageDecoder::getDecodePF(PixelFormat destPF, bool bAlpha)
+{
+    switch (destPF) {
+        case B8G8R8A8:
+        case B8G8R8X8:
+        case R8G8B8A8:
+        case R8G8B8X8:
+            return destPF;
+        default:
+            if (pixelFormatIsBlueFirst(destPF)) {
+                return bAlpha ? B8G8R8A8 : B8G8R8X8;
+            } else {
+                return bAlpha ? R8G8B8A8 : R8G8B8X8;
+            }
+    }
+}
+
+BitmapPtr ImageDecoder::convertToDestPF(BitmapPtr pBmp, PixelFormat destPF,
+        const UTF8String& sFilename)
+{
+    if (pBmp->getPixelFormat() == destPF) {
+        return pBmp;
+    }
+    ScopeTimer timer(ConvertProfilingZone);
+    BitmapPtr pDestBmp(new Bitmap(pBmp->getSize(), destPF, sFilename));
+    pDestBmp->copyPixels(*pBmp);
+    return pDestBmp;
+}
+
+}
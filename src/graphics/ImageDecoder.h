@@ -0,0 +1,79 @@
+//
+//  libavg - Media Playback Engine.
+//  Copyright (C) 2003-2014 Ulrich von Zadow
+//
+//  This library is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU Lesser General Public
+//  License as published by the Free Software Foundation; either
+//  version 2 of the License, or (at your option) any later version.
+//
+//  This library is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//  Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public
+//  License along with this library; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+//  Current versions can be found at www.libavg.de
+//
+
+#ifndef _ImageDecoder_H_
+#define _ImageDecoder_H_
+
+#include "../api.h"
+
+#include "Bitmap.h"
+#include "PixelFormat.h"
+
+#include <boost/shared_ptr.hpp>
+
+#include <string>
+
+namespace avg {
+
+// Decodes one type of image file. BitmapLoader keeps a list of decoders and uses the
+// first one that recognizes a file by its first bytes. Decoders must be thread-safe.
+class AVG_API ImageDecoder
+{
+public:
+    // Number of bytes passed to canDecode().
+    static const int HEADER_SIZE = 16;
+
+    virtual ~ImageDecoder();
+
+    virtual std::string getName() const = 0;
+    // headerLen can be less than HEADER_SIZE for very small files.
+    virtual bool canDecode(const unsigned char* pHeader, int headerLen) const = 0;
+    // Decodes the file into a bitmap with pixel format pf, or the loader's default
+    // pixel format if pf is NO_PIXELFORMAT. Throws on I/O and format errors. Returns
+    // an empty pointer if the file uses a feature the decoder doesn't support, so the
+    // next decoder can try.
+    // Decoders that can cheaply decode at reduced resolution may shrink the image by
+    // up to getReductionFactor(size, maxDecodeSize). The loader downscales whatever
+    // remains.
+    virtual BitmapPtr decode(const UTF8String& sFilename, PixelFormat pf,
+            const IntPoint& maxDecodeSize) const = 0;
+
+    // Largest power-of-two factor the image can be shrunk by while staying at least
+    // maxDecodeSize. A component of 0 in maxDecodeSize means that dimension isn't
+    // limited; (0,0) disables the reduction.
+    static int getReductionFactor(const IntPoint& size, const IntPoint& maxDecodeSize);
+
+protected:
+    // Resolves NO_PIXELFORMAT.
+    static PixelFormat getDestPF(PixelFormat pf, bool bAlpha);
+    // 32 bpp format with the channel order of destPF. Decoders write this format
+    // directly; other formats are converted afterwards.
+    static PixelFormat getDecodePF(PixelFormat destPF, bool bAlpha);
+    // Converts pBmp to destPF if necessary.
+    static BitmapPtr convertToDestPF(BitmapPtr pBmp, PixelFormat destPF,
+            const UTF8String& sFilename);
+};
+
+typedef boost::shared_ptr<ImageDecoder> ImageDecoderPtr;
+
+}
+
+#endif
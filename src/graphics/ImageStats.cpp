@@ -0,0 +1,246 @@
+//
+//  libavg - Media Playback Engine.
+//  Copyright (C) 2003-2014 Ulrich von Zadow
+//
+//  This library is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU Lesser General Public
+//  License as published by the Free Software Foundation; either
+//  version 2 of the License, or (at your option) any later version.
+//
+//  This library is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//  Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public
+//  License along with this library; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+//  Current versions can be found at www.libavg.de
+//
+
+#include "ImageStats.h"
+#include "PixelKernels.h"
+
+#include "../base/Exception.h"
+
+#include <math.h>
+#include <sstream>
+
+using namespace std;
+
+namespace avg {
+
+ImageStats::ImageStats(const Bitmap& bmp, int stride)
+{
+    accumulate(bmp, IntRect(IntPoint(0,0), bmp.getSize()), stride);
+}
+
+ImageStats::ImageStats(const Bitmap& bmp, const IntRect& roi, int stride)
+{
+    accumulate(bmp, roi, stride);
+}
+
+int ImageStats::getNumChannels() const
+{
+    return m_NumChannels;
+}
+
+int ImageStats::getNumPixels() const
+{
+    return m_NumPixels;
+}
+
+int ImageStats::getMin(int channel) const
+{
+    checkChannel(channel);
+    return m_Min[channel];
+}
+
+int ImageStats::getMax(int channel) const
+{
+    checkChannel(channel);
+    return m_Max[channel];
+}
+
+float ImageStats::getChannelAvg(int channel) const
+{
+    checkChannel(channel);
+    return float(double(m_Sum[channel])/m_NumPixels);
+}
+
+float ImageStats::getChannelStdDev(int channel) const
+{
+    checkChannel(channel);
+    double avg = double(m_Sum[channel])/m_NumPixels;
+    double variance = double(m_SqrSum[channel])/m_NumPixels - avg*avg;
+    return float(sqrt(max(variance, 0.)));
+}
+
+float ImageStats::getAvg() const
+{
+    long long sum = 0;
+    int numValues = 0;
+    for (int i = 0; i < m_NumChannels; ++i) {
+        if (i != m_UnusedChannel) {
+            sum += m_Sum[i];
+            numValues += m_NumPixels;
+        }
+    }
+    return float(double(sum)/numValues);
+}
+
+float ImageStats::getStdDev() const
+{
+    long long sum = 0;
+    long long sqrSum = 0;
+    int numValues = 0;
+    for (int i = 0; i < m_NumChannels; ++i) {
+        if (i != m_UnusedChannel) {
+            sum += m_Sum[i];
+            sqrSum += m_SqrSum[i];
+            numValues += m_NumPixels;
+        }
+    }
+    double avg = double(sum)/numValues;
+    double variance = double(sqrSum)/numValues - avg*avg;
+    return float(sqrt(max(variance, 0.)));
+}
+
+HistogramPtr ImageStats::getHistogram(int channel) const
+{
+    checkChannel(channel);
+    return HistogramPtr(new Histogram(m_Histograms[channel]));
+}
+
+void ImageStats::accumulate(const Bitmap& bmp, const IntRect& roi, int stride)
+{
+    PixelFormat pf = bmp.getPixelFormat();
+    int bpp = bmp.getBytesPerPixel();
+    if (!(bpp == 1 || (bpp == 4 && pf != I32F))) {
+        throw Exception(AVG_ERR_UNSUPPORTED, string("ImageStats: pixel format ") +
+                getPixelFormatString(pf) + " not supported.");
+    }
+    IntPoint size = bmp.getSize();
+    if (roi.tl.x < 0 || roi.tl.y < 0 || roi.br.x > size.x || roi.br.y > size.y ||
+            roi.width() <= 0 || roi.height() <= 0)
+    {
+        stringstream ss;
+        ss << "ImageStats: Region of interest " << roi << " doesn't fit into bitmap "
+                << "of size " << size << ".";
+        throw Exception(AVG_ERR_OUT_OF_RANGE, ss.str());
+    }
+    if (stride < 1) {
+        throw Exception(AVG_ERR_OUT_OF_RANGE, "ImageStats: stride must be positive.");
+    }
+
+    m_NumChannels = bpp;
+    switch (pf) {
+        case B8G8R8X8:
+        case R8G8B8X8:
+            m_UnusedChannel = 3;
+            break;
+        case X8B8G8R8:
+        case X8R8G8B8:
+            m_UnusedChannel = 0;
+            break;
+        default:
+            m_UnusedChannel = -1;
+    }
+    m_NumPixels = ((roi.width()+stride-1)/stride)*((roi.height()+stride-1)/stride);
+    for (int i = 0; i < 4; ++i) {
+        m_Min[i] = 255;
+        m_Max[i] = 0;
+        m_Sum[i] = 0;
+        m_SqrSum[i] = 0;
+    }
+    m_Histograms.assign(m_NumChannels, Histogram(256, 0));
+
+    if (stride == 1) {
+        accumulateLines(bmp, roi);
+    } else {
+        accumulatePixels(bmp, roi, stride);
+    }
+}
+
+void ImageStats::accumulateLines(const Bitmap& bmp, const IntRect& roi)
+{
+    const PixelKernels& kernels = getPixelKernels();
+    int bpp = m_NumChannels;
+    int numValues = roi.width()*bpp;
+    unsigned char minValues[4] = {255, 255, 255, 255};
+    unsigned char maxValues[4] = {0, 0, 0, 0};
+    // One-byte pixels are counted in four histograms, so consecutive equal values
+    // don't wait for each other's increments.
+    vector<int> hist(4*256, 0);
+    const unsigned char* pLine = bmp.getPixels()+roi.tl.y*bmp.getStride()+roi.tl.x*bpp;
+    for (int y = roi.tl.y; y < roi.br.y; ++y) {
+        kernels.m_AccumulateStatsLine8(pLine, numValues, minValues, maxValues, m_Sum,
+                m_SqrSum);
+        // The line is still in the cache.
+        int i = 0;
+        for (; i+4 <= numValues; i += 4) {
+            hist[pLine[i]]++;
+            hist[256+pLine[i+1]]++;
+            hist[512+pLine[i+2]]++;
+            hist[768+pLine[i+3]]++;
+        }
+        for (; i < numValues; ++i) {
+            hist[pLine[i]]++;
+        }
+        pLine += bmp.getStride();
+    }
+
+    // The kernel counts value i in slot i%4, which is the channel for 32 bpp.
+    if (bpp == 1) {
+        for (int i = 1; i < 4; ++i) {
+            minValues[0] = min(minValues[0], minValues[i]);
+            maxValues[0] = max(maxValues[0], maxValues[i]);
+            m_Sum[0] += m_Sum[i];
+            m_SqrSum[0] += m_SqrSum[i];
+            m_Sum[i] = 0;
+            m_SqrSum[i] = 0;
+        }
+        for (int v = 0; v < 256; ++v) {
+            m_Histograms[0][v] = hist[v]+hist[256+v]+hist[512+v]+hist[768+v];
+        }
+    } else {
+        for (int c = 0; c < 4; ++c) {
+            copy(hist.begin()+c*256, hist.begin()+(c+1)*256, m_Histograms[c].begin());
+        }
+    }
+    for (int c = 0; c < bpp; ++c) {
+        m_Min[c] = minValues[c];
+        m_Max[c] = maxValues[c];
+    }
+}
+
+void ImageStats::accumulatePixels(const Bitmap& bmp, const IntRect& roi, int stride)
+{
+    int bpp = m_NumChannels;
+    const unsigned char* pLine = bmp.getPixels()+roi.tl.y*bmp.getStride()+roi.tl.x*bpp;
+    for (int y = roi.tl.y; y < roi.br.y; y += stride) {
+        const unsigned char* pPixel = pLine;
+        for (int x = roi.tl.x; x < roi.br.x; x += stride) {
+            for (int c = 0; c < bpp; ++c) {
+                int v = pPixel[c];
+                m_Min[c] = min(m_Min[c], v);
+                m_Max[c] = max(m_Max[c], v);
+                m_Sum[c] += v;
+                m_SqrSum[c] += v*v;
+                m_Histograms[c][v]++;
+            }
+            pPixel += stride*bpp;
+        }
+        pLine += stride*bmp.getStride();
+    }
+}
+
+void ImageStats::checkChannel(int channel) const
+{
+    if (channel < 0 || channel >= m_NumChannels) {
+        throw Exception(AVG_ERR_OUT_OF_RANGE, "ImageStats: Channel index out of range.");
+    }
+}
+
+}
@@ -0,0 +1,83 @@
+//
+//  libavg - Media Playback Engine.
+//  Copyright (C) 2003-2014 Ulrich von Zadow
+//
+//  This library is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU Lesser General Public
+//  License as published by the Free Software Foundation; either
+//  version 2 of the License, or (at your option) any later version.
+//
+//  This library is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//  Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public
+//  License along with this library; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+//  Current versions can be found at www.libavg.de
+//
+
+#ifndef _ImageStats_H_
+#define _ImageStats_H_
+
+#include "../api.h"
+#include "Bitmap.h"
+
+#include "../base/Rect.h"
+
+#include <boost/shared_ptr.hpp>
+
+#include <vector>
+
+namespace avg {
+
+// Histogram, minimum, maximum, average and standard deviation of a bitmap, computed
+// in one pass. Works for one-byte formats (I8, A8, BAYER8) and 32 bpp color formats.
+// Channels are numbered in memory order, as in Bitmap::getChannelAvg(). Unlike
+// Bitmap::getAvg(), color values are not premultiplied by alpha.
+// Only every stride-th pixel in every stride-th line of the region of interest is
+// evaluated.
+class AVG_API ImageStats
+{
+public:
+    ImageStats(const Bitmap& bmp, int stride=1);
+    ImageStats(const Bitmap& bmp, const IntRect& roi, int stride=1);
+
+    int getNumChannels() const;
+    // Number of pixels evaluated.
+    int getNumPixels() const;
+
+    int getMin(int channel=0) const;
+    int getMax(int channel=0) const;
+    float getChannelAvg(int channel) const;
+    float getChannelStdDev(int channel) const;
+    // Average and standard deviation of all channel values. The unused byte of
+    // 32 bpp formats without alpha is ignored.
+    float getAvg() const;
+    float getStdDev() const;
+    HistogramPtr getHistogram(int channel=0) const;
+
+private:
+    void accumulate(const Bitmap& bmp, const IntRect& roi, int stride);
+    void accumulateLines(const Bitmap& bmp, const IntRect& roi);
+    void accumulatePixels(const Bitmap& bmp, const IntRect& roi, int stride);
+    void checkChannel(int channel) const;
+
+    int m_NumChannels;
+    // Channel excluded from getAvg() and getStdDev(), -1 if there is none.
+    int m_UnusedChannel;
+    int m_NumPixels;
+    int m_Min[4];
+    int m_Max[4];
+    long long m_Sum[4];
+    long long m_SqrSum[4];
+    std::vector<Histogram> m_Histograms;
+};
+
+typedef boost::shared_ptr<ImageStats> ImageStatsPtr;
+
+}
+
+#endif
@@ -0,0 +1,217 @@
+//
+//  libavg - Media Playback Engine.
+//  Copyright (C) 2003-2014 Ulrich von Zadow
+//
+//  This library is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU Lesser General Public
+//  License as published by the Free Software Foundation; either
+//  version 2 of the License, or (at your option) any later version.
+//
+//  This library is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//  Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public
+//  License along with this library; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+//  Current versions can be found at www.libavg.de
+//
+
+#include "JPEGDecoder.h"
+#include "PixelKernels.h"
+
+#include "../base/Exception.h"
+#include "../base/ScopeTimer.h"
+
+#include <stdio.h>
+#include <setjmp.h>
+#include <string.h>
+#include <errno.h>
+#include <jpeglib.h>
+
+#include <vector>
+#include <algorithm>
+
+using namespace std;
+
+namespace avg {
+
+static ProfilingZoneID JPEGProfilingZone("JPEG decode", true);
+
+struct JPEGErrorManager
+{
+    // Must be first so libjpeg's error pointer can be cast to JPEGErrorManager.
+    jpeg_error_mgr m_Mgr;
+    jmp_buf m_JumpBuffer;
+    char m_szMsg[JMSG_LENGTH_MAX];
+};
+
+static void onJPEGError(j_common_ptr pInfo)
+{
+    JPEGErrorManager* pErrMgr = (JPEGErrorManager*)(pInfo->err);
+    pInfo->err->format_message(pInfo, pErrMgr->m_szMsg);
+    longjmp(pErrMgr->m_JumpBuffer, 1);
+}
+
+static void ignoreJPEGMessage(j_common_ptr pInfo)
+{
+}
+
+// libjpeg reports errors with longjmp. The functions below contain all calls that can
+// fail and don't create C++ objects, so no destructors are skipped.
+static bool readJPEGHeader(jpeg_decompress_struct* pInfo, JPEGErrorManager* pErrMgr,
+        FILE* pFile)
+{
+    if (setjmp(pErrMgr->m_JumpBuffer)) {
+        return false;
+    }
+    jpeg_create_decompress(pInfo);
+    jpeg_stdio_src(pInfo, pFile);
+    jpeg_read_header(pInfo, TRUE);
+    return true;
+}
+
+static bool startJPEGDecompress(jpeg_decompress_struct* pInfo,
+        JPEGErrorManager* pErrMgr)
+{
+    if (setjmp(pErrMgr->m_JumpBuffer)) {
+        return false;
+    }
+    jpeg_start_decompress(pInfo);
+    return true;
+}
+
+static bool readJPEGLines(jpeg_decompress_struct* pInfo, JPEGErrorManager* pErrMgr,
+        JSAMPROW* ppLines, int numLines)
+{
+    if (setjmp(pErrMgr->m_JumpBuffer)) {
+        return false;
+    }
+    int linesRead = 0;
+    while (linesRead < numLines) {
+        linesRead += jpeg_read_scanlines(pInfo, ppLines+linesRead, numLines-linesRead);
+    }
+    return true;
+}
+
+static bool finishJPEGDecompress(jpeg_decompress_struct* pInfo,
+        JPEGErrorManager* pErrMgr)
+{
+    if (setjmp(pErrMgr->m_JumpBuffer)) {
+        return false;
+    }
+    jpeg_finish_decompress(pInfo);
+    return true;
+}
+
+string JPEGDecoder::getName() const
+{
+    return "libjpeg";
+}
+
+bool JPEGDecoder::canDecode(const unsigned char* pHeader, int headerLen) const
+{
+    return headerLen >= 3 && pHeader[0] == 0xFF && pHeader[1] == 0xD8 && 
+            pHeader[2] == 0xFF;
+}
+
+BitmapPtr JPEGDecoder::decode(const UTF8String& sFilename, PixelFormat pf,
+        const IntPoint& maxDecodeSize) const
+{
+    ScopeTimer timer(JPEGProfilingZone);
+    FILE* pFile = fopen(sFilename.c_str(), "rb");
+    if (!pFile) {
+        throw Exception(AVG_ERR_FILEIO, string("Can't open '") + sFilename + "': " +
+                strerror(errno));
+    }
+    jpeg_decompress_struct info;
+    memset(&info, 0, sizeof(info));
+    JPEGErrorManager errMgr;
+    info.err = jpeg_std_error(&errMgr.m_Mgr);
+    errMgr.m_Mgr.error_exit = onJPEGError;
+    errMgr.m_Mgr.output_message = ignoreJPEGMessage;
+
+    BitmapPtr pBmp;
+    bool bOk = readJPEGHeader(&info, &errMgr, pFile);
+    if (bOk && (info.jpeg_color_space == JCS_CMYK || info.jpeg_color_space == JCS_YCCK)) 
+    {
+        jpeg_destroy_decompress(&info);
+        fclose(pFile);
+        return BitmapPtr();
+    }
+    PixelFormat destPF = getDestPF(pf, false);
+    if (bOk) {
+        bool bGray = (info.num_components == 1 && (destPF == I8 || destPF == A8));
+        PixelFormat decodePF = bGray ? destPF : getDecodePF(destPF, false);
+        bool bBlueFirst = pixelFormatIsBlueFirst(decodePF);
+        if (bGray) {
+            info.out_color_space = JCS_GRAYSCALE;
+        } else {
+#ifdef JCS_EXTENSIONS
+            info.out_color_space = bBlueFirst ? JCS_EXT_BGRX : JCS_EXT_RGBX;
+#else
+            // Plain libjpeg can't convert grayscale to RGB, so these images are
+            // expanded below.
+            info.out_color_space = (info.num_components == 1) ? JCS_GRAYSCALE : JCS_RGB;
+#endif
+        }
+        // libjpeg can skip most of the work for reduced sizes by using a smaller
+        // inverse DCT.
+        int factor = getReductionFactor(IntPoint(info.image_width, info.image_height),
+                maxDecodeSize);
+        info.scale_num = 1;
+        info.scale_denom = min(factor, 8);
+        bOk = startJPEGDecompress(&info, &errMgr);
+        if (bOk) {
+            IntPoint size(info.output_width, info.output_height);
+            pBmp = BitmapPtr(new Bitmap(size, decodePF, sFilename));
+            unsigned char* pDestLine = pBmp->getPixels();
+            int stride = pBmp->getStride();
+#ifdef JCS_EXTENSIONS
+            bool bConvert = false;
+#else
+            bool bConvert = !bGray;
+#endif
+            if (bConvert) {
+                // Plain libjpeg only delivers RGB and grayscale, so lines are expanded
+                // to 32 bpp.
+                bool bGrayLines = (info.out_color_space == JCS_GRAYSCALE);
+                vector<unsigned char> lineBuffer(size.x*(bGrayLines ? 1 : 3));
+                JSAMPROW pLine = &lineBuffer[0];
+                const PixelKernels& kernels = getPixelKernels();
+                for (int y = 0; bOk && y < size.y; ++y) {
+                    bOk = readJPEGLines(&info, &errMgr, &pLine, 1);
+                    if (bOk) {
+                        if (bGrayLines) {
+                            kernels.m_I8toGray32Line(pLine, pDestLine, size.x);
+                        } else {
+                            kernels.m_Color24to32Line(pLine, pDestLine, size.x, 
+                                    bBlueFirst);
+                        }
+                        pDestLine += stride;
+                    }
+                }
+            } else {
+                vector<JSAMPROW> pLines(size.y);
+                for (int y = 0; y < size.y; ++y) {
+                    pLines[y] = pDestLine + y*stride;
+                }
+                bOk = readJPEGLines(&info, &errMgr, &pLines[0], size.y);
+            }
+            if (bOk) {
+                bOk = finishJPEGDecompress(&info, &errMgr);
+            }
+        }
+    }
+    jpeg_destroy_decompress(&info);
+    fclose(pFile);
+    if (!bOk) {
+        throw Exception(AVG_ERR_FILEIO, string("Error decoding '") + sFilename + "': " +
+                errMgr.m_szMsg);
+    }
+    return convertToDestPF(pBmp, destPF, sFilename);
+}
+
+}
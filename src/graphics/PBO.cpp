@@ -182,6 +182,7 @@ void PBO::moveToTexture(GLTexture& tex)
     GLContext::checkError("PBO::setImage: glTexSubImage2D()");
     glproc::BindBuffer(GL_PIXEL_UNPACK_BUFFER_EXT, 0);
     tex.generateMipmaps();
+    addBytesUploaded(size.x*size.y*getBytesPerPixel(getPF()));
 }
 
 unsigned PBO::getMemNeeded() const
@@ -0,0 +1,170 @@
+//
+//  libavg - Media Playback Engine.
+//  Copyright (C) 2003-2014 Ulrich von Zadow
+//
+//  This library is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU Lesser General Public
+//  License as published by the Free Software Foundation; either
+//  version 2 of the License, or (at your option) any later version.
+//
+//  This library is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//  Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public
+//  License along with this library; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+//  Current versions can be found at www.libavg.de
+//
+
+#include "PNGDecoder.h"
+
+#include "../base/Exception.h"
+#include "../base/ScopeTimer.h"
+
+#include <stdio.h>
+#include <setjmp.h>
+#include <string.h>
+#include <errno.h>
+#include <png.h>
+
+#include <vector>
+
+using namespace std;
+
+namespace avg {
+
+static ProfilingZoneID PNGProfilingZone("PNG decode", true);
+
+struct PNGErrorState
+{
+    jmp_buf m_JumpBuffer;
+    char m_szMsg[256];
+};
+
+static void onPNGError(png_structp pPNG, png_const_charp pszMsg)
+{
+    PNGErrorState* pState = (PNGErrorState*)png_get_error_ptr(pPNG);
+    strncpy(pState->m_szMsg, pszMsg, sizeof(pState->m_szMsg)-1);
+    longjmp(pState->m_JumpBuffer, 1);
+}
+
+static void ignorePNGWarning(png_structp pPNG, png_const_charp pszMsg)
+{
+}
+
+// libpng reports errors with longjmp. The functions below contain all calls that can
+// fail and don't create C++ objects, so no destructors are skipped.
+static bool readPNGInfo(png_structp pPNG, png_infop pInfo, PNGErrorState* pState,
+        FILE* pFile)
+{
+    if (setjmp(pState->m_JumpBuffer)) {
+        return false;
+    }
+    png_init_io(pPNG, pFile);
+    png_read_info(pPNG, pInfo);
+    return true;
+}
+
+static bool setPNGTransforms(png_structp pPNG, png_infop pInfo, PNGErrorState* pState,
+        bool bGray, bool bAlpha, bool bBlueFirst)
+{
+    if (setjmp(pState->m_JumpBuffer)) {
+        return false;
+    }
+    // Palettes, low bit depths and tRNS chunks become 8 bit channels and alpha.
+    png_set_expand(pPNG);
+    png_set_strip_16(pPNG);
+    if (!bGray) {
+        png_set_gray_to_rgb(pPNG);
+        if (bBlueFirst) {
+            png_set_bgr(pPNG);
+        }
+        if (!bAlpha) {
+            png_set_filler(pPNG, 0xFF, PNG_FILLER_AFTER);
+        }
+    }
+    png_set_interlace_handling(pPNG);
+    png_read_update_info(pPNG, pInfo);
+    return true;
+}
+
+static bool readPNGRows(png_structp pPNG, PNGErrorState* pState, png_bytepp ppRows)
+{
+    if (setjmp(pState->m_JumpBuffer)) {
+        return false;
+    }
+    png_read_image(pPNG, ppRows);
+    png_read_end(pPNG, 0);
+    return true;
+}
+
+string PNGDecoder::getName() const
+{
+    return "libpng";
+}
+
+bool PNGDecoder::canDecode(const unsigned char* pHeader, int headerLen) const
+{
+    return headerLen >= 8 && png_sig_cmp((png_bytep)pHeader, 0, 8) == 0;
+}
+
+BitmapPtr PNGDecoder::decode(const UTF8String& sFilename, PixelFormat pf,
+        const IntPoint& maxDecodeSize) const
+{
+    ScopeTimer timer(PNGProfilingZone);
+    FILE* pFile = fopen(sFilename.c_str(), "rb");
+    if (!pFile) {
+        throw Exception(AVG_ERR_FILEIO, string("Can't open '") + sFilename + "': " +
+                strerror(errno));
+    }
+    PNGErrorState state;
+    strcpy(state.m_szMsg, "Out of memory");
+    state.m_szMsg[sizeof(state.m_szMsg)-1] = 0;
+    png_structp pPNG = png_create_read_struct(PNG_LIBPNG_VER_STRING, &state,
+            onPNGError, ignorePNGWarning);
+    png_infop pInfo = 0;
+    if (pPNG) {
+        pInfo = png_create_info_struct(pPNG);
+    }
+    bool bOk = (pInfo != 0) && readPNGInfo(pPNG, pInfo, &state, pFile);
+
+    BitmapPtr pBmp;
+    PixelFormat destPF = NO_PIXELFORMAT;
+    if (bOk) {
+        int colorType = png_get_color_type(pPNG, pInfo);
+        bool bAlpha = (colorType & PNG_COLOR_MASK_ALPHA) ||
+                png_get_valid(pPNG, pInfo, PNG_INFO_tRNS);
+        destPF = getDestPF(pf, bAlpha);
+        bool bGray = (colorType == PNG_COLOR_TYPE_GRAY && !bAlpha && 
+                (destPF == I8 || destPF == A8));
+        PixelFormat decodePF = bGray ? destPF : getDecodePF(destPF, bAlpha);
+        bOk = setPNGTransforms(pPNG, pInfo, &state, bGray, bAlpha,
+                pixelFormatIsBlueFirst(decodePF));
+        if (bOk) {
+            IntPoint size(png_get_image_width(pPNG, pInfo),
+                    png_get_image_height(pPNG, pInfo));
+            pBmp = BitmapPtr(new Bitmap(size, decodePF, sFilename));
+            AVG_ASSERT(png_get_rowbytes(pPNG, pInfo) == 
+                    size_t(size.x*pBmp->getBytesPerPixel()));
+            unsigned char* pPixels = pBmp->getPixels();
+            int stride = pBmp->getStride();
+            vector<png_bytep> pRows(size.y);
+            for (int y = 0; y < size.y; ++y) {
+                pRows[y] = pPixels + y*stride;
+            }
+            bOk = readPNGRows(pPNG, &state, &pRows[0]);
+        }
+    }
+    png_destroy_read_struct(&pPNG, &pInfo, 0);
+    fclose(pFile);
+    if (!bOk) {
+        throw Exception(AVG_ERR_FILEIO, string("Error decoding '") + sFilename + "': " +
+                state.m_szMsg);
+    }
+    return convertToDestPF(pBmp, destPF, sFilename);
+}
+
+}
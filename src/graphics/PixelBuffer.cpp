@@ -0,0 +1,85 @@
+//
+//  libavg - Media Playback Engine.
+//  Copyright (C) 2003-2014 Ulrich von Zadow
+//
+//  This library is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU Lesser General Public
+//  License as published by the Free Software Foundation; either
+//  version 2 of the License, or (at your option) any later version.
+//
+//  This library is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//  Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public
+//  License along with this library; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+//  Current versions can be found at www.libavg.de
+//
+
+#include "PixelBuffer.h"
+#include "BitmapPool.h"
+
+#include "../base/Exception.h"
+#include "../base/ObjectCounter.h"
+
+namespace avg {
+
+PixelBuffer::PixelBuffer(size_t numBytes)
+    : m_Size(numBytes),
+      m_NumViews(0)
+{
+    ObjectCounter::get()->incRef(&typeid(*this));
+    m_pBits = BitmapPool::get()->alloc(numBytes);
+}
+
+PixelBuffer::PixelBuffer(unsigned char* pBits, size_t numBytes,
+        const ReleaseFunc& releaseFunc)
+    : m_pBits(pBits),
+      m_Size(numBytes),
+      m_ReleaseFunc(releaseFunc),
+      m_NumViews(0)
+{
+    ObjectCounter::get()->incRef(&typeid(*this));
+    AVG_ASSERT(releaseFunc);
+}
+
+PixelBuffer::~PixelBuffer()
+{
+    ObjectCounter::get()->decRef(&typeid(*this));
+    if (m_ReleaseFunc) {
+        m_ReleaseFunc();
+    } else {
+        BitmapPool::get()->free(m_pBits);
+    }
+}
+
+unsigned char* PixelBuffer::getBits()
+{
+    return m_pBits;
+}
+
+size_t PixelBuffer::getSize() const
+{
+    return m_Size;
+}
+
+void PixelBuffer::addView()
+{
+    m_NumViews.fetch_add(1);
+}
+
+void PixelBuffer::removeView()
+{
+    int numViews = m_NumViews.fetch_sub(1);
+    AVG_ASSERT(numViews > 0);
+}
+
+int PixelBuffer::getNumViews() const
+{
+    return m_NumViews.load();
+}
+
+}
@@ -0,0 +1,72 @@
+//
+//  libavg - Media Playback Engine.
+//  Copyright (C) 2003-2014 Ulrich von Zadow
+//
+//  This library is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU Lesser General Public
+//  License as published by the Free Software Foundation; either
+//  version 2 of the License, or (at your option) any later version.
+//
+//  This library is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//  Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public
+//  License along with this library; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+//  Current versions can be found at www.libavg.de
+//
+
+#ifndef _PixelBuffer_H_
+#define _PixelBuffer_H_
+
+#include "../api.h"
+
+#include <boost/shared_ptr.hpp>
+#include <boost/function.hpp>
+#include <boost/atomic.hpp>
+
+#include <cstddef>
+
+namespace avg {
+
+// Reference-counted block of pixel memory shared by Bitmaps. Bitmaps that are
+// copies of each other share a buffer until one of them is written to
+// (copy-on-write). Views (sub-bitmaps and non-owning bitmaps) keep the buffer
+// alive and see all changes to it; a buffer with views is never shared by copies.
+class AVG_API PixelBuffer
+{
+public:
+    typedef boost::function<void()> ReleaseFunc;
+
+    // Allocates numBytes from the BitmapPool.
+    PixelBuffer(size_t numBytes);
+    // Wraps memory owned by someone else. releaseFunc is called when the last
+    // reference to the buffer is gone.
+    PixelBuffer(unsigned char* pBits, size_t numBytes, const ReleaseFunc& releaseFunc);
+    virtual ~PixelBuffer();
+
+    unsigned char* getBits();
+    size_t getSize() const;
+
+    void addView();
+    void removeView();
+    int getNumViews() const;
+
+private:
+    PixelBuffer(const PixelBuffer&);
+    PixelBuffer& operator=(const PixelBuffer&);
+
+    unsigned char* m_pBits;
+    size_t m_Size;
+    ReleaseFunc m_ReleaseFunc;
+    boost::atomic<int> m_NumViews;
+};
+
+typedef boost::shared_ptr<PixelBuffer> PixelBufferPtr;
+
+}
+
+#endif
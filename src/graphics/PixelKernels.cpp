@@ -0,0 +1,1633 @@
+//
+//  libavg - Media Playback Engine.
+//  Copyright (C) 2003-2014 Ulrich von Zadow
+//
+//  This library is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU Lesser General Public
+//  License as published by the Free Software Foundation; either
+//  version 2 of the License, or (at your option) any later version.
+//
+//  This library is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//  Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public
+//  License along with this library; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+//  Current versions can be found at www.libavg.de
+//
+#include "PixelKernels.h"
+#include "Pixel32.h"
+
+#include "../base/Exception.h"
+
+#include <boost/thread/once.hpp>
+
+#ifdef AVG_X86
+#include <emmintrin.h>
+#include <tmmintrin.h>
+#include <immintrin.h>
+#endif
+
+#include <algorithm>
+#include <stdlib.h>
+
+using namespace std;
+
+namespace avg {
+
+// Reference implementations. These define the results all other versions must match.
+
+static void I8toGray32LineScalar(const unsigned char* pSrc, unsigned char* pDest,
+        int width)
+{
+    for (int x = 0; x < width; ++x) {
+        pDest[0] =
+        pDest[1] =
+        pDest[2] = pSrc[x];
+        pDest[3] = 255;
+        pDest += 4;
+    }
+}
+
+static void I8toGray24LineScalar(const unsigned char* pSrc, unsigned char* pDest,
+        int width)
+{
+    for (int x = 0; x < width; ++x) {
+        pDest[0] =
+        pDest[1] =
+        pDest[2] = pSrc[x];
+        pDest += 3;
+    }
+}
+
+static void I16toI8LineScalar(const unsigned short* pSrc, unsigned char* pDest,
+        int width)
+{
+    for (int x = 0; x < width; ++x) {
+        pDest[x] = pSrc[x] >> 8;
+    }
+}
+
+static void I8toI16LineScalar(const unsigned char* pSrc, unsigned short* pDest,
+        int width)
+{
+    for (int x = 0; x < width; ++x) {
+        pDest[x] = pSrc[x] << 8;
+    }
+}
+
+static void ByteToFloatLineScalar(const unsigned char* pSrc, float* pDest,
+        int numValues)
+{
+    for (int i = 0; i < numValues; ++i) {
+        pDest[i] = float(pSrc[i])/255;
+    }
+}
+
+static void FloatToByteLineScalar(const float* pSrc, unsigned char* pDest,
+        int numValues)
+{
+    for (int i = 0; i < numValues; ++i) {
+        pDest[i] = (unsigned char)(pSrc[i]*255+0.5);
+    }
+}
+
+static void getLuminanceWeights(bool bRedFirst, int& w0, int& w1, int& w2)
+{
+    if (bRedFirst) {
+        w0 = 54;
+        w2 = 19;
+    } else {
+        w0 = 19;
+        w2 = 54;
+    }
+    w1 = 183;
+}
+
+static void Color32toI8LineScalar(const unsigned char* pSrc, unsigned char* pDest,
+        int width, bool bRedFirst)
+{
+    int w0, w1, w2;
+    getLuminanceWeights(bRedFirst, w0, w1, w2);
+    for (int x = 0; x < width; ++x) {
+        pDest[x] = (pSrc[0]*w0 + pSrc[1]*w1 + pSrc[2]*w2)/256;
+        pSrc += 4;
+    }
+}
+
+static void Color32to24LineScalar(const unsigned char* pSrc, unsigned char* pDest,
+        int width, bool bSwapRB)
+{
+    int pos0 = bSwapRB ? 2 : 0;
+    int pos2 = 2-pos0;
+    for (int x = 0; x < width; ++x) {
+        pDest[0] = pSrc[pos0];
+        pDest[1] = pSrc[1];
+        pDest[2] = pSrc[pos2];
+        pSrc += 4;
+        pDest += 3;
+    }
+}
+
+static void Color24to32LineScalar(const unsigned char* pSrc, unsigned char* pDest,
+        int width, bool bSwapRB)
+{
+    int pos0 = bSwapRB ? 2 : 0;
+    int pos2 = 2-pos0;
+    for (int x = 0; x < width; ++x) {
+        pDest[0] = pSrc[pos0];
+        pDest[1] = pSrc[1];
+        pDest[2] = pSrc[pos2];
+        pDest[3] = 255;
+        pSrc += 3;
+        pDest += 4;
+    }
+}
+
+static void Color32to16LineScalar(const unsigned char* pSrc, unsigned short* pDest,
+        int width, bool bSwapRB)
+{
+    // Same bit layout as Pixel16::Set().
+    int redPos = bSwapRB ? 0 : 2;
+    int bluePos = 2-redPos;
+    for (int x = 0; x < width; ++x) {
+        pDest[x] = ((pSrc[redPos]&0xF8) << 8) | ((pSrc[1]&0xFC) << 3) | 
+                (pSrc[bluePos] >> 3);
+        pSrc += 4;
+    }
+}
+
+static void SwapRB32LineScalar(const unsigned char* pSrc, unsigned char* pDest,
+        int width)
+{
+    for (int x = 0; x < width; ++x) {
+        unsigned char tmp = pSrc[0];
+        pDest[0] = pSrc[2];
+        pDest[1] = pSrc[1];
+        pDest[2] = tmp;
+        pDest[3] = pSrc[3];
+        pSrc += 4;
+        pDest += 4;
+    }
+}
+
+static void SwapRB24LineScalar(const unsigned char* pSrc, unsigned char* pDest,
+        int width)
+{
+    for (int x = 0; x < width; ++x) {
+        unsigned char tmp = pSrc[0];
+        pDest[0] = pSrc[2];
+        pDest[1] = pSrc[1];
+        pDest[2] = tmp;
+        pSrc += 3;
+        pDest += 3;
+    }
+}
+
+// Converts the 4:2:2 pixel pairs from startPair to the end of the line. The chroma
+// values are interpolated between neighbouring pairs; v is the v value of the pair
+// before startPair (or of the first pair if startPair is 0).
+template<int Y0POS, int UPOS, int Y1POS, int VPOS>
+static void YUV422toBGR32Pairs(const unsigned char* pSrcLine, unsigned char* pDestLine,
+        int width, int startPair, int v)
+{
+    const unsigned char * pSrcPixels = pSrcLine+startPair*4;
+    Pixel32 * pDestPixel = (Pixel32*)pDestLine+startPair*2;
+    int v0; // Previous v
+    int u;
+    int u1; // Next u;
+    for (int x = startPair; x < width/2-1; x++) {
+        u = pSrcPixels[UPOS];
+        v0 = v;
+        v = pSrcPixels[VPOS];
+        u1 = pSrcPixels[UPOS+4];
+
+        YUVtoBGR32Pixel(pDestPixel, pSrcPixels[Y0POS], u, (v0+v)/2);
+        YUVtoBGR32Pixel(pDestPixel+1, pSrcPixels[Y1POS], (u+u1)/2, v);
+
+        pSrcPixels+=4;
+        pDestPixel+=2;
+    }
+    // Last pixels.
+    u = pSrcPixels[UPOS];
+    v0 = v;
+    v = pSrcPixels[VPOS];
+    YUVtoBGR32Pixel(pDestPixel, pSrcPixels[Y0POS], u, v0/2+v/2);
+    YUVtoBGR32Pixel(pDestPixel+1, pSrcPixels[Y1POS], u, v);
+}
+
+static void YUYV422toBGR32LineScalar(const unsigned char* pSrc, unsigned char* pDest,
+        int width)
+{
+    YUV422toBGR32Pairs<0, 1, 2, 3>(pSrc, pDest, width, 0, pSrc[3]);
+}
+
+static void UYVY422toBGR32LineScalar(const unsigned char* pSrc, unsigned char* pDest,
+        int width)
+{
+    YUV422toBGR32Pairs<1, 0, 3, 2>(pSrc, pDest, width, 0, pSrc[2]);
+}
+
+static void PlanarYUVtoBGR32LineScalar(const unsigned char* pY,
+        const unsigned char* pU, const unsigned char* pV, unsigned char* pDest,
+        int width, bool bJPEG)
+{
+    Pixel32 * pDestPixel = (Pixel32*)pDest;
+    if (bJPEG) {
+        for (int x = 0; x < width; ++x) {
+            YUVJtoBGR32Pixel(pDestPixel+x, pY[x], pU[x/2], pV[x/2]);
+        }
+    } else {
+        for (int x = 0; x < width; ++x) {
+            YUVtoBGR32Pixel(pDestPixel+x, pY[x], pU[x/2], pV[x/2]);
+        }
+    }
+}
+
+static void ConvolveLine16Scalar(const unsigned short* pSrc, unsigned short* pDest,
+        int numValues, int step, const unsigned short* pKernel, int kernelSize,
+        unsigned short bias)
+{
+    for (int i = 0; i < numValues; ++i) {
+        const unsigned short* pSrcValue = pSrc+i;
+        unsigned sum = bias;
+        for (int k = 0; k < kernelSize; ++k) {
+            sum += (unsigned(*pSrcValue)*pKernel[k]) >> 16;
+            pSrcValue += step;
+        }
+        pDest[i] = (unsigned short)(min(sum, 65535u));
+    }
+}
+
+static void BoxBlurLine16Scalar(const unsigned short* pSrc, unsigned short* pDest,
+        int numPixels, int step, int radius)
+{
+    int width = 2*radius+1;
+    float factor = 1.f/width;
+    for (int c = 0; c < step; ++c) {
+        const unsigned short* pAdd = pSrc+c;
+        const unsigned short* pSub = pSrc+c;
+        int sum = 0;
+        for (int i = 0; i < width-1; ++i) {
+            sum += *pAdd;
+            pAdd += step;
+        }
+        for (int i = 0; i < numPixels; ++i) {
+            sum += *pAdd;
+            pDest[i*step+c] = (unsigned short)(int(sum*factor+0.5f));
+            sum -= *pSub;
+            pAdd += step;
+            pSub += step;
+        }
+    }
+}
+
+static void AccumulateStatsLine8Scalar(const unsigned char* pSrc, int numValues,
+        unsigned char* pMin, unsigned char* pMax, long long* pSum, long long* pSqrSum)
+{
+    for (int i = 0; i < numValues; ++i) {
+        int slot = i & 3;
+        unsigned char v = pSrc[i];
+        pMin[slot] = min(pMin[slot], v);
+        pMax[slot] = max(pMax[slot], v);
+        pSum[slot] += v;
+        pSqrSum[slot] += v*v;
+    }
+}
+
+static bool CompareLine8Scalar(const unsigned char* pSrc1, const unsigned char* pSrc2,
+        int numValues, int bpp, unsigned char tolerance, unsigned char* pMismatch,
+        unsigned char* pMaxDiff, long long* pSum, long long* pSqrSum)
+{
+    bool bMismatch = false;
+    int slot = 0;
+    for (int i = 0; i < numValues; ++i) {
+        int diff = abs(int(pSrc1[i])-int(pSrc2[i]));
+        pMaxDiff[slot] = max(pMaxDiff[slot], (unsigned char)diff);
+        pSum[slot] += diff;
+        pSqrSum[slot] += diff*diff;
+        if (diff > tolerance) {
+            pMismatch[i] = 255;
+            bMismatch = true;
+        } else {
+            pMismatch[i] = 0;
+        }
+        slot++;
+        if (slot == bpp) {
+            slot = 0;
+        }
+    }
+    return bMismatch;
+}
+
+static inline unsigned char clampResampled(int sum)
+{
+    int v = (sum + (1 << (PixelKernels::RESAMPLE_PRECISION_BITS-1))) >>
+            PixelKernels::RESAMPLE_PRECISION_BITS;
+    return (unsigned char)(max(0, min(v, 255)));
+}
+
+static void ResampleLineHScalar(const unsigned char* pSrc, unsigned char* pDest,
+        int destWidth, int bpp, const int* pLeft, const int* pNumTaps,
+        const short* pWeights, int weightStride)
+{
+    for (int x = 0; x < destWidth; ++x) {
+        const short* pWeight = pWeights+x*weightStride;
+        const unsigned char* pSrcPixel = pSrc+pLeft[x]*bpp;
+        for (int c = 0; c < bpp; ++c) {
+            int sum = 0;
+            for (int k = 0; k < pNumTaps[x]; ++k) {
+                sum += pWeight[k]*pSrcPixel[k*bpp+c];
+            }
+            pDest[c] = clampResampled(sum);
+        }
+        pDest += bpp;
+    }
+}
+
+static void ResampleLineVScalar(const unsigned char* const* ppSrcLines,
+        unsigned char* pDest, int numValues, const short* pWeights, int numTaps)
+{
+    for (int i = 0; i < numValues; ++i) {
+        int sum = 0;
+        for (int k = 0; k < numTaps; ++k) {
+            sum += pWeights[k]*ppSrcLines[k][i];
+        }
+        pDest[i] = clampResampled(sum);
+    }
+}
+
+#ifdef AVG_X86
+
+// Fixed-point coefficients of YUVtoBGR32Pixel() and YUVJtoBGR32Pixel().
+struct YUVCoeffs
+{
+    short m_YOffset;
+    short m_Y;
+    short m_BU;
+    short m_GU;
+    short m_GV;
+    short m_RV;
+};
+
+static const YUVCoeffs VIDEO_YUV_COEFFS = {16, 298, 516, -100, -208, 409};
+static const YUVCoeffs JPEG_YUV_COEFFS = {0, 256, 452, -88, -182, 358};
+
+// SSE2. Part of the baseline on x86_64, but not necessarily on 32-bit x86.
+
+AVG_TARGET_SSE2
+static void I8toGray32LineSSE2(const unsigned char* pSrc, unsigned char* pDest,
+        int width)
+{
+    const __m128i alpha = _mm_set1_epi8(char(0xFF));
+    int x = 0;
+    for (; x+16 <= width; x += 16) {
+        __m128i src = _mm_loadu_si128((const __m128i*)(pSrc+x));
+        __m128i vv = _mm_unpacklo_epi8(src, src);
+        __m128i va = _mm_unpacklo_epi8(src, alpha);
+        _mm_storeu_si128((__m128i*)(pDest), _mm_unpacklo_epi16(vv, va));
+        _mm_storeu_si128((__m128i*)(pDest+16), _mm_unpackhi_epi16(vv, va));
+        vv = _mm_unpackhi_epi8(src, src);
+        va = _mm_unpackhi_epi8(src, alpha);
+        _mm_storeu_si128((__m128i*)(pDest+32), _mm_unpacklo_epi16(vv, va));
+        _mm_storeu_si128((__m128i*)(pDest+48), _mm_unpackhi_epi16(vv, va));
+        pDest += 64;
+    }
+    I8toGray32LineScalar(pSrc+x, pDest, width-x);
+}
+
+AVG_TARGET_SSE2
+static void I16toI8LineSSE2(const unsigned short* pSrc, unsigned char* pDest,
+        int width)
+{
+    int x = 0;
+    for (; x+16 <= width; x += 16) {
+        __m128i src0 = _mm_loadu_si128((const __m128i*)(pSrc+x));
+        __m128i src1 = _mm_loadu_si128((const __m128i*)(pSrc+x+8));
+        __m128i dest = _mm_packus_epi16(_mm_srli_epi16(src0, 8), 
+                _mm_srli_epi16(src1, 8));
+        _mm_storeu_si128((__m128i*)(pDest+x), dest);
+    }
+    I16toI8LineScalar(pSrc+x, pDest+x, width-x);
+}
+
+AVG_TARGET_SSE2
+static void I8toI16LineSSE2(const unsigned char* pSrc, unsigned short* pDest,
+        int width)
+{
+    const __m128i zero = _mm_setzero_si128();
+    int x = 0;
+    for (; x+16 <= width; x += 16) {
+        __m128i src = _mm_loadu_si128((const __m128i*)(pSrc+x));
+        _mm_storeu_si128((__m128i*)(pDest+x), _mm_unpacklo_epi8(zero, src));
+        _mm_storeu_si128((__m128i*)(pDest+x+8), _mm_unpackhi_epi8(zero, src));
+    }
+    I8toI16LineScalar(pSrc+x, pDest+x, width-x);
+}
+
+AVG_TARGET_SSE2
+static void ByteToFloatLineSSE2(const unsigned char* pSrc, float* pDest,
+        int numValues)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128 divisor = _mm_set1_ps(255);
+    int i = 0;
+    for (; i+16 <= numValues; i += 16) {
+        __m128i src = _mm_loadu_si128((const __m128i*)(pSrc+i));
+        __m128i src16[2];
+        src16[0] = _mm_unpacklo_epi8(src, zero);
+        src16[1] = _mm_unpackhi_epi8(src, zero);
+        for (int j = 0; j < 2; ++j) {
+            __m128 lo = _mm_cvtepi32_ps(_mm_unpacklo_epi16(src16[j], zero));
+            __m128 hi = _mm_cvtepi32_ps(_mm_unpackhi_epi16(src16[j], zero));
+            _mm_storeu_ps(pDest+i+j*8, _mm_div_ps(lo, divisor));
+            _mm_storeu_ps(pDest+i+j*8+4, _mm_div_ps(hi, divisor));
+        }
+    }
+    ByteToFloatLineScalar(pSrc+i, pDest+i, numValues-i);
+}
+
+AVG_TARGET_SSE2
+static inline __m128i floatToByteSSE2(const float* pSrc)
+{
+    // Multiply in single precision and round in double precision like the scalar
+    // version does. The int conversion truncates.
+    __m128 f = _mm_mul_ps(_mm_loadu_ps(pSrc), _mm_set1_ps(255));
+    __m128d half = _mm_set1_pd(0.5);
+    __m128i lo = _mm_cvttpd_epi32(_mm_add_pd(_mm_cvtps_pd(f), half));
+    __m128i hi = _mm_cvttpd_epi32(_mm_add_pd(_mm_cvtps_pd(_mm_movehl_ps(f, f)), half));
+    return _mm_and_si128(_mm_unpacklo_epi64(lo, hi), _mm_set1_epi32(0xFF));
+}
+
+AVG_TARGET_SSE2
+static void FloatToByteLineSSE2(const float* pSrc, unsigned char* pDest,
+        int numValues)
+{
+    int i = 0;
+    for (; i+16 <= numValues; i += 16) {
+        __m128i lo = _mm_packs_epi32(floatToByteSSE2(pSrc+i), floatToByteSSE2(pSrc+i+4));
+        __m128i hi = _mm_packs_epi32(floatToByteSSE2(pSrc+i+8), 
+                floatToByteSSE2(pSrc+i+12));
+        _mm_storeu_si128((__m128i*)(pDest+i), _mm_packus_epi16(lo, hi));
+    }
+    FloatToByteLineScalar(pSrc+i, pDest+i, numValues-i);
+}
+
+AVG_TARGET_SSE2
+static inline __m128i color32toI8SSE2(const unsigned char* pSrc, __m128i weights02,
+        __m128i weights1)
+{
+    // Channels 0 and 2 are multiplied and added in one madd, channel 1 in a second
+    // one. The sum is at most 255*256, so it fits into the low 16 bits.
+    __m128i src = _mm_loadu_si128((const __m128i*)pSrc);
+    __m128i c02 = _mm_and_si128(src, _mm_set1_epi32(0x00FF00FF));
+    __m128i c1 = _mm_and_si128(_mm_srli_epi32(src, 8), _mm_set1_epi32(0xFF));
+    __m128i sum = _mm_add_epi32(_mm_madd_epi16(c02, weights02), 
+            _mm_madd_epi16(c1, weights1));
+    return _mm_srli_epi32(sum, 8);
+}
+
+AVG_TARGET_SSE2
+static void Color32toI8LineSSE2(const unsigned char* pSrc, unsigned char* pDest,
+        int width, bool bRedFirst)
+{
+    int w0, w1, w2;
+    getLuminanceWeights(bRedFirst, w0, w1, w2);
+    __m128i weights02 = _mm_set1_epi32((w2 << 16) | w0);
+    __m128i weights1 = _mm_set1_epi32(w1);
+    int x = 0;
+    for (; x+16 <= width; x += 16) {
+        const unsigned char* pSrcPixels = pSrc+x*4;
+        __m128i lo = _mm_packs_epi32(color32toI8SSE2(pSrcPixels, weights02, weights1),
+                color32toI8SSE2(pSrcPixels+16, weights02, weights1));
+        __m128i hi = _mm_packs_epi32(color32toI8SSE2(pSrcPixels+32, weights02, weights1),
+                color32toI8SSE2(pSrcPixels+48, weights02, weights1));
+        _mm_storeu_si128((__m128i*)(pDest+x), _mm_packus_epi16(lo, hi));
+    }
+    Color32toI8LineScalar(pSrc+x*4, pDest+x, width-x, bRedFirst);
+}
+
+template<bool SWAP_RB>
+AVG_TARGET_SSE2
+static inline __m128i color32to16SSE2(const unsigned char* pSrc)
+{
+    __m128i src = _mm_loadu_si128((const __m128i*)pSrc);
+    __m128i r;
+    __m128i b;
+    if (SWAP_RB) {
+        r = _mm_and_si128(_mm_slli_epi32(src, 8), _mm_set1_epi32(0xF800));
+        b = _mm_and_si128(_mm_srli_epi32(src, 19), _mm_set1_epi32(0x001F));
+    } else {
+        r = _mm_and_si128(_mm_srli_epi32(src, 8), _mm_set1_epi32(0xF800));
+        b = _mm_and_si128(_mm_srli_epi32(src, 3), _mm_set1_epi32(0x001F));
+    }
+    __m128i g = _mm_and_si128(_mm_srli_epi32(src, 5), _mm_set1_epi32(0x07E0));
+    __m128i dest = _mm_or_si128(_mm_or_si128(r, g), b);
+    // Sign-extend so the signed saturation in packs_epi32 keeps all 16 bits.
+    return _mm_srai_epi32(_mm_slli_epi32(dest, 16), 16);
+}
+
+template<bool SWAP_RB>
+AVG_TARGET_SSE2
+static int color32to16PixelsSSE2(const unsigned char* pSrc, unsigned short* pDest,
+        int width)
+{
+    int x = 0;
+    for (; x+8 <= width; x += 8) {
+        __m128i dest = _mm_packs_epi32(color32to16SSE2<SWAP_RB>(pSrc+x*4), 
+                color32to16SSE2<SWAP_RB>(pSrc+x*4+16));
+        _mm_storeu_si128((__m128i*)(pDest+x), dest);
+    }
+    return x;
+}
+
+AVG_TARGET_SSE2
+static void Color32to16LineSSE2(const unsigned char* pSrc, unsigned short* pDest,
+        int width, bool bSwapRB)
+{
+    int x;
+    if (bSwapRB) {
+        x = color32to16PixelsSSE2<true>(pSrc, pDest, width);
+    } else {
+        x = color32to16PixelsSSE2<false>(pSrc, pDest, width);
+    }
+    Color32to16LineScalar(pSrc+x*4, pDest+x, width-x, bSwapRB);
+}
+
+AVG_TARGET_SSE2
+static void SwapRB32LineSSE2(const unsigned char* pSrc, unsigned char* pDest,
+        int width)
+{
+    const __m128i ga = _mm_set1_epi32(0xFF00FF00);
+    const __m128i low = _mm_set1_epi32(0xFF);
+    int x = 0;
+    for (; x+4 <= width; x += 4) {
+        __m128i src = _mm_loadu_si128((const __m128i*)(pSrc+x*4));
+        __m128i b = _mm_and_si128(_mm_srli_epi32(src, 16), low);
+        __m128i r = _mm_slli_epi32(_mm_and_si128(src, low), 16);
+        __m128i dest = _mm_or_si128(_mm_and_si128(src, ga), _mm_or_si128(r, b));
+        _mm_storeu_si128((__m128i*)(pDest+x*4), dest);
+    }
+    SwapRB32LineScalar(pSrc+x*4, pDest+x*4, width-x);
+}
+
+AVG_TARGET_SSE2
+static inline __m128i coeffPairSSE2(short c0, short c1)
+{
+    return _mm_set_epi16(c1, c0, c1, c0, c1, c0, c1, c0);
+}
+
+// Converts one 16-bit vector each of y, u and v values (8 pixels) to BGR32 using
+// the same fixed-point arithmetic as YUVtoBGR32Pixel().
+AVG_TARGET_SSE2
+static inline void YUVtoBGR32SSE2(__m128i y, __m128i u, __m128i v, unsigned char* pDest,
+        const YUVCoeffs& c)
+{
+    y = _mm_sub_epi16(y, _mm_set1_epi16(c.m_YOffset));
+    u = _mm_sub_epi16(u, _mm_set1_epi16(128));
+    v = _mm_sub_epi16(v, _mm_set1_epi16(128));
+    __m128i yu[2];
+    __m128i yv[2];
+    yu[0] = _mm_unpacklo_epi16(y, u);
+    yu[1] = _mm_unpackhi_epi16(y, u);
+    yv[0] = _mm_unpacklo_epi16(y, v);
+    yv[1] = _mm_unpackhi_epi16(y, v);
+    __m128i b[2];
+    __m128i g[2];
+    __m128i r[2];
+    for (int i = 0; i < 2; ++i) {
+        b[i] = _mm_srai_epi32(_mm_madd_epi16(yu[i], coeffPairSSE2(c.m_Y, c.m_BU)), 8);
+        g[i] = _mm_srai_epi32(_mm_add_epi32(
+                _mm_madd_epi16(yv[i], coeffPairSSE2(c.m_Y, c.m_GV)),
+                _mm_madd_epi16(yu[i], coeffPairSSE2(0, c.m_GU))), 8);
+        r[i] = _mm_srai_epi32(_mm_madd_epi16(yv[i], coeffPairSSE2(c.m_Y, c.m_RV)), 8);
+    }
+    // packus clamps to 0..255.
+    __m128i b8 = _mm_packus_epi16(_mm_packs_epi32(b[0], b[1]), _mm_setzero_si128());
+    __m128i g8 = _mm_packus_epi16(_mm_packs_epi32(g[0], g[1]), _mm_setzero_si128());
+    __m128i r8 = _mm_packus_epi16(_mm_packs_epi32(r[0], r[1]), _mm_setzero_si128());
+    __m128i bg = _mm_unpacklo_epi8(b8, g8);
+    __m128i ra = _mm_unpacklo_epi8(r8, _mm_set1_epi8(char(0xFF)));
+    _mm_storeu_si128((__m128i*)pDest, _mm_unpacklo_epi16(bg, ra));
+    _mm_storeu_si128((__m128i*)(pDest+16), _mm_unpackhi_epi16(bg, ra));
+}
+
+template<int Y0POS, int UPOS, int Y1POS, int VPOS>
+AVG_TARGET_SSE2
+static void YUV422toBGR32LineSSE2(const unsigned char* pSrc, unsigned char* pDest,
+        int width)
+{
+    const __m128i lowBytes = _mm_set1_epi16(0xFF);
+    const __m128i evenLanes = _mm_set1_epi32(0xFFFF);
+    int v = pSrc[VPOS];
+    // Four pairs per iteration. The last pair of the line isn't interpolated and is
+    // left to the scalar code.
+    int pair = 0;
+    for (; pair+4 < width/2; pair += 4) {
+        const unsigned char* pSrcPixels = pSrc+pair*4;
+        __m128i src = _mm_loadu_si128((const __m128i*)pSrcPixels);
+        __m128i y;
+        __m128i uv;
+        if (Y0POS == 0) {
+            y = _mm_and_si128(src, lowBytes);
+            uv = _mm_srli_epi16(src, 8);
+        } else {
+            y = _mm_srli_epi16(src, 8);
+            uv = _mm_and_si128(src, lowBytes);
+        }
+        // uv contains u0 v0 u1 v1 u2 v2 u3 v3. Even pixels get the pair's u and the
+        // average of the previous and current v, odd pixels the average of the
+        // current and next u and the pair's v.
+        __m128i u = _mm_and_si128(uv, evenLanes);
+        u = _mm_or_si128(u, _mm_slli_epi32(u, 16));
+        __m128i nextU = _mm_insert_epi16(_mm_srli_si128(u, 4), pSrcPixels[16+UPOS], 7);
+        __m128i avgU = _mm_srli_epi16(_mm_add_epi16(u, nextU), 1);
+        u = _mm_or_si128(_mm_and_si128(evenLanes, u), _mm_andnot_si128(evenLanes, avgU));
+
+        __m128i curV = _mm_srli_epi32(uv, 16);
+        curV = _mm_or_si128(curV, _mm_slli_epi32(curV, 16));
+        __m128i prevV = _mm_insert_epi16(_mm_slli_si128(curV, 4), v, 0);
+        __m128i avgV = _mm_srli_epi16(_mm_add_epi16(prevV, curV), 1);
+        __m128i v8 = _mm_or_si128(_mm_and_si128(evenLanes, avgV), 
+                _mm_andnot_si128(evenLanes, curV));
+        v = pSrcPixels[12+VPOS];
+
+        YUVtoBGR32SSE2(y, u, v8, pDest+pair*8, VIDEO_YUV_COEFFS);
+    }
+    YUV422toBGR32Pairs<Y0POS, UPOS, Y1POS, VPOS>(pSrc, pDest, width, pair, v);
+}
+
+AVG_TARGET_SSE2
+static void YUYV422toBGR32LineSSE2(const unsigned char* pSrc, unsigned char* pDest,
+        int width)
+{
+    YUV422toBGR32LineSSE2<0, 1, 2, 3>(pSrc, pDest, width);
+}
+
+AVG_TARGET_SSE2
+static void UYVY422toBGR32LineSSE2(const unsigned char* pSrc, unsigned char* pDest,
+        int width)
+{
+    YUV422toBGR32LineSSE2<1, 0, 3, 2>(pSrc, pDest, width);
+}
+
+AVG_TARGET_SSE2
+static void PlanarYUVtoBGR32LineSSE2(const unsigned char* pY,
+        const unsigned char* pU, const unsigned char* pV, unsigned char* pDest,
+        int width, bool bJPEG)
+{
+    const YUVCoeffs& coeffs = bJPEG ? JPEG_YUV_COEFFS : VIDEO_YUV_COEFFS;
+    const __m128i zero = _mm_setzero_si128();
+    int x = 0;
+    for (; x+16 <= width; x += 16) {
+        __m128i y = _mm_loadu_si128((const __m128i*)(pY+x));
+        __m128i u = _mm_loadl_epi64((const __m128i*)(pU+x/2));
+        __m128i v = _mm_loadl_epi64((const __m128i*)(pV+x/2));
+        // One chroma sample for two pixels.
+        u = _mm_unpacklo_epi8(u, u);
+        v = _mm_unpacklo_epi8(v, v);
+        YUVtoBGR32SSE2(_mm_unpacklo_epi8(y, zero), _mm_unpacklo_epi8(u, zero),
+                _mm_unpacklo_epi8(v, zero), pDest+x*4, coeffs);
+        YUVtoBGR32SSE2(_mm_unpackhi_epi8(y, zero), _mm_unpackhi_epi8(u, zero),
+                _mm_unpackhi_epi8(v, zero), pDest+x*4+32, coeffs);
+    }
+    PlanarYUVtoBGR32LineScalar(pY+x, pU+x/2, pV+x/2, pDest+x*4, width-x, bJPEG);
+}
+
+AVG_TARGET_SSE2
+static void ConvolveLine16SSE2(const unsigned short* pSrc, unsigned short* pDest,
+        int numValues, int step, const unsigned short* pKernel, int kernelSize,
+        unsigned short bias)
+{
+    AVG_ASSERT(kernelSize <= PixelKernels::MAX_CONVOLVE_KERNEL_SIZE);
+    __m128i kernel[PixelKernels::MAX_CONVOLVE_KERNEL_SIZE];
+    for (int k = 0; k < kernelSize; ++k) {
+        kernel[k] = _mm_set1_epi16(short(pKernel[k]));
+    }
+    const __m128i vBias = _mm_set1_epi16(short(bias));
+    int i = 0;
+    for (; i+8 <= numValues; i += 8) {
+        const unsigned short* pSrcValue = pSrc+i;
+        __m128i sum = vBias;
+        for (int k = 0; k < kernelSize; ++k) {
+            __m128i src = _mm_loadu_si128((const __m128i*)pSrcValue);
+            sum = _mm_adds_epu16(sum, _mm_mulhi_epu16(src, kernel[k]));
+            pSrcValue += step;
+        }
+        _mm_storeu_si128((__m128i*)(pDest+i), sum);
+    }
+    ConvolveLine16Scalar(pSrc+i, pDest+i, numValues-i, step, pKernel, kernelSize,
+            bias);
+}
+
+// Keeps eight running sums per 8 values. Only used if step is a multiple of 8.
+AVG_TARGET_SSE2
+static void BoxBlurLine16SSE2(const unsigned short* pSrc, unsigned short* pDest,
+        int numPixels, int step, int radius)
+{
+    if (step % 8 != 0 || step > 64) {
+        BoxBlurLine16Scalar(pSrc, pDest, numPixels, step, radius);
+        return;
+    }
+    int width = 2*radius+1;
+    int numVectors = step/8;
+    const __m128 factor = _mm_set1_ps(1.f/width);
+    const __m128 half = _mm_set1_ps(0.5f);
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i offset = _mm_set1_epi32(32768);
+    const __m128i offset16 = _mm_set1_epi16(short(0x8000));
+    __m128i sumLo[8];
+    __m128i sumHi[8];
+    for (int v = 0; v < numVectors; ++v) {
+        sumLo[v] = zero;
+        sumHi[v] = zero;
+        for (int i = 0; i < width-1; ++i) {
+            __m128i src = _mm_loadu_si128((const __m128i*)(pSrc+i*step+v*8));
+            sumLo[v] = _mm_add_epi32(sumLo[v], _mm_unpacklo_epi16(src, zero));
+            sumHi[v] = _mm_add_epi32(sumHi[v], _mm_unpackhi_epi16(src, zero));
+        }
+    }
+    const unsigned short* pAdd = pSrc+(width-1)*step;
+    for (int i = 0; i < numPixels; ++i) {
+        for (int v = 0; v < numVectors; ++v) {
+            __m128i add = _mm_loadu_si128((const __m128i*)(pAdd+v*8));
+            sumLo[v] = _mm_add_epi32(sumLo[v], _mm_unpacklo_epi16(add, zero));
+            sumHi[v] = _mm_add_epi32(sumHi[v], _mm_unpackhi_epi16(add, zero));
+            __m128i lo = _mm_cvttps_epi32(_mm_add_ps(
+                    _mm_mul_ps(_mm_cvtepi32_ps(sumLo[v]), factor), half));
+            __m128i hi = _mm_cvttps_epi32(_mm_add_ps(
+                    _mm_mul_ps(_mm_cvtepi32_ps(sumHi[v]), factor), half));
+            // There is no unsigned saturating pack in SSE2.
+            __m128i dest = _mm_packs_epi32(_mm_sub_epi32(lo, offset),
+                    _mm_sub_epi32(hi, offset));
+            _mm_storeu_si128((__m128i*)(pDest+v*8), _mm_add_epi16(dest, offset16));
+            __m128i sub = _mm_loadu_si128((const __m128i*)(pSrc+v*8));
+            sumLo[v] = _mm_sub_epi32(sumLo[v], _mm_unpacklo_epi16(sub, zero));
+            sumHi[v] = _mm_sub_epi32(sumHi[v], _mm_unpackhi_epi16(sub, zero));
+        }
+        pAdd += step;
+        pSrc += step;
+        pDest += step;
+    }
+}
+
+// Vector lane j of the 32-bit sums collects the values with index j (mod 4). The
+// sums of squares are flushed to 64 bits before they can overflow.
+AVG_TARGET_SSE2
+static void AccumulateStatsLine8SSE2(const unsigned char* pSrc, int numValues,
+        unsigned char* pMin, unsigned char* pMax, long long* pSum, long long* pSqrSum)
+{
+    const int MAX_BLOCK_VALUES = 16*8192;
+    const __m128i zero = _mm_setzero_si128();
+    __m128i vMin = _mm_set1_epi32(pMin[0] | (pMin[1] << 8) | (pMin[2] << 16) |
+            (pMin[3] << 24));
+    __m128i vMax = _mm_set1_epi32(pMax[0] | (pMax[1] << 8) | (pMax[2] << 16) |
+            (pMax[3] << 24));
+    int i = 0;
+    while (i+16 <= numValues) {
+        int blockEnd = min(numValues, i+MAX_BLOCK_VALUES);
+        __m128i sum = zero;
+        __m128i sqrSum = zero;
+        for (; i+16 <= blockEnd; i += 16) {
+            __m128i src = _mm_loadu_si128((const __m128i*)(pSrc+i));
+            vMin = _mm_min_epu8(vMin, src);
+            vMax = _mm_max_epu8(vMax, src);
+            __m128i lo = _mm_unpacklo_epi8(src, zero);
+            __m128i hi = _mm_unpackhi_epi8(src, zero);
+            __m128i sum16 = _mm_add_epi16(lo, hi);
+            sum = _mm_add_epi32(sum, _mm_add_epi32(_mm_unpacklo_epi16(sum16, zero),
+                    _mm_unpackhi_epi16(sum16, zero)));
+            __m128i sqrLo = _mm_mullo_epi16(lo, lo);
+            __m128i sqrHi = _mm_mullo_epi16(hi, hi);
+            sqrSum = _mm_add_epi32(sqrSum, _mm_add_epi32(
+                    _mm_unpacklo_epi16(sqrLo, zero), _mm_unpackhi_epi16(sqrLo, zero)));
+            sqrSum = _mm_add_epi32(sqrSum, _mm_add_epi32(
+                    _mm_unpacklo_epi16(sqrHi, zero), _mm_unpackhi_epi16(sqrHi, zero)));
+        }
+        unsigned sums[4];
+        unsigned sqrSums[4];
+        _mm_storeu_si128((__m128i*)sums, sum);
+        _mm_storeu_si128((__m128i*)sqrSums, sqrSum);
+        for (int j = 0; j < 4; ++j) {
+            pSum[j] += sums[j];
+            pSqrSum[j] += sqrSums[j];
+        }
+    }
+    unsigned char mins[16];
+    unsigned char maxs[16];
+    _mm_storeu_si128((__m128i*)mins, vMin);
+    _mm_storeu_si128((__m128i*)maxs, vMax);
+    for (int j = 0; j < 16; ++j) {
+        pMin[j%4] = min(pMin[j%4], mins[j]);
+        pMax[j%4] = max(pMax[j%4], maxs[j]);
+    }
+    AccumulateStatsLine8Scalar(pSrc+i, numValues-i, pMin, pMax, pSum, pSqrSum);
+}
+
+// Like AccumulateStatsLine8SSE2(), but for absolute differences. The vector lanes
+// collect the values with the same index (mod 4), which is folded to the index
+// (mod bpp) at the end. 24 bpp lines use the scalar version.
+AVG_TARGET_SSE2
+static bool CompareLine8SSE2(const unsigned char* pSrc1, const unsigned char* pSrc2,
+        int numValues, int bpp, unsigned char tolerance, unsigned char* pMismatch,
+        unsigned char* pMaxDiff, long long* pSum, long long* pSqrSum)
+{
+    if (bpp == 3) {
+        return CompareLine8Scalar(pSrc1, pSrc2, numValues, bpp, tolerance, pMismatch,
+                pMaxDiff, pSum, pSqrSum);
+    }
+    const int MAX_BLOCK_VALUES = 16*8192;
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i ones = _mm_set1_epi8(-1);
+    const __m128i tol = _mm_set1_epi8(char(tolerance));
+    __m128i vMax = zero;
+    __m128i vMismatch = zero;
+    long long sums[4] = {0, 0, 0, 0};
+    long long sqrSums[4] = {0, 0, 0, 0};
+    int i = 0;
+    while (i+16 <= numValues) {
+        int blockEnd = min(numValues, i+MAX_BLOCK_VALUES);
+        __m128i sum = zero;
+        __m128i sqrSum = zero;
+        for (; i+16 <= blockEnd; i += 16) {
+            __m128i src1 = _mm_loadu_si128((const __m128i*)(pSrc1+i));
+            __m128i src2 = _mm_loadu_si128((const __m128i*)(pSrc2+i));
+            __m128i diff = _mm_or_si128(_mm_subs_epu8(src1, src2),
+                    _mm_subs_epu8(src2, src1));
+            vMax = _mm_max_epu8(vMax, diff);
+            __m128i mismatch = _mm_xor_si128(
+                    _mm_cmpeq_epi8(_mm_subs_epu8(diff, tol), zero), ones);
+            _mm_storeu_si128((__m128i*)(pMismatch+i), mismatch);
+            vMismatch = _mm_or_si128(vMismatch, mismatch);
+            __m128i lo = _mm_unpacklo_epi8(diff, zero);
+            __m128i hi = _mm_unpackhi_epi8(diff, zero);
+            __m128i sum16 = _mm_add_epi16(lo, hi);
+            sum = _mm_add_epi32(sum, _mm_add_epi32(_mm_unpacklo_epi16(sum16, zero),
+                    _mm_unpackhi_epi16(sum16, zero)));
+            __m128i sqrLo = _mm_mullo_epi16(lo, lo);
+            __m128i sqrHi = _mm_mullo_epi16(hi, hi);
+            sqrSum = _mm_add_epi32(sqrSum, _mm_add_epi32(
+                    _mm_unpacklo_epi16(sqrLo, zero), _mm_unpackhi_epi16(sqrLo, zero)));
+            sqrSum = _mm_add_epi32(sqrSum, _mm_add_epi32(
+                    _mm_unpacklo_epi16(sqrHi, zero), _mm_unpackhi_epi16(sqrHi, zero)));
+        }
+        unsigned blockSums[4];
+        unsigned blockSqrSums[4];
+        _mm_storeu_si128((__m128i*)blockSums, sum);
+        _mm_storeu_si128((__m128i*)blockSqrSums, sqrSum);
+        for (int j = 0; j < 4; ++j) {
+            sums[j] += blockSums[j];
+            sqrSums[j] += blockSqrSums[j];
+        }
+    }
+    unsigned char maxs[16];
+    _mm_storeu_si128((__m128i*)maxs, vMax);
+    for (int j = 0; j < 16; ++j) {
+        pMaxDiff[j%bpp] = max(pMaxDiff[j%bpp], maxs[j]);
+    }
+    for (int j = 0; j < 4; ++j) {
+        pSum[j%bpp] += sums[j];
+        pSqrSum[j%bpp] += sqrSums[j];
+    }
+    bool bMismatch = _mm_movemask_epi8(vMismatch) != 0;
+    bool bTailMismatch = CompareLine8Scalar(pSrc1+i, pSrc2+i, numValues-i, bpp,
+            tolerance, pMismatch+i, pMaxDiff, pSum, pSqrSum);
+    return bMismatch || bTailMismatch;
+}
+
+// The resampling kernels multiply pairs of 16-bit values with pairs of weights using
+// pmaddwd, so two taps are summed per instruction.
+AVG_TARGET_SSE2
+static inline __m128i weightPairSSE2(short w0, short w1)
+{
+    return _mm_set1_epi32((unsigned short)w0 | (int(w1) << 16));
+}
+
+// Rounds, shifts and packs the sums in four vectors to 16 bytes.
+AVG_TARGET_SSE2
+static inline __m128i packResampledSSE2(__m128i s0, __m128i s1, __m128i s2, __m128i s3)
+{
+    const __m128i round = _mm_set1_epi32(1 << (PixelKernels::RESAMPLE_PRECISION_BITS-1));
+    const int bits = PixelKernels::RESAMPLE_PRECISION_BITS;
+    s0 = _mm_srai_epi32(_mm_add_epi32(s0, round), bits);
+    s1 = _mm_srai_epi32(_mm_add_epi32(s1, round), bits);
+    s2 = _mm_srai_epi32(_mm_add_epi32(s2, round), bits);
+    s3 = _mm_srai_epi32(_mm_add_epi32(s3, round), bits);
+    return _mm_packus_epi16(_mm_packs_epi32(s0, s1), _mm_packs_epi32(s2, s3));
+}
+
+AVG_TARGET_SSE2
+static void ResampleLineHSSE2(const unsigned char* pSrc, unsigned char* pDest,
+        int destWidth, int bpp, const int* pLeft, const int* pNumTaps,
+        const short* pWeights, int weightStride)
+{
+    const __m128i zero = _mm_setzero_si128();
+    if (bpp == 4) {
+        for (int x = 0; x < destWidth; ++x) {
+            const short* pWeight = pWeights+x*weightStride;
+            const unsigned char* pSrcPixel = pSrc+pLeft[x]*4;
+            __m128i sum = zero;
+            // Reads one tap too many if the number of taps is odd. Its weight is 0.
+            for (int k = 0; k < pNumTaps[x]; k += 2) {
+                // r0 g0 b0 a0 r1 g1 b1 a1 -> r0 r1 g0 g1 b0 b1 a0 a1
+                __m128i pixels = _mm_unpacklo_epi8(
+                        _mm_loadl_epi64((const __m128i*)(pSrcPixel+k*4)), zero);
+                pixels = _mm_unpacklo_epi16(pixels, _mm_srli_si128(pixels, 8));
+                sum = _mm_add_epi32(sum, _mm_madd_epi16(pixels,
+                        weightPairSSE2(pWeight[k], pWeight[k+1])));
+            }
+            __m128i dest = packResampledSSE2(sum, sum, sum, sum);
+            *(int*)(pDest+x*4) = _mm_cvtsi128_si32(dest);
+        }
+    } else if (bpp == 1) {
+        for (int x = 0; x < destWidth; ++x) {
+            const short* pWeight = pWeights+x*weightStride;
+            const unsigned char* pSrcPixel = pSrc+pLeft[x];
+            __m128i sum = zero;
+            // weightStride is a multiple of 8, so whole vectors of weights can be read.
+            for (int k = 0; k < pNumTaps[x]; k += 8) {
+                __m128i pixels = _mm_unpacklo_epi8(
+                        _mm_loadl_epi64((const __m128i*)(pSrcPixel+k)), zero);
+                sum = _mm_add_epi32(sum, _mm_madd_epi16(pixels,
+                        _mm_loadu_si128((const __m128i*)(pWeight+k))));
+            }
+            sum = _mm_add_epi32(sum, _mm_srli_si128(sum, 8));
+            sum = _mm_add_epi32(sum, _mm_srli_si128(sum, 4));
+            pDest[x] = clampResampled(_mm_cvtsi128_si32(sum));
+        }
+    } else {
+        ResampleLineHScalar(pSrc, pDest, destWidth, bpp, pLeft, pNumTaps, pWeights,
+                weightStride);
+    }
+}
+
+AVG_TARGET_SSE2
+static void ResampleLineVSSE2(const unsigned char* const* ppSrcLines,
+        unsigned char* pDest, int numValues, const short* pWeights, int numTaps)
+{
+    const __m128i zero = _mm_setzero_si128();
+    int i = 0;
+    for (; i+16 <= numValues; i += 16) {
+        __m128i sum0 = zero;
+        __m128i sum1 = zero;
+        __m128i sum2 = zero;
+        __m128i sum3 = zero;
+        int k = 0;
+        for (; k+2 <= numTaps; k += 2) {
+            __m128i src0 = _mm_loadu_si128((const __m128i*)(ppSrcLines[k]+i));
+            __m128i src1 = _mm_loadu_si128((const __m128i*)(ppSrcLines[k+1]+i));
+            __m128i weights = weightPairSSE2(pWeights[k], pWeights[k+1]);
+            // Interleave the two lines so each pair of 16-bit values has one tap each.
+            __m128i lo = _mm_unpacklo_epi8(src0, src1);
+            __m128i hi = _mm_unpackhi_epi8(src0, src1);
+            sum0 = _mm_add_epi32(sum0, _mm_madd_epi16(_mm_unpacklo_epi8(lo, zero), 
+                    weights));
+            sum1 = _mm_add_epi32(sum1, _mm_madd_epi16(_mm_unpackhi_epi8(lo, zero), 
+                    weights));
+            sum2 = _mm_add_epi32(sum2, _mm_madd_epi16(_mm_unpacklo_epi8(hi, zero), 
+                    weights));
+            sum3 = _mm_add_epi32(sum3, _mm_madd_epi16(_mm_unpackhi_epi8(hi, zero), 
+                    weights));
+        }
+        if (k < numTaps) {
+            __m128i src = _mm_loadu_si128((const __m128i*)(ppSrcLines[k]+i));
+            __m128i weights = weightPairSSE2(pWeights[k], 0);
+            __m128i lo = _mm_unpacklo_epi8(src, zero);
+            __m128i hi = _mm_unpackhi_epi8(src, zero);
+            sum0 = _mm_add_epi32(sum0, _mm_madd_epi16(_mm_unpacklo_epi16(lo, zero), 
+                    weights));
+            sum1 = _mm_add_epi32(sum1, _mm_madd_epi16(_mm_unpackhi_epi16(lo, zero), 
+                    weights));
+            sum2 = _mm_add_epi32(sum2, _mm_madd_epi16(_mm_unpacklo_epi16(hi, zero), 
+                    weights));
+            sum3 = _mm_add_epi32(sum3, _mm_madd_epi16(_mm_unpackhi_epi16(hi, zero), 
+                    weights));
+        }
+        _mm_storeu_si128((__m128i*)(pDest+i), packResampledSSE2(sum0, sum1, sum2, sum3));
+    }
+    for (; i < numValues; ++i) {
+        int sum = 0;
+        for (int k = 0; k < numTaps; ++k) {
+            sum += pWeights[k]*ppSrcLines[k][i];
+        }
+        pDest[i] = clampResampled(sum);
+    }
+}
+
+// SSSE3: pshufb makes the 24 bpp conversions cheap.
+
+AVG_TARGET_SSSE3
+static void I8toGray24LineSSSE3(const unsigned char* pSrc, unsigned char* pDest,
+        int width)
+{
+    const __m128i shuffle0 = _mm_setr_epi8(0,0,0,1,1,1,2,2,2,3,3,3,4,4,4,5);
+    const __m128i shuffle1 = _mm_setr_epi8(5,5,6,6,6,7,7,7,8,8,8,9,9,9,10,10);
+    const __m128i shuffle2 = _mm_setr_epi8(10,11,11,11,12,12,12,13,13,13,14,14,14,
+            15,15,15);
+    int x = 0;
+    for (; x+16 <= width; x += 16) {
+        __m128i src = _mm_loadu_si128((const __m128i*)(pSrc+x));
+        _mm_storeu_si128((__m128i*)(pDest), _mm_shuffle_epi8(src, shuffle0));
+        _mm_storeu_si128((__m128i*)(pDest+16), _mm_shuffle_epi8(src, shuffle1));
+        _mm_storeu_si128((__m128i*)(pDest+32), _mm_shuffle_epi8(src, shuffle2));
+        pDest += 48;
+    }
+    I8toGray24LineScalar(pSrc+x, pDest, width-x);
+}
+
+AVG_TARGET_SSSE3
+static void Color32to24LineSSSE3(const unsigned char* pSrc, unsigned char* pDest,
+        int width, bool bSwapRB)
+{
+    const __m128i shuffle = bSwapRB ? 
+            _mm_setr_epi8(2,1,0,6,5,4,10,9,8,14,13,12,-1,-1,-1,-1) :
+            _mm_setr_epi8(0,1,2,4,5,6,8,9,10,12,13,14,-1,-1,-1,-1);
+    int x = 0;
+    for (; x+16 <= width; x += 16) {
+        __m128i a = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)pSrc), shuffle);
+        __m128i b = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(pSrc+16)),
+                shuffle);
+        __m128i c = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(pSrc+32)), 
+                shuffle);
+        __m128i d = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(pSrc+48)), 
+                shuffle);
+        _mm_storeu_si128((__m128i*)pDest, _mm_or_si128(a, _mm_slli_si128(b, 12)));
+        _mm_storeu_si128((__m128i*)(pDest+16), 
+                _mm_or_si128(_mm_srli_si128(b, 4), _mm_slli_si128(c, 8)));
+        _mm_storeu_si128((__m128i*)(pDest+32), 
+                _mm_or_si128(_mm_srli_si128(c, 8), _mm_slli_si128(d, 4)));
+        pSrc += 64;
+        pDest += 48;
+    }
+    Color32to24LineScalar(pSrc, pDest, width-x, bSwapRB);
+}
+
+AVG_TARGET_SSSE3
+static void Color24to32LineSSSE3(const unsigned char* pSrc, unsigned char* pDest,
+        int width, bool bSwapRB)
+{
+    const __m128i shuffle = bSwapRB ? 
+            _mm_setr_epi8(2,1,0,-1,5,4,3,-1,8,7,6,-1,11,10,9,-1) :
+            _mm_setr_epi8(0,1,2,-1,3,4,5,-1,6,7,8,-1,9,10,11,-1);
+    const __m128i alpha = _mm_set1_epi32(0xFF000000);
+    int x = 0;
+    for (; x+16 <= width; x += 16) {
+        __m128i src0 = _mm_loadu_si128((const __m128i*)pSrc);
+        __m128i src1 = _mm_loadu_si128((const __m128i*)(pSrc+16));
+        __m128i src2 = _mm_loadu_si128((const __m128i*)(pSrc+32));
+        __m128i pixels[4];
+        pixels[0] = src0;
+        pixels[1] = _mm_alignr_epi8(src1, src0, 12);
+        pixels[2] = _mm_alignr_epi8(src2, src1, 8);
+        pixels[3] = _mm_srli_si128(src2, 4);
+        for (int i = 0; i < 4; ++i) {
+            _mm_storeu_si128((__m128i*)(pDest+i*16), 
+                    _mm_or_si128(_mm_shuffle_epi8(pixels[i], shuffle), alpha));
+        }
+        pSrc += 48;
+        pDest += 64;
+    }
+    Color24to32LineScalar(pSrc, pDest, width-x, bSwapRB);
+}
+
+AVG_TARGET_SSSE3
+static void SwapRB24LineSSSE3(const unsigned char* pSrc, unsigned char* pDest,
+        int width)
+{
+    // Every iteration swaps four pixels (12 bytes) and writes the remaining four
+    // bytes of the vector back unchanged. The next iteration overwrites them, so this
+    // also works in place.
+    const __m128i shuffle = _mm_setr_epi8(2,1,0,5,4,3,8,7,6,11,10,9,12,13,14,15);
+    int x = 0;
+    for (; x+6 <= width; x += 4) {
+        __m128i src = _mm_loadu_si128((const __m128i*)(pSrc+x*3));
+        _mm_storeu_si128((__m128i*)(pDest+x*3), _mm_shuffle_epi8(src, shuffle));
+    }
+    SwapRB24LineScalar(pSrc+x*3, pDest+x*3, width-x);
+}
+
+// AVX2: 256-bit versions of the kernels that are limited by arithmetic throughput.
+// The pack instructions work per 128-bit lane, so results are permuted back into
+// order before storing.
+
+AVG_TARGET_AVX2
+static void SwapRB32LineAVX2(const unsigned char* pSrc, unsigned char* pDest,
+        int width)
+{
+    const __m256i shuffle = _mm256_setr_epi8(2,1,0,3,6,5,4,7,10,9,8,11,14,13,12,15,
+            2,1,0,3,6,5,4,7,10,9,8,11,14,13,12,15);
+    int x = 0;
+    for (; x+8 <= width; x += 8) {
+        __m256i src = _mm256_loadu_si256((const __m256i*)(pSrc+x*4));
+        _mm256_storeu_si256((__m256i*)(pDest+x*4), _mm256_shuffle_epi8(src, shuffle));
+    }
+    SwapRB32LineSSE2(pSrc+x*4, pDest+x*4, width-x);
+}
+
+AVG_TARGET_AVX2
+static void I8toGray32LineAVX2(const unsigned char* pSrc, unsigned char* pDest,
+        int width)
+{
+    const __m256i shuffle0 = _mm256_setr_epi8(0,0,0,-1,1,1,1,-1,2,2,2,-1,3,3,3,-1,
+            4,4,4,-1,5,5,5,-1,6,6,6,-1,7,7,7,-1);
+    const __m256i shuffle1 = _mm256_setr_epi8(8,8,8,-1,9,9,9,-1,10,10,10,-1,11,11,11,-1,
+            12,12,12,-1,13,13,13,-1,14,14,14,-1,15,15,15,-1);
+    const __m256i alpha = _mm256_set1_epi32(0xFF000000);
+    int x = 0;
+    for (; x+16 <= width; x += 16) {
+        __m256i src = _mm256_broadcastsi128_si256(
+                _mm_loadu_si128((const __m128i*)(pSrc+x)));
+        _mm256_storeu_si256((__m256i*)pDest, 
+                _mm256_or_si256(_mm256_shuffle_epi8(src, shuffle0), alpha));
+        _mm256_storeu_si256((__m256i*)(pDest+32), 
+                _mm256_or_si256(_mm256_shuffle_epi8(src, shuffle1), alpha));
+        pDest += 64;
+    }
+    I8toGray32LineScalar(pSrc+x, pDest, width-x);
+}
+
+AVG_TARGET_AVX2
+static void I16toI8LineAVX2(const unsigned short* pSrc, unsigned char* pDest,
+        int width)
+{
+    int x = 0;
+    for (; x+32 <= width; x += 32) {
+        __m256i src0 = _mm256_loadu_si256((const __m256i*)(pSrc+x));
+        __m256i src1 = _mm256_loadu_si256((const __m256i*)(pSrc+x+16));
+        __m256i dest = _mm256_packus_epi16(_mm256_srli_epi16(src0, 8), 
+                _mm256_srli_epi16(src1, 8));
+        dest = _mm256_permute4x64_epi64(dest, _MM_SHUFFLE(3,1,2,0));
+        _mm256_storeu_si256((__m256i*)(pDest+x), dest);
+    }
+    I16toI8LineSSE2(pSrc+x, pDest+x, width-x);
+}
+
+AVG_TARGET_AVX2
+static void ByteToFloatLineAVX2(const unsigned char* pSrc, float* pDest,
+        int numValues)
+{
+    const __m256 divisor = _mm256_set1_ps(255);
+    int i = 0;
+    for (; i+8 <= numValues; i += 8) {
+        __m256i src = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(pSrc+i)));
+        _mm256_storeu_ps(pDest+i, _mm256_div_ps(_mm256_cvtepi32_ps(src), divisor));
+    }
+    ByteToFloatLineScalar(pSrc+i, pDest+i, numValues-i);
+}
+
+AVG_TARGET_AVX2
+static inline __m256i floatToByteAVX2(const float* pSrc)
+{
+    __m256 f = _mm256_mul_ps(_mm256_loadu_ps(pSrc), _mm256_set1_ps(255));
+    __m256d half = _mm256_set1_pd(0.5);
+    __m128i lo = _mm256_cvttpd_epi32(_mm256_add_pd(
+            _mm256_cvtps_pd(_mm256_castps256_ps128(f)), half));
+    __m128i hi = _mm256_cvttpd_epi32(_mm256_add_pd(
+            _mm256_cvtps_pd(_mm256_extractf128_ps(f, 1)), half));
+    __m256i dest = _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+    return _mm256_and_si256(dest, _mm256_set1_epi32(0xFF));
+}
+
+// Packs four vectors of 8 32-bit values in the range 0..255 into 32 bytes in order.
+AVG_TARGET_AVX2
+static inline __m256i pack32to8AVX2(__m256i a, __m256i b, __m256i c, __m256i d)
+{
+    __m256i dest = _mm256_packus_epi16(_mm256_packs_epi32(a, b), 
+            _mm256_packs_epi32(c, d));
+    return _mm256_permutevar8x32_epi32(dest, _mm256_setr_epi32(0,4,1,5,2,6,3,7));
+}
+
+AVG_TARGET_AVX2
+static void FloatToByteLineAVX2(const float* pSrc, unsigned char* pDest,
+        int numValues)
+{
+    int i = 0;
+    for (; i+32 <= numValues; i += 32) {
+        __m256i dest = pack32to8AVX2(floatToByteAVX2(pSrc+i), 
+                floatToByteAVX2(pSrc+i+8), floatToByteAVX2(pSrc+i+16), 
+                floatToByteAVX2(pSrc+i+24));
+        _mm256_storeu_si256((__m256i*)(pDest+i), dest);
+    }
+    FloatToByteLineSSE2(pSrc+i, pDest+i, numValues-i);
+}
+
+AVG_TARGET_AVX2
+static inline __m256i color32toI8AVX2(const unsigned char* pSrc, __m256i weights02,
+        __m256i weights1)
+{
+    __m256i src = _mm256_loadu_si256((const __m256i*)pSrc);
+    __m256i c02 = _mm256_and_si256(src, _mm256_set1_epi32(0x00FF00FF));
+    __m256i c1 = _mm256_and_si256(_mm256_srli_epi32(src, 8), _mm256_set1_epi32(0xFF));
+    __m256i sum = _mm256_add_epi32(_mm256_madd_epi16(c02, weights02), 
+            _mm256_madd_epi16(c1, weights1));
+    return _mm256_srli_epi32(sum, 8);
+}
+
+AVG_TARGET_AVX2
+static void Color32toI8LineAVX2(const unsigned char* pSrc, unsigned char* pDest,
+        int width, bool bRedFirst)
+{
+    int w0, w1, w2;
+    getLuminanceWeights(bRedFirst, w0, w1, w2);
+    __m256i weights02 = _mm256_set1_epi32((w2 << 16) | w0);
+    __m256i weights1 = _mm256_set1_epi32(w1);
+    int x = 0;
+    for (; x+32 <= width; x += 32) {
+        const unsigned char* pSrcPixels = pSrc+x*4;
+        __m256i dest = pack32to8AVX2(color32toI8AVX2(pSrcPixels, weights02, weights1),
+                color32toI8AVX2(pSrcPixels+32, weights02, weights1),
+                color32toI8AVX2(pSrcPixels+64, weights02, weights1),
+                color32toI8AVX2(pSrcPixels+96, weights02, weights1));
+        _mm256_storeu_si256((__m256i*)(pDest+x), dest);
+    }
+    Color32toI8LineSSE2(pSrc+x*4, pDest+x, width-x, bRedFirst);
+}
+
+AVG_TARGET_AVX2
+static inline __m256i coeffPairAVX2(short c0, short c1)
+{
+    return _mm256_set1_epi32((int(c1) << 16) | (c0 & 0xFFFF));
+}
+
+// 16 pixels per call. Same arithmetic as YUVtoBGR32SSE2().
+AVG_TARGET_AVX2
+static inline void YUVtoBGR32AVX2(__m256i y, __m256i u, __m256i v, unsigned char* pDest,
+        const YUVCoeffs& c)
+{
+    y = _mm256_sub_epi16(y, _mm256_set1_epi16(c.m_YOffset));
+    u = _mm256_sub_epi16(u, _mm256_set1_epi16(128));
+    v = _mm256_sub_epi16(v, _mm256_set1_epi16(128));
+    __m256i yu[2];
+    __m256i yv[2];
+    yu[0] = _mm256_unpacklo_epi16(y, u);
+    yu[1] = _mm256_unpackhi_epi16(y, u);
+    yv[0] = _mm256_unpacklo_epi16(y, v);
+    yv[1] = _mm256_unpackhi_epi16(y, v);
+    __m256i b[2];
+    __m256i g[2];
+    __m256i r[2];
+    for (int i = 0; i < 2; ++i) {
+        b[i] = _mm256_srai_epi32(_mm256_madd_epi16(yu[i], coeffPairAVX2(c.m_Y, c.m_BU)),
+                8);
+        g[i] = _mm256_srai_epi32(_mm256_add_epi32(
+                _mm256_madd_epi16(yv[i], coeffPairAVX2(c.m_Y, c.m_GV)),
+                _mm256_madd_epi16(yu[i], coeffPairAVX2(0, c.m_GU))), 8);
+        r[i] = _mm256_srai_epi32(_mm256_madd_epi16(yv[i], coeffPairAVX2(c.m_Y, c.m_RV)),
+                8);
+    }
+    // Unpacking and packing both work per lane, so the 16-bit values are in pixel
+    // order again after packs_epi32.
+    __m256i b16 = _mm256_packs_epi32(b[0], b[1]);
+    __m256i g16 = _mm256_packs_epi32(g[0], g[1]);
+    __m256i r16 = _mm256_packs_epi32(r[0], r[1]);
+    __m256i b8 = _mm256_packus_epi16(b16, b16);
+    __m256i g8 = _mm256_packus_epi16(g16, g16);
+    __m256i r8 = _mm256_packus_epi16(r16, r16);
+    __m256i bg = _mm256_unpacklo_epi8(b8, g8);
+    __m256i ra = _mm256_unpacklo_epi8(r8, _mm256_set1_epi8(char(0xFF)));
+    __m256i lo = _mm256_unpacklo_epi16(bg, ra);
+    __m256i hi = _mm256_unpackhi_epi16(bg, ra);
+    _mm256_storeu_si256((__m256i*)pDest, _mm256_permute2x128_si256(lo, hi, 0x20));
+    _mm256_storeu_si256((__m256i*)(pDest+32), _mm256_permute2x128_si256(lo, hi, 0x31));
+}
+
+AVG_TARGET_AVX2
+static void PlanarYUVtoBGR32LineAVX2(const unsigned char* pY,
+        const unsigned char* pU, const unsigned char* pV, unsigned char* pDest,
+        int width, bool bJPEG)
+{
+    const YUVCoeffs& coeffs = bJPEG ? JPEG_YUV_COEFFS : VIDEO_YUV_COEFFS;
+    int x = 0;
+    for (; x+32 <= width; x += 32) {
+        for (int i = 0; i < 32; i += 16) {
+            __m256i y = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(pY+x+i)));
+            __m128i u = _mm_loadl_epi64((const __m128i*)(pU+(x+i)/2));
+            __m128i v = _mm_loadl_epi64((const __m128i*)(pV+(x+i)/2));
+            YUVtoBGR32AVX2(y, _mm256_cvtepu8_epi16(_mm_unpacklo_epi8(u, u)),
+                    _mm256_cvtepu8_epi16(_mm_unpacklo_epi8(v, v)), pDest+(x+i)*4, 
+                    coeffs);
+        }
+    }
+    PlanarYUVtoBGR32LineSSE2(pY+x, pU+x/2, pV+x/2, pDest+x*4, width-x, bJPEG);
+}
+
+AVG_TARGET_AVX2
+static void ConvolveLine16AVX2(const unsigned short* pSrc, unsigned short* pDest,
+        int numValues, int step, const unsigned short* pKernel, int kernelSize,
+        unsigned short bias)
+{
+    AVG_ASSERT(kernelSize <= PixelKernels::MAX_CONVOLVE_KERNEL_SIZE);
+    __m256i kernel[PixelKernels::MAX_CONVOLVE_KERNEL_SIZE];
+    for (int k = 0; k < kernelSize; ++k) {
+        kernel[k] = _mm256_set1_epi16(short(pKernel[k]));
+    }
+    const __m256i vBias = _mm256_set1_epi16(short(bias));
+    int i = 0;
+    for (; i+16 <= numValues; i += 16) {
+        const unsigned short* pSrcValue = pSrc+i;
+        __m256i sum = vBias;
+        for (int k = 0; k < kernelSize; ++k) {
+            __m256i src = _mm256_loadu_si256((const __m256i*)pSrcValue);
+            sum = _mm256_adds_epu16(sum, _mm256_mulhi_epu16(src, kernel[k]));
+            pSrcValue += step;
+        }
+        _mm256_storeu_si256((__m256i*)(pDest+i), sum);
+    }
+    ConvolveLine16SSE2(pSrc+i, pDest+i, numValues-i, step, pKernel, kernelSize, bias);
+}
+
+AVG_TARGET_AVX2
+static void AccumulateStatsLine8AVX2(const unsigned char* pSrc, int numValues,
+        unsigned char* pMin, unsigned char* pMax, long long* pSum, long long* pSqrSum)
+{
+    const int MAX_BLOCK_VALUES = 32*4096;
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i vMin = _mm256_set1_epi32(pMin[0] | (pMin[1] << 8) | (pMin[2] << 16) |
+            (pMin[3] << 24));
+    __m256i vMax = _mm256_set1_epi32(pMax[0] | (pMax[1] << 8) | (pMax[2] << 16) |
+            (pMax[3] << 24));
+    int i = 0;
+    while (i+32 <= numValues) {
+        int blockEnd = min(numValues, i+MAX_BLOCK_VALUES);
+        __m256i sum = zero;
+        __m256i sqrSum = zero;
+        for (; i+32 <= blockEnd; i += 32) {
+            __m256i src = _mm256_loadu_si256((const __m256i*)(pSrc+i));
+            vMin = _mm256_min_epu8(vMin, src);
+            vMax = _mm256_max_epu8(vMax, src);
+            // The unpacks work per 128-bit lane, which keeps every value in a 32-bit
+            // lane with the same index (mod 4).
+            __m256i lo = _mm256_unpacklo_epi8(src, zero);
+            __m256i hi = _mm256_unpackhi_epi8(src, zero);
+            __m256i sum16 = _mm256_add_epi16(lo, hi);
+            sum = _mm256_add_epi32(sum, _mm256_add_epi32(
+                    _mm256_unpacklo_epi16(sum16, zero),
+                    _mm256_unpackhi_epi16(sum16, zero)));
+            __m256i sqrLo = _mm256_mullo_epi16(lo, lo);
+            __m256i sqrHi = _mm256_mullo_epi16(hi, hi);
+            sqrSum = _mm256_add_epi32(sqrSum, _mm256_add_epi32(
+                    _mm256_unpacklo_epi16(sqrLo, zero),
+                    _mm256_unpackhi_epi16(sqrLo, zero)));
+            sqrSum = _mm256_add_epi32(sqrSum, _mm256_add_epi32(
+                    _mm256_unpacklo_epi16(sqrHi, zero),
+                    _mm256_unpackhi_epi16(sqrHi, zero)));
+        }
+        unsigned sums[8];
+        unsigned sqrSums[8];
+        _mm256_storeu_si256((__m256i*)sums, sum);
+        _mm256_storeu_si256((__m256i*)sqrSums, sqrSum);
+        for (int j = 0; j < 8; ++j) {
+            pSum[j%4] += sums[j];
+            pSqrSum[j%4] += sqrSums[j];
+        }
+    }
+    unsigned char mins[32];
+    unsigned char maxs[32];
+    _mm256_storeu_si256((__m256i*)mins, vMin);
+    _mm256_storeu_si256((__m256i*)maxs, vMax);
+    for (int j = 0; j < 32; ++j) {
+        pMin[j%4] = min(pMin[j%4], mins[j]);
+        pMax[j%4] = max(pMax[j%4], maxs[j]);
+    }
+    AccumulateStatsLine8SSE2(pSrc+i, numValues-i, pMin, pMax, pSum, pSqrSum);
+}
+
+AVG_TARGET_AVX2
+static bool CompareLine8AVX2(const unsigned char* pSrc1, const unsigned char* pSrc2,
+        int numValues, int bpp, unsigned char tolerance, unsigned char* pMismatch,
+        unsigned char* pMaxDiff, long long* pSum, long long* pSqrSum)
+{
+    if (bpp == 3) {
+        return CompareLine8Scalar(pSrc1, pSrc2, numValues, bpp, tolerance, pMismatch,
+                pMaxDiff, pSum, pSqrSum);
+    }
+    const int MAX_BLOCK_VALUES = 32*4096;
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i ones = _mm256_set1_epi8(-1);
+    const __m256i tol = _mm256_set1_epi8(char(tolerance));
+    __m256i vMax = zero;
+    __m256i vMismatch = zero;
+    long long sums[4] = {0, 0, 0, 0};
+    long long sqrSums[4] = {0, 0, 0, 0};
+    int i = 0;
+    while (i+32 <= numValues) {
+        int blockEnd = min(numValues, i+MAX_BLOCK_VALUES);
+        __m256i sum = zero;
+        __m256i sqrSum = zero;
+        for (; i+32 <= blockEnd; i += 32) {
+            __m256i src1 = _mm256_loadu_si256((const __m256i*)(pSrc1+i));
+            __m256i src2 = _mm256_loadu_si256((const __m256i*)(pSrc2+i));
+            __m256i diff = _mm256_or_si256(_mm256_subs_epu8(src1, src2),
+                    _mm256_subs_epu8(src2, src1));
+            vMax = _mm256_max_epu8(vMax, diff);
+            __m256i mismatch = _mm256_xor_si256(
+                    _mm256_cmpeq_epi8(_mm256_subs_epu8(diff, tol), zero), ones);
+            _mm256_storeu_si256((__m256i*)(pMismatch+i), mismatch);
+            vMismatch = _mm256_or_si256(vMismatch, mismatch);
+            __m256i lo = _mm256_unpacklo_epi8(diff, zero);
+            __m256i hi = _mm256_unpackhi_epi8(diff, zero);
+            __m256i sum16 = _mm256_add_epi16(lo, hi);
+            sum = _mm256_add_epi32(sum, _mm256_add_epi32(
+                    _mm256_unpacklo_epi16(sum16, zero),
+                    _mm256_unpackhi_epi16(sum16, zero)));
+            __m256i sqrLo = _mm256_mullo_epi16(lo, lo);
+            __m256i sqrHi = _mm256_mullo_epi16(hi, hi);
+            sqrSum = _mm256_add_epi32(sqrSum, _mm256_add_epi32(
+                    _mm256_unpacklo_epi16(sqrLo, zero),
+                    _mm256_unpackhi_epi16(sqrLo, zero)));
+            sqrSum = _mm256_add_epi32(sqrSum, _mm256_add_epi32(
+                    _mm256_unpacklo_epi16(sqrHi, zero),
+                    _mm256_unpackhi_epi16(sqrHi, zero)));
+        }
+        unsigned blockSums[8];
+        unsigned blockSqrSums[8];
+        _mm256_storeu_si256((__m256i*)blockSums, sum);
+        _mm256_storeu_si256((__m256i*)blockSqrSums, sqrSum);
+        for (int j = 0; j < 8; ++j) {
+            sums[j%4] += blockSums[j];
+            sqrSums[j%4] += blockSqrSums[j];
+        }
+    }
+    unsigned char maxs[32];
+    _mm256_storeu_si256((__m256i*)maxs, vMax);
+    for (int j = 0; j < 32; ++j) {
+        pMaxDiff[j%bpp] = max(pMaxDiff[j%bpp], maxs[j]);
+    }
+    for (int j = 0; j < 4; ++j) {
+        pSum[j%bpp] += sums[j];
+        pSqrSum[j%bpp] += sqrSums[j];
+    }
+    bool bMismatch = !_mm256_testz_si256(vMismatch, vMismatch);
+    bool bTailMismatch = CompareLine8SSE2(pSrc1+i, pSrc2+i, numValues-i, bpp,
+            tolerance, pMismatch+i, pMaxDiff, pSum, pSqrSum);
+    return bMismatch || bTailMismatch;
+}
+
+AVG_TARGET_AVX2
+static void ResampleLineVAVX2(const unsigned char* const* ppSrcLines,
+        unsigned char* pDest, int numValues, const short* pWeights, int numTaps)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i round = _mm256_set1_epi32(
+            1 << (PixelKernels::RESAMPLE_PRECISION_BITS-1));
+    const int bits = PixelKernels::RESAMPLE_PRECISION_BITS;
+    int i = 0;
+    for (; i+32 <= numValues; i += 32) {
+        __m256i sum0 = zero;
+        __m256i sum1 = zero;
+        __m256i sum2 = zero;
+        __m256i sum3 = zero;
+        for (int k = 0; k < numTaps; k += 2) {
+            __m256i src0 = _mm256_loadu_si256((const __m256i*)(ppSrcLines[k]+i));
+            __m256i src1;
+            __m256i weights;
+            if (k+1 < numTaps) {
+                src1 = _mm256_loadu_si256((const __m256i*)(ppSrcLines[k+1]+i));
+                weights = _mm256_set1_epi32((unsigned short)pWeights[k] | 
+                        (int(pWeights[k+1]) << 16));
+            } else {
+                src1 = zero;
+                weights = _mm256_set1_epi32((unsigned short)pWeights[k]);
+            }
+            // All unpacks and packs work per 128-bit lane, so the values stay in
+            // order.
+            __m256i lo = _mm256_unpacklo_epi8(src0, src1);
+            __m256i hi = _mm256_unpackhi_epi8(src0, src1);
+            sum0 = _mm256_add_epi32(sum0, _mm256_madd_epi16(
+                    _mm256_unpacklo_epi8(lo, zero), weights));
+            sum1 = _mm256_add_epi32(sum1, _mm256_madd_epi16(
+                    _mm256_unpackhi_epi8(lo, zero), weights));
+            sum2 = _mm256_add_epi32(sum2, _mm256_madd_epi16(
+                    _mm256_unpacklo_epi8(hi, zero), weights));
+            sum3 = _mm256_add_epi32(sum3, _mm256_madd_epi16(
+                    _mm256_unpackhi_epi8(hi, zero), weights));
+        }
+        sum0 = _mm256_srai_epi32(_mm256_add_epi32(sum0, round), bits);
+        sum1 = _mm256_srai_epi32(_mm256_add_epi32(sum1, round), bits);
+        sum2 = _mm256_srai_epi32(_mm256_add_epi32(sum2, round), bits);
+        sum3 = _mm256_srai_epi32(_mm256_add_epi32(sum3, round), bits);
+        __m256i dest = _mm256_packus_epi16(_mm256_packs_epi32(sum0, sum1),
+                _mm256_packs_epi32(sum2, sum3));
+        _mm256_storeu_si256((__m256i*)(pDest+i), dest);
+    }
+    for (; i < numValues; ++i) {
+        int sum = 0;
+        for (int k = 0; k < numTaps; ++k) {
+            sum += pWeights[k]*ppSrcLines[k][i];
+        }
+        pDest[i] = clampResampled(sum);
+    }
+}
+
+#endif
+
+static PixelKernels createScalarKernels()
+{
+    PixelKernels kernels;
+    kernels.m_I8toGray32Line = I8toGray32LineScalar;
+    kernels.m_I8toGray24Line = I8toGray24LineScalar;
+    kernels.m_I16toI8Line = I16toI8LineScalar;
+    kernels.m_I8toI16Line = I8toI16LineScalar;
+    kernels.m_ByteToFloatLine = ByteToFloatLineScalar;
+    kernels.m_FloatToByteLine = FloatToByteLineScalar;
+    kernels.m_Color32toI8Line = Color32toI8LineScalar;
+    kernels.m_Color32to24Line = Color32to24LineScalar;
+    kernels.m_Color24to32Line = Color24to32LineScalar;
+    kernels.m_Color32to16Line = Color32to16LineScalar;
+    kernels.m_SwapRB32Line = SwapRB32LineScalar;
+    kernels.m_SwapRB24Line = SwapRB24LineScalar;
+    kernels.m_YUYV422toBGR32Line = YUYV422toBGR32LineScalar;
+    kernels.m_UYVY422toBGR32Line = UYVY422toBGR32LineScalar;
+    kernels.m_PlanarYUVtoBGR32Line = PlanarYUVtoBGR32LineScalar;
+    kernels.m_ConvolveLine16 = ConvolveLine16Scalar;
+    kernels.m_BoxBlurLine16 = BoxBlurLine16Scalar;
+    kernels.m_AccumulateStatsLine8 = AccumulateStatsLine8Scalar;
+    kernels.m_CompareLine8 = CompareLine8Scalar;
+    kernels.m_ResampleLineH = ResampleLineHScalar;
+    kernels.m_ResampleLineV = ResampleLineVScalar;
+    return kernels;
+}
+
+static PixelKernels createKernels(SIMDLevel level)
+{
+    PixelKernels kernels = createScalarKernels();
+#ifdef AVG_X86
+    if (level >= SIMD_SSE2) {
+        kernels.m_I8toGray32Line = I8toGray32LineSSE2;
+        kernels.m_I16toI8Line = I16toI8LineSSE2;
+        kernels.m_I8toI16Line = I8toI16LineSSE2;
+        kernels.m_ByteToFloatLine = ByteToFloatLineSSE2;
+        kernels.m_FloatToByteLine = FloatToByteLineSSE2;
+        kernels.m_Color32toI8Line = Color32toI8LineSSE2;
+        kernels.m_Color32to16Line = Color32to16LineSSE2;
+        kernels.m_SwapRB32Line = SwapRB32LineSSE2;
+        kernels.m_YUYV422toBGR32Line = YUYV422toBGR32LineSSE2;
+        kernels.m_UYVY422toBGR32Line = UYVY422toBGR32LineSSE2;
+        kernels.m_PlanarYUVtoBGR32Line = PlanarYUVtoBGR32LineSSE2;
+        kernels.m_ConvolveLine16 = ConvolveLine16SSE2;
+        kernels.m_BoxBlurLine16 = BoxBlurLine16SSE2;
+        kernels.m_AccumulateStatsLine8 = AccumulateStatsLine8SSE2;
+        kernels.m_CompareLine8 = CompareLine8SSE2;
+        kernels.m_ResampleLineH = ResampleLineHSSE2;
+        kernels.m_ResampleLineV = ResampleLineVSSE2;
+    }
+    if (level >= SIMD_SSSE3) {
+        kernels.m_I8toGray24Line = I8toGray24LineSSSE3;
+        kernels.m_Color32to24Line = Color32to24LineSSSE3;
+        kernels.m_Color24to32Line = Color24to32LineSSSE3;
+        kernels.m_SwapRB24Line = SwapRB24LineSSSE3;
+    }
+    if (level >= SIMD_AVX2) {
+        kernels.m_I8toGray32Line = I8toGray32LineAVX2;
+        kernels.m_SwapRB32Line = SwapRB32LineAVX2;
+        kernels.m_I16toI8Line = I16toI8LineAVX2;
+        kernels.m_ByteToFloatLine = ByteToFloatLineAVX2;
+        kernels.m_FloatToByteLine = FloatToByteLineAVX2;
+        kernels.m_Color32toI8Line = Color32toI8LineAVX2;
+        kernels.m_PlanarYUVtoBGR32Line = PlanarYUVtoBGR32LineAVX2;
+        kernels.m_ConvolveLine16 = ConvolveLine16AVX2;
+        kernels.m_AccumulateStatsLine8 = AccumulateStatsLine8AVX2;
+        kernels.m_CompareLine8 = CompareLine8AVX2;
+        kernels.m_ResampleLineV = ResampleLineVAVX2;
+    }
+#endif
+    return kernels;
+}
+
+const PixelKernels& getPixelKernels(SIMDLevel level)
+{
+    static const PixelKernels kernels[] = {
+        createKernels(SIMD_NONE),
+        createKernels(SIMD_SSE2),
+        createKernels(SIMD_SSSE3),
+        createKernels(SIMD_AVX2)
+    };
+    AVG_ASSERT(level <= getCPUSIMDLevel());
+    return kernels[level];
+}
+
+static const PixelKernels* s_pKernels = 0;
+static boost::once_flag s_KernelsOnceFlag = BOOST_ONCE_INIT;
+
+static void initKernels()
+{
+    s_pKernels = &getPixelKernels(getSIMDLevel());
+}
+
+const PixelKernels& getPixelKernels()
+{
+    boost::call_once(s_KernelsOnceFlag, &initKernels);
+    return *s_pKernels;
+}
+
+void setPixelKernelsLevel(SIMDLevel level)
+{
+    // Makes sure a later first call of getPixelKernels() doesn't override level.
+    boost::call_once(s_KernelsOnceFlag, &initKernels);
+    s_pKernels = &getPixelKernels(level);
+}
+
+}
@@ -0,0 +1,144 @@
+//
+//  libavg - Media Playback Engine.
+//  Copyright (C) 2003-2014 Ulrich von Zadow
+//
+//  This library is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU Lesser General Public
+//  License as published by the Free Software Foundation; either
+//  version 2 of the License, or (at your option) any later version.
+//
+//  This library is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//  Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public
+//  License along with this library; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+//  Current versions can be found at www.libavg.de
+//
+#ifndef _PixelKernels_H_
+#define _PixelKernels_H_
+
+#include "../api.h"
+#include "../base/CPUFeatures.h"
+
+namespace avg {
+
+// Line functions used by Bitmap::copyPixels() and some filters. There is one table of
+// functions per SIMDLevel. Entries that have no optimized version at a level point to
+// the version of the next lower level, so every table is complete and the SIMD_NONE
+// table contains the plain C++ reference implementations. All versions produce
+// identical results.
+// Widths are in pixels unless noted otherwise. Source and destination lines don't
+// need to be aligned.
+struct PixelKernels
+{
+    // I8 -> 32 bpp gray (v, v, v, 255).
+    void (*m_I8toGray32Line)(const unsigned char* pSrc, unsigned char* pDest,
+            int width);
+    // I8 -> 24 bpp gray.
+    void (*m_I8toGray24Line)(const unsigned char* pSrc, unsigned char* pDest,
+            int width);
+    void (*m_I16toI8Line)(const unsigned short* pSrc, unsigned char* pDest, int width);
+    void (*m_I8toI16Line)(const unsigned char* pSrc, unsigned short* pDest, int width);
+    // numValues is the number of channel values, i.e. 4*width for RGBA.
+    void (*m_ByteToFloatLine)(const unsigned char* pSrc, float* pDest, int numValues);
+    void (*m_FloatToByteLine)(const float* pSrc, unsigned char* pDest, int numValues);
+    // 32 bpp color -> I8 using fixed-point luminance weights. bRedFirst selects
+    // R8G8B8X8 channel order instead of B8G8R8X8.
+    void (*m_Color32toI8Line)(const unsigned char* pSrc, unsigned char* pDest,
+            int width, bool bRedFirst);
+    // 32 bpp -> 24 bpp, dropping the fourth byte. bSwapRB exchanges the first and
+    // third byte of every pixel while converting (e.g. R8G8B8X8 -> B8G8R8).
+    void (*m_Color32to24Line)(const unsigned char* pSrc, unsigned char* pDest,
+            int width, bool bSwapRB);
+    // 24 bpp -> 32 bpp, setting the fourth byte to 255.
+    void (*m_Color24to32Line)(const unsigned char* pSrc, unsigned char* pDest,
+            int width, bool bSwapRB);
+    // B8G8R8X8 -> B5G6R5, or R8G8B8X8 -> B5G6R5 if bSwapRB is set.
+    void (*m_Color32to16Line)(const unsigned char* pSrc, unsigned short* pDest,
+            int width, bool bSwapRB);
+    // Exchange the first and third byte of every 32 or 24 bpp pixel. pSrc and pDest
+    // may point to the same line.
+    void (*m_SwapRB32Line)(const unsigned char* pSrc, unsigned char* pDest,
+            int width);
+    void (*m_SwapRB24Line)(const unsigned char* pSrc, unsigned char* pDest,
+            int width);
+    void (*m_YUYV422toBGR32Line)(const unsigned char* pSrc, unsigned char* pDest,
+            int width);
+    void (*m_UYVY422toBGR32Line)(const unsigned char* pSrc, unsigned char* pDest,
+            int width);
+    // Planar YUV -> BGR32. pU and pV contain one sample for every two pixels, so
+    // this works for 4:2:0 and 4:2:2 data. bJPEG selects full-range (JPEG) instead
+    // of BT.601 video-range coefficients.
+    void (*m_PlanarYUVtoBGR32Line)(const unsigned char* pY, const unsigned char* pU,
+            const unsigned char* pV, unsigned char* pDest, int width, bool bJPEG);
+
+    // 1D convolution of 16-bit values with a fixed-point kernel (weights in 1/65536).
+    // For every i in [0, numValues):
+    //   pDest[i] = min(65535, bias + sum((pSrc[i+k*step]*pKernel[k]) >> 16)),
+    // summed over k in [0, kernelSize). step is the distance between neighbouring
+    // pixels in values, i.e. 4 for RGBA. kernelSize must not exceed
+    // MAX_CONVOLVE_KERNEL_SIZE.
+    void (*m_ConvolveLine16)(const unsigned short* pSrc, unsigned short* pDest,
+            int numValues, int step, const unsigned short* pKernel, int kernelSize,
+            unsigned short bias);
+    // Box blur of 16-bit values using running sums. Each pixel has step values that are
+    // blurred independently:
+    //   pDest[i*step+c] = round(sum(pSrc[(i+k)*step+c])/(2*radius+1)),
+    // summed over k in [0, 2*radius]. pSrc contains numPixels+2*radius pixels.
+    void (*m_BoxBlurLine16)(const unsigned short* pSrc, unsigned short* pDest,
+            int numPixels, int step, int radius);
+    // Statistics of 8-bit values. pSrc[i] is counted in slot i%4 of pMin, pMax, pSum
+    // and pSqrSum, so for 32 bpp pixels the slots are the channels. The results are
+    // combined with the values already in the arrays.
+    void (*m_AccumulateStatsLine8)(const unsigned char* pSrc, int numValues,
+            unsigned char* pMin, unsigned char* pMax, long long* pSum,
+            long long* pSqrSum);
+    // Absolute differences of 8-bit values. |pSrc1[i]-pSrc2[i]| is counted in slot
+    // i%bpp of pMaxDiff, pSum and pSqrSum, combined with the values already there.
+    // pMismatch[i] is set to 255 if the difference is larger than tolerance and to 0
+    // otherwise. bpp must be between 1 and 4. Returns whether any difference is larger
+    // than tolerance.
+    bool (*m_CompareLine8)(const unsigned char* pSrc1, const unsigned char* pSrc2,
+            int numValues, int bpp, unsigned char tolerance, unsigned char* pMismatch,
+            unsigned char* pMaxDiff, long long* pSum, long long* pSqrSum);
+
+    // Horizontal resampling pass for 8-bit pixels with bpp (1, 3 or 4) channels. For
+    // every destination pixel x and channel c:
+    //   pDest[x*bpp+c] = clamp((sum(w[k]*pSrc[(pLeft[x]+k)*bpp+c])+round) >> 
+    //           RESAMPLE_PRECISION_BITS),
+    // with w = pWeights+x*weightStride, summed over k in [0, pNumTaps[x]). The
+    // weights after pNumTaps[x] must be 0, and pSrc must be readable up to pixel
+    // pLeft[x]+weightStride. weightStride must be a multiple of 8, since the SIMD
+    // versions process the weights in groups of up to 8.
+    void (*m_ResampleLineH)(const unsigned char* pSrc, unsigned char* pDest,
+            int destWidth, int bpp, const int* pLeft, const int* pNumTaps,
+            const short* pWeights, int weightStride);
+    // Vertical resampling pass: For every i in [0, numValues),
+    //   pDest[i] = clamp((sum(pWeights[k]*ppSrcLines[k][i])+round) >>
+    //           RESAMPLE_PRECISION_BITS),
+    // summed over k in [0, numTaps).
+    void (*m_ResampleLineV)(const unsigned char* const* ppSrcLines, unsigned char* pDest,
+            int numValues, const short* pWeights, int numTaps);
+
+    static const int MAX_CONVOLVE_KERNEL_SIZE = 64;
+    // Resampling weights are fixed-point numbers with this many fractional bits.
+    static const int RESAMPLE_PRECISION_BITS = 14;
+};
+
+// Kernels for the SIMD level the process uses (see getSIMDLevel()).
+AVG_API const PixelKernels& getPixelKernels();
+
+// Kernels for a specific level. level must not be higher than getCPUSIMDLevel().
+AVG_API const PixelKernels& getPixelKernels(SIMDLevel level);
+
+// Changes the kernels returned by getPixelKernels(). For tests and benchmarks; not
+// thread-safe.
+AVG_API void setPixelKernelsLevel(SIMDLevel level);
+
+}
+
+#endif
@@ -34,6 +34,8 @@ using namespace boost;
 
 namespace avg {
 
+long long TextureMover::s_NumBytesUploaded = 0;
+
 TextureMoverPtr TextureMover::create(OGLMemoryMode memoryMode, IntPoint size, 
         PixelFormat pf, unsigned usage)
 {
@@ -76,4 +78,14 @@ const IntPoint& TextureMover::getSize() const
     return m_Size;
 }
 
+long long TextureMover::getNumBytesUploaded()
+{
+    return s_NumBytesUploaded;
+}
+
+void TextureMover::addBytesUploaded(long long numBytes)
+{
+    s_NumBytesUploaded += numBytes;
+}
+
 }
@@ -55,7 +55,15 @@ public:
     PixelFormat getPF() const;
     const IntPoint& getSize() const;
 
+    // Total number of bytes uploaded to textures since program start.
+    static long long getNumBytesUploaded();
+
+protected:
+    static void addBytesUploaded(long long numBytes);
+
 private:
+    static long long s_NumBytesUploaded;
+
     IntPoint m_Size;
     PixelFormat m_pf;
 };
@@ -0,0 +1,100 @@
+//
+//  libavg - Media Playback Engine.
+//  Copyright (C) 2003-2014 Ulrich von Zadow
+//
+//  This library is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU Lesser General Public
+//  License as published by the Free Software Foundation; either
+//  version 2 of the License, or (at your option) any later version.
+//
+//  This library is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//  Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public
+//  License along with this library; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+//  Current versions can be found at www.libavg.de
+//
+
+#include "WebPDecoder.h"
+
+#include "../base/Exception.h"
+#include "../base/ScopeTimer.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <webp/decode.h>
+
+#include <vector>
+
+using namespace std;
+
+namespace avg {
+
+static ProfilingZoneID WebPProfilingZone("WebP decode", true);
+
+string WebPDecoder::getName() const
+{
+    return "libwebp";
+}
+
+bool WebPDecoder::canDecode(const unsigned char* pHeader, int headerLen) const
+{
+    return headerLen >= 12 && memcmp(pHeader, "RIFF", 4) == 0 && 
+            memcmp(pHeader+8, "WEBP", 4) == 0;
+}
+
+BitmapPtr WebPDecoder::decode(const UTF8String& sFilename, PixelFormat pf,
+        const IntPoint& maxDecodeSize) const
+{
+    ScopeTimer timer(WebPProfilingZone);
+    FILE* pFile = fopen(sFilename.c_str(), "rb");
+    if (!pFile) {
+        throw Exception(AVG_ERR_FILEIO, string("Can't open '") + sFilename + "': " +
+                strerror(errno));
+    }
+    vector<uint8_t> data;
+    uint8_t buffer[65536];
+    size_t bytesRead;
+    while ((bytesRead = fread(buffer, 1, sizeof(buffer), pFile)) > 0) {
+        data.insert(data.end(), buffer, buffer+bytesRead);
+    }
+    fclose(pFile);
+
+    WebPBitstreamFeatures features;
+    if (data.empty() || 
+            WebPGetFeatures(&data[0], data.size(), &features) != VP8_STATUS_OK)
+    {
+        throw Exception(AVG_ERR_FILEIO, string("Error decoding '") + sFilename + 
+                "': Invalid WebP header.");
+    }
+    if (features.has_animation) {
+        return BitmapPtr();
+    }
+    bool bAlpha = (features.has_alpha != 0);
+    PixelFormat destPF = getDestPF(pf, bAlpha);
+    PixelFormat decodePF = getDecodePF(destPF, bAlpha);
+    IntPoint size(features.width, features.height);
+    BitmapPtr pBmp(new Bitmap(size, decodePF, sFilename));
+    // Files without alpha get an opaque fourth byte, which is what the X formats
+    // expect.
+    uint8_t* pResult;
+    if (pixelFormatIsBlueFirst(decodePF)) {
+        pResult = WebPDecodeBGRAInto(&data[0], data.size(), pBmp->getPixels(),
+                pBmp->getMemNeeded(), pBmp->getStride());
+    } else {
+        pResult = WebPDecodeRGBAInto(&data[0], data.size(), pBmp->getPixels(),
+                pBmp->getMemNeeded(), pBmp->getStride());
+    }
+    if (!pResult) {
+        throw Exception(AVG_ERR_FILEIO, string("Error decoding '") + sFilename + 
+                "': Corrupt WebP data.");
+    }
+    return convertToDestPF(pBmp, destPF, sFilename);
+}
+
+}
@@ -35,12 +35,29 @@
 #include "HistoryPreProcessor.h"
 #include "FilterHighpass.h"
 #include "FilterGauss.h"
+#include "FilterFastGauss.h"
+#include "FilterResample.h"
 #include "FilterBlur.h"
 #include "FilterBandpass.h"
+#include "PixelKernels.h"
+#include "ImageStats.h"
+#include "ImageCompare.h"
+#include "GdkPixbufDecoder.h"
+#include "ImageContainer.h"
+#ifdef AVG_ENABLE_LIBJPEG
+#include "JPEGDecoder.h"
+#endif
+#ifdef AVG_ENABLE_LIBPNG
+#include "PNGDecoder.h"
+#endif
 
 #include "../base/TimeSource.h"
+#include "../base/CPUFeatures.h"
 
 #include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <cstring>
 #include <stdio.h>
 #include <stdlib.h>
 
@@ -89,6 +106,88 @@ public:
     }
 };
 
+// Decodes with one specific decoder, bypassing the BitmapCache.
+template<class DECODER>
+class DecodeJPEGPerfTest: public PerfTestBase {
+public:
+    DecodeJPEGPerfTest()
+        : PerfTestBase("DecodeJPEGPerfTest ("+DECODER().getName()+")")
+    {
+    }
+
+    void run()
+    {
+        BitmapPtr pBmp = m_Decoder.decode("../test/media/widebmp.jpg", B8G8R8X8,
+                IntPoint(0,0));
+    }
+
+private:
+    DECODER m_Decoder;
+};
+
+#ifdef AVG_ENABLE_LIBJPEG
+// JPEG decoding at 1/8 size using DCT scaling.
+class DecodeReducedJPEGPerfTest: public PerfTestBase {
+public:
+    DecodeReducedJPEGPerfTest()
+        : PerfTestBase("DecodeReducedJPEGPerfTest")
+    {
+    }
+
+    void run()
+    {
+        BitmapPtr pBmp = m_Decoder.decode("../test/media/widebmp.jpg", B8G8R8X8,
+                IntPoint(640,4));
+    }
+
+private:
+    JPEGDecoder m_Decoder;
+};
+#endif
+
+template<class DECODER>
+class DecodePNGPerfTest: public PerfTestBase {
+public:
+    DecodePNGPerfTest()
+        : PerfTestBase("DecodePNGPerfTest ("+DECODER().getName()+")")
+    {
+    }
+
+    void run()
+    {
+        BitmapPtr pBmp = m_Decoder.decode("../test/media/scrollarea_border.png", 
+                B8G8R8A8, IntPoint(0,0));
+    }
+
+private:
+    DECODER m_Decoder;
+};
+
+class DecodePrecompiledPerfTest: public PerfTestBase {
+public:
+    DecodePrecompiledPerfTest()
+        : PerfTestBase("DecodePrecompiledPerfTest")
+    {
+        m_sFName = string("benchmark")+ImageContainer::EXTENSION;
+        ImageContainer::save(m_sFName, 
+                loadBitmap("../test/media/widebmp.jpg", B8G8R8X8));
+    }
+
+    ~DecodePrecompiledPerfTest()
+    {
+        ::remove(m_sFName.c_str());
+    }
+
+    void run()
+    {
+        BitmapPtr pBmp = m_Decoder.decode(m_sFName, B8G8R8X8, IntPoint(0,0));
+    }
+
+private:
+    string m_sFName;
+    ImageContainerDecoder m_Decoder;
+};
+
 class FillI8PerfTest: public PerfTestBase {
 public:
     FillI8PerfTest() 
@@ -234,9 +333,190 @@ private:
         
 };
 
+class YUV422toRGB4KPerfTest: public PerfTestBase {
+public:
+    YUV422toRGB4KPerfTest() 
+        : PerfTestBase("YUV422toRGB4KPerfTest")
+    {
+        m_pYBmp = BitmapPtr(new Bitmap(IntPoint(3840, 2160), I8));
+        m_pUBmp = BitmapPtr(new Bitmap(IntPoint(1920, 2160), I8));
+        m_pVBmp = BitmapPtr(new Bitmap(IntPoint(1920, 2160), I8));
+        m_pRGBBmp = BitmapPtr(new Bitmap(IntPoint(3840, 2160), B8G8R8X8));
+    }
+
+    void run()
+    {
+        m_pRGBBmp->copyYUVPixels(*m_pYBmp, *m_pUBmp, *m_pVBmp, true, true);
+    }
+
+private:
+    BitmapPtr m_pYBmp;
+    BitmapPtr m_pUBmp;
+    BitmapPtr m_pVBmp;
+    BitmapPtr m_pRGBBmp;
+};
+
+class GaussI8PerfTest: public PerfTestBase {
+public:
+    GaussI8PerfTest() 
+        : PerfTestBase("GaussI8PerfTest")
+    {
+        m_pBmp = BitmapPtr(new Bitmap(IntPoint(1280, 720), I8));
+        memset(m_pBmp->getPixels(), 0x80, m_pBmp->getMemNeeded());
+    }
+
+    void run()
+    {
+        // Standard deviation 1.9, the largest FilterGauss supports.
+        FilterGauss(7).apply(m_pBmp);
+    }
+
+private:
+    BitmapPtr m_pBmp;
+};
+
+template<PixelFormat PF, int STD_DEV>
+class FastGaussPerfTest: public PerfTestBase {
+public:
+    FastGaussPerfTest() 
+        : PerfTestBase(createName())
+    {
+        m_pBmp = BitmapPtr(new Bitmap(IntPoint(1280, 720), PF));
+        memset(m_pBmp->getPixels(), 0x80, m_pBmp->getMemNeeded());
+    }
+
+    void run()
+    {
+        FilterFastGauss(float(STD_DEV)).apply(m_pBmp);
+    }
+
+private:
+    static string createName()
+    {
+        stringstream ss;
+        ss << "FastGauss" << getPixelFormatString(PF) << "StdDev" << STD_DEV << 
+                "PerfTest";
+        return ss.str();
+    }
+
+    BitmapPtr m_pBmp;
+};
+
+template<PixelFormat PF>
+class ImageStatsPerfTest: public PerfTestBase {
+public:
+    ImageStatsPerfTest() 
+        : PerfTestBase(string("ImageStats")+getPixelFormatString(PF)+"PerfTest")
+    {
+        m_pBmp = BitmapPtr(new Bitmap(IntPoint(1280, 720), PF));
+        unsigned char* pPixels = m_pBmp->getPixels();
+        for (int i = 0; i < m_pBmp->getMemNeeded(); ++i) {
+            pPixels[i] = rand();
+        }
+    }
+
+    void run()
+    {
+        ImageStats stats(*m_pBmp);
+    }
+
+private:
+    BitmapPtr m_pBmp;
+};
+
+// Compares bitmaps that differ in a few pixels, as in a typical baseline test.
+template<PixelFormat PF>
+class ImageComparePerfTest: public PerfTestBase {
+public:
+    ImageComparePerfTest() 
+        : PerfTestBase(string("ImageCompare")+getPixelFormatString(PF)+"PerfTest")
+    {
+        m_pBmp1 = BitmapPtr(new Bitmap(IntPoint(1280, 720), PF));
+        unsigned char* pPixels = m_pBmp1->getPixels();
+        for (int i = 0; i < m_pBmp1->getMemNeeded(); ++i) {
+            pPixels[i] = rand();
+        }
+        m_pBmp2 = BitmapPtr(new Bitmap(*m_pBmp1));
+        for (int i = 0; i < 100; ++i) {
+            m_pBmp2->getPixels()[rand()%m_pBmp2->getMemNeeded()] ^= 1;
+        }
+    }
+
+    void run()
+    {
+        ImageCompare imgCompare(*m_pBmp1, *m_pBmp2);
+    }
+
+private:
+    BitmapPtr m_pBmp1;
+    BitmapPtr m_pBmp2;
+};
+
+template<PixelFormat PF, int DEST_WIDTH>
+class ResamplePerfTest: public PerfTestBase {
+public:
+    ResamplePerfTest() 
+        : PerfTestBase(createName())
+    {
+        m_pBmp = BitmapPtr(new Bitmap(IntPoint(1920, 1080), PF));
+        memset(m_pBmp->getPixels(), 0x80, m_pBmp->getMemNeeded());
+    }
+
+    void run()
+    {
+        FilterResample(IntPoint(DEST_WIDTH, DEST_WIDTH*9/16), FilterResample::BILINEAR)
+                .apply(m_pBmp);
+    }
+
+private:
+    static string createName()
+    {
+        stringstream ss;
+        ss << "Resample" << getPixelFormatString(PF) << "To" << DEST_WIDTH << 
+                "PerfTest";
+        return ss.str();
+    }
+
+    BitmapPtr m_pBmp;
+};
+
+// The conversion BitmapLoader does for every image: decoder output (RGB) to the
+// native blue-first pixel format.
+template<PixelFormat SRCPF, PixelFormat DESTPF>
+class SwapRBPerfTest: public PerfTestBase {
+public:
+    SwapRBPerfTest() 
+        : PerfTestBase(string("SwapRB")+getPixelFormatString(SRCPF)+"To"+
+                getPixelFormatString(DESTPF)+"PerfTest")
+    {
+        m_pSrcBmp = BitmapPtr(new Bitmap(IntPoint(1920, 1080), SRCPF));
+        memset(m_pSrcBmp->getPixels(), 0x80, m_pSrcBmp->getMemNeeded());
+        m_pDestBmp = BitmapPtr(new Bitmap(IntPoint(1920, 1080), DESTPF));
+    }
+
+    void run()
+    {
+        m_pDestBmp->copyPixelsSwapRB(*m_pSrcBmp);
+    }
+
+private:
+    BitmapPtr m_pSrcBmp;
+    BitmapPtr m_pDestBmp;
+};
+
 void runPerformanceTests()
 {
     runPerformanceTest<LoadPNGPerfTest>();
+    runPerformanceTest<DecodeJPEGPerfTest<GdkPixbufDecoder> >(100);
+#ifdef AVG_ENABLE_LIBJPEG
+    runPerformanceTest<DecodeJPEGPerfTest<JPEGDecoder> >(100);
+    runPerformanceTest<DecodeReducedJPEGPerfTest>(100);
+#endif
+    runPerformanceTest<DecodePNGPerfTest<GdkPixbufDecoder> >(100);
+#ifdef AVG_ENABLE_LIBPNG
+    runPerformanceTest<DecodePNGPerfTest<PNGDecoder> >(100);
+#endif
+    runPerformanceTest<DecodePrecompiledPerfTest>(100);
     runPerformanceTest<FillI8PerfTest>();
     runPerformanceTest<FillRGBPerfTest>();
     runPerformanceTest<FillRGBAPerfTest>();
@@ -245,11 +525,104 @@ void runPerformanceTests()
     runPerformanceTest<CopyRGBPerfTest>();
     runPerformanceTest<CopyRGBAPerfTest>();
     runPerformanceTest<YUV2RGBPerfTest>(200);
+    runPerformanceTest<YUV422toRGB4KPerfTest>(20);
+    runPerformanceTest<GaussI8PerfTest>(20);
+    runPerformanceTest<FastGaussPerfTest<I8, 2> >(20);
+    runPerformanceTest<FastGaussPerfTest<I8, 10> >(20);
+    runPerformanceTest<FastGaussPerfTest<B8G8R8A8, 2> >(20);
+    runPerformanceTest<FastGaussPerfTest<B8G8R8A8, 10> >(20);
+    runPerformanceTest<ImageStatsPerfTest<I8> >(100);
+    runPerformanceTest<ImageStatsPerfTest<B8G8R8A8> >(100);
+    runPerformanceTest<ImageComparePerfTest<I8> >(100);
+    runPerformanceTest<ImageComparePerfTest<B8G8R8X8> >(100);
+    runPerformanceTest<ImageComparePerfTest<B8G8R8A8> >(100);
+    runPerformanceTest<ResamplePerfTest<I8, 320> >(20);
+    runPerformanceTest<ResamplePerfTest<I8, 3840> >(20);
+    runPerformanceTest<ResamplePerfTest<B8G8R8A8, 320> >(20);
+    runPerformanceTest<ResamplePerfTest<B8G8R8A8, 3840> >(20);
+    runPerformanceTest<SwapRBPerfTest<R8G8B8, B8G8R8X8> >(100);
+    runPerformanceTest<SwapRBPerfTest<R8G8B8A8, B8G8R8A8> >(100);
+    runPerformanceTest<SwapRBPerfTest<R8G8B8X8, B5G6R5> >(100);
+}
+
+// Format pairs Bitmap::copyPixels() can convert.
+bool isConversionSupported(PixelFormat srcPF, PixelFormat destPF)
+{
+    if (srcPF == destPF) {
+        return true;
+    }
+    switch (srcPF) {
+        case YCbCr422:
+        case YUYV422:
+            return destPF != I8 && destPF != I16 && destPF != YCbCr422 && 
+                    destPF != YUYV422;
+        case I8:
+        case I16:
+            return destPF == I8 || destPF == I16 || 
+                    (getBytesPerPixel(destPF) >= 3 && destPF != R32G32B32A32F);
+        case R32G32B32A32F:
+            return getBytesPerPixel(destPF) == 4;
+        default:
+            if (destPF == R32G32B32A32F) {
+                return getBytesPerPixel(srcPF) == 4;
+            }
+            return destPF == I8 || destPF == B5G6R5 || getBytesPerPixel(destPF) == 3 || 
+                    getBytesPerPixel(destPF) == 4;
+    }
+}
+
+float timeConversion(const Bitmap& srcBmp, Bitmap& destBmp, int numRuns)
+{
+    long long startTime = TimeSource::get()->getCurrentMicrosecs();
+    for (int i = 0; i < numRuns; ++i) {
+        destBmp.copyPixels(srcBmp);
+    }
+    return (TimeSource::get()->getCurrentMicrosecs()-startTime)/1000.f/numRuns;
+}
+
+// Times copyPixels() for every supported pair of formats with the scalar line kernels
+// and with the ones for the SIMD level in use. Set AVG_SIMD to compare other levels.
+void runConversionBenchmarks()
+{
+    PixelFormat formats[] = {B5G6R5, B8G8R8, B8G8R8A8, B8G8R8X8, R8G8B8A8, I8, I16,
+            YCbCr422, YUYV422, R32G32B32A32F};
+    int numFormats = sizeof(formats)/sizeof(*formats);
+    IntPoint sizes[] = {IntPoint(1920, 1080), IntPoint(3840, 2160)};
+    SIMDLevel level = getSIMDLevel();
+    cerr << "Bitmap::copyPixels() in ms: scalar, " << getSIMDLevelString(level) << 
+            ", speedup" << endl;
+    for (int i = 0; i < 2; ++i) {
+        IntPoint size = sizes[i];
+        cerr << size.x << "x" << size.y << ":" << endl;
+        for (int srcIdx = 0; srcIdx < numFormats; ++srcIdx) {
+            PixelFormat srcPF = formats[srcIdx];
+            Bitmap srcBmp(size, srcPF);
+            // 0x3F3F3F3F is about 0.75 as float.
+            memset(srcBmp.getPixels(), 0x3F, srcBmp.getMemNeeded());
+            for (int destIdx = 0; destIdx < numFormats; ++destIdx) {
+                PixelFormat destPF = formats[destIdx];
+                if (!isConversionSupported(srcPF, destPF)) {
+                    continue;
+                }
+                Bitmap destBmp(size, destPF);
+                setPixelKernelsLevel(SIMD_NONE);
+                float scalarTime = timeConversion(srcBmp, destBmp, 5);
+                setPixelKernelsLevel(level);
+                float simdTime = timeConversion(srcBmp, destBmp, 5);
+                cerr << "  " << setw(14) << left << getPixelFormatString(srcPF) << 
+                        "-> " << setw(14) << getPixelFormatString(destPF) << right <<
+                        fixed << setprecision(2) << setw(8) << scalarTime << 
+                        setw(8) << simdTime << setw(7) << scalarTime/simdTime << "x" <<
+                        endl;
+            }
+        }
+    }
 }
 
 int main(int nargs, char** args)
 {
     BitmapLoader::init(true);
     runPerformanceTests();
+    runConversionBenchmarks();
 }
 
@@ -37,6 +37,7 @@
 #include "FilterHighpass.h"
 #include "FilterFastBandpass.h"
 #include "FilterGauss.h"
+#include "FilterFastGauss.h"
 #include "FilterBlur.h"
 #include "FilterBandpass.h"
 #include "FilterFastDownscale.h"
@@ -47,11 +48,28 @@
 #include "FilterErosion.h"
 #include "FilterGetAlpha.h"
 #include "FilterResizeBilinear.h"
+#include "FilterResample.h"
+#include "ContribDefs.h"
 #include "FilterUnmultiplyAlpha.h"
+#include "PixelKernels.h"
+#include "BitmapPool.h"
+#include "BitmapCache.h"
+#include "GdkPixbufDecoder.h"
+#include "ImageContainer.h"
+#ifdef AVG_ENABLE_LIBJPEG
+#include "JPEGDecoder.h"
+#endif
+#ifdef AVG_ENABLE_LIBPNG
+#include "PNGDecoder.h"
+#endif
+#include "ImageStats.h"
+#include "ImageCompare.h"
 
 #include "../base/TestSuite.h"
 #include "../base/Exception.h"
 #include "../base/MathHelper.h"
+#include "../base/FileHelper.h"
+#include "../base/CPUFeatures.h"
 
 #ifdef _WIN32
 #pragma warning(push)
@@ -63,6 +81,8 @@
 
 #include <cstring>
 #include <iostream>
+#include <vector>
+#include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
 
@@ -402,6 +422,925 @@ private:
 
 };
 
+class PixelKernelsTest: public GraphicsTest {
+public:
+    PixelKernelsTest()
+      : GraphicsTest("PixelKernelsTest", 2)
+    {
+    }
+
+    void runTests()
+    {
+        // Conversions that use PixelKernels. Every SIMD version must produce the same
+        // result as the scalar version.
+        PixelFormat conversions[][2] = {
+            {I8, B8G8R8X8}, {I8, B8G8R8}, {I8, I16}, {I16, I8},
+            {B8G8R8A8, R32G32B32A32F}, {R32G32B32A32F, B8G8R8A8},
+            {B8G8R8A8, I8}, {R8G8B8A8, I8}, {B8G8R8A8, B8G8R8}, {B8G8R8, B8G8R8A8},
+            {B8G8R8A8, B5G6R5}, {YUYV422, B8G8R8X8}, {YCbCr422, B8G8R8X8}
+        };
+        int numConversions = sizeof(conversions)/sizeof(*conversions);
+        for (int level = SIMD_SSE2; level <= getCPUSIMDLevel(); ++level) {
+            cerr << "    " << getSIMDLevelString(SIMDLevel(level)) << endl;
+            for (int i = 0; i < numConversions; ++i) {
+                // Widths that aren't multiples of the vector size exercise the scalar
+                // code for the last pixels.
+                testConversion(conversions[i][0], conversions[i][1], IntPoint(66, 4),
+                        SIMDLevel(level));
+                testConversion(conversions[i][0], conversions[i][1], IntPoint(258, 4),
+                        SIMDLevel(level));
+            }
+            for (int i = 0; i < 4; ++i) {
+                bool bJPEG = (i & 1) != 0;
+                bool bChroma422 = (i & 2) != 0;
+                testYUVConversion(IntPoint(66, 4), bJPEG, bChroma422, SIMDLevel(level));
+            }
+            PixelFormat swapConversions[][2] = {
+                {R8G8B8A8, B8G8R8A8}, {R8G8B8, B8G8R8}, {R8G8B8X8, B8G8R8},
+                {R8G8B8, B8G8R8X8}, {R8G8B8X8, B5G6R5}, {R8G8B8A8, I8}
+            };
+            int numSwapConversions = sizeof(swapConversions)/sizeof(*swapConversions);
+            for (int i = 0; i < numSwapConversions; ++i) {
+                for (int width = 63; width <= 66; ++width) {
+                    testSwapConversion(swapConversions[i][0], swapConversions[i][1], 
+                            IntPoint(width, 4), SIMDLevel(level));
+                }
+            }
+        }
+        // Big enough to be split into several bands.
+        testYUVConversion(IntPoint(3840, 2160), false, false, getCPUSIMDLevel());
+        setPixelKernelsLevel(getSIMDLevel());
+    }
+
+private:
+    void testConversion(PixelFormat srcPF, PixelFormat destPF, const IntPoint& size,
+            SIMDLevel level)
+    {
+        BitmapPtr pSrcBmp = createRandomBmp(size, srcPF);
+        setPixelKernelsLevel(SIMD_NONE);
+        BitmapPtr pBaselineBmp = convert(pSrcBmp, destPF);
+        setPixelKernelsLevel(level);
+        BitmapPtr pDestBmp = convert(pSrcBmp, destPF);
+        if (!(*pDestBmp == *pBaselineBmp)) {
+            cerr << "      " << srcPF << "->" << destPF << ", width " << size.x
+                    << ": result differs from scalar version." << endl;
+        }
+        QUIET_TEST(*pDestBmp == *pBaselineBmp);
+    }
+
+    void testSwapConversion(PixelFormat srcPF, PixelFormat destPF, const IntPoint& size,
+            SIMDLevel level)
+    {
+        // Baseline: Swap red and blue in a copy of the source, then convert.
+        BitmapPtr pSrcBmp = createRandomBmp(size, srcPF);
+        BitmapPtr pSwappedBmp(new Bitmap(*pSrcBmp));
+        int bpp = pSwappedBmp->getBytesPerPixel();
+        for (int y = 0; y < size.y; ++y) {
+            unsigned char * pLine = pSwappedBmp->getPixels()+y*pSwappedBmp->getStride();
+            for (int x = 0; x < size.x; ++x) {
+                swap(pLine[x*bpp], pLine[x*bpp+2]);
+            }
+        }
+        setPixelKernelsLevel(SIMD_NONE);
+        BitmapPtr pBaselineBmp = convert(pSwappedBmp, destPF);
+
+        setPixelKernelsLevel(level);
+        BitmapPtr pDestBmp(new Bitmap(size, destPF));
+        memset(pDestBmp->getPixels(), 0, pDestBmp->getMemNeeded());
+        pDestBmp->copyPixelsSwapRB(*pSrcBmp);
+        if (!(*pDestBmp == *pBaselineBmp)) {
+            cerr << "      " << srcPF << "->" << destPF << ", width " << size.x
+                    << ": swapped conversion differs from baseline." << endl;
+        }
+        QUIET_TEST(*pDestBmp == *pBaselineBmp);
+
+        if (srcPF != destPF && getBytesPerPixel(srcPF) == getBytesPerPixel(destPF)) {
+            // In place, with the pixel format changing.
+            BitmapPtr pBmp(new Bitmap(*pSrcBmp));
+            FilterFlipRGB().applyInPlace(pBmp);
+            QUIET_TEST(pBmp->getPixelFormat() == destPF);
+            pBmp->setPixelFormat(srcPF);
+            pSwappedBmp->setPixelFormat(srcPF);
+            QUIET_TEST(*pBmp == *pSwappedBmp);
+            pBmp = FilterFlipRGB().apply(pSrcBmp);
+            pBmp->setPixelFormat(srcPF);
+            QUIET_TEST(*pBmp == *pSwappedBmp);
+        }
+    }
+
+    void testYUVConversion(const IntPoint& size, bool bJPEG, bool bChroma422,
+            SIMDLevel level)
+    {
+        IntPoint chromaSize(size.x/2, bChroma422 ? size.y : size.y/2);
+        BitmapPtr pYBmp = createRandomBmp(size, I8);
+        BitmapPtr pUBmp = createRandomBmp(chromaSize, I8);
+        BitmapPtr pVBmp = createRandomBmp(chromaSize, I8);
+        BitmapPtr pBaselineBmp(new Bitmap(size, B8G8R8X8));
+        BitmapPtr pDestBmp(new Bitmap(size, B8G8R8X8));
+        memset(pDestBmp->getPixels(), 0, pDestBmp->getMemNeeded());
+        setPixelKernelsLevel(SIMD_NONE);
+        pBaselineBmp->copyYUVPixels(*pYBmp, *pUBmp, *pVBmp, bJPEG, bChroma422);
+        setPixelKernelsLevel(level);
+        pDestBmp->copyYUVPixels(*pYBmp, *pUBmp, *pVBmp, bJPEG, bChroma422);
+        QUIET_TEST(*pDestBmp == *pBaselineBmp);
+        // Make sure all lines were written.
+        bool bAlphaOk = true;
+        for (int y = 0; y < size.y; ++y) {
+            unsigned char * pLine = pDestBmp->getPixels()+y*pDestBmp->getStride();
+            for (int x = 0; x < size.x; ++x) {
+                bAlphaOk &= (pLine[x*4+ALPHAPOS] == 255);
+            }
+        }
+        QUIET_TEST(bAlphaOk);
+    }
+
+    BitmapPtr createRandomBmp(const IntPoint& size, PixelFormat pf)
+    {
+        BitmapPtr pBmp(new Bitmap(size, pf));
+        for (int y = 0; y < size.y; ++y) {
+            unsigned char * pLine = pBmp->getPixels()+y*pBmp->getStride();
+            if (pf == R32G32B32A32F) {
+                for (int x = 0; x < size.x*4; ++x) {
+                    ((float*)pLine)[x] = float(rand())/RAND_MAX;
+                }
+            } else {
+                for (int x = 0; x < pBmp->getLineLen(); ++x) {
+                    pLine[x] = rand();
+                }
+            }
+        }
+        return pBmp;
+    }
+
+    BitmapPtr convert(BitmapPtr pSrcBmp, PixelFormat destPF)
+    {
+        BitmapPtr pDestBmp(new Bitmap(pSrcBmp->getSize(), destPF));
+        memset(pDestBmp->getPixels(), 0, pDestBmp->getMemNeeded());
+        pDestBmp->copyPixels(*pSrcBmp);
+        return pDestBmp;
+    }
+};
+
+class BitmapPoolTest: public GraphicsTest {
+public:
+    BitmapPoolTest()
+      : GraphicsTest("BitmapPoolTest", 2)
+    {
+    }
+
+    void runTests()
+    {
+        // Size classes
+        TEST(BitmapPool::getClassSize(BitmapPool::getSizeClass(1)) == 256);
+        TEST(BitmapPool::getClassSize(BitmapPool::getSizeClass(256)) == 256);
+        TEST(BitmapPool::getClassSize(BitmapPool::getSizeClass(257)) == 320);
+        TEST(BitmapPool::getClassSize(BitmapPool::getSizeClass(512)) == 512);
+        TEST(BitmapPool::getClassSize(BitmapPool::getSizeClass(513)) == 640);
+        for (size_t numBytes = 1; numBytes < 100000; numBytes += 37) {
+            int sizeClass = BitmapPool::getSizeClass(numBytes);
+            TEST(BitmapPool::getClassSize(sizeClass) >= numBytes);
+            QUIET_TEST(sizeClass == 0 || 
+                    BitmapPool::getClassSize(sizeClass-1) < numBytes);
+        }
+
+        BitmapPool* pPool = BitmapPool::get();
+        size_t oldMaxBytes = pPool->getMaxBytesRetained();
+        pPool->trim();
+        pPool->resetStats();
+        BitmapPoolStats stats = pPool->getStats();
+        TEST(stats.m_NumHits == 0 && stats.m_NumMisses == 0);
+        TEST(stats.m_BytesRetained == 0);
+
+        // Freed blocks are reused by allocations of the same size class.
+        unsigned char* pBits = pPool->alloc(100000);
+        TEST(size_t(pBits) % BitmapPool::ALIGNMENT == 0);
+        memset(pBits, 0, 100000);
+        pPool->free(pBits);
+        stats = pPool->getStats();
+        TEST(stats.m_NumMisses == 1);
+        TEST(stats.m_BytesRetained == 
+                BitmapPool::getClassSize(BitmapPool::getSizeClass(100000)));
+        unsigned char* pBits2 = pPool->alloc(99000);
+        TEST(pBits2 == pBits);
+        TEST(pPool->getStats().m_NumHits == 1);
+        TEST(pPool->getStats().m_BytesRetained == 0);
+        pPool->free(pBits2);
+
+        // Same for bitmaps.
+        pPool->resetStats();
+        for (int i = 0; i < 10; ++i) {
+            Bitmap bmp(IntPoint(320, 240), B8G8R8A8);
+            TEST(size_t(bmp.getPixels()) % BitmapPool::ALIGNMENT == 0);
+        }
+        stats = pPool->getStats();
+        TEST(stats.m_NumHits + stats.m_NumMisses == 10);
+        TEST(stats.m_NumHits >= 9);
+
+        // High-water limit and trim.
+        pPool->setMaxBytesRetained(0);
+        TEST(pPool->getStats().m_BytesRetained == 0);
+        pBits = pPool->alloc(1000);
+        pPool->free(pBits);
+        TEST(pPool->getStats().m_BytesRetained == 0);
+        pPool->setMaxBytesRetained(oldMaxBytes);
+        pBits = pPool->alloc(1000);
+        pPool->free(pBits);
+        TEST(pPool->getStats().m_BytesRetained > 0);
+        pPool->trim();
+        TEST(pPool->getStats().m_BytesRetained == 0);
+    }
+};
+
+
+class BitmapCacheTest: public GraphicsTest {
+public:
+    BitmapCacheTest()
+      : GraphicsTest("BitmapCacheTest", 2)
+    {
+    }
+
+    void runTests()
+    {
+        // The cache only looks at the file's time stamp and size, so the contents
+        // don't need to be an image.
+        string sFName = "BitmapCacheTest.tmp";
+        writeWholeFile(sFName, "a");
+        BitmapCache* pCache = BitmapCache::get();
+        size_t oldMaxBytes = pCache->getMaxBytes();
+        pCache->clear();
+        pCache->resetStats();
+        pCache->setMaxBytes(3*4096);
+
+        BitmapPtr pBmp = createBmp(I8, 1);
+        TEST(!pCache->find(sFName, I8));
+        pCache->insert(sFName, I8, pBmp);
+        BitmapCacheStats stats = pCache->getStats();
+        TEST(stats.m_NumMisses == 1 && stats.m_NumHits == 0);
+        TEST(stats.m_NumBitmaps == 1 && stats.m_BytesUsed == 4096);
+        BitmapPtr pCachedBmp = pCache->find(sFName, I8);
+        TEST(pCachedBmp && *pCachedBmp == *pBmp);
+        TEST(!pCache->find(sFName, A8));
+        stats = pCache->getStats();
+        TEST(stats.m_NumMisses == 2 && stats.m_NumHits == 1);
+
+        // Changing a bitmap doesn't change the cached version.
+        pCachedBmp->getPixels()[0] = 0;
+        pBmp->getPixels()[1] = 0;
+        TEST(*pCache->find(sFName, I8) == *createBmp(I8, 1));
+
+        // Least recently used entries are evicted first.
+        pCache->insert(sFName, A8, createBmp(A8, 2));
+        TEST(bool(pCache->find(sFName, I8)));
+        pCache->insert(sFName, I16, createBmp(I16, 3));
+        stats = pCache->getStats();
+        TEST(stats.m_NumEvictions == 1);
+        TEST(stats.m_NumBitmaps == 2 && stats.m_BytesUsed == 3*4096);
+        TEST(!pCache->find(sFName, A8));
+        TEST(bool(pCache->find(sFName, I8)));
+        TEST(*pCache->find(sFName, I16) == *createBmp(I16, 3));
+
+        // Bitmaps larger than the budget aren't cached.
+        pCache->insert(sFName, B8G8R8A8, 
+                BitmapPtr(new Bitmap(IntPoint(128, 128), B8G8R8A8)));
+        TEST(!pCache->find(sFName, B8G8R8A8));
+        TEST(pCache->getStats().m_NumBitmaps == 2);
+
+        // Entries are dropped if the file changes or on request.
+        writeWholeFile(sFName, "ab");
+        TEST(!pCache->find(sFName, I8));
+        TEST(pCache->getStats().m_NumBitmaps == 1);
+        pCache->insert(sFName, I8, createBmp(I8, 5));
+        TEST(bool(pCache->find(sFName, I8)));
+        pCache->invalidate(sFName);
+        stats = pCache->getStats();
+        TEST(stats.m_NumBitmaps == 0 && stats.m_BytesUsed == 0);
+        pCache->insert(sFName, I8, createBmp(I8, 6));
+        ::remove(sFName.c_str());
+        TEST(!pCache->find(sFName, I8));
+
+        pCache->setMaxBytes(oldMaxBytes);
+        pCache->clear();
+    }
+
+private:
+    BitmapPtr createBmp(PixelFormat pf, int seed)
+    {
+        BitmapPtr pBmp(new Bitmap(IntPoint(64, 64), pf));
+        for (int i = 0; i < pBmp->getMemNeeded(); ++i) {
+            pBmp->getPixels()[i] = (unsigned char)(i*seed);
+        }
+        return pBmp;
+    }
+};
+
+class ImageDecoderTest: public GraphicsTest {
+public:
+    ImageDecoderTest()
+      : GraphicsTest("ImageDecoderTest", 2)
+    {
+    }
+
+    void runTests()
+    {
+        vector<string> sNames = BitmapLoader::get()->getDecoderNames();
+        TEST(sNames.back() == "gdk-pixbuf");
+        const char* pszPNGFiles[] = {"rgb24-64x64.png", "rgb24alpha-64x64.png", 
+                "i8-64x64.png", "slider_thumb_up.png", 0};
+        const char* pszJPEGFiles[] = {"freidrehen.jpg", "widebmp.jpg", 
+                "greyscale.jpg", 0};
+#ifdef AVG_ENABLE_LIBJPEG
+        runDecoderTests(JPEGDecoder(), pszJPEGFiles, pszPNGFiles);
+#endif
+#ifdef AVG_ENABLE_LIBPNG
+        runDecoderTests(PNGDecoder(), pszPNGFiles, pszJPEGFiles);
+#endif
+    }
+
+private:
+    void runDecoderTests(const ImageDecoder& decoder, const char** ppszFiles, 
+            const char** ppszOtherFiles)
+    {
+        cerr << "    Testing " << decoder.getName() << endl;
+        for (int i = 0; ppszFiles[i]; ++i) {
+            TEST(canDecode(decoder, ppszFiles[i]));
+        }
+        for (int i = 0; ppszOtherFiles[i]; ++i) {
+            TEST(!canDecode(decoder, ppszOtherFiles[i]));
+        }
+
+        // The native decoders should produce the same bitmaps as gdk-pixbuf.
+        GdkPixbufDecoder refDecoder;
+        PixelFormat pfs[] = {NO_PIXELFORMAT, B8G8R8A8, B8G8R8X8, R8G8B8A8, R8G8B8X8,
+                B8G8R8, I8};
+        for (int i = 0; ppszFiles[i]; ++i) {
+            string sFName = string("../test/media/")+ppszFiles[i];
+            for (unsigned j = 0; j < sizeof(pfs)/sizeof(PixelFormat); ++j) {
+                BitmapPtr pBmp = decoder.decode(sFName, pfs[j], IntPoint(0,0));
+                BitmapPtr pBaselineBmp = refDecoder.decode(sFName, pfs[j], 
+                        IntPoint(0,0));
+                TEST(pBmp->getPixelFormat() == pBaselineBmp->getPixelFormat());
+                testEqual(*pBmp, *pBaselineBmp, string("Decode_")+decoder.getName()+
+                        "_"+getPixelFormatString(pfs[j]), 0.5, 0.5);
+            }
+        }
+
+        string sFName = "ImageDecoderTest.tmp";
+        writeWholeFile(sFName, readHeader(ppszFiles[0])+"corrupt");
+        bool bExceptionThrown = false;
+        try {
+            decoder.decode(sFName, NO_PIXELFORMAT, IntPoint(0,0));
+        } catch (Exception& ex) {
+            bExceptionThrown = (ex.getCode() == AVG_ERR_FILEIO);
+        }
+        TEST(bExceptionThrown);
+        ::remove(sFName.c_str());
+    }
+
+    bool canDecode(const ImageDecoder& decoder, const string& sFName)
+    {
+        string sHeader = readHeader(sFName);
+        return decoder.canDecode((const unsigned char*)sHeader.c_str(), 
+                int(sHeader.size()));
+    }
+
+    string readHeader(const string& sFName)
+    {
+        string sContents;
+        readWholeFile(string("../test/media/")+sFName, sContents);
+        return sContents.substr(0, ImageDecoder::HEADER_SIZE);
+    }
+};
+
+class DecodeSizeTest: public GraphicsTest {
+public:
+    DecodeSizeTest()
+      : GraphicsTest("DecodeSizeTest", 2)
+    {
+    }
+
+    void runTests()
+    {
+        TEST(ImageDecoder::getReductionFactor(IntPoint(100,100), IntPoint(0,0)) == 1);
+        TEST(ImageDecoder::getReductionFactor(IntPoint(100,100), IntPoint(50,50)) == 2);
+        TEST(ImageDecoder::getReductionFactor(IntPoint(100,100), IntPoint(51,50)) == 1);
+        TEST(ImageDecoder::getReductionFactor(IntPoint(100,100), IntPoint(10,0)) == 8);
+        TEST(ImageDecoder::getReductionFactor(IntPoint(100,10), IntPoint(1,0)) == 8);
+        TEST(ImageDecoder::getReductionFactor(IntPoint(40,30), IntPoint(100,100)) == 1);
+
+        // JPEGs are scaled while decoding, other formats afterwards. Both should look
+        // like a box-filtered full-size image.
+        runLoadTest("freidrehen.jpg", IntPoint(40,30), IntPoint(40,30), 1, 1);
+        runLoadTest("freidrehen.jpg", IntPoint(50,0), IntPoint(80,60), 1, 1);
+        runLoadTest("widebmp.jpg", IntPoint(640,4), IntPoint(640,4), 1, 1);
+        runLoadTest("checker.png", IntPoint(64,64), IntPoint(64,64), 0, 0);
+        runLoadTest("rgb24alpha-64x64.png", IntPoint(30,30), IntPoint(32,32), 0, 0);
+        runLoadTest("rgb24alpha-64x64.png", IntPoint(33,1), IntPoint(64,64), 0, 0);
+    }
+
+private:
+    void runLoadTest(const string& sFName, const IntPoint& maxDecodeSize, 
+            const IntPoint& expectedSize, float maxAverage, float maxStdDev)
+    {
+        string sPath = "../test/media/"+sFName;
+        BitmapPtr pBmp = loadBitmap(sPath, NO_PIXELFORMAT, maxDecodeSize);
+        TEST(pBmp->getSize() == expectedSize);
+        BitmapPtr pFullBmp = loadBitmap(sPath);
+        BitmapPtr pBaselineBmp = FilterResample(expectedSize, FilterResample::BOX)
+                .apply(pFullBmp);
+        testEqual(*pBmp, *pBaselineBmp, "DecodeSize_"+sFName, maxAverage, maxStdDev);
+    }
+};
+
+class ImageContainerTest: public GraphicsTest {
+public:
+    ImageContainerTest()
+      : GraphicsTest("ImageContainerTest", 2)
+    {
+    }
+
+    void runTests()
+    {
+        string sFName = string("ImageContainerTest")+ImageContainer::EXTENSION;
+        // Odd widths make the stored stride differ from the line length.
+        BitmapPtr pRGBBmp = loadBitmap("../test/media/rgb24-65x65.png", B8G8R8);
+        PixelFormat pfs[] = {I8, B8G8R8, B8G8R8A8, R8G8B8X8};
+        for (unsigned i = 0; i < sizeof(pfs)/sizeof(PixelFormat); ++i) {
+            BitmapPtr pBmp(new Bitmap(pRGBBmp->getSize(), pfs[i]));
+            pBmp->copyPixels(*pRGBBmp);
+            runRoundTripTest(sFName, pBmp);
+        }
+        runRoundTripTest(sFName, initBmp(I16));
+        runRoundTripTest(sFName, initBmp(R32G32B32A32F));
+        // Sub-bitmaps are stored without the rest of their parent.
+        runRoundTripTest(sFName, BitmapPtr(new Bitmap(*pRGBBmp, IntRect(3,5,40,21))));
+
+        // Conversion to a requested pixel format.
+        ImageContainer::save(sFName, pRGBBmp);
+        BitmapPtr pBmp = loadBitmap(sFName, B8G8R8X8);
+        TEST(pBmp->getPixelFormat() == B8G8R8X8);
+        testEqual(*pBmp, *loadBitmap("../test/media/rgb24-65x65.png", B8G8R8X8), 
+                "ImageContainer_Convert", 0, 0);
+
+        // Writing to a loaded bitmap doesn't change the file.
+        pBmp = loadBitmap(sFName);
+        FilterFill<Pixel24>(Pixel24(1,2,3)).applyInPlace(pBmp);
+        testEqual(*loadBitmap(sFName), *pRGBBmp, "ImageContainer_Write", 0, 0);
+
+        runMipmapTests(sFName);
+        runCorruptFileTests(sFName);
+        ::remove(sFName.c_str());
+    }
+
+private:
+    void runRoundTripTest(const string& sFName, BitmapPtr pBmp)
+    {
+        ImageContainer::save(sFName, pBmp);
+        BitmapPtr pLoadedBmp = loadBitmap(sFName);
+        TEST(pLoadedBmp->getPixelFormat() == pBmp->getPixelFormat());
+        TEST(*pLoadedBmp == *pBmp);
+    }
+
+    void runMipmapTests(const string& sFName)
+    {
+        string sPNGName = "../test/media/rgb24alpha-64x64.png";
+        BitmapPtr pBmp = loadBitmap(sPNGName);
+        ImageContainer::save(sFName, pBmp, true);
+        testEqual(*loadBitmap(sFName), *pBmp, "ImageContainer_Level0", 0, 0);
+        // The smallest level that is still large enough is used.
+        IntPoint maxSizes[] = {IntPoint(32,32), IntPoint(20,20), IntPoint(1,0),
+                IntPoint(33,0)};
+        IntPoint expectedSizes[] = {IntPoint(32,32), IntPoint(32,32), IntPoint(1,1),
+                IntPoint(64,64)};
+        for (unsigned i = 0; i < sizeof(maxSizes)/sizeof(IntPoint); ++i) {
+            BitmapPtr pLevelBmp = loadBitmap(sFName, NO_PIXELFORMAT, maxSizes[i]);
+            TEST(pLevelBmp->getSize() == expectedSizes[i]);
+            BitmapPtr pBaselineBmp = loadBitmap(sPNGName, NO_PIXELFORMAT, maxSizes[i]);
+            // Rounding errors add up over the levels.
+            testEqual(*pLevelBmp, *pBaselineBmp, "ImageContainer_Mipmap", 2, 2);
+        }
+
+        // Without mipmaps, the loader scales the image down.
+        ImageContainer::save(sFName, pBmp);
+        TEST(loadBitmap(sFName, NO_PIXELFORMAT, IntPoint(16,16))->getSize() == 
+                IntPoint(16,16));
+
+        bool bExceptionThrown = false;
+        try {
+            ImageContainer::save(sFName, BitmapPtr(new Bitmap(IntPoint(4,4), I16)),
+                    true);
+        } catch (Exception& ex) {
+            bExceptionThrown = (ex.getCode() == AVG_ERR_UNSUPPORTED);
+        }
+        TEST(bExceptionThrown);
+    }
+
+    void runCorruptFileTests(const string& sFName)
+    {
+        ImageContainer::save(sFName, initBmp(B8G8R8A8));
+        string sContents;
+        readWholeFile(sFName, sContents);
+        string sCorruptContents[] = {
+                sContents.substr(0, sContents.size()-1),
+                sContents.substr(0, ImageContainer::HEADER_SIZE),
+                sContents.substr(0, 8)+"corrupt",
+                sContents.substr(0, 24)+"XYZ"+sContents.substr(27)
+            };
+        for (unsigned i = 0; i < sizeof(sCorruptContents)/sizeof(string); ++i) {
+            writeWholeFile(sFName, sCorruptContents[i]);
+            bool bExceptionThrown = false;
+            try {
+                ImageContainerDecoder().decode(sFName, NO_PIXELFORMAT, IntPoint(0,0));
+            } catch (Exception& ex) {
+                bExceptionThrown = (ex.getCode() == AVG_ERR_FILEIO);
+            }
+            TEST(bExceptionThrown);
+        }
+    }
+};
+
+class SharedBitmapTest: public GraphicsTest {
+public:
+    SharedBitmapTest()
+      : GraphicsTest("SharedBitmapTest", 2)
+    {
+    }
+
+    void runTests()
+    {
+        BitmapPtr pBmp = initBmp(I8);
+        const Bitmap& constBmp = *pBmp;
+        TEST(!pBmp->isShared());
+
+        // Copies share pixels until one of them is written to.
+        {
+            Bitmap copyBmp(*pBmp);
+            const Bitmap& constCopyBmp = copyBmp;
+            TEST(copyBmp.isShared() && pBmp->isShared());
+            TEST(constCopyBmp.getPixels() == constBmp.getPixels());
+            copyBmp.setPixel(IntPoint(0,0), Pixel8(42));
+            TEST(!copyBmp.isShared() && !pBmp->isShared());
+            TEST(constCopyBmp.getPixels() != constBmp.getPixels());
+            TEST(getPixel(copyBmp, IntPoint(0,0)) == 42);
+            TEST(getPixel(*pBmp, IntPoint(0,0)) == 0);
+        }
+        {
+            Bitmap copyBmp(IntPoint(1,1), I8);
+            copyBmp = *pBmp;
+            TEST(copyBmp.isShared());
+            BitmapPtr pCopy2Bmp(new Bitmap(copyBmp));
+            FilterFill<Pixel8>(Pixel8(42)).applyInPlace(pCopy2Bmp);
+            testEqual(copyBmp, *pBmp, "SharedBitmapAssign");
+        }
+        TEST(!pBmp->isShared());
+
+        // Views see changes to the original and keep the pixels alive.
+        BitmapPtr pViewBmp(new Bitmap(*pBmp, false));
+        TEST(!pViewBmp->ownsBits());
+        TEST(pViewBmp->getPixels() == pBmp->getPixels());
+        BitmapPtr pSubBmp(new Bitmap(*pBmp, IntRect(1,1,3,3)));
+        pBmp->setPixel(IntPoint(1,1), Pixel8(42));
+        TEST(getPixel(*pSubBmp, IntPoint(0,0)) == 42);
+        TEST(getPixel(*pViewBmp, IntPoint(1,1)) == 42);
+
+        // Copying a bitmap that has views can't defer the copy.
+        Bitmap copyBmp(*pBmp);
+        TEST(!copyBmp.isShared());
+        testEqual(copyBmp, *pBmp, "SharedBitmapCopyWithView");
+
+        pBmp = BitmapPtr();
+        pViewBmp = BitmapPtr();
+        TEST(getPixel(*pSubBmp, IntPoint(0,0)) == 42);
+        pSubBmp->setPixel(IntPoint(1,1), Pixel8(43));
+        TEST(getPixel(*pSubBmp, IntPoint(1,1)) == 43);
+    }
+
+private:
+    unsigned char getPixel(const Bitmap& bmp, const IntPoint& pos)
+    {
+        return bmp.getPixels()[pos.y*bmp.getStride()+pos.x];
+    }
+};
+
+
+class ImageStatsTest: public GraphicsTest {
+public:
+    ImageStatsTest()
+      : GraphicsTest("ImageStatsTest", 2)
+    {
+    }
+
+    void runTests()
+    {
+        // Widths that aren't multiples of the vector size exercise the scalar code.
+        PixelFormat pfs[] = {I8, B8G8R8A8, R8G8B8X8};
+        for (int i = 0; i < 3; ++i) {
+            cerr << "    " << pfs[i] << endl;
+            BitmapPtr pBmp = createRandomBmp(IntPoint(131, 37), pfs[i]);
+            IntRect fullRect(IntPoint(0,0), pBmp->getSize());
+            testStats(*pBmp, fullRect, 1);
+            testStats(*pBmp, fullRect, 4);
+            testStats(*pBmp, IntRect(3, 5, 100, 30), 1);
+            testStats(*pBmp, IntRect(3, 5, 100, 30), 3);
+        }
+        {
+            // Compatibility with the Bitmap functions.
+            BitmapPtr pBmp = createRandomBmp(IntPoint(131, 37), I8);
+            ImageStats stats(*pBmp);
+            TEST(almostEqual(stats.getAvg(), pBmp->getAvg(), 0.01f));
+            TEST(almostEqual(stats.getStdDev(), pBmp->getStdDev(), 0.01f));
+            pBmp = createRandomBmp(IntPoint(131, 37), B8G8R8X8);
+            ImageStats colorStats(*pBmp);
+            TEST(almostEqual(colorStats.getAvg(), pBmp->getAvg(), 0.01f));
+            TEST(almostEqual(colorStats.getStdDev(), pBmp->getStdDev(), 0.01f));
+            for (int c = 0; c < 4; ++c) {
+                TEST(almostEqual(colorStats.getChannelAvg(c), pBmp->getChannelAvg(c),
+                        0.01f));
+            }
+        }
+        {
+            // Lines long enough to make the SIMD versions flush their sums.
+            BitmapPtr pBmp(new Bitmap(IntPoint(40000, 2), B8G8R8A8));
+            FilterFill<Pixel32>(Pixel32(255, 255, 255, 255)).applyInPlace(pBmp);
+            ImageStats stats(*pBmp);
+            TEST(stats.getMin(2) == 255 && stats.getMax(2) == 255);
+            TEST(stats.getAvg() == 255);
+            TEST(stats.getStdDev() == 0);
+        }
+        for (int level = SIMD_SSE2; level <= getCPUSIMDLevel(); ++level) {
+            cerr << "    " << getSIMDLevelString(SIMDLevel(level)) << endl;
+            testSIMD(I8, IntPoint(1003, 7), SIMDLevel(level));
+            testSIMD(B8G8R8A8, IntPoint(1003, 7), SIMDLevel(level));
+            testSIMD(B8G8R8A8, IntPoint(40007, 2), SIMDLevel(level));
+        }
+        setPixelKernelsLevel(getSIMDLevel());
+
+        BitmapPtr pBmp = createRandomBmp(IntPoint(16, 16), I8);
+        bool bExceptionThrown = false;
+        try {
+            ImageStats stats(*pBmp, IntRect(8, 8, 17, 16));
+        } catch (const Exception&) {
+            bExceptionThrown = true;
+        }
+        TEST(bExceptionThrown);
+        bExceptionThrown = false;
+        try {
+            ImageStats stats(Bitmap(IntPoint(16, 16), I16));
+        } catch (const Exception&) {
+            bExceptionThrown = true;
+        }
+        TEST(bExceptionThrown);
+    }
+
+private:
+    // Compares with values computed pixel by pixel.
+    void testStats(const Bitmap& bmp, const IntRect& roi, int stride)
+    {
+        int bpp = bmp.getBytesPerPixel();
+        ImageStats stats(bmp, roi, stride);
+        TEST(stats.getNumChannels() == bpp);
+        for (int c = 0; c < bpp; ++c) {
+            int minValue = 255;
+            int maxValue = 0;
+            double sum = 0;
+            double sqrSum = 0;
+            int numPixels = 0;
+            Histogram hist(256, 0);
+            for (int y = roi.tl.y; y < roi.br.y; y += stride) {
+                const unsigned char* pLine = bmp.getPixels()+y*bmp.getStride();
+                for (int x = roi.tl.x; x < roi.br.x; x += stride) {
+                    int v = pLine[x*bpp+c];
+                    minValue = min(minValue, v);
+                    maxValue = max(maxValue, v);
+                    sum += v;
+                    sqrSum += v*v;
+                    hist[v]++;
+                    numPixels++;
+                }
+            }
+            double avg = sum/numPixels;
+            double stdDev = sqrt(sqrSum/numPixels - avg*avg);
+            QUIET_TEST(stats.getNumPixels() == numPixels);
+            QUIET_TEST(stats.getMin(c) == minValue);
+            QUIET_TEST(stats.getMax(c) == maxValue);
+            QUIET_TEST(almostEqual(stats.getChannelAvg(c), float(avg), 0.001f));
+            QUIET_TEST(almostEqual(stats.getChannelStdDev(c), float(stdDev), 0.001f));
+            QUIET_TEST(*stats.getHistogram(c) == hist);
+        }
+    }
+
+    void testSIMD(PixelFormat pf, const IntPoint& size, SIMDLevel level)
+    {
+        BitmapPtr pBmp = createRandomBmp(size, pf);
+        setPixelKernelsLevel(SIMD_NONE);
+        ImageStats baselineStats(*pBmp);
+        setPixelKernelsLevel(level);
+        ImageStats stats(*pBmp);
+        for (int c = 0; c < stats.getNumChannels(); ++c) {
+            QUIET_TEST(stats.getMin(c) == baselineStats.getMin(c));
+            QUIET_TEST(stats.getMax(c) == baselineStats.getMax(c));
+            QUIET_TEST(stats.getChannelAvg(c) == baselineStats.getChannelAvg(c));
+            QUIET_TEST(stats.getChannelStdDev(c) == baselineStats.getChannelStdDev(c));
+        }
+    }
+
+    BitmapPtr createRandomBmp(const IntPoint& size, PixelFormat pf)
+    {
+        BitmapPtr pBmp(new Bitmap(size, pf));
+        for (int y = 0; y < size.y; ++y) {
+            unsigned char * pLine = pBmp->getPixels()+y*pBmp->getStride();
+            for (int x = 0; x < pBmp->getLineLen(); ++x) {
+                pLine[x] = rand();
+            }
+        }
+        return pBmp;
+    }
+};
+
+
+class ImageCompareTest: public GraphicsTest {
+public:
+    ImageCompareTest()
+      : GraphicsTest("ImageCompareTest", 2)
+    {
+    }
+
+    void runTests()
+    {
+        PixelFormat pfs[] = {I8, B5G6R5, B8G8R8, B8G8R8A8, R8G8B8X8};
+        for (int i = 0; i < 5; ++i) {
+            cerr << "    " << pfs[i] << endl;
+            BitmapPtr pBmp1 = createRandomBmp(IntPoint(131, 37), pfs[i]);
+            BitmapPtr pBmp2 = createRandomBmp(IntPoint(131, 37), pfs[i]);
+            testCompare(*pBmp1, *pBmp2, 0);
+            testCompare(*pBmp1, *pBmp2, 100);
+            // Same definition as Bitmap::subtract() and the Bitmap statistics.
+            ImageCompare imgCompare(*pBmp1, *pBmp2);
+            BitmapPtr pDiffBmp = pBmp1->subtract(*pBmp2);
+            TEST(almostEqual(imgCompare.getAvg(), pDiffBmp->getAvg(), 0.01f));
+            TEST(almostEqual(imgCompare.getStdDev(), pDiffBmp->getStdDev(), 0.01f));
+        }
+        {
+            // Tolerance and mismatch mask.
+            BitmapPtr pBmp1 = createRandomBmp(IntPoint(23, 11), B8G8R8X8);
+            BitmapPtr pBmp2(new Bitmap(*pBmp1));
+            unsigned char* pPixel = pBmp2->getPixels()+2*pBmp2->getStride()+3*4;
+            pPixel[1] = (pPixel[1] < 128) ? pPixel[1]+5 : pPixel[1]-5;
+            // The unused byte isn't compared.
+            pBmp2->getPixels()[7] ^= 0xFF;
+            ImageCompare imgCompare(*pBmp1, *pBmp2, 4, true);
+            TEST(imgCompare.getNumMismatches() == 1);
+            TEST(imgCompare.getMaxDiff(1) == 5);
+            TEST(imgCompare.getMaxDiff(0) == 0);
+            BitmapPtr pMaskBmp = imgCompare.getMismatchMask();
+            TEST(pMaskBmp->getPixelFormat() == I8);
+            TEST(pMaskBmp->getSize() == IntPoint(23, 11));
+            ImageStats maskStats(*pMaskBmp);
+            TEST(maskStats.getHistogram()->at(255) == 1);
+            TEST(pMaskBmp->getPixels()[2*pMaskBmp->getStride()+3] == 255);
+            TEST(ImageCompare(*pBmp1, *pBmp2, 5).getNumMismatches() == 0);
+            TEST(almostEqual(imgCompare.getAvg(), 5.f/(23*11*3)));
+        }
+        {
+            // Lines long enough to make the SIMD versions flush their sums.
+            BitmapPtr pBmp1(new Bitmap(IntPoint(40000, 2), B8G8R8A8));
+            FilterFill<Pixel32>(Pixel32(255, 255, 255, 255)).applyInPlace(pBmp1);
+            BitmapPtr pBmp2(new Bitmap(IntPoint(40000, 2), B8G8R8A8));
+            FilterFill<Pixel32>(Pixel32(0, 0, 0, 0)).applyInPlace(pBmp2);
+            ImageCompare imgCompare(*pBmp1, *pBmp2);
+            TEST(imgCompare.getMaxDiff(3) == 255 && imgCompare.getMeanError(3) == 255);
+            TEST(imgCompare.getNumMismatches() == 80000);
+            TEST(imgCompare.getAvg() == 255 && imgCompare.getStdDev() == 0);
+        }
+        for (int level = SIMD_SSE2; level <= getCPUSIMDLevel(); ++level) {
+            cerr << "    " << getSIMDLevelString(SIMDLevel(level)) << endl;
+            for (int i = 0; i < 5; ++i) {
+                testSIMD(pfs[i], IntPoint(1003, 7), SIMDLevel(level));
+            }
+            testSIMD(B8G8R8A8, IntPoint(40007, 2), SIMDLevel(level));
+        }
+        setPixelKernelsLevel(getSIMDLevel());
+        {
+            BitmapPtr pBmp1 = createRandomBmp(IntPoint(64, 64), R8G8B8A8);
+            BitmapPtr pBmp2 = createRandomBmp(IntPoint(64, 64), R8G8B8A8);
+            TEST(ImageCompare::isSimilar(*pBmp1, *pBmp1, 0, 0));
+            TEST(!ImageCompare::isSimilar(*pBmp1, *pBmp2, 2, 6));
+            ImageCompare imgCompare(*pBmp1, *pBmp2);
+            TEST(ImageCompare::isSimilar(*pBmp1, *pBmp2, imgCompare.getAvg(),
+                    imgCompare.getStdDev()));
+        }
+        {
+            vector<BitmapPtr> pBmps1;
+            vector<BitmapPtr> pBmps2;
+            for (int i = 0; i < 9; ++i) {
+                pBmps1.push_back(createRandomBmp(IntPoint(50+i, 20), I8));
+                pBmps2.push_back(createRandomBmp(IntPoint(50+i, 20), I8));
+            }
+            vector<ImageComparePtr> pResults = ImageCompare::compareAll(pBmps1, pBmps2,
+                    10);
+            TEST(pResults.size() == 9);
+            bool bOk = true;
+            for (int i = 0; i < 9; ++i) {
+                ImageCompare imgCompare(*pBmps1[i], *pBmps2[i], 10);
+                bOk &= (pResults[i]->getNumMismatches() == imgCompare.getNumMismatches()
+                        && pResults[i]->getAvg() == imgCompare.getAvg());
+            }
+            TEST(bOk);
+        }
+
+        bool bExceptionThrown = false;
+        try {
+            ImageCompare(Bitmap(IntPoint(16, 16), I8), Bitmap(IntPoint(16, 16), A8));
+        } catch (const Exception&) {
+            bExceptionThrown = true;
+        }
+        TEST(bExceptionThrown);
+        bExceptionThrown = false;
+        try {
+            ImageCompare(Bitmap(IntPoint(16, 16), I16), Bitmap(IntPoint(16, 16), I16));
+        } catch (const Exception&) {
+            bExceptionThrown = true;
+        }
+        TEST(bExceptionThrown);
+    }
+
+private:
+    // Compares with values computed pixel by pixel.
+    void testCompare(const Bitmap& bmp1, const Bitmap& bmp2, int tolerance)
+    {
+        int bpp = bmp1.getBytesPerPixel();
+        PixelFormat pf = bmp1.getPixelFormat();
+        int numComparedChannels = (pf == B8G8R8X8 || pf == R8G8B8X8) ? 3 : bpp;
+        IntPoint size = bmp1.getSize();
+        ImageCompare imgCompare(bmp1, bmp2, tolerance, true);
+        TEST(imgCompare.getNumChannels() == bpp);
+        int numMismatches = 0;
+        bool bMaskOk = true;
+        for (int y = 0; y < size.y; ++y) {
+            const unsigned char* pLine1 = bmp1.getPixels()+y*bmp1.getStride();
+            const unsigned char* pLine2 = bmp2.getPixels()+y*bmp2.getStride();
+            const unsigned char* pMaskLine = imgCompare.getMismatchMask()->getPixels()+
+                    y*imgCompare.getMismatchMask()->getStride();
+            for (int x = 0; x < size.x; ++x) {
+                bool bMismatch = false;
+                for (int c = 0; c < numComparedChannels; ++c) {
+                    bMismatch |= abs(pLine1[x*bpp+c]-pLine2[x*bpp+c]) > tolerance;
+                }
+                numMismatches += bMismatch;
+                bMaskOk &= (pMaskLine[x] == (bMismatch ? 255 : 0));
+            }
+        }
+        TEST(imgCompare.getNumMismatches() == numMismatches);
+        TEST(bMaskOk);
+        for (int c = 0; c < bpp; ++c) {
+            int maxDiff = 0;
+            double sum = 0;
+            for (int y = 0; y < size.y; ++y) {
+                const unsigned char* pLine1 = bmp1.getPixels()+y*bmp1.getStride();
+                const unsigned char* pLine2 = bmp2.getPixels()+y*bmp2.getStride();
+                for (int x = 0; x < size.x; ++x) {
+                    int diff = abs(pLine1[x*bpp+c]-pLine2[x*bpp+c]);
+                    maxDiff = max(maxDiff, diff);
+                    sum += diff;
+                }
+            }
+            QUIET_TEST(imgCompare.getMaxDiff(c) == maxDiff);
+            float meanError = float(sum/(size.x*size.y));
+            QUIET_TEST(almostEqual(imgCompare.getMeanError(c), meanError, 0.001f));
+        }
+    }
+
+    void testSIMD(PixelFormat pf, const IntPoint& size, SIMDLevel level)
+    {
+        BitmapPtr pBmp1 = createRandomBmp(size, pf);
+        BitmapPtr pBmp2 = createRandomBmp(size, pf);
+        setPixelKernelsLevel(SIMD_NONE);
+        ImageCompare baselineCompare(*pBmp1, *pBmp2, 77, true);
+        setPixelKernelsLevel(level);
+        ImageCompare imgCompare(*pBmp1, *pBmp2, 77, true);
+        for (int c = 0; c < imgCompare.getNumChannels(); ++c) {
+            QUIET_TEST(imgCompare.getMaxDiff(c) == baselineCompare.getMaxDiff(c));
+            QUIET_TEST(imgCompare.getMeanError(c) == baselineCompare.getMeanError(c));
+        }
+        QUIET_TEST(imgCompare.getAvg() == baselineCompare.getAvg());
+        QUIET_TEST(imgCompare.getStdDev() == baselineCompare.getStdDev());
+        QUIET_TEST(imgCompare.getNumMismatches() == baselineCompare.getNumMismatches());
+        QUIET_TEST(*imgCompare.getMismatchMask() == *baselineCompare.getMismatchMask());
+    }
+
+    BitmapPtr createRandomBmp(const IntPoint& size, PixelFormat pf)
+    {
+        BitmapPtr pBmp(new Bitmap(size, pf));
+        for (int y = 0; y < size.y; ++y) {
+            unsigned char * pLine = pBmp->getPixels()+y*pBmp->getStride();
+            for (int x = 0; x < pBmp->getLineLen(); ++x) {
+                pLine[x] = rand();
+            }
+        }
+        return pBmp;
+    }
+};
+
+
 class FilterColorizeTest: public GraphicsTest {
 public:
     FilterColorizeTest()
@@ -769,6 +1708,177 @@ public:
 };
 
 
+class FilterFastGaussTest: public GraphicsTest {
+public:
+    FilterFastGaussTest()
+        : GraphicsTest("FilterFastGaussTest", 2)
+    {
+    }
+
+    void runTests()
+    {
+        BitmapPtr pGrayBmp = createRandomBmp(IntPoint(67, 45), I8);
+        BitmapPtr pColorBmp = createRandomBmp(IntPoint(67, 45), B8G8R8X8);
+
+        // FilterGauss(radius) has a standard deviation of sqrt(radius/2). It truncates
+        // after both passes and its radius 1 kernel only adds up to 255/256, so its
+        // results are up to about two values darker.
+        float radii[] = {1, 1.5f, 3};
+        float maxAverages[] = {2.2f, 1.1f, 1.1f};
+        float maxStdDevs[] = {1.5f, 0.6f, 0.6f};
+        for (int i = 0; i < 3; ++i) {
+            int intRadius = int(ceil(radii[i]));
+            BitmapPtr pBaselineBmp = FilterGauss(radii[i]).apply(pGrayBmp);
+            BitmapPtr pDestBmp = FilterFastGauss(sqrt(radii[i]/2)).apply(pGrayBmp);
+            Bitmap destRect(*pDestBmp, IntRect(intRadius, intRadius,
+                    pGrayBmp->getSize().x-intRadius, pGrayBmp->getSize().y-intRadius));
+            testEqual(destRect, *pBaselineBmp, "FastGaussI8", maxAverages[i],
+                    maxStdDevs[i]);
+        }
+
+        // FilterConvol with a 2D gaussian kernel.
+        {
+            float stdDev = 1.2f;
+            int radius = int(ceil(3*stdDev));
+            int kernelSize = 2*radius+1;
+            vector<float> kernel(kernelSize*kernelSize);
+            float sum = 0;
+            for (int y = 0; y < kernelSize; ++y) {
+                for (int x = 0; x < kernelSize; ++x) {
+                    float dist2 = float((x-radius)*(x-radius)+(y-radius)*(y-radius));
+                    kernel[y*kernelSize+x] = exp(-dist2/(2*stdDev*stdDev));
+                    sum += kernel[y*kernelSize+x];
+                }
+            }
+            for (unsigned i = 0; i < kernel.size(); ++i) {
+                kernel[i] /= sum;
+            }
+            // FilterConvol truncates instead of rounding.
+            BitmapPtr pBaselineBmp = FilterConvol<Pixel32>(&kernel[0], kernelSize,
+                    kernelSize).apply(pColorBmp);
+            BitmapPtr pDestBmp = FilterFastGauss(stdDev).apply(pColorBmp);
+            Bitmap destRect(*pDestBmp, IntRect(radius, radius,
+                    pColorBmp->getSize().x-radius, pColorBmp->getSize().y-radius));
+            testEqual(destRect, *pBaselineBmp, "FastGaussRGBA", 1, 1);
+        }
+
+        // The box approximation is close to the exact gaussian.
+        float stdDevs[] = {2.5f, 4, 7};
+        for (int i = 0; i < 3; ++i) {
+            BitmapPtr pBaselineBmp = 
+                    FilterFastGauss(stdDevs[i], FilterFastGauss::KERNEL).apply(pGrayBmp);
+            FilterFastGauss boxFilter(stdDevs[i], FilterFastGauss::BOX);
+            TEST(boxFilter.getMethod() == FilterFastGauss::BOX);
+            BitmapPtr pDestBmp = boxFilter.apply(pGrayBmp);
+            testEqual(*pDestBmp, *pBaselineBmp, "FastGaussBox", 1, 1);
+        }
+        TEST(FilterFastGauss(1).getMethod() == FilterFastGauss::KERNEL);
+        TEST(FilterFastGauss(10).getMethod() == FilterFastGauss::BOX);
+
+        // Blurring a constant bitmap doesn't change it, edges included.
+        BitmapPtr pConstBmp(new Bitmap(IntPoint(19, 23), B8G8R8A8));
+        FilterFill<Pixel32>(Pixel32(0, 100, 201, 255)).applyInPlace(pConstBmp);
+        testEqual(*FilterFastGauss(2).apply(pConstBmp), *pConstBmp, "FastGaussConst",
+                0, 0);
+        testEqual(*FilterFastGauss(5).apply(pConstBmp), *pConstBmp, 
+                "FastGaussBoxConst", 0, 0);
+
+        // SIMD versions must produce the same result as the scalar version.
+        float simdStdDevs[] = {1.7f, 6};
+        for (int level = SIMD_SSE2; level <= getCPUSIMDLevel(); ++level) {
+            for (int i = 0; i < 2; ++i) {
+                FilterFastGauss filter(simdStdDevs[i]);
+                setPixelKernelsLevel(SIMD_NONE);
+                BitmapPtr pBaselineGrayBmp = filter.apply(pGrayBmp);
+                BitmapPtr pBaselineColorBmp = filter.apply(pColorBmp);
+                setPixelKernelsLevel(SIMDLevel(level));
+                testEqual(*filter.apply(pGrayBmp), *pBaselineGrayBmp, 
+                        "FastGaussSIMDI8", 0, 0);
+                testEqual(*filter.apply(pColorBmp), *pBaselineColorBmp, 
+                        "FastGaussSIMDRGBA", 0, 0);
+            }
+        }
+        setPixelKernelsLevel(getSIMDLevel());
+    }
+
+private:
+    BitmapPtr createRandomBmp(const IntPoint& size, PixelFormat pf)
+    {
+        BitmapPtr pBmp(new Bitmap(size, pf));
+        int bpp = pBmp->getBytesPerPixel();
+        for (int y = 0; y < size.y; ++y) {
+            unsigned char * pLine = pBmp->getPixels()+y*pBmp->getStride();
+            for (int x = 0; x < size.x*bpp; ++x) {
+                pLine[x] = (unsigned char)(rand()&255);
+            }
+            if (bpp == 4) {
+                for (int x = 0; x < size.x; ++x) {
+                    pLine[x*4+ALPHAPOS] = 255;
+                }
+            }
+        }
+        return pBmp;
+    }
+};
+
+
+class FilterBandsTest: public GraphicsTest {
+public:
+    FilterBandsTest()
+        : GraphicsTest("FilterBandsTest", 2)
+    {
+    }
+
+    void runTests()
+    {
+        // Filters that are split into bands must produce the same result as the
+        // single-band version.
+        BitmapPtr pGrayBmp = createRandomBmp(IntPoint(67, 131), I8);
+        BitmapPtr pColorBmp = createRandomBmp(IntPoint(67, 131), R8G8B8X8);
+        float mat[3][3] = 
+                {{0.1f,0.1f,0.1f},
+                 {0.1f,0.2f,0.1f},
+                 {0.1f,0.1f,0.1f}};
+        testBands(FilterPtr(new Filter3x3(mat)), pColorBmp, "Filter3x3Bands");
+        testBands(FilterPtr(new FilterGauss(1)), pGrayBmp, "Gauss1Bands");
+        testBands(FilterPtr(new FilterGauss(3)), pGrayBmp, "Gauss3Bands");
+        testBands(FilterPtr(new FilterGauss(5)), pGrayBmp, "Gauss5Bands");
+        testBands(FilterPtr(new FilterFastGauss(1.5f)), pGrayBmp, "FastGaussBands");
+        testBands(FilterPtr(new FilterFastGauss(6)), pColorBmp, "FastGaussBoxBands");
+        testBands(FilterPtr(new FilterFastBandpass()), pGrayBmp, "FastBandpassBands");
+        testBands(FilterPtr(new FilterGrayscale()), pColorBmp, "GrayscaleBands");
+        testBands(FilterPtr(new FilterResample(IntPoint(30, 50),
+                FilterResample::BICUBIC)), pGrayBmp, "ResampleBands");
+        testBands(FilterPtr(new FilterResample(IntPoint(90, 300),
+                FilterResample::LANCZOS)), pColorBmp, "ResampleUpBands");
+    }
+
+private:
+    BitmapPtr createRandomBmp(const IntPoint& size, PixelFormat pf)
+    {
+        BitmapPtr pBmp(new Bitmap(size, pf));
+        for (int y = 0; y < size.y; ++y) {
+            unsigned char * pLine = pBmp->getPixels()+y*pBmp->getStride();
+            for (int x = 0; x < size.x*pBmp->getBytesPerPixel(); ++x) {
+                pLine[x] = (unsigned char)(rand()&255);
+            }
+        }
+        return pBmp;
+    }
+
+    void testBands(FilterPtr pFilter, BitmapPtr pBmp, const string& sName)
+    {
+        int oldMinBandPixels = Filter::getMinBandPixels();
+        Filter::setMinBandPixels(1000000000);
+        BitmapPtr pBaselineBmp = pFilter->apply(pBmp);
+        Filter::setMinBandPixels(1);
+        BitmapPtr pBandsBmp = pFilter->apply(pBmp);
+        Filter::setMinBandPixels(oldMinBandPixels);
+        testEqual(*pBandsBmp, *pBaselineBmp, sName, 0, 0);
+    }
+};
+
+
 class FilterBlurTest: public GraphicsTest {
 public:
     FilterBlurTest()
@@ -972,6 +2082,128 @@ private:
 
 };
 
+class FilterResampleTest: public GraphicsTest {
+public:
+    FilterResampleTest()
+        : GraphicsTest("FilterResampleTest", 2)
+    {
+    }
+
+    void runTests()
+    {
+        PixelFormat pfs[] = {I8, B8G8R8, B8G8R8A8};
+        for (int i = 0; i < 3; ++i) {
+            cerr << "    " << pfs[i] << endl;
+            for (int type = FilterResample::BOX; type <= FilterResample::LANCZOS; ++type)
+            {
+                // The weights always sum to one, so constant bitmaps stay constant.
+                FilterResample::FilterType filterType = FilterResample::FilterType(type);
+                testConstant(pfs[i], IntPoint(67, 45), IntPoint(13, 100), filterType);
+                testConstant(pfs[i], IntPoint(67, 45), IntPoint(200, 7), filterType);
+            }
+        }
+        {
+            // Halving with a box filter averages 2x2 pixels, rounding after each
+            // pass.
+            BitmapPtr pBmp = createRandomBmp(IntPoint(34, 6), I8);
+            BitmapPtr pDestBmp = FilterResample(IntPoint(17, 3), FilterResample::BOX)
+                    .apply(pBmp);
+            bool bOk = true;
+            for (int y = 0; y < 3; ++y) {
+                for (int x = 0; x < 17; ++x) {
+                    int top = (getPixel(*pBmp, 2*x, 2*y)+getPixel(*pBmp, 2*x+1, 2*y)+1)/2;
+                    int bottom = (getPixel(*pBmp, 2*x, 2*y+1)+
+                            getPixel(*pBmp, 2*x+1, 2*y+1)+1)/2;
+                    bOk &= (getPixel(*pDestBmp, x, y) == (top+bottom+1)/2);
+                }
+            }
+            TEST(bOk);
+        }
+        {
+            // Unchanged sizes copy the pixels.
+            BitmapPtr pBmp = createRandomBmp(IntPoint(34, 6), B8G8R8A8);
+            BitmapPtr pDestBmp = FilterResample(IntPoint(34, 6), FilterResample::LANCZOS)
+                    .apply(pBmp);
+            TEST(*pDestBmp == *pBmp);
+        }
+        for (int level = SIMD_SSE2; level <= getCPUSIMDLevel(); ++level) {
+            cerr << "    " << getSIMDLevelString(SIMDLevel(level)) << endl;
+            for (int i = 0; i < 3; ++i) {
+                testSIMD(pfs[i], IntPoint(131, 37), IntPoint(50, 81), SIMDLevel(level));
+                testSIMD(pfs[i], IntPoint(31, 37), IntPoint(77, 14), SIMDLevel(level));
+            }
+        }
+        setPixelKernelsLevel(getSIMDLevel());
+
+        // Weight tables are cached.
+        FilterResample::clearContribCache();
+        ResampleContribsPtr pContribs = FilterResample::getContribs(100, 30,
+                FilterResample::BICUBIC);
+        TEST(pContribs == FilterResample::getContribs(100, 30, FilterResample::BICUBIC));
+        TEST(pContribs != FilterResample::getContribs(100, 30, FilterResample::LANCZOS));
+        TEST(FilterResample::getNumCachedContribs() == 2);
+        TEST(pContribs->m_DestLen == 30 && pContribs->m_WeightStride % 8 == 0);
+        BilinearContribDef contribDef(0.64f);
+        pContribs = FilterResample::getContribs(100, 30, contribDef);
+        TEST(pContribs == FilterResample::getContribs(100, 30, 
+                BilinearContribDef(0.64f)));
+        TEST(pContribs != FilterResample::getContribs(100, 30, 
+                BilinearContribDef(1.0f)));
+        TEST(FilterResample::getNumCachedContribs() == 4);
+        FilterResample::clearContribCache();
+        TEST(FilterResample::getNumCachedContribs() == 0);
+    }
+
+private:
+    void testConstant(PixelFormat pf, const IntPoint& srcSize, const IntPoint& destSize,
+            FilterResample::FilterType filterType)
+    {
+        BitmapPtr pBmp(new Bitmap(srcSize, pf));
+        memset(pBmp->getPixels(), 0xC8, pBmp->getMemNeeded());
+        BitmapPtr pDestBmp = FilterResample(destSize, filterType).apply(pBmp);
+        QUIET_TEST(pDestBmp->getSize() == destSize);
+        bool bOk = true;
+        for (int y = 0; y < destSize.y; ++y) {
+            const unsigned char* pLine = pDestBmp->getPixels()+y*pDestBmp->getStride();
+            for (int x = 0; x < pDestBmp->getLineLen(); ++x) {
+                bOk &= (pLine[x] == 0xC8);
+            }
+        }
+        QUIET_TEST(bOk);
+    }
+
+    void testSIMD(PixelFormat pf, const IntPoint& srcSize, const IntPoint& destSize,
+            SIMDLevel level)
+    {
+        BitmapPtr pBmp = createRandomBmp(srcSize, pf);
+        for (int type = FilterResample::BOX; type <= FilterResample::LANCZOS; ++type) {
+            FilterResample filter(destSize, FilterResample::FilterType(type));
+            setPixelKernelsLevel(SIMD_NONE);
+            BitmapPtr pBaselineBmp = filter.apply(pBmp);
+            setPixelKernelsLevel(level);
+            BitmapPtr pDestBmp = filter.apply(pBmp);
+            QUIET_TEST(*pDestBmp == *pBaselineBmp);
+        }
+    }
+
+    int getPixel(const Bitmap& bmp, int x, int y)
+    {
+        return bmp.getPixels()[y*bmp.getStride()+x];
+    }
+
+    BitmapPtr createRandomBmp(const IntPoint& size, PixelFormat pf)
+    {
+        BitmapPtr pBmp(new Bitmap(size, pf));
+        for (int y = 0; y < size.y; ++y) {
+            unsigned char * pLine = pBmp->getPixels()+y*pBmp->getStride();
+            for (int x = 0; x < pBmp->getLineLen(); ++x) {
+                pLine[x] = rand();
+            }
+        }
+        return pBmp;
+    }
+};
+
 class FilterUnmultiplyAlphaTest: public GraphicsTest {
 public:
     FilterUnmultiplyAlphaTest()
@@ -1012,6 +2244,15 @@ public:
     {
         addTest(TestPtr(new PixelTest));
         addTest(TestPtr(new BitmapTest));
+        addTest(TestPtr(new PixelKernelsTest));
+        addTest(TestPtr(new BitmapPoolTest));
+        addTest(TestPtr(new BitmapCacheTest));
+        addTest(TestPtr(new ImageDecoderTest));
+        addTest(TestPtr(new DecodeSizeTest));
+        addTest(TestPtr(new ImageContainerTest));
+        addTest(TestPtr(new SharedBitmapTest));
+        addTest(TestPtr(new ImageStatsTest));
+        addTest(TestPtr(new ImageCompareTest));
         addTest(TestPtr(new Filter3x3Test));
         addTest(TestPtr(new FilterConvolTest));
         addTest(TestPtr(new FilterColorizeTest));
@@ -1024,6 +2265,8 @@ public:
         addTest(TestPtr(new HistoryPreProcessorTest));
         addTest(TestPtr(new FilterHighpassTest));
         addTest(TestPtr(new FilterGaussTest));
+        addTest(TestPtr(new FilterFastGaussTest));
+        addTest(TestPtr(new FilterBandsTest));
         addTest(TestPtr(new FilterBlurTest));
         addTest(TestPtr(new FilterBandpassTest));
         addTest(TestPtr(new FilterFastBandpassTest));
@@ -1035,6 +2278,7 @@ public:
         addTest(TestPtr(new FilterErosionTest));
         addTest(TestPtr(new FilterAlphaTest));
         addTest(TestPtr(new FilterResizeBilinearTest));
+        addTest(TestPtr(new FilterResampleTest));
         addTest(TestPtr(new FilterUnmultiplyAlphaTest));
     }
 };
@@ -82,14 +82,14 @@ BitmapPtr Camera::convertCamFrameToDestPF(BitmapPtr pCamBmp)
 {
     ScopeTimer Timer(CameraConvertProfilingZone);
     BitmapPtr pDestBmp = BitmapPtr(new Bitmap(pCamBmp->getSize(), m_DestPF));
-    pDestBmp->copyPixels(*pCamBmp);
     if (m_CamPF == R8G8B8 && m_DestPF == B8G8R8X8) {
-        pDestBmp->setPixelFormat(R8G8B8X8);
-        FilterFlipRGB().applyInPlace(pDestBmp);
-    }
-    if (m_CamPF != R8G8B8 && m_DestPF == R8G8B8X8) {
-        pDestBmp->setPixelFormat(B8G8R8X8);
-        FilterFlipRGB().applyInPlace(pDestBmp);
+        pDestBmp->copyPixelsSwapRB(*pCamBmp);
+    } else {
+        pDestBmp->copyPixels(*pCamBmp);
+        if (m_CamPF != R8G8B8 && m_DestPF == R8G8B8X8) {
+            pDestBmp->setPixelFormat(B8G8R8X8);
+            FilterFlipRGB().applyInPlace(pDestBmp);
+        }
     }
 
     return pDestBmp;
@@ -23,6 +23,8 @@
 
 #include "FilterDistortion.h"
 
+#include <boost/bind.hpp>
+
 #include <iostream>
 #include <math.h>
 
@@ -62,22 +64,28 @@ FilterDistortion::~FilterDistortion()
 BitmapPtr FilterDistortion::apply(BitmapPtr pBmpSource)
 {
     BitmapPtr pDestBmp = BitmapPtr(new Bitmap(m_SrcSize, I8));
-    unsigned char* pDestLine = pDestBmp->getPixels();
-    unsigned char* pSrcPixels = pBmpSource->getPixels();
-    unsigned char* pDestPixel = pDestLine;
-    int destStride = pDestBmp->getStride();
-    int srcStride = pBmpSource->getStride();
-    IntPoint * pMapPos = m_pMap;
-    for (int y = 0; y < m_SrcSize.y; ++y) {
+    applyBands(boost::bind(&FilterDistortion::applyBand, this, boost::cref(*pBmpSource),
+            boost::ref(*pDestBmp), _1, _2), pDestBmp->getSize());
+    return pDestBmp;
+}
+
+void FilterDistortion::applyBand(const Bitmap& srcBmp, Bitmap& destBmp,
+        int startLine, int endLine) const
+{
+    int destStride = destBmp.getStride();
+    int srcStride = srcBmp.getStride();
+    unsigned char* pDestLine = destBmp.getPixels()+startLine*destStride;
+    const unsigned char* pSrcPixels = srcBmp.getPixels();
+    const IntPoint * pMapPos = m_pMap+startLine*m_SrcSize.x;
+    for (int y = startLine; y < endLine; ++y) {
+        unsigned char* pDestPixel = pDestLine;
         for(int x = 0; x < m_SrcSize.x; ++x) {
             *pDestPixel = pSrcPixels[pMapPos->x + srcStride*pMapPos->y];
             pDestPixel++;
             pMapPos++;
         }
         pDestLine+=destStride;
-        pDestPixel = pDestLine;
     }
-    return pDestBmp;
 }
 
 }
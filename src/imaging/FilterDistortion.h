@@ -43,7 +43,10 @@ class AVG_API FilterDistortion: public Filter
         FilterDistortion(const IntPoint& srcSize, CoordTransformerPtr pTransformer);
         virtual ~FilterDistortion();
         BitmapPtr apply(BitmapPtr pBmpSource);
+
     private:
+        void applyBand(const Bitmap& srcBmp, Bitmap& destBmp, int startLine,
+                int endLine) const;
         IntPoint m_SrcSize;
         CoordTransformerPtr m_pTransformer;
         IntPoint* m_pMap;
@@ -28,6 +28,7 @@
 #include "ArgList.h"
 #include "TypeDefinition.h"
 #include "TypeRegistry.h"
+#include "Player.h"
 #include "BoostPython.h"
 
 #include "../base/MathHelper.h"
@@ -244,6 +245,7 @@ void AreaNode::maybeRender(const glm::mat4& parentTransform)
         calcTransform();
         m_Transform = parentTransform*m_LocalTransform;
         render();
+        Player::get()->addRenderedNode();
     }
 }
 
@@ -0,0 +1,124 @@
+//
+//  libavg - Media Playback Engine.
+//  Copyright (C) 2003-2014 Ulrich von Zadow
+//
+//  This library is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU Lesser General Public
+//  License as published by the Free Software Foundation; either
+//  version 2 of the License, or (at your option) any later version.
+//
+//  This library is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//  Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public
+//  License along with this library; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+//  Current versions can be found at www.libavg.de
+//
+
+#include "BitmapLoadQueue.h"
+
+#include "../base/Exception.h"
+#include "../base/ThreadHelper.h"
+
+using namespace std;
+
+namespace avg {
+
+BitmapLoadQueue::BitmapLoadQueue()
+    : m_NumPushes(0),
+      m_MaxSize(0)
+{
+}
+
+BitmapLoadQueue::~BitmapLoadQueue()
+{
+}
+
+void BitmapLoadQueue::push(BitmapManagerMsgPtr pMsg, float priority)
+{
+    lock_guard lock(m_Mutex);
+    AVG_ASSERT(m_MsgIndex.find(pMsg) == m_MsgIndex.end());
+    LoadKey key;
+    key.m_Priority = priority;
+    key.m_PushIndex = m_NumPushes++;
+    LoadOrder::iterator it = m_LoadOrder.insert(make_pair(key, pMsg)).first;
+    m_MsgIndex[pMsg] = it;
+    m_MaxSize = max(m_MaxSize, int(m_LoadOrder.size()));
+}
+
+BitmapManagerMsgPtr BitmapLoadQueue::pop()
+{
+    lock_guard lock(m_Mutex);
+    if (m_LoadOrder.empty()) {
+        return BitmapManagerMsgPtr();
+    }
+    BitmapManagerMsgPtr pMsg = m_LoadOrder.begin()->second;
+    m_LoadOrder.erase(m_LoadOrder.begin());
+    m_MsgIndex.erase(pMsg);
+    return pMsg;
+}
+
+bool BitmapLoadQueue::setPriority(BitmapManagerMsgPtr pMsg, float priority)
+{
+    lock_guard lock(m_Mutex);
+    MsgIndex::iterator indexIt = m_MsgIndex.find(pMsg);
+    if (indexIt == m_MsgIndex.end()) {
+        return false;
+    }
+    // Keep the push index so the message doesn't lose its place among messages with
+    // the same priority.
+    LoadKey key = indexIt->second->first;
+    key.m_Priority = priority;
+    m_LoadOrder.erase(indexIt->second);
+    indexIt->second = m_LoadOrder.insert(make_pair(key, pMsg)).first;
+    return true;
+}
+
+bool BitmapLoadQueue::remove(BitmapManagerMsgPtr pMsg)
+{
+    lock_guard lock(m_Mutex);
+    MsgIndex::iterator indexIt = m_MsgIndex.find(pMsg);
+    if (indexIt == m_MsgIndex.end()) {
+        return false;
+    }
+    m_LoadOrder.erase(indexIt->second);
+    m_MsgIndex.erase(indexIt);
+    return true;
+}
+
+void BitmapLoadQueue::clear()
+{
+    lock_guard lock(m_Mutex);
+    m_LoadOrder.clear();
+    m_MsgIndex.clear();
+}
+
+int BitmapLoadQueue::size() const
+{
+    lock_guard lock(m_Mutex);
+    return int(m_LoadOrder.size());
+}
+
+void BitmapLoadQueue::addLatency(long long latency)
+{
+    lock_guard lock(m_Mutex);
+    m_Latencies.addValue(latency);
+}
+
+LatencyHistogram BitmapLoadQueue::getLatencyHistogram() const
+{
+    lock_guard lock(m_Mutex);
+    return m_Latencies;
+}
+
+int BitmapLoadQueue::getMaxSize() const
+{
+    lock_guard lock(m_Mutex);
+    return m_MaxSize;
+}
+
+}
@@ -0,0 +1,90 @@
+//
+//  libavg - Media Playback Engine.
+//  Copyright (C) 2003-2014 Ulrich von Zadow
+//
+//  This library is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU Lesser General Public
+//  License as published by the Free Software Foundation; either
+//  version 2 of the License, or (at your option) any later version.
+//
+//  This library is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//  Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public
+//  License along with this library; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+//  Current versions can be found at www.libavg.de
+//
+
+#ifndef _BitmapLoadQueue_H_
+#define _BitmapLoadQueue_H_
+
+#include "../api.h"
+
+#include "BitmapManagerMsg.h"
+
+#include "../base/LatencyHistogram.h"
+
+#include <boost/thread/mutex.hpp>
+
+#include <map>
+
+namespace avg {
+
+// Loads that haven't been started yet. Shared by BitmapManager and its loader
+// threads. The loader threads take the message with the highest priority; messages
+// with the same priority are loaded in the order they were pushed.
+// All operations are O(log n) in the queue size.
+// Also collects queue depth and latency statistics.
+class AVG_API BitmapLoadQueue
+{
+public:
+    BitmapLoadQueue();
+    virtual ~BitmapLoadQueue();
+
+    // pMsg must not be in the queue already.
+    void push(BitmapManagerMsgPtr pMsg, float priority);
+    // Returns an empty pointer if the queue is empty.
+    BitmapManagerMsgPtr pop();
+    // These return false if pMsg isn't in the queue (anymore).
+    bool setPriority(BitmapManagerMsgPtr pMsg, float priority);
+    bool remove(BitmapManagerMsgPtr pMsg);
+    void clear();
+    int size() const;
+
+    // Time from the first request to the end of the load, in microseconds.
+    void addLatency(long long latency);
+    LatencyHistogram getLatencyHistogram() const;
+    int getMaxSize() const;
+
+private:
+    // Sorts by descending priority, then by push order.
+    struct LoadKey {
+        float m_Priority;
+        long long m_PushIndex;
+
+        bool operator <(const LoadKey& other) const
+        {
+            if (m_Priority != other.m_Priority) {
+                return m_Priority > other.m_Priority;
+            }
+            return m_PushIndex < other.m_PushIndex;
+        }
+    };
+    typedef std::map<LoadKey, BitmapManagerMsgPtr> LoadOrder;
+    typedef std::map<BitmapManagerMsgPtr, LoadOrder::iterator> MsgIndex;
+
+    LoadOrder m_LoadOrder;
+    MsgIndex m_MsgIndex;
+    long long m_NumPushes;
+    int m_MaxSize;
+    LatencyHistogram m_Latencies;
+    mutable boost::mutex m_Mutex;
+};
+
+}
+
+#endif
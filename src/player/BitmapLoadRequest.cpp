@@ -0,0 +1,136 @@
+//
+//  libavg - Media Playback Engine.
+//  Copyright (C) 2003-2014 Ulrich von Zadow
+//
+//  This library is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU Lesser General Public
+//  License as published by the Free Software Foundation; either
+//  version 2 of the License, or (at your option) any later version.
+//
+//  This library is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//  Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public
+//  License along with this library; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+//  Current versions can be found at www.libavg.de
+//
+
+#include "BitmapLoadRequest.h"
+#include "BitmapManager.h"
+#include "BitmapManagerMsg.h"
+#include "IBitmapLoadedListener.h"
+
+#include "../base/ObjectCounter.h"
+#include "../base/Exception.h"
+
+using namespace std;
+
+namespace avg {
+
+BitmapLoadRequest::BitmapLoadRequest(const UTF8String& sFilename,
+        const boost::python::object& onLoadedCb, float priority)
+    : m_OnLoadedCb(onLoadedCb),
+      m_pLoadedListener(0)
+{
+    init(sFilename, priority);
+}
+
+BitmapLoadRequest::BitmapLoadRequest(const UTF8String& sFilename,
+        IBitmapLoadedListener* pLoadedListener, float priority)
+    : m_pLoadedListener(pLoadedListener)
+{
+    init(sFilename, priority);
+}
+
+BitmapLoadRequest::~BitmapLoadRequest()
+{
+    ObjectCounter::get()->decRef(&typeid(*this));
+}
+
+void BitmapLoadRequest::init(const UTF8String& sFilename, float priority)
+{
+    ObjectCounter::get()->incRef(&typeid(*this));
+    m_sFilename = sFilename;
+    m_Priority = priority;
+    m_bPending = true;
+}
+
+const UTF8String& BitmapLoadRequest::getFilename() const
+{
+    return m_sFilename;
+}
+
+float BitmapLoadRequest::getPriority() const
+{
+    return m_Priority;
+}
+
+void BitmapLoadRequest::setPriority(float priority)
+{
+    m_Priority = priority;
+    BitmapManagerMsgPtr pMsg = m_pMsg.lock();
+    if (m_bPending && pMsg) {
+        BitmapManager::get()->updateMsg(pMsg);
+    }
+}
+
+void BitmapLoadRequest::cancel()
+{
+    if (!m_bPending) {
+        return;
+    }
+    finish();
+    BitmapManagerMsgPtr pMsg = m_pMsg.lock();
+    if (pMsg) {
+        BitmapManager::get()->onRequestCanceled(pMsg);
+    }
+}
+
+bool BitmapLoadRequest::isPending() const
+{
+    return m_bPending;
+}
+
+void BitmapLoadRequest::setMsg(BitmapManagerMsgPtr pMsg)
+{
+    m_pMsg = pMsg;
+}
+
+void BitmapLoadRequest::onLoaded(BitmapPtr pBmp)
+{
+    AVG_ASSERT(m_bPending);
+    boost::python::object onLoadedCb = m_OnLoadedCb;
+    IBitmapLoadedListener* pLoadedListener = m_pLoadedListener;
+    finish();
+    if (pLoadedListener) {
+        pLoadedListener->onBitmapLoaded(pBmp);
+    } else {
+        boost::python::call<void>(onLoadedCb.ptr(), pBmp);
+    }
+}
+
+void BitmapLoadRequest::onError(const Exception* pEx)
+{
+    AVG_ASSERT(m_bPending);
+    boost::python::object onLoadedCb = m_OnLoadedCb;
+    IBitmapLoadedListener* pLoadedListener = m_pLoadedListener;
+    finish();
+    if (pLoadedListener) {
+        pLoadedListener->onBitmapLoadError(pEx);
+    } else {
+        boost::python::call<void>(onLoadedCb.ptr(), pEx);
+    }
+}
+
+void BitmapLoadRequest::finish()
+{
+    m_bPending = false;
+    m_OnLoadedCb = boost::python::object();
+    m_pLoadedListener = 0;
+}
+
+}
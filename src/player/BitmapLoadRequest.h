@@ -0,0 +1,84 @@
+//
+//  libavg - Media Playback Engine.
+//  Copyright (C) 2003-2014 Ulrich von Zadow
+//
+//  This library is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU Lesser General Public
+//  License as published by the Free Software Foundation; either
+//  version 2 of the License, or (at your option) any later version.
+//
+//  This library is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//  Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public
+//  License along with this library; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+//  Current versions can be found at www.libavg.de
+//
+
+#ifndef _BitmapLoadRequest_H_
+#define _BitmapLoadRequest_H_
+
+#include "WrapPython.h"
+
+#include "../api.h"
+#include "../base/UTF8String.h"
+
+#include <boost/shared_ptr.hpp>
+#include <boost/weak_ptr.hpp>
+#include <boost/python.hpp>
+
+namespace avg {
+
+class Bitmap;
+typedef boost::shared_ptr<Bitmap> BitmapPtr;
+class Exception;
+class IBitmapLoadedListener;
+class BitmapManagerMsg;
+typedef boost::shared_ptr<BitmapManagerMsg> BitmapManagerMsgPtr;
+
+// Handle for an asynchronous load started by BitmapManager::loadBitmap(). Pending
+// loads with higher priority are started first. Requests for the same file and pixel
+// format share one load, which is started with the highest priority of its requests.
+// Canceled requests don't get a callback. Only used in the main thread.
+class AVG_API BitmapLoadRequest
+{
+public:
+    BitmapLoadRequest(const UTF8String& sFilename,
+            const boost::python::object& onLoadedCb, float priority);
+    BitmapLoadRequest(const UTF8String& sFilename,
+            IBitmapLoadedListener* pLoadedListener, float priority);
+    virtual ~BitmapLoadRequest();
+
+    const UTF8String& getFilename() const;
+    float getPriority() const;
+    void setPriority(float priority);
+    void cancel();
+    // True until the callback has been called or the request has been canceled.
+    bool isPending() const;
+
+    // Called by BitmapManager.
+    void setMsg(BitmapManagerMsgPtr pMsg);
+    void onLoaded(BitmapPtr pBmp);
+    void onError(const Exception* pEx);
+
+private:
+    void init(const UTF8String& sFilename, float priority);
+    void finish();
+
+    UTF8String m_sFilename;
+    float m_Priority;
+    bool m_bPending;
+    boost::python::object m_OnLoadedCb;
+    IBitmapLoadedListener* m_pLoadedListener;
+    boost::weak_ptr<BitmapManagerMsg> m_pMsg;
+};
+
+typedef boost::shared_ptr<BitmapLoadRequest> BitmapLoadRequestPtr;
+
+}
+
+#endif
@@ -29,14 +29,31 @@
 #include  <stdlib.h>
 
 #include "../base/OSHelper.h"
+#include "../base/Logger.h"
 
 using namespace std;
 
 namespace avg {
 
+BitmapManagerStats::BitmapManagerStats()
+    : m_NumRequests(0),
+      m_NumCoalescedRequests(0),
+      m_NumCanceledRequests(0),
+      m_QueueDepth(0),
+      m_MaxQueueDepth(0),
+      m_NumLoads(0),
+      m_AvgLatency(0),
+      m_P99Latency(0),
+      m_MaxLatency(0)
+{
+}
+
 BitmapManager * BitmapManager::s_pBitmapManager=0;
 
 BitmapManager::BitmapManager()
+    : m_NumRequests(0),
+      m_NumCoalescedRequests(0),
+      m_NumCanceledRequests(0)
 {
     if (s_pBitmapManager) {
         throw Exception(AVG_ERR_UNKNOWN, "BitmapMananger has already been instantiated.");
@@ -52,13 +69,16 @@ BitmapManager::BitmapManager()
 
 BitmapManager::~BitmapManager()
 {
+    dumpStatistics();
     while (!m_pCmdQueue->empty()) {
         m_pCmdQueue->pop();
     }
+    m_LoadQueue.clear();
     while (!m_pMsgQueue->empty()) {
         m_pMsgQueue->pop();
     }
     stopThreads();
+    m_ActiveMsgs.clear();
     s_pBitmapManager = 0;
 }
 
@@ -70,22 +90,20 @@ BitmapManager* BitmapManager::get()
     return s_pBitmapManager;
 }
 
-void BitmapManager::loadBitmapPy(const UTF8String& sUtf8FileName,
-        const boost::python::object& pyFunc, PixelFormat pf)
+BitmapLoadRequestPtr BitmapManager::loadBitmapPy(const UTF8String& sUtf8FileName,
+        const boost::python::object& pyFunc, PixelFormat pf, float priority)
 {
-    std::string sFileName = convertUTF8ToFilename(sUtf8FileName);
-    BitmapManagerMsgPtr pMsg = BitmapManagerMsgPtr(
-            new BitmapManagerMsg(sUtf8FileName, pyFunc, pf));
-    internalLoadBitmap(pMsg);
+    BitmapLoadRequestPtr pRequest(new BitmapLoadRequest(sUtf8FileName, pyFunc, 
+            priority));
+    return internalLoadBitmap(pRequest, pf);
 }
 
-void BitmapManager::loadBitmap(const UTF8String& sUtf8FileName,
-        IBitmapLoadedListener* pLoadedListener, PixelFormat pf)
+BitmapLoadRequestPtr BitmapManager::loadBitmap(const UTF8String& sUtf8FileName,
+        IBitmapLoadedListener* pLoadedListener, PixelFormat pf, float priority)
 {
-    std::string sFileName = convertUTF8ToFilename(sUtf8FileName);
-    BitmapManagerMsgPtr pMsg = BitmapManagerMsgPtr(
-            new BitmapManagerMsg(sUtf8FileName, pLoadedListener, pf));
-    internalLoadBitmap(pMsg);
+    BitmapLoadRequestPtr pRequest(new BitmapLoadRequest(sUtf8FileName, 
+            pLoadedListener, priority));
+    return internalLoadBitmap(pRequest, pf);
 }
 
 void BitmapManager::setNumThreads(int numThreads)
@@ -94,16 +112,87 @@ void BitmapManager::setNumThreads(int numThreads)
     startThreads(numThreads);
 }
 
+BitmapManagerStats BitmapManager::getStats() const
+{
+    BitmapManagerStats stats;
+    stats.m_NumRequests = m_NumRequests;
+    stats.m_NumCoalescedRequests = m_NumCoalescedRequests;
+    stats.m_NumCanceledRequests = m_NumCanceledRequests;
+    stats.m_QueueDepth = m_LoadQueue.size();
+    stats.m_MaxQueueDepth = m_LoadQueue.getMaxSize();
+    LatencyHistogram latencies = m_LoadQueue.getLatencyHistogram();
+    stats.m_NumLoads = latencies.getNumValues();
+    if (stats.m_NumLoads > 0) {
+        stats.m_AvgLatency = latencies.getAvg()/1000.f;
+        stats.m_P99Latency = latencies.getPercentile(99)/1000.f;
+        stats.m_MaxLatency = latencies.getMax()/1000.f;
+    }
+    return stats;
+}
+
 void BitmapManager::onFrameEnd()
 {
     while (!m_pMsgQueue->empty()) {
         BitmapManagerMsgPtr pMsg = m_pMsgQueue->pop();
+        MsgMap::iterator it = m_ActiveMsgs.find(
+                MsgKey(pMsg->getFilename(), pMsg->getPixelFormat()));
+        if (it != m_ActiveMsgs.end() && it->second == pMsg) {
+            m_ActiveMsgs.erase(it);
+        }
         pMsg->executeCallback();
     }
 }
 
-void BitmapManager::internalLoadBitmap(BitmapManagerMsgPtr pMsg)
+void BitmapManager::onRequestCanceled(BitmapManagerMsgPtr pMsg)
+{
+    m_NumCanceledRequests++;
+    updateMsg(pMsg);
+}
+
+void BitmapManager::updateMsg(BitmapManagerMsgPtr pMsg)
+{
+    const vector<BitmapLoadRequestPtr>& pRequests = pMsg->getRequests();
+    bool bPending = false;
+    float priority = 0;
+    for (unsigned i = 0; i < pRequests.size(); ++i) {
+        if (pRequests[i]->isPending()) {
+            if (!bPending || pRequests[i]->getPriority() > priority) {
+                priority = pRequests[i]->getPriority();
+            }
+            bPending = true;
+        }
+    }
+    if (bPending) {
+        m_LoadQueue.setPriority(pMsg, priority);
+    } else {
+        // Nobody is interested anymore. Loads that have already started are finished
+        // so later requests for the same file can use the result.
+        if (m_LoadQueue.remove(pMsg)) {
+            m_ActiveMsgs.erase(MsgKey(pMsg->getFilename(), pMsg->getPixelFormat()));
+        }
+    }
+}
+
+BitmapLoadRequestPtr BitmapManager::internalLoadBitmap(BitmapLoadRequestPtr pRequest,
+        PixelFormat pf)
 {
+    m_NumRequests++;
+    MsgKey key(pRequest->getFilename(), pf);
+    MsgMap::iterator it = m_ActiveMsgs.find(key);
+    if (it != m_ActiveMsgs.end()) {
+        // Same file, same pixel format: No need to load it twice.
+        m_NumCoalescedRequests++;
+        BitmapManagerMsgPtr pMsg = it->second;
+        pMsg->addRequest(pRequest);
+        pRequest->setMsg(pMsg);
+        updateMsg(pMsg);
+        return pRequest;
+    }
+
+    BitmapManagerMsgPtr pMsg(new BitmapManagerMsg(pRequest->getFilename(), pf));
+    pMsg->addRequest(pRequest);
+    pRequest->setMsg(pMsg);
+    m_ActiveMsgs[key] = pMsg;
 #ifdef WIN32
     int rc = _access(pMsg->getFilename().c_str(), 04);
 #else
@@ -117,31 +206,49 @@ void BitmapManager::internalLoadBitmap(BitmapManagerMsgPtr pMsg)
                 strerror(errno)));
         m_pMsgQueue->push(pMsg);
     } else {
-        m_pCmdQueue->pushCmd(boost::bind(&BitmapManagerThread::loadBitmap, _1, pMsg));
+        m_LoadQueue.push(pMsg, pRequest->getPriority());
+        m_pCmdQueue->pushCmd(boost::bind(&BitmapManagerThread::loadNextBitmap, _1));
     }
+    return pRequest;
 }
 
 void BitmapManager::startThreads(int numThreads)
 {
+    // The loader threads run as tasks on the shared TaskScheduler.
     for (int i=0; i<numThreads; ++i) {
-        boost::thread* pThread = new boost::thread(
-                BitmapManagerThread(*m_pCmdQueue, *m_pMsgQueue));
-        m_pBitmapManagerThreads.push_back(pThread);
+        TaskPtr pTask = BitmapManagerThread::startAsTask(
+                BitmapManagerThread(*m_pCmdQueue, m_LoadQueue, *m_pMsgQueue));
+        m_pLoaderTasks.push_back(pTask);
     }
 }
 
 void BitmapManager::stopThreads()
 {
-    int numThreads = m_pBitmapManagerThreads.size();
+    int numThreads = m_pLoaderTasks.size();
     for (int i=0; i<numThreads; ++i) {
         m_pCmdQueue->pushCmd(boost::bind(&BitmapManagerThread::stop, _1));
     }
     for (int i=0; i<numThreads; ++i) {
-        boost::thread* pThread = m_pBitmapManagerThreads[i];
-        pThread->join();
-        delete pThread;
+        m_pLoaderTasks[i]->wait();
+    }
+    m_pLoaderTasks.clear();
+}
+
+void BitmapManager::dumpStatistics()
+{
+    BitmapManagerStats stats = getStats();
+    if (stats.m_NumRequests == 0) {
+        return;
     }
-    m_pBitmapManagerThreads.clear();
+    AVG_TRACE(Logger::category::PROFILE, Logger::severity::INFO,
+            "Async bitmap loads: " << stats.m_NumRequests << " requests, " 
+            << stats.m_NumCoalescedRequests << " coalesced, " 
+            << stats.m_NumCanceledRequests << " canceled, " << stats.m_NumLoads 
+            << " loads");
+    AVG_TRACE(Logger::category::PROFILE, Logger::severity::INFO,
+            "Async bitmap load latency: avg " << stats.m_AvgLatency << " ms, p99 "
+            << stats.m_P99Latency << " ms, max " << stats.m_MaxLatency 
+            << " ms. Max. queue depth: " << stats.m_MaxQueueDepth);
 }
 
 }
@@ -26,40 +26,81 @@
 
 #include "BitmapManagerThread.h"
 #include "BitmapManagerMsg.h"
+#include "BitmapLoadQueue.h"
+#include "BitmapLoadRequest.h"
 
 #include "../base/Queue.h"
 #include "../base/IFrameEndListener.h"
+#include "../base/TaskScheduler.h"
 
 #include <boost/thread.hpp>
 
 #include <vector>
+#include <map>
 
 namespace avg {
 
+struct AVG_API BitmapManagerStats
+{
+    BitmapManagerStats();
+
+    long long m_NumRequests;
+    // Requests that were added to a load of the same file that was already under way.
+    long long m_NumCoalescedRequests;
+    long long m_NumCanceledRequests;
+    // Loads waiting for a loader thread.
+    int m_QueueDepth;
+    int m_MaxQueueDepth;
+    // Time from the first request to the end of the load, in milliseconds.
+    int m_NumLoads;
+    float m_AvgLatency;
+    float m_P99Latency;
+    float m_MaxLatency;
+};
+
 class AVG_API BitmapManager : public IFrameEndListener
 {
     public:
         BitmapManager();
         ~BitmapManager();
         static BitmapManager* get();
-        void loadBitmapPy(const UTF8String& sUtf8FileName,
-                const boost::python::object& pyFunc, PixelFormat pf=NO_PIXELFORMAT);
-        void loadBitmap(const UTF8String& sUtf8FileName,
-                IBitmapLoadedListener* pLoadedListener, PixelFormat pf=NO_PIXELFORMAT);
+        BitmapLoadRequestPtr loadBitmapPy(const UTF8String& sUtf8FileName,
+                const boost::python::object& pyFunc, PixelFormat pf=NO_PIXELFORMAT,
+                float priority=0);
+        BitmapLoadRequestPtr loadBitmap(const UTF8String& sUtf8FileName,
+                IBitmapLoadedListener* pLoadedListener, PixelFormat pf=NO_PIXELFORMAT,
+                float priority=0);
         void setNumThreads(int numThreads);
+        BitmapManagerStats getStats() const;
 
         virtual void onFrameEnd();
+
+        // Called by BitmapLoadRequest.
+        void onRequestCanceled(BitmapManagerMsgPtr pMsg);
+        void updateMsg(BitmapManagerMsgPtr pMsg);
         
     private:
-        void internalLoadBitmap(BitmapManagerMsgPtr pMsg);
+        typedef std::pair<std::string, PixelFormat> MsgKey;
+        typedef std::map<MsgKey, BitmapManagerMsgPtr> MsgMap;
+
+        BitmapLoadRequestPtr internalLoadBitmap(BitmapLoadRequestPtr pRequest,
+                PixelFormat pf);
         void startThreads(int numThreads);
         void stopThreads();
+        void dumpStatistics();
 
         static BitmapManager * s_pBitmapManager;
 
-        std::vector<boost::thread*> m_pBitmapManagerThreads;
+        std::vector<TaskPtr> m_pLoaderTasks;
         BitmapManagerThread::CQueuePtr m_pCmdQueue;
+        BitmapLoadQueue m_LoadQueue;
         BitmapManagerMsgQueuePtr m_pMsgQueue;
+        // Loads whose results haven't been delivered yet, for coalescing requests.
+        MsgMap m_ActiveMsgs;
+
+        long long m_NumRequests;
+        long long m_NumCoalescedRequests;
+        long long m_NumCanceledRequests;
 };
 
 }
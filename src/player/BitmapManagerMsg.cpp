@@ -20,31 +20,23 @@
 //
 
 #include "BitmapManagerMsg.h"
-#include "IBitmapLoadedListener.h"
 
 #include "../base/ObjectCounter.h"
 #include "../base/Exception.h"
 #include "../base/TimeSource.h"
 
+using namespace std;
 
 namespace avg {
 
-BitmapManagerMsg::BitmapManagerMsg(const UTF8String& sFilename,
-        const boost::python::object& onLoadedCb, PixelFormat pf) 
+BitmapManagerMsg::BitmapManagerMsg(const UTF8String& sFilename, PixelFormat pf)
+    : m_sFilename(sFilename),
+      m_StartTime(TimeSource::get()->getCurrentMicrosecs()),
+      m_PF(pf),
+      m_MsgType(REQUEST),
+      m_pEx(0)
 {
     ObjectCounter::get()->incRef(&typeid(*this));
-    init(sFilename, pf);
-    m_OnLoadedCb = onLoadedCb;
-    m_pLoadedListener = 0;
-}
-
-BitmapManagerMsg::BitmapManagerMsg(const UTF8String& sFilename,
-        IBitmapLoadedListener* pLoadedListener, PixelFormat pf)
-{
-    ObjectCounter::get()->incRef(&typeid(*this));
-    init(sFilename, pf);
-    m_OnLoadedCb = boost::python::object();
-    m_pLoadedListener = pLoadedListener;
 }
 
 BitmapManagerMsg::~BitmapManagerMsg()
@@ -55,35 +47,37 @@ BitmapManagerMsg::~BitmapManagerMsg()
     ObjectCounter::get()->decRef(&typeid(*this));
 }
 
-void BitmapManagerMsg::init(const UTF8String& sFilename, PixelFormat pf)
+void BitmapManagerMsg::addRequest(BitmapLoadRequestPtr pRequest)
 {
-    m_sFilename = sFilename;
-    m_StartTime = TimeSource::get()->getCurrentMicrosecs()/1000.0f;
-    m_PF = pf;
-    m_MsgType = REQUEST;
-    m_pEx = 0;
+    m_pRequests.push_back(pRequest);
+}
+
+const vector<BitmapLoadRequestPtr>& BitmapManagerMsg::getRequests() const
+{
+    return m_pRequests;
 }
 
 void BitmapManagerMsg::executeCallback()
 {
-    switch (m_MsgType) {
-        case BITMAP:
-            if (m_pLoadedListener) {
-                m_pLoadedListener->onBitmapLoaded(m_pBmp);
-            } else {
-                boost::python::call<void>(m_OnLoadedCb.ptr(), m_pBmp);
-            }
-            break;
-        case ERROR:
-            if (m_pLoadedListener) {
-                m_pLoadedListener->onBitmapLoadError(m_pEx);
-            } else {
-                boost::python::call<void>(m_OnLoadedCb.ptr(), m_pEx);
-            }
-            break;
-        
-        default:
-            AVG_ASSERT(false);
+    // Dropping the requests here makes sure their python callbacks are released in
+    // the main thread.
+    vector<BitmapLoadRequestPtr> pRequests;
+    pRequests.swap(m_pRequests);
+    for (unsigned i = 0; i < pRequests.size(); ++i) {
+        BitmapLoadRequestPtr pRequest = pRequests[i];
+        if (!pRequest->isPending()) {
+            continue;
+        }
+        switch (m_MsgType) {
+            case BITMAP:
+                pRequest->onLoaded(m_pBmp);
+                break;
+            case ERROR:
+                pRequest->onError(m_pEx);
+                break;
+            default:
+                AVG_ASSERT(false);
+        }
     }
 }
     
@@ -92,7 +86,7 @@ const UTF8String BitmapManagerMsg::getFilename()
     return m_sFilename;
 }
 
-float BitmapManagerMsg::getStartTime()
+long long BitmapManagerMsg::getStartTime()
 {
     AVG_ASSERT(m_MsgType == REQUEST);
     return m_StartTime;
@@ -100,7 +94,6 @@ float BitmapManagerMsg::getStartTime()
     
 PixelFormat BitmapManagerMsg::getPixelFormat()
 {
-    AVG_ASSERT(m_MsgType == REQUEST);
     return m_PF;
 }
 
@@ -22,40 +22,44 @@
 #ifndef _BitmapManagerMsg_H_
 #define _BitmapManagerMsg_H_
 
-#include "WrapPython.h"
+#include "BitmapLoadRequest.h"
 
 #include "../api.h"
-#include "../base/Queue.h"
+#include "../base/LockFreeQueue.h"
 #include "../base/UTF8String.h"
 #include "../base/Exception.h"
 
 #include "../graphics/PixelFormat.h"
 
 #include <boost/shared_ptr.hpp>
-#include <boost/python.hpp>
+
+#include <vector>
 
 
 namespace avg {
 
 class Bitmap;
 typedef boost::shared_ptr<Bitmap> BitmapPtr;
-class IBitmapLoadedListener;
 
+// One load of a file. Carries the file name to a loader thread and the result back.
+// All requests for the file that arrive before the result is delivered share the
+// message.
 class AVG_API BitmapManagerMsg
 {
 public:
     enum MsgType {REQUEST, BITMAP, ERROR};
 
-    BitmapManagerMsg(const UTF8String& sFilename,
-            const boost::python::object& onLoadedCb, PixelFormat pf);
-    BitmapManagerMsg(const UTF8String& sFilename,
-            IBitmapLoadedListener* pLoadedListener, PixelFormat pf);
+    BitmapManagerMsg(const UTF8String& sFilename, PixelFormat pf);
     virtual ~BitmapManagerMsg();
-    void init(const UTF8String& sFilename, PixelFormat pf);
 
+    // Request handling happens in the main thread only.
+    void addRequest(BitmapLoadRequestPtr pRequest);
+    const std::vector<BitmapLoadRequestPtr>& getRequests() const;
+    // Calls the callbacks of all pending requests and drops the requests.
     void executeCallback();
+
     const UTF8String getFilename();
-    float getStartTime();
+    long long getStartTime();
     PixelFormat getPixelFormat();
     void setBitmap(BitmapPtr pBmp);
     void setError(const Exception& ex);
@@ -64,17 +68,16 @@ public:
 
 private:
     UTF8String m_sFilename;
-    float m_StartTime;
+    long long m_StartTime;
     BitmapPtr m_pBmp;
-    boost::python::object m_OnLoadedCb;
-    IBitmapLoadedListener* m_pLoadedListener;
+    std::vector<BitmapLoadRequestPtr> m_pRequests;
     PixelFormat m_PF;
     MsgType m_MsgType;
     Exception* m_pEx;
 };
 
 typedef boost::shared_ptr<BitmapManagerMsg> BitmapManagerMsgPtr;
-typedef Queue<BitmapManagerMsg> BitmapManagerMsgQueue;
+typedef MsgQueue<BitmapManagerMsg>::type BitmapManagerMsgQueue;
 typedef boost::shared_ptr<BitmapManagerMsgQueue> BitmapManagerMsgQueuePtr;
 }
 
@@ -32,12 +32,15 @@
 
 namespace avg {
 
-BitmapManagerThread::BitmapManagerThread(CQueue& cmdQ, BitmapManagerMsgQueue& MsgQueue)
+BitmapManagerThread::BitmapManagerThread(CQueue& cmdQ, BitmapLoadQueue& loadQueue,
+        BitmapManagerMsgQueue& MsgQueue)
     : WorkerThread<BitmapManagerThread>("BitmapManager", cmdQ),
-      m_MsgQueue(MsgQueue),
-      m_TotalLatency(0),
-      m_NumBmpsLoaded(0)
+      m_LoadQueue(loadQueue),
+      m_MsgQueue(MsgQueue)
 {
+    // All loader threads share one command queue and every command loads a bitmap, 
+    // so each thread takes one command at a time.
+    setMaxCmdBatchSize(1);
 }
 
 bool BitmapManagerThread::work()
@@ -46,32 +49,24 @@ bool BitmapManagerThread::work()
     return true;
 }
 
-void BitmapManagerThread::deinit()
-{
-    if (m_NumBmpsLoaded > 0) {
-        AVG_TRACE(Logger::category::PROFILE, Logger::severity::INFO,
-                "Average latency for async bitmap loads: " << m_TotalLatency/m_NumBmpsLoaded
-                << " ms");
-    }
-}
-
 static ProfilingZoneID LoaderProfilingZone("loadBitmap", true);
 
-void BitmapManagerThread::loadBitmap(BitmapManagerMsgPtr pRequest)
+void BitmapManagerThread::loadNextBitmap()
 {
-    BitmapPtr pBmp;
+    BitmapManagerMsgPtr pMsg = m_LoadQueue.pop();
+    if (!pMsg) {
+        return;
+    }
     ScopeTimer timer(LoaderProfilingZone);
-    float startTime = pRequest->getStartTime();
+    long long startTime = pMsg->getStartTime();
     try {
-        pBmp = avg::loadBitmap(pRequest->getFilename(), pRequest->getPixelFormat());
-        pRequest->setBitmap(pBmp);
+        BitmapPtr pBmp = avg::loadBitmap(pMsg->getFilename(), pMsg->getPixelFormat());
+        pMsg->setBitmap(pBmp);
     } catch (const Exception& ex) {
-        pRequest->setError(ex);
+        pMsg->setError(ex);
     }
-    m_MsgQueue.push(pRequest);
-    m_NumBmpsLoaded++;
-    float curLatency = TimeSource::get()->getCurrentMicrosecs()/1000 - startTime;
-    m_TotalLatency += curLatency;
+    m_LoadQueue.addLatency(TimeSource::get()->getCurrentMicrosecs() - startTime);
+    m_MsgQueue.push(pMsg);
     ThreadProfiler::get()->reset();
 }
 
@@ -25,6 +25,7 @@
 #include "../api.h"
 
 #include "BitmapManagerMsg.h"
+#include "BitmapLoadQueue.h"
 
 #include "../base/WorkerThread.h"
 
@@ -36,17 +37,18 @@ namespace avg {
 class AVG_API BitmapManagerThread : public WorkerThread<BitmapManagerThread>
 {
     public:
-        BitmapManagerThread(CQueue& cmdQ, BitmapManagerMsgQueue& MsgQueue);
+        BitmapManagerThread(CQueue& cmdQ, BitmapLoadQueue& loadQueue,
+                BitmapManagerMsgQueue& MsgQueue);
                 
-        void loadBitmap(BitmapManagerMsgPtr pRequest);
+        // Loads the message with the highest priority from the load queue. There is
+        // one command per message pushed, but canceled messages are removed from the
+        // queue, so the queue can be empty.
+        void loadNextBitmap();
         
     private:
         virtual bool work();
-        virtual void deinit();
+        BitmapLoadQueue& m_LoadQueue;
         BitmapManagerMsgQueue& m_MsgQueue;
-
-        float m_TotalLatency;
-        int m_NumBmpsLoaded;
 };
 
 }
@@ -28,6 +28,7 @@
 
 #include "../base/Exception.h"
 #include "../base/OSHelper.h"
+#include "../base/FrameArena.h"
 
 #include <string>
 
@@ -49,7 +50,8 @@ EventDispatcher::~EventDispatcher()
 
 void EventDispatcher::dispatch() 
 {
-    vector<EventPtr> events;
+    FrameVector<EventPtr>::type events(
+            FrameArenaAllocator<EventPtr>(m_pPlayer->getFrameArena()));
 
     for (unsigned int i = 0; i < m_InputDevices.size(); ++i) {
         InputDevicePtr pCurInputDevice = m_InputDevices[i];
@@ -63,7 +65,7 @@ void EventDispatcher::dispatch()
         }
     }
 
-    vector<EventPtr>::iterator it;
+    FrameVector<EventPtr>::type::iterator it;
     for (it = events.begin(); it != events.end(); ++it) {
         EventPtr pEvent = *it;
         bool bHookEatsEvent = processEventHook(pEvent);
@@ -0,0 +1,137 @@
+//
+//  libavg - Media Playback Engine.
+//  Copyright (C) 2003-2014 Ulrich von Zadow
+//
+//  This library is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU Lesser General Public
+//  License as published by the Free Software Foundation; either
+//  version 2 of the License, or (at your option) any later version.
+//
+//  This library is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//  Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public
+//  License along with this library; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+//  Current versions can be found at www.libavg.de
+//
+
+#include "FrameStats.h"
+
+#include "../base/Exception.h"
+
+namespace avg {
+
+const char* FrameStats::FORMAT = "=qqqiiiiiiiiii";
+
+FrameStats::FrameStats()
+    : m_FrameNum(0),
+      m_StartTime(0),
+      m_TextureUploadBytes(0),
+      m_TotalTime(0),
+      m_TimersTime(0),
+      m_EventsTime(0),
+      m_OffscreenTime(0),
+      m_RenderTime(0),
+      m_WaitTime(0),
+      m_SwapTime(0),
+      m_NumNodesRendered(0),
+      m_NumVideoFramesDropped(0),
+      m_bLate(0)
+{
+}
+
+FrameStatsSummary::FrameStatsSummary()
+    : m_NumFrames(0),
+      m_NumLateFrames(0),
+      m_AvgFrameTime(0),
+      m_MaxFrameTime(0),
+      m_AvgRenderTime(0),
+      m_AvgNodesRendered(0),
+      m_TextureUploadBytes(0),
+      m_NumVideoFramesDropped(0)
+{
+}
+
+FrameStatsRing::FrameStatsRing(int size)
+    : m_Size(size),
+      m_NextIndex(0),
+      m_NumFrames(0)
+{
+    AVG_ASSERT(size > 0);
+    m_Frames.resize(2*size);
+}
+
+void FrameStatsRing::push(const FrameStats& stats)
+{
+    m_Frames[m_NextIndex] = stats;
+    m_Frames[m_NextIndex+m_Size] = stats;
+    m_NextIndex = (m_NextIndex+1) % m_Size;
+    if (m_NumFrames < m_Size) {
+        m_NumFrames++;
+    }
+}
+
+void FrameStatsRing::clear()
+{
+    m_NextIndex = 0;
+    m_NumFrames = 0;
+}
+
+int FrameStatsRing::getSize() const
+{
+    return m_Size;
+}
+
+int FrameStatsRing::getNumFrames() const
+{
+    return m_NumFrames;
+}
+
+const FrameStats* FrameStatsRing::getLastFrames(int numFrames) const
+{
+    if (numFrames < 0 || numFrames > m_NumFrames) {
+        throw Exception(AVG_ERR_OUT_OF_RANGE,
+                "Requested statistics for more frames than are available.");
+    }
+    return &m_Frames[m_NextIndex+m_Size-numFrames];
+}
+
+FrameStatsSummary FrameStatsRing::getSummary(int numFrames) const
+{
+    if (numFrames > m_NumFrames) {
+        numFrames = m_NumFrames;
+    }
+    FrameStatsSummary summary;
+    summary.m_NumFrames = numFrames;
+    if (numFrames == 0) {
+        return summary;
+    }
+    const FrameStats* pFrames = getLastFrames(numFrames);
+    long long totalTime = 0;
+    long long renderTime = 0;
+    long long numNodes = 0;
+    for (int i=0; i<numFrames; ++i) {
+        const FrameStats& frame = pFrames[i];
+        if (frame.m_bLate) {
+            summary.m_NumLateFrames++;
+        }
+        totalTime += frame.m_TotalTime;
+        if (frame.m_TotalTime > summary.m_MaxFrameTime) {
+            summary.m_MaxFrameTime = frame.m_TotalTime;
+        }
+        renderTime += frame.m_RenderTime;
+        numNodes += frame.m_NumNodesRendered;
+        summary.m_TextureUploadBytes += frame.m_TextureUploadBytes;
+        summary.m_NumVideoFramesDropped += frame.m_NumVideoFramesDropped;
+    }
+    summary.m_AvgFrameTime = int(totalTime/numFrames);
+    summary.m_AvgRenderTime = int(renderTime/numFrames);
+    summary.m_AvgNodesRendered = int(numNodes/numFrames);
+    return summary;
+}
+
+}
@@ -0,0 +1,97 @@
+//
+//  libavg - Media Playback Engine.
+//  Copyright (C) 2003-2014 Ulrich von Zadow
+//
+//  This library is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU Lesser General Public
+//  License as published by the Free Software Foundation; either
+//  version 2 of the License, or (at your option) any later version.
+//
+//  This library is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//  Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public
+//  License along with this library; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+//  Current versions can be found at www.libavg.de
+//
+
+#ifndef _FrameStats_H_
+#define _FrameStats_H_
+
+#include "../api.h"
+
+#include <vector>
+
+namespace avg {
+
+// Statistics for one frame. Times are in microseconds. The layout is fixed (64 bytes,
+// no padding) so the records can be handed to Python without copying;
+// FrameStats::FORMAT is the corresponding python struct module format.
+struct AVG_API FrameStats
+{
+    static const char* FORMAT;
+
+    FrameStats();
+
+    long long m_FrameNum;
+    long long m_StartTime;
+    long long m_TextureUploadBytes;
+    int m_TotalTime;
+    int m_TimersTime;
+    int m_EventsTime;
+    int m_OffscreenTime;
+    int m_RenderTime;
+    int m_WaitTime;
+    int m_SwapTime;
+    int m_NumNodesRendered;
+    int m_NumVideoFramesDropped;
+    int m_bLate;
+};
+
+struct AVG_API FrameStatsSummary
+{
+    FrameStatsSummary();
+
+    int m_NumFrames;
+    int m_NumLateFrames;
+    int m_AvgFrameTime;
+    int m_MaxFrameTime;
+    int m_AvgRenderTime;
+    int m_AvgNodesRendered;
+    long long m_TextureUploadBytes;
+    int m_NumVideoFramesDropped;
+};
+
+// Fixed-size ring of the statistics of the last frames. Every record is stored twice,
+// at i and i+size, so the most recent n records are always contiguous in memory.
+class AVG_API FrameStatsRing
+{
+public:
+    static const int DEFAULT_SIZE = 1024;
+
+    FrameStatsRing(int size=DEFAULT_SIZE);
+
+    void push(const FrameStats& stats);
+    void clear();
+
+    int getSize() const;
+    int getNumFrames() const;
+    // Returns the last numFrames records, oldest first. The pointer stays valid, but
+    // the records it points to change when the next frame is pushed.
+    const FrameStats* getLastFrames(int numFrames) const;
+    FrameStatsSummary getSummary(int numFrames) const;
+
+private:
+    std::vector<FrameStats> m_Frames;
+    int m_Size;
+    int m_NextIndex;
+    int m_NumFrames;
+};
+
+}
+
+#endif
@@ -25,7 +25,6 @@
 #include "../base/Exception.h"
 #include "../base/ObjectCounter.h"
 
-#include "../graphics/Filterfliprgb.h"
 #include "../graphics/BitmapLoader.h"
 #include "../graphics/Bitmap.h"
 #include "../graphics/GLContextManager.h"
@@ -42,6 +41,7 @@ namespace avg {
 
 Image::Image(OGLSurface * pSurface, const MaterialInfo& material)
     : m_sFilename(""),
+      m_MaxDecodeSize(0,0),
       m_pSurface(pSurface),
       m_State(CPU),
       m_Source(NONE),
@@ -110,11 +110,12 @@ void Image::setEmpty()
     assertValid();
 }
 
-void Image::setFilename(const std::string& sFilename, TextureCompression comp)
+void Image::setFilename(const std::string& sFilename, TextureCompression comp,
+        const IntPoint& maxDecodeSize)
 {
     assertValid();
     AVG_TRACE(Logger::category::MEMORY, Logger::severity::INFO, "Loading " << sFilename);
-    BitmapPtr pBmp = loadBitmap(sFilename);
+    BitmapPtr pBmp = loadBitmap(sFilename, NO_PIXELFORMAT, maxDecodeSize);
     if (comp == TEXTURECOMPRESSION_B5G6R5 && pBmp->hasAlpha()) {
         throw Exception(AVG_ERR_UNSUPPORTED, 
                 "B5G6R5-compressed textures with an alpha channel are not supported.");
@@ -123,14 +124,16 @@ void Image::setFilename(const std::string& sFilename, TextureCompression comp)
     m_pBmp = pBmp;
 
     m_sFilename = sFilename;
+    m_MaxDecodeSize = maxDecodeSize;
 
     switch (comp) {
         case TEXTURECOMPRESSION_B5G6R5:
             m_pBmp = BitmapPtr(new Bitmap(pBmp->getSize(), B5G6R5, sFilename));
-            if (!BitmapLoader::get()->isBlueFirst()) {
-                FilterFlipRGB().applyInPlace(pBmp);
+            if (BitmapLoader::get()->isBlueFirst()) {
+                m_pBmp->copyPixels(*pBmp);
+            } else {
+                m_pBmp->copyPixelsSwapRB(*pBmp);
             }
-            m_pBmp->copyPixels(*pBmp);
             break;
         case TEXTURECOMPRESSION_NONE:
             break;
@@ -163,15 +166,16 @@ void Image::setBitmap(BitmapPtr pBmp, TextureCompression comp)
             break;
         case TEXTURECOMPRESSION_B5G6R5:
             pf = B5G6R5;
-            if (!BitmapLoader::get()->isBlueFirst()) {
-                FilterFlipRGB().applyInPlace(pBmp);
-            }
             break;
         default:
             assert(false);
     }
     m_pBmp = BitmapPtr(new Bitmap(pBmp->getSize(), pf, ""));
-    m_pBmp->copyPixels(*pBmp);
+    if (pf == B5G6R5 && !BitmapLoader::get()->isBlueFirst()) {
+        m_pBmp->copyPixelsSwapRB(*pBmp);
+    } else {
+        m_pBmp->copyPixels(*pBmp);
+    }
     if (m_State == GPU) {
         MCTexturePtr pTex = m_pSurface->getTex();
         if (bSourceChanged || m_pSurface->getSize() != m_pBmp->getSize() ||
@@ -212,6 +216,11 @@ const string& Image::getFilename() const
     return m_sFilename;
 }
 
+const IntPoint& Image::getMaxDecodeSize() const
+{
+    return m_MaxDecodeSize;
+}
+
 BitmapPtr Image::getBitmap()
 {
     if (m_Source == NONE || m_Source == SCENE) {
@@ -327,6 +336,7 @@ bool Image::changeSource(Source newSource)
             case BITMAP:
                 m_pBmp = BitmapPtr();
                 m_sFilename = "";
+                m_MaxDecodeSize = IntPoint(0,0);
                 break;
             case SCENE:
                 m_pCanvas = OffscreenCanvasPtr();
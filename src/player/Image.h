@@ -59,13 +59,16 @@ class AVG_API Image
 
         void discard();
         void setEmpty();
+        // See BitmapLoader::load() for maxDecodeSize.
         void setFilename(const std::string& sFilename,
-                TextureCompression comp = TEXTURECOMPRESSION_NONE);
+                TextureCompression comp = TEXTURECOMPRESSION_NONE,
+                const IntPoint& maxDecodeSize = IntPoint(0,0));
         void setBitmap(BitmapPtr pBmp, 
                 TextureCompression comp = TEXTURECOMPRESSION_NONE);
         void setCanvas(OffscreenCanvasPtr pCanvas);
         OffscreenCanvasPtr getCanvas() const;
         const std::string& getFilename() const;
+        const IntPoint& getMaxDecodeSize() const;
 
         BitmapPtr getBitmap();
         IntPoint getSize();
@@ -83,6 +86,7 @@ class AVG_API Image
         void assertValid() const;
 
         std::string m_sFilename;
+        IntPoint m_MaxDecodeSize;
         BitmapPtr m_pBmp;
         OGLSurface * m_pSurface;
         OffscreenCanvasPtr m_pCanvas;
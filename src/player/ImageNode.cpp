@@ -40,6 +40,7 @@
 
 #include <iostream>
 #include <sstream>
+#include <math.h>
 
 using namespace std;
 using namespace boost;
@@ -51,7 +52,11 @@ void ImageNode::registerType()
     TypeDefinition def = TypeDefinition("image", "rasternode", 
             ExportedObject::buildObject<ImageNode>)
         .addArg(Arg<UTF8String>("href", "", false, offsetof(ImageNode, m_href)))
-        .addArg(Arg<string>("compression", "none"));
+        .addArg(Arg<string>("compression", "none"))
+        .addArg(Arg<glm::vec2>("maxdecodesize", glm::vec2(0,0), false,
+                offsetof(ImageNode, m_MaxDecodeSize)))
+        .addArg(Arg<bool>("autodecodesize", false, false, 
+                offsetof(ImageNode, m_bAutoDecodeSize)));
     TypeRegistry::get()->registerType(def);
 }
 
@@ -138,6 +143,32 @@ const string ImageNode::getCompression() const
     return Image::compression2String(m_Compression);
 }
 
+const glm::vec2& ImageNode::getMaxDecodeSize() const
+{
+    return m_MaxDecodeSize;
+}
+
+void ImageNode::setMaxDecodeSize(const glm::vec2& size)
+{
+    m_MaxDecodeSize = size;
+    if (m_pImage->getSource() == Image::FILE) {
+        checkReload();
+    }
+}
+
+bool ImageNode::getAutoDecodeSize() const
+{
+    return m_bAutoDecodeSize;
+}
+
+void ImageNode::setAutoDecodeSize(bool bAuto)
+{
+    m_bAutoDecodeSize = bAuto;
+    if (m_pImage->getSource() == Image::FILE) {
+        checkReload();
+    }
+}
+
 void ImageNode::setBitmap(BitmapPtr pBmp)
 {
     if (m_pImage->getSource() == Image::SCENE && getState() == Node::NS_CANRENDER) {
@@ -198,7 +229,8 @@ void ImageNode::checkReload()
         }
         newSurface();
     } else {
-        bool bNewImage = Node::checkReload(m_href, m_pImage, m_Compression);
+        bool bNewImage = Node::checkReload(m_href, m_pImage, m_Compression,
+                getEffectiveMaxDecodeSize());
         if (bNewImage) {
             newSurface();
         }
@@ -207,6 +239,28 @@ void ImageNode::checkReload()
     RasterNode::checkReload();
 }
 
+void ImageNode::setViewport(float x, float y, float width, float height)
+{
+    RasterNode::setViewport(x, y, width, height);
+    if (m_pImage && m_pImage->getSource() == Image::FILE && m_bAutoDecodeSize &&
+            m_MaxDecodeSize == glm::vec2(0,0))
+    {
+        // If the image was decoded at reduced size and the node has grown beyond
+        // that, decode it again at a higher resolution. A reduced image is at least
+        // as large as the size it was decoded for. Shrinking nodes keep their image.
+        IntPoint lastDecodeSize = m_pImage->getMaxDecodeSize();
+        IntPoint bmpSize = m_pImage->getSize();
+        bool bReduced = lastDecodeSize != IntPoint(0,0) && 
+                bmpSize.x >= lastDecodeSize.x && bmpSize.y >= lastDecodeSize.y;
+        IntPoint decodeSize = getEffectiveMaxDecodeSize();
+        if (bReduced && (decodeSize == IntPoint(0,0) || decodeSize.x > bmpSize.x || 
+                decodeSize.y > bmpSize.y))
+        {
+            checkReload();
+        }
+    }
+}
+
 void ImageNode::getElementsByPos(const glm::vec2& pos, vector<NodePtr>& pElements)
 {
     if (reactsToMouseEvents()) {
@@ -233,6 +287,18 @@ bool ImageNode::isCanvasURL(const std::string& sURL)
     return sURL.find("canvas:") == 0;
 }
 
+IntPoint ImageNode::getEffectiveMaxDecodeSize() const
+{
+    if (m_MaxDecodeSize != glm::vec2(0,0)) {
+        return IntPoint(int(ceil(m_MaxDecodeSize.x)), int(ceil(m_MaxDecodeSize.y)));
+    }
+    glm::vec2 userSize = getUserSize();
+    if (m_bAutoDecodeSize && userSize.x > 0 && userSize.y > 0) {
+        return IntPoint(int(ceil(userSize.x)), int(ceil(userSize.y)));
+    }
+    return IntPoint(0,0);
+}
+
 void ImageNode::checkCanvasValid(const CanvasPtr& pCanvas)
 {
     if (pCanvas == getCanvas()) {
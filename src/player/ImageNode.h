@@ -50,6 +50,10 @@ class AVG_API ImageNode : public RasterNode
         const UTF8String& getHRef() const;
         void setHRef(const UTF8String& href);
         const std::string getCompression() const;
+        const glm::vec2& getMaxDecodeSize() const;
+        void setMaxDecodeSize(const glm::vec2& size);
+        bool getAutoDecodeSize() const;
+        void setAutoDecodeSize(bool bAuto);
         void setBitmap(BitmapPtr pBmp);
         
         virtual void preRender(const VertexArrayPtr& pVA, bool bIsParentActive, 
@@ -60,13 +64,17 @@ class AVG_API ImageNode : public RasterNode
 
         virtual BitmapPtr getBitmap();
         virtual IntPoint getMediaSize();
+        virtual void setViewport(float x, float y, float width, float height);
 
     private:
         bool isCanvasURL(const std::string& sURL);
         void checkCanvasValid(const CanvasPtr& pCanvas);
+        IntPoint getEffectiveMaxDecodeSize() const;
 
         UTF8String m_href;
         Image::TextureCompression m_Compression;
+        glm::vec2 m_MaxDecodeSize;
+        bool m_bAutoDecodeSize;
         ImagePtr m_pImage;
 };
 
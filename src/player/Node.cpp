@@ -469,18 +469,20 @@ void Node::initFilename(string& sFilename)
 }
 
 bool Node::checkReload(const std::string& sHRef, const ImagePtr& pImage,
-        Image::TextureCompression comp)
+        Image::TextureCompression comp, const IntPoint& maxDecodeSize)
 {
     string sLastFilename = pImage->getFilename();
     string sFilename = sHRef;
     initFilename(sFilename);
-    if (sLastFilename != sFilename) {
+    if (sLastFilename != sFilename || 
+            (sHRef != "" && pImage->getMaxDecodeSize() != maxDecodeSize)) 
+    {
         try {
             sFilename = convertUTF8ToFilename(sFilename);
             if (sHRef == "") {
                 pImage->setEmpty();
             } else {
-                pImage->setFilename(sFilename, comp);
+                pImage->setFilename(sFilename, comp, maxDecodeSize);
             }
         } catch (Exception& ex) {
             pImage->setEmpty();
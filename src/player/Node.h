@@ -135,7 +135,8 @@ class AVG_API Node: public Publisher
         void setState(NodeState state);
         void initFilename(std::string& sFilename);
         bool checkReload(const std::string& sHRef, const ImagePtr& pImage,
-                Image::TextureCompression comp = Image::TEXTURECOMPRESSION_NONE);
+                Image::TextureCompression comp = Image::TEXTURECOMPRESSION_NONE,
+                const IntPoint& maxDecodeSize = IntPoint(0,0));
         virtual bool isVisible() const;
         bool getEffectiveActive() const;
         NodePtr getSharedThis();
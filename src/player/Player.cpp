@@ -75,6 +75,7 @@
 #include "../base/ConfigMgr.h"
 #include "../base/XMLHelper.h"
 #include "../base/ScopeTimer.h"
+#include "../base/TimeSource.h"
 #include "../base/WorkerThread.h"
 #include "../base/DAG.h"
 
@@ -82,6 +83,7 @@
 #include "../graphics/ShaderRegistry.h"
 #include "../graphics/Display.h"
 #include "../graphics/GLContextManager.h"
+#include "../graphics/TextureMover.h"
 
 #include "../imaging/Camera.h"
 
@@ -559,6 +561,7 @@ void Player::initPlayback(const std::string& sShaderPath)
 
     m_FrameTime = 0;
     m_NumFrames = 0;
+    m_FrameStats.clear();
 }
 
 bool Player::isPlaying()
@@ -629,6 +632,26 @@ long long Player::getFrameTime()
     return m_FrameTime;
 }
 
+const FrameStats* Player::getFrameStats(int numFrames) const
+{
+    return m_FrameStats.getLastFrames(numFrames);
+}
+
+int Player::getNumFrameStats() const
+{
+    return m_FrameStats.getNumFrames();
+}
+
+FrameStatsSummary Player::getFrameStatsSummary(int numFrames) const
+{
+    return m_FrameStats.getSummary(numFrames);
+}
+
+long long Player::getNumFrameArenaBytes() const
+{
+    return m_FrameArena.getNumBytesAllocated();
+}
+
 float Player::getFrameDuration()
 {
     if (!m_bIsPlaying) {
@@ -1076,8 +1099,21 @@ static ProfilingZoneID EventsProfilingZone("Dispatch events");
 static ProfilingZoneID MainCanvasProfilingZone("Main canvas rendering");
 static ProfilingZoneID OffscreenProfilingZone("Offscreen rendering");
 
+static int getMicrosecsSince(long long& lastTime)
+{
+    long long curTime = TimeSource::get()->getCurrentMicrosecs();
+    int elapsed = int(curTime-lastTime);
+    lastTime = curTime;
+    return elapsed;
+}
+
 void Player::doFrame(bool bFirstFrame)
 {
+    m_CurFrameStats = FrameStats();
+    TimeSource::get()->setFrameStartTime();
+    long long startTime = TimeSource::get()->getFrameStartMicrosecs();
+    long long lastTime = startTime;
+    long long startUploadBytes = TextureMover::getNumBytesUploaded();
     {
         ScopeTimer Timer(MainProfilingZone);
         if (!bFirstFrame) {
@@ -1091,22 +1127,26 @@ void Player::doFrame(bool bFirstFrame)
                 ScopeTimer Timer(TimersProfilingZone);
                 handleTimers();
             }
+            m_CurFrameStats.m_TimersTime = getMicrosecsSince(lastTime);
             {
                 ScopeTimer Timer(EventsProfilingZone);
                 m_pEventDispatcher->dispatch();
                 sendFakeEvents();
                 removeDeadEventCaptures();
             }
+            m_CurFrameStats.m_EventsTime = getMicrosecsSince(lastTime);
         }
         for (unsigned i = 0; i < m_pCanvases.size(); ++i) {
             ScopeTimer Timer(OffscreenProfilingZone);
             dispatchOffscreenRendering(m_pCanvases[i].get());
         }
+        m_CurFrameStats.m_OffscreenTime = getMicrosecsSince(lastTime);
         {
             ScopeTimer Timer(MainCanvasProfilingZone);
             m_pMainCanvas->doFrame(m_bPythonAvailable);
         }
         GLContext::mandatoryCheckError("End of frame");
+        m_CurFrameStats.m_RenderTime = getMicrosecsSince(lastTime);
         if (m_bPythonAvailable) {
             Py_BEGIN_ALLOW_THREADS;
             try {
@@ -1120,6 +1160,15 @@ void Player::doFrame(bool bFirstFrame)
             endFrame();
         }
     }
+    m_CurFrameStats.m_FrameNum = m_NumFrames;
+    m_CurFrameStats.m_StartTime = startTime;
+    m_CurFrameStats.m_TotalTime =
+            int(TimeSource::get()->getCurrentMicrosecs()-startTime);
+    m_CurFrameStats.m_TextureUploadBytes =
+            TextureMover::getNumBytesUploaded()-startUploadBytes;
+    m_CurFrameStats.m_bLate = m_pDisplayEngine->wasFrameLate();
+    m_FrameStats.push(m_CurFrameStats);
+
     ThreadProfiler::get()->reset();
     if (m_NumFrames == 5) {
         ThreadProfiler::get()->restart();
@@ -1128,9 +1177,13 @@ void Player::doFrame(bool bFirstFrame)
 
 void Player::endFrame()
 {
+    long long lastTime = TimeSource::get()->getCurrentMicrosecs();
     m_pDisplayEngine->frameWait();
+    m_CurFrameStats.m_WaitTime = getMicrosecsSince(lastTime);
     m_pDisplayEngine->swapBuffers();
+    m_CurFrameStats.m_SwapTime = getMicrosecsSince(lastTime);
     m_pDisplayEngine->checkJitter();
+    m_FrameArena.reset();
 }
 
 float Player::getFramerate()
@@ -1486,28 +1539,32 @@ void Player::handleCursorEvent(CursorEventPtr pEvent, bool bOnlyCheckCursorOver)
     int cursorID = pEvent->getCursorID();
 
     // Determine the nodes the event should be sent to.
-    vector<NodePtr> pDestNodes = pCursorNodes;
+    FrameArenaAllocator<NodePtr> nodeAllocator(m_FrameArena);
+    FrameVector<NodePtr>::type pDestNodes(pCursorNodes.begin(), pCursorNodes.end(),
+            nodeAllocator);
     if (m_EventCaptureInfoMap.find(cursorID) != m_EventCaptureInfoMap.end()) {
         NodeWeakPtr pEventCaptureNode = 
                 m_EventCaptureInfoMap[cursorID]->m_pNode;
         if (pEventCaptureNode.expired()) {
             m_EventCaptureInfoMap.erase(cursorID);
         } else {
-            pDestNodes = pEventCaptureNode.lock()->getParentChain();
+            vector<NodePtr> pParentChain = pEventCaptureNode.lock()->getParentChain();
+            pDestNodes.assign(pParentChain.begin(), pParentChain.end());
         }
     }
 
-    vector<NodePtr> pLastCursorNodes;
+    FrameVector<NodePtr>::type pLastCursorNodes(nodeAllocator);
     {
         map<int, CursorStatePtr>::iterator it;
         it = m_pLastCursorStates.find(cursorID);
         if (it != m_pLastCursorStates.end()) {
-            pLastCursorNodes = it->second->getNodes();
+            const vector<NodePtr>& pNodes = it->second->getNodes();
+            pLastCursorNodes.assign(pNodes.begin(), pNodes.end());
         }
     }
 
     // Send out events.
-    vector<NodePtr>::const_iterator itLast;
+    FrameVector<NodePtr>::type::const_iterator itLast;
     vector<NodePtr>::iterator itCur;
     for (itLast = pLastCursorNodes.begin(); itLast != pLastCursorNodes.end(); 
             ++itLast)
@@ -1540,7 +1597,7 @@ void Player::handleCursorEvent(CursorEventPtr pEvent, bool bOnlyCheckCursorOver)
 
     if (!bOnlyCheckCursorOver) {
         // Iterate through the nodes and send the event to all of them.
-        vector<NodePtr>::iterator it;
+        FrameVector<NodePtr>::type::iterator it;
         for (it = pDestNodes.begin(); it != pDestNodes.end(); ++it) {
             NodePtr pNode = *it;
             if (pNode->getState() != Node::NS_UNCONNECTED) {
@@ -27,6 +27,9 @@
 #include "DisplayParams.h"
 #include "BoostPython.h"
 #include "Event.h"
+#include "FrameStats.h"
+
+#include "../base/FrameArena.h"
 
 #include "../audio/AudioParams.h"
 #include "../graphics/GLConfig.h"
@@ -136,6 +139,19 @@ class AVG_API Player: public Publisher
         long long getFrameTime();
         float getFrameDuration();
 
+        // Statistics of the last numFrames frames, oldest first. The records are
+        // overwritten as new frames are rendered.
+        const FrameStats* getFrameStats(int numFrames) const;
+        int getNumFrameStats() const;
+        FrameStatsSummary getFrameStatsSummary(int numFrames) const;
+        void addRenderedNode();
+        void addDroppedVideoFrame();
+
+        // Scratch memory for the current frame. Everything allocated from it is
+        // released at the end of the frame.
+        FrameArena& getFrameArena();
+        long long getNumFrameArenaBytes() const;
+
         NodePtr createNode(const std::string& sType, const py::dict& PyDict,
                 const py::object& self=py::object());
         NodePtr createNodeFromXmlString(const std::string& sXML);
@@ -278,6 +294,10 @@ class AVG_API Player: public Publisher
         long long m_PlayStartTime;
         long long m_NumFrames;
 
+        FrameStatsRing m_FrameStats;
+        FrameStats m_CurFrameStats;
+        FrameArena m_FrameArena;
+
         float m_Volume;
 
         bool m_bPythonAvailable;
@@ -308,5 +328,20 @@ class AVG_API Player: public Publisher
         bool m_bMouseEnabled;
 };
 
+inline void Player::addRenderedNode()
+{
+    m_CurFrameStats.m_NumNodesRendered++;
+}
+
+inline void Player::addDroppedVideoFrame()
+{
+    m_CurFrameStats.m_NumVideoFramesDropped++;
+}
+
+inline FrameArena& Player::getFrameArena()
+{
+    return m_FrameArena;
+}
+
 }
 #endif
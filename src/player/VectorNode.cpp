@@ -26,6 +26,7 @@
 #include "OGLSurface.h"
 #include "Image.h"
 #include "Shape.h"
+#include "Player.h"
 
 #include "../base/Exception.h"
 #include "../base/Logger.h"
@@ -172,6 +173,7 @@ void VectorNode::maybeRender(const glm::mat4& parentTransform)
         m_Transform = glm::translate(parentTransform, trans);
         GLContext::getCurrent()->setBlendMode(m_BlendMode);
         render();
+        Player::get()->addRenderedNode();
     }
 }
 
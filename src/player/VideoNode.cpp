@@ -723,6 +723,7 @@ bool VideoNode::renderFrame()
                 m_FramesPlayed++;
                 m_FramesTooLate++;
                 m_FramesInRowTooLate++;
+                Player::get()->addDroppedVideoFrame();
                 float framerate = Player::get()->getEffectiveFramerate();
                 long long frameTime = Player::get()->getFrameTime();
                 if (m_VideoState == Playing) {
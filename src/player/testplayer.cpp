@@ -20,6 +20,8 @@
 //
 
 #include "Player.h"
+#include "FrameStats.h"
+#include "BitmapLoadQueue.h"
 
 #include "../base/TestSuite.h"
 #include "../base/Exception.h"
@@ -77,11 +79,112 @@ public:
     }
 };
 
+class FrameStatsTest: public Test {
+public:
+    FrameStatsTest()
+        : Test("FrameStatsTest", 2)
+    {
+    }
+
+    void runTests() 
+    {
+        TEST(sizeof(FrameStats) == 64);
+        FrameStatsRing ring(4);
+        TEST(ring.getNumFrames() == 0);
+        TEST(ring.getSummary(10).m_NumFrames == 0);
+        for (int i=0; i<6; ++i) {
+            FrameStats stats;
+            stats.m_FrameNum = i;
+            stats.m_TotalTime = 1000*(i+1);
+            stats.m_NumNodesRendered = 2;
+            stats.m_TextureUploadBytes = 100;
+            stats.m_bLate = (i == 5);
+            ring.push(stats);
+        }
+        TEST(ring.getNumFrames() == 4);
+        const FrameStats* pFrames = ring.getLastFrames(4);
+        for (int i=0; i<4; ++i) {
+            TEST(pFrames[i].m_FrameNum == i+2);
+        }
+        TEST(ring.getLastFrames(1)->m_FrameNum == 5);
+        FrameStatsSummary summary = ring.getSummary(2);
+        TEST(summary.m_NumFrames == 2);
+        TEST(summary.m_NumLateFrames == 1);
+        TEST(summary.m_AvgFrameTime == 5500);
+        TEST(summary.m_MaxFrameTime == 6000);
+        TEST(summary.m_AvgNodesRendered == 2);
+        TEST(summary.m_TextureUploadBytes == 200);
+        bool bExceptionThrown = false;
+        try {
+            ring.getLastFrames(5);
+        } catch (Exception&) {
+            bExceptionThrown = true;
+        }
+        TEST(bExceptionThrown);
+        ring.clear();
+        TEST(ring.getNumFrames() == 0);
+    }
+};
+
+class BitmapLoadQueueTest: public Test {
+public:
+    BitmapLoadQueueTest()
+        : Test("BitmapLoadQueueTest", 2)
+    {
+    }
+
+    void runTests() 
+    {
+        BitmapLoadQueue queue;
+        TEST(!queue.pop());
+        vector<BitmapManagerMsgPtr> pMsgs;
+        float priorities[] = {0, 2, 1, 2, 0};
+        for (int i=0; i<5; ++i) {
+            pMsgs.push_back(BitmapManagerMsgPtr(
+                    new BitmapManagerMsg("", NO_PIXELFORMAT)));
+            queue.push(pMsgs[i], priorities[i]);
+        }
+        TEST(queue.size() == 5);
+        TEST(queue.getMaxSize() == 5);
+        // Highest priority first, first come first served within a priority.
+        TEST(queue.pop() == pMsgs[1]);
+        TEST(queue.setPriority(pMsgs[4], 3));
+        TEST(!queue.setPriority(pMsgs[1], 3));
+        TEST(queue.pop() == pMsgs[4]);
+        TEST(queue.remove(pMsgs[3]));
+        TEST(!queue.remove(pMsgs[3]));
+        TEST(queue.pop() == pMsgs[2]);
+        TEST(queue.pop() == pMsgs[0]);
+        TEST(!queue.pop());
+        TEST(queue.size() == 0);
+        TEST(queue.getMaxSize() == 5);
+
+        // Messages keep their place within a priority when they are reprioritized.
+        for (int i=0; i<3; ++i) {
+            queue.push(pMsgs[i], 1);
+        }
+        TEST(queue.setPriority(pMsgs[0], 0));
+        TEST(queue.setPriority(pMsgs[0], 1));
+        TEST(queue.pop() == pMsgs[0]);
+        TEST(queue.pop() == pMsgs[1]);
+        queue.clear();
+        TEST(queue.size() == 0);
+        TEST(!queue.setPriority(pMsgs[2], 1));
+
+        queue.addLatency(1000);
+        queue.addLatency(3000);
+        TEST(queue.getLatencyHistogram().getNumValues() == 2);
+        TEST(queue.getLatencyHistogram().getAvg() == 2000);
+    }
+};
+
 class PlayerTestSuite: public TestSuite {
 public:
     PlayerTestSuite() 
         : TestSuite("PlayerTestSuite")
     {
+        addTest(TestPtr(new FrameStatsTest));
+        addTest(TestPtr(new BitmapLoadQueueTest));
         addTest(TestPtr(new PlayerTest));
     }
 };
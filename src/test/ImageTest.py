@@ -155,6 +155,33 @@ class ImageTestCase(AVGTestCase):
                  lambda: self.compareImage("testImgSize2"),
                 ))
        
+    def testImageDecodeSize(self):
+        root = self.loadEmptyScene()
+        node = avg.ImageNode(href="freidrehen.jpg", maxdecodesize=(40,30), parent=root)
+        self.assertEqual(node.getMediaSize(), (40,30))
+        self.assertEqual(node.size, (40,30))
+        node.maxdecodesize = (50,0)
+        self.assertEqual(node.maxdecodesize, (50,0))
+        self.assertEqual(node.getMediaSize(), (80,60))
+        node.maxdecodesize = (0,0)
+        self.assertEqual(node.getMediaSize(), (160,120))
+        node.maxdecodesize = (64,64)
+        node.href = "checker.png"
+        self.assertEqual(node.getMediaSize(), (64,64))
+
+        node = avg.ImageNode(href="freidrehen.jpg", size=(40,30), autodecodesize=True,
+                parent=root)
+        self.assert_(node.autodecodesize)
+        self.assertEqual(node.getMediaSize(), (40,30))
+        # Growing beyond the decoded resolution loads the image again, shrinking
+        # doesn't.
+        node.size = (60,45)
+        self.assertEqual(node.getMediaSize(), (80,60))
+        node.size = (100,75)
+        self.assertEqual(node.getMediaSize(), (160,120))
+        node.size = (40,30)
+        self.assertEqual(node.getMediaSize(), (160,120))
+
     def testImageWarp(self):
         def createNode(p):
             return avg.ImageNode(pos=p, href="rgb24-32x32.png",
@@ -315,6 +342,142 @@ class ImageTestCase(AVGTestCase):
                  testSubBitmap,
                 ))
 
+    def testBitmapPool(self):
+        avg.trimBitmapPool()
+        stats = avg.getBitmapPoolStats()
+        self.assertEqual(stats.bytesretained, 0)
+        numMisses = stats.nummisses
+        for i in range(10):
+            bmp = avg.Bitmap((64,64), avg.B8G8R8A8, "")
+        del bmp
+        stats = avg.getBitmapPoolStats()
+        self.assert_(stats.numhits > 0)
+        self.assert_(stats.nummisses > numMisses)
+        self.assert_(stats.bytesretained > 0)
+        self.assert_(stats.maxbytesretained >= stats.bytesretained)
+        avg.trimBitmapPool()
+        self.assertEqual(avg.getBitmapPoolStats().bytesretained, 0)
+        maxBytes = stats.maxbytesretained
+        avg.setBitmapPoolMaxBytes(0)
+        bmp = avg.Bitmap((64,64), avg.B8G8R8A8, "")
+        del bmp
+        self.assertEqual(avg.getBitmapPoolStats().bytesretained, 0)
+        avg.setBitmapPoolMaxBytes(maxBytes)
+
+    def testBitmapCache(self):
+        avg.invalidateBitmapCache()
+        stats = avg.getBitmapCacheStats()
+        self.assertEqual(stats.numbitmaps, 0)
+        self.assertEqual(stats.bytesused, 0)
+        numHits = stats.numhits
+        bmp1 = avg.Bitmap("media/rgb24-65x65.png")
+        bmp2 = avg.Bitmap("media/rgb24-65x65.png")
+        stats = avg.getBitmapCacheStats()
+        self.assertEqual(stats.numhits, numHits+1)
+        self.assertEqual(stats.numbitmaps, 1)
+        self.assert_(stats.bytesused > 0)
+        self.assert_(self.areSimilarBmps(bmp1, bmp2, 0, 0))
+        # Changes to a loaded bitmap don't affect the cache.
+        bmp1.setPixels(bytearray(65*65*4))
+        self.assert_(not(self.areSimilarBmps(bmp1, bmp2, 0, 0)))
+        bmp3 = avg.Bitmap("media/rgb24-65x65.png")
+        self.assert_(self.areSimilarBmps(bmp2, bmp3, 0, 0))
+
+        avg.invalidateBitmapCache("media/rgb24-65x65.png")
+        self.assertEqual(avg.getBitmapCacheStats().numbitmaps, 0)
+        maxBytes = stats.maxbytes
+        avg.setBitmapCacheMaxBytes(0)
+        bmp1 = avg.Bitmap("media/rgb24-65x65.png")
+        self.assertEqual(avg.getBitmapCacheStats().numbitmaps, 0)
+        avg.setBitmapCacheMaxBytes(maxBytes)
+
+    def testPrecompiledImage(self):
+        import tempfile
+        fileName = os.path.join(tempfile.gettempdir(), "precompiled.avgimg")
+        origBmp = avg.Bitmap("media/rgb24alpha-64x64.png")
+        avg.savePrecompiledImage(origBmp, fileName, mipmaps=True)
+        try:
+            bmp = avg.Bitmap(fileName)
+            self.assertEqual(bmp.getFormat(), origBmp.getFormat())
+            self.assert_(self.areSimilarBmps(bmp, origBmp, 0, 0))
+            root = self.loadEmptyScene()
+            # The smallest stored level that is large enough is used.
+            node = avg.ImageNode(href=fileName, maxdecodesize=(20,20), parent=root)
+            self.assertEqual(node.getMediaSize(), (32,32))
+            node.maxdecodesize = (0,0)
+            self.assertEqual(node.getMediaSize(), (64,64))
+        finally:
+            os.remove(fileName)
+        # Mipmaps need 8 bit channels.
+        self.assertRaises(RuntimeError, lambda: avg.savePrecompiledImage(
+                avg.Bitmap((4,4), avg.I16, ""), fileName, True))
+
+    def testImageStats(self):
+        bmp = avg.Bitmap((4,2), avg.I8, "")
+        bmp.setPixels(bytearray([0, 10, 20, 30, 40, 50, 60, 250]))
+        stats = avg.ImageStats(bmp)
+        self.assertEqual(stats.getNumChannels(), 1)
+        self.assertEqual(stats.getNumPixels(), 8)
+        self.assertEqual(stats.getMin(), 0)
+        self.assertEqual(stats.getMax(), 250)
+        self.assertAlmostEqual(stats.getAvg(), 57.5)
+        self.assertAlmostEqual(stats.getStdDev(), bmp.getStdDev(), 3)
+        histogram = stats.getHistogram()
+        self.assertEqual(len(histogram), 256)
+        self.assertEqual(histogram[250], 1)
+        self.assertEqual(sum(histogram), 8)
+
+        stats = avg.ImageStats(bmp, 2)
+        self.assertEqual(stats.getNumPixels(), 2)
+        self.assertAlmostEqual(stats.getAvg(), 10)
+        stats = avg.ImageStats(bmp, (1,0), (3,2))
+        self.assertEqual(stats.getNumPixels(), 4)
+        self.assertAlmostEqual(stats.getAvg(), 35)
+        self.assertEqual(stats.getMax(), 60)
+        stats = avg.ImageStats(bmp, (1,0), (3,2), 2)
+        self.assertEqual(stats.getNumPixels(), 1)
+        self.assertRaises(RuntimeError, lambda: avg.ImageStats(bmp, (0,0), (5,2)))
+
+        bmp = avg.Bitmap('media/rgb24-65x65.png')
+        stats = avg.ImageStats(bmp)
+        self.assertEqual(stats.getNumChannels(), 4)
+        for channel in range(3):
+            self.assertAlmostEqual(stats.getChannelAvg(channel),
+                    bmp.getChannelAvg(channel), 3)
+        self.assertAlmostEqual(stats.getAvg(), bmp.getAvg(), 3)
+        self.assertRaises(RuntimeError, lambda: stats.getMin(4))
+
+    def testImageCompare(self):
+        bmp1 = avg.Bitmap((4,2), avg.I8, "")
+        bmp1.setPixels(bytearray([0, 10, 20, 30, 40, 50, 60, 250]))
+        bmp2 = avg.Bitmap((4,2), avg.I8, "")
+        bmp2.setPixels(bytearray([0, 12, 20, 30, 40, 50, 60, 200]))
+        comparison = avg.ImageCompare(bmp1, bmp2)
+        self.assertEqual(comparison.getNumChannels(), 1)
+        self.assertEqual(comparison.getMaxDiff(0), 50)
+        self.assertAlmostEqual(comparison.getMeanError(0), 6.5)
+        self.assertEqual(comparison.getNumMismatches(), 2)
+        diffBmp = bmp1.subtract(bmp2)
+        self.assertAlmostEqual(comparison.getAvg(), diffBmp.getAvg(), 3)
+        self.assertAlmostEqual(comparison.getStdDev(), diffBmp.getStdDev(), 3)
+        self.assertRaises(RuntimeError, comparison.getMismatchMask)
+
+        comparison = avg.ImageCompare(bmp1, bmp2, 2, True)
+        self.assertEqual(comparison.getNumMismatches(), 1)
+        mask = comparison.getMismatchMask()
+        self.assertEqual(mask.getPixel((3,1)), (255,255,255,255))
+        self.assertEqual(mask.getPixel((1,0)), (0,0,0,255))
+
+        self.assert_(avg.ImageCompare.isSimilar(bmp1, bmp1, 0, 0))
+        self.assert_(not(avg.ImageCompare.isSimilar(bmp1, bmp2, 1, 10)))
+        comparisons = avg.ImageCompare.compareAll([bmp1, bmp2], [bmp2, bmp2], 2)
+        self.assertEqual(len(comparisons), 2)
+        self.assertEqual(comparisons[0].getNumMismatches(), 1)
+        self.assertEqual(comparisons[1].getNumMismatches(), 0)
+
+        bmp = avg.Bitmap('media/rgb24-65x65.png')
+        self.assertRaises(RuntimeError, lambda: avg.ImageCompare(bmp, bmp1))
+
     def testBitmapManager(self):
         WAIT_TIMEOUT = 2000
         def expectException(returnValue, nextAction):
@@ -374,6 +537,52 @@ class ImageTestCase(AVGTestCase):
             player.play()
         avg.BitmapManager.get().setNumThreads(1)
         
+    def testBitmapManagerRequests(self):
+        def onLoaded(bmp):
+            self.assert_(not isinstance(bmp, Exception))
+            self.loadedBmps.append(bmp)
+            if len(self.loadedBmps) == 2:
+                player.setTimeout(0, checkResults)
+
+        def onCanceledLoaded(bmp):
+            raise RuntimeError("Canceled BitmapManager request got a callback")
+
+        def checkResults():
+            self.assert_(not(request1.pending) and not(request2.pending))
+            self.assert_(self.areSimilarBmps(self.loadedBmps[0], self.loadedBmps[1],
+                    0, 0))
+            stats = manager.getStats()
+            self.assertEqual(stats.numloads-oldStats.numloads, 1)
+            self.assertEqual(stats.queuedepth, 0)
+            self.assert_(stats.maxqueuedepth >= 1)
+            self.assert_(stats.avglatency > 0)
+            player.stop()
+
+        def reportStuck():
+            raise RuntimeError("BitmapManager didn't reply within 2000ms timeout")
+
+        self.loadEmptyScene()
+        self.loadedBmps = []
+        manager = avg.BitmapManager.get()
+        oldStats = manager.getStats()
+        # Requests for the same file share one load.
+        fileName = "media/rgb24-65x65.png"
+        request1 = manager.loadBitmap(fileName, onLoaded, priority=1)
+        request2 = manager.loadBitmap(fileName, onLoaded)
+        request3 = manager.loadBitmap(fileName, onCanceledLoaded)
+        request3.cancel()
+        self.assert_(request1.pending and not(request3.pending))
+        self.assertEqual(request1.filename, fileName)
+        self.assertEqual(request1.priority, 1)
+        request2.priority = 5
+        self.assertEqual(request2.priority, 5)
+        stats = manager.getStats()
+        self.assertEqual(stats.numrequests-oldStats.numrequests, 3)
+        self.assertEqual(stats.numcoalescedrequests-oldStats.numcoalescedrequests, 2)
+        self.assertEqual(stats.numcanceledrequests-oldStats.numcanceledrequests, 1)
+        player.setTimeout(2000, reportStuck)
+        player.play()
+
     def testBitmapManagerException(self):
         def bitmapCb(bitmap):
             raise RuntimeError
@@ -607,9 +816,16 @@ def imageTestSuite(tests):
             "testImageHRef",
             "testImagePos",
             "testImageSize",
+            "testImageDecodeSize",
             "testImageWarp",
             "testBitmap",
+            "testBitmapPool",
+            "testBitmapCache",
+            "testPrecompiledImage",
+            "testImageStats",
+            "testImageCompare",
             "testBitmapManager",
+            "testBitmapManagerRequests",
             "testBitmapManagerException",
             "testBlendMode",
             "testImageMask",
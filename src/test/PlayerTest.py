@@ -21,6 +21,10 @@
 
 import math
 import threading
+import os
+import json
+import struct
+import tempfile
 
 from libavg import avg, player
 from testcase import *
@@ -821,6 +825,95 @@ class PlayerTestCase(AVGTestCase):
         self.assertRaises(RuntimeError, lambda: avg.validateXml(brokenXml, schema,
                 "shiporder.xml", "shiporder.xsd"))
 
+    def testTracing(self):
+        def startTracing():
+            self.assert_(not(avg.isTracing()))
+            avg.startTracing(self.__traceFilename)
+            self.assert_(avg.isTracing())
+            self.assertRaises(RuntimeError, lambda: 
+                    avg.startTracing(self.__traceFilename))
+
+        def stopTracing():
+            avg.stopTracing()
+            self.assert_(not(avg.isTracing()))
+
+        def checkTrace():
+            traceFile = open(self.__traceFilename)
+            events = json.load(traceFile)["traceEvents"]
+            traceFile.close()
+            os.remove(self.__traceFilename)
+            threadNames = [event["args"]["name"] for event in events
+                    if event["ph"] == "M"]
+            self.assert_("main" in threadNames)
+            numBegins = len([event for event in events if event["ph"] == "B"])
+            numEnds = len([event for event in events if event["ph"] == "E"])
+            self.assert_(numBegins > 0)
+            self.assert_(abs(numBegins-numEnds) < 10)
+            self.assertEqual(avg.getNumDroppedTraceEvents(), 0)
+
+        (fd, self.__traceFilename) = tempfile.mkstemp(suffix=".json")
+        os.close(fd)
+        self.__initDefaultScene()
+        self.start(False,
+                (startTracing,
+                 None,
+                 None,
+                 stopTracing,
+                 checkTrace,
+                ))
+
+    def testProfilingZoneStats(self):
+        def checkStats():
+            stats = avg.getProfilingZoneStats()
+            frameStats = [zone for zone in stats 
+                    if zone.name == "Player - Total frame time"]
+            self.assertEqual(len(frameStats), 1)
+            zone = frameStats[0]
+            self.assert_(zone.numframes > 0)
+            self.assert_(zone.p50 <= zone.p95 <= zone.p99 <= zone.max)
+            avg.enableProfilingZoneStats(False)
+
+        avg.enableProfilingZoneStats(True)
+        self.__initDefaultScene()
+        self.start(False, [None]*8 + [checkStats])
+
+    def testFrameStats(self):
+        def checkStats():
+            self.assert_(player.getNumFrameStats() >= 5)
+            fmt = avg.Player.FRAME_STATS_FORMAT
+            recordSize = struct.calcsize(fmt)
+            self.assertEqual(recordSize, 64)
+            buf = player.getFrameStats(5)
+            self.assertEqual(len(buf), 5*recordSize)
+            records = [struct.unpack_from(fmt, buf, i*recordSize) for i in range(5)]
+            frameNums = [record[0] for record in records]
+            self.assertEqual(frameNums, range(frameNums[0], frameNums[0]+5))
+            for record in records:
+                # Total frame time covers all phases and nodes were rendered.
+                self.assert_(record[3] >= record[7])
+                self.assert_(record[11] > 0)
+            summary = player.getFrameStatsSummary(5)
+            self.assertEqual(summary.numframes, 5)
+            self.assert_(summary.maxframetime >= summary.avgframetime)
+            self.assert_(summary.avgnodesrendered > 0)
+            self.assertRaises(RuntimeError,
+                    lambda: player.getFrameStats(player.getNumFrameStats()+1))
+
+        self.__initDefaultScene()
+        self.start(False, [None]*8 + [checkStats])
+
+    def testFrameArena(self):
+        def checkArenaUsed():
+            self.assert_(player.getNumFrameArenaBytes() > startBytes)
+
+        self.__initDefaultScene()
+        startBytes = player.getNumFrameArenaBytes()
+        self.start(False,
+                (lambda: self.fakeClick(10, 10),
+                 lambda: self._sendMouseEvent(avg.Event.CURSOR_MOTION, 20, 20),
+                 checkArenaUsed,
+                ))
+
     # Not executed due to bug #145 - hangs with some window managers.
     def testWindowFrame(self):
         def revertWindowFrame():
@@ -888,6 +981,10 @@ def playerTestSuite(tests):
             "testSVG",
             "testGetConfigOption",
             "testValidateXml",
+            "testTracing",
+            "testProfilingZoneStats",
+            "testFrameStats",
+            "testFrameArena",
 #            "testWindowFrame",
             )
     return createAVGTestSuite(availableTests, PlayerTestCase, tests)
@@ -159,6 +159,34 @@ class AVGTestCase(unittest.TestCase):
             bmp.save(AVGTestCase.getImageResultDir()+"/"+fileName+".png")
             self.__logger.warning("Could not load image "+fileName+".png")
             raise
+        if not(avg.ImageCompare.isPixelFormatSupported(bmp.getFormat())):
+            self.__compareBitmapBySubtraction(bmp, baselineBmp, fileName)
+            return
+        comparison = avg.ImageCompare(bmp, baselineBmp)
+        average = comparison.getAvg()
+        stdDev = comparison.getStdDev()
+        if (average > 0.1 or stdDev > 0.5):
+            if self._isCurrentDirWriteable():
+                bmp.save(AVGTestCase.getImageResultDir() + "/" + fileName + ".png")
+                baselineBmp.save(AVGTestCase.getImageResultDir() + "/" + fileName
+                        + "_baseline.png")
+                diffBmp = bmp.subtract(baselineBmp)
+                diffBmp.save(AVGTestCase.getImageResultDir() + "/" + fileName
+                        + "_diff.png")
+        if (average > 2 or stdDev > 6):
+            maxDiffs = [comparison.getMaxDiff(i)
+                    for i in range(comparison.getNumChannels())]
+            msg = ("  "+fileName+
+                    ": Difference image has avg=%(avg).2f, std dev=%(stddev).2f, "
+                    "max. channel differences=%(maxdiffs)s, differing pixels=%(num)i"%
+                    {'avg':average, 'stddev':stdDev, 'maxdiffs':maxDiffs,
+                     'num':comparison.getNumMismatches()})
+            if self.__warnOnImageDiff:
+                sys.stderr.write("\n"+msg+"\n")
+            else:
+                self.fail(msg)
+
+    def __compareBitmapBySubtraction(self, bmp, baselineBmp, fileName):
         diffBmp = bmp.subtract(baselineBmp)
         average = diffBmp.getAvg()
         stdDev = diffBmp.getStdDev()
@@ -179,10 +207,10 @@ class AVGTestCase(unittest.TestCase):
                 self.fail(msg)
 
     def areSimilarBmps(self, bmp1, bmp2, maxAvg, maxStdDev):
-        diffBmp = bmp1.subtract(bmp2)
-        avg = diffBmp.getAvg()
-        stdDev = diffBmp.getStdDev()
-        return avg <= maxAvg and stdDev <= maxStdDev
+        if not(avg.ImageCompare.isPixelFormatSupported(bmp1.getFormat())):
+            diffBmp = bmp1.subtract(bmp2)
+            return diffBmp.getAvg() <= maxAvg and diffBmp.getStdDev() <= maxStdDev
+        return avg.ImageCompare.isSimilar(bmp1, bmp2, maxAvg, maxStdDev)
 
     def assertAlmostEqual(self, a, b, epsilon=0.00001):
         if not(almostEqual(a, b, epsilon)):
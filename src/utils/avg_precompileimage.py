@@ -0,0 +1,55 @@
+#!/usr/bin/env python
+# -*- coding: utf-8 -*-
+#
+# libavg - Media Playback Engine.
+# Copyright (C) 2003-2014 Ulrich von Zadow
+#
+# This library is free software; you can redistribute it and/or
+# modify it under the terms of the GNU Lesser General Public
+# License as published by the Free Software Foundation; either
+# version 2 of the License, or (at your option) any later version.
+#
+# This library is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+# Lesser General Public License for more details.
+#
+# You should have received a copy of the GNU Lesser General Public
+# License along with this library; if not, write to the Free Software
+# Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+#
+# Current versions can be found at www.libavg.de
+#
+
+from optparse import OptionParser
+import os
+import sys
+from libavg import avg
+
+parser = OptionParser(usage="%prog <imagefile> [<outfile>] [options]",
+        description="Converts an image to a precompiled image that libavg can load "
+        "without decoding. The default output file name is the input file name with "
+        "the extension replaced by .avgimg.")
+parser.add_option("-m", "--mipmaps", dest="mipmaps", action="store_true",
+        default=False, help="Store mipmap levels for loading at reduced size")
+options, args = parser.parse_args()
+
+if len(args) < 1 or len(args) > 2:
+    parser.print_help()
+    sys.exit(1)
+
+inFile = args[0]
+if len(args) == 2:
+    outFile = args[1]
+else:
+    outFile = os.path.splitext(inFile)[0] + ".avgimg"
+
+try:
+    bmp = avg.Bitmap(inFile)
+    avg.savePrecompiledImage(bmp, outFile, options.mipmaps)
+except RuntimeError, err:
+    sys.stderr.write(str(err) + "\n")
+    sys.exit(1)
+
+print "%s: %dx%d, %s -> %s" % (inFile, bmp.getSize().x, bmp.getSize().y,
+        bmp.getFormat(), outFile)
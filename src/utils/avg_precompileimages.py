@@ -0,0 +1,85 @@
+#!/usr/bin/env python
+# -*- coding: utf-8 -*-
+#
+# libavg - Media Playback Engine.
+# Copyright (C) 2003-2014 Ulrich von Zadow
+#
+# This library is free software; you can redistribute it and/or
+# modify it under the terms of the GNU Lesser General Public
+# License as published by the Free Software Foundation; either
+# version 2 of the License, or (at your option) any later version.
+#
+# This library is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+# Lesser General Public License for more details.
+#
+# You should have received a copy of the GNU Lesser General Public
+# License along with this library; if not, write to the Free Software
+# Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+#
+# Current versions can be found at www.libavg.de
+#
+
+from optparse import OptionParser
+import os
+import sys
+from libavg import avg
+
+IMAGE_EXTENSIONS = (".png", ".jpg", ".jpeg", ".webp", ".gif", ".tif", ".tiff", ".bmp")
+
+parser = OptionParser(usage="%prog <directory> [options]",
+        description="Converts all images in a directory and its subdirectories to "
+        "precompiled images that libavg can load without decoding. Images that "
+        "are older than their precompiled versions are skipped.")
+parser.add_option("-o", "--outdir", dest="outdir",
+        help="Write the precompiled images to this directory instead of next to the "
+        "originals. The directory structure is preserved.")
+parser.add_option("-m", "--mipmaps", dest="mipmaps", action="store_true",
+        default=False, help="Store mipmap levels for loading at reduced size")
+parser.add_option("-f", "--force", dest="force", action="store_true",
+        default=False, help="Convert all images, even if they are up to date")
+options, args = parser.parse_args()
+
+if len(args) != 1 or not os.path.isdir(args[0]):
+    parser.print_help()
+    sys.exit(1)
+
+def isUpToDate(inFile, outFile):
+    return (os.path.exists(outFile) and 
+            os.path.getmtime(outFile) >= os.path.getmtime(inFile))
+
+def precompile(inFile, outFile):
+    if not(options.force) and isUpToDate(inFile, outFile):
+        return True
+    outDir = os.path.dirname(outFile)
+    if outDir and not(os.path.isdir(outDir)):
+        os.makedirs(outDir)
+    try:
+        bmp = avg.Bitmap(inFile)
+        avg.savePrecompiledImage(bmp, outFile, options.mipmaps)
+    except RuntimeError, err:
+        sys.stderr.write(str(err) + "\n")
+        return False
+    print "%s -> %s" % (inFile, outFile)
+    return True
+
+srcDir = args[0]
+numErrors = 0
+for dirPath, dirNames, fileNames in os.walk(srcDir):
+    for fileName in sorted(fileNames):
+        baseName, ext = os.path.splitext(fileName)
+        if ext.lower() not in IMAGE_EXTENSIONS:
+            continue
+        inFile = os.path.join(dirPath, fileName)
+        if options.outdir:
+            outDir = os.path.join(options.outdir, os.path.relpath(dirPath, srcDir))
+        else:
+            outDir = dirPath
+        outFile = os.path.normpath(os.path.join(outDir, baseName + ".avgimg"))
+        if not(precompile(inFile, outFile)):
+            numErrors += 1
+
+if numErrors > 0:
+    sys.stderr.write("%d image(s) could not be converted.\n" % numErrors)
+    sys.exit(1)
@@ -141,8 +141,10 @@ void FFMpegFrameDecoder::convertFrameToBmp(AVFrame* pFrame, BitmapPtr pBmp)
             destFmt = PIX_FMT_BGRA;
     }
     AVCodecContext const* pContext = m_pStream->codec;
-    if (destFmt == PIX_FMT_BGRA && (pContext->pix_fmt == PIX_FMT_YUV420P || 
-                pContext->pix_fmt == PIX_FMT_YUVJ420P))
+    AVPixelFormat srcFmt = pContext->pix_fmt;
+    bool bChroma422 = (srcFmt == PIX_FMT_YUV422P || srcFmt == PIX_FMT_YUVJ422P);
+    if (destFmt == PIX_FMT_BGRA && (srcFmt == PIX_FMT_YUV420P || 
+                srcFmt == PIX_FMT_YUVJ420P || bChroma422))
     {
         ScopeTimer timer(ConvertImageLibavgProfilingZone);
         BitmapPtr pBmpY(new Bitmap(pBmp->getSize(), I8, pFrame->data[0],
@@ -151,8 +153,8 @@ void FFMpegFrameDecoder::convertFrameToBmp(AVFrame* pFrame, BitmapPtr pBmp)
                 pFrame->linesize[1], false));
         BitmapPtr pBmpV(new Bitmap(pBmp->getSize(), I8, pFrame->data[2],
                 pFrame->linesize[2], false));
-        pBmp->copyYUVPixels(*pBmpY, *pBmpU, *pBmpV, 
-                pContext->pix_fmt == PIX_FMT_YUVJ420P);
+        bool bJPEG = (srcFmt == PIX_FMT_YUVJ420P || srcFmt == PIX_FMT_YUVJ422P);
+        pBmp->copyYUVPixels(*pBmpY, *pBmpU, *pBmpV, bJPEG, bChroma422);
     } else {
         if (!m_pSwsContext) {
             m_pSwsContext = sws_getContext(pContext->width, pContext->height, 
@@ -23,7 +23,7 @@
 #define _VideoMsg_H_
 
 #include "../api.h"
-#include "../base/Queue.h"
+#include "../base/LockFreeQueue.h"
 
 #include "../audio/AudioMsg.h"
 
@@ -67,7 +67,7 @@ private:
 };
 
 typedef boost::shared_ptr<VideoMsg> VideoMsgPtr;
-typedef Queue<VideoMsg> VideoMsgQueue;
+typedef MsgQueue<VideoMsg>::type VideoMsgQueue;
 typedef boost::shared_ptr<VideoMsgQueue> VideoMsgQueuePtr;
 
 }
@@ -31,6 +31,9 @@ void export_anim();
 #include "../base/OSHelper.h"
 #include "../base/GeomHelper.h"
 #include "../base/XMLHelper.h"
+#include "../base/TraceRecorder.h"
+#include "../base/ThreadProfiler.h"
+#include "../base/ProfilingZone.h"
 #include "../player/Player.h"
 #include "../player/AVGNode.h"
 #include "../player/CameraNode.h"
@@ -88,6 +91,51 @@ size_t getMemoryUsageDeprecated() {
     return getMemoryUsage();
 }
 
+void startTracing(const std::string& sFilename)
+{
+    TraceRecorder::get()->start(sFilename);
+}
+
+void startTracingWithBufferSize(const std::string& sFilename, int eventsPerThread)
+{
+    TraceRecorder::get()->start(sFilename, eventsPerThread);
+}
+
+void flushTracing()
+{
+    TraceRecorder::get()->flush();
+}
+
+void stopTracing()
+{
+    TraceRecorder::get()->stop();
+}
+
+int getNumDroppedTraceEvents()
+{
+    return TraceRecorder::get()->getNumDroppedEvents();
+}
+
+vector<ProfilingZoneStats> getProfilingZoneStats()
+{
+    return ThreadProfiler::get()->getZoneStats();
+}
+
+bp::object Player_getFrameStats(Player& player, int numFrames)
+{
+    // Returns a read-only view of the records in the frame statistics ring. The data
+    // isn't copied, so the contents change with every frame rendered.
+    const FrameStats* pFrames = player.getFrameStats(numFrames);
+    int buffSize = numFrames*sizeof(FrameStats);
+#if PY_MAJOR_VERSION < 3
+    return bp::object(handle<>(PyBuffer_FromMemory((void*)pFrames, buffSize)));
+#else
+    PyObject* py_memView = PyMemoryView_FromMemory((char*)pFrames, buffSize,
+            PyBUF_READ);
+    return bp::object(handle<>(py_memView));
+#endif
+}
+
 bool pointInPolygonDepcrecated(const glm::vec2& pt, const std::vector<glm::vec2>& poly) {
     avgDeprecationWarning("1.9.0", "avg.pointInPolygon", "Point2D.isInPolygon");
     return pointInPolygon(pt, poly);
@@ -118,6 +166,39 @@ BOOST_PYTHON_MODULE(avg)
 
         def("validateXml", validateXml);
 
+        def("startTracing", startTracing);
+        def("startTracing", startTracingWithBufferSize);
+        def("flushTracing", flushTracing);
+        def("stopTracing", stopTracing);
+        def("isTracing", &TraceRecorder::isRecording);
+        def("getNumDroppedTraceEvents", getNumDroppedTraceEvents);
+
+        class_<ProfilingZoneStats>("ProfilingZoneStats", no_init)
+            .def_readonly("name", &ProfilingZoneStats::m_sName)
+            .def_readonly("numframes", &ProfilingZoneStats::m_NumFrames)
+            .def_readonly("avg", &ProfilingZoneStats::m_AvgTime)
+            .def_readonly("p50", &ProfilingZoneStats::m_P50Time)
+            .def_readonly("p95", &ProfilingZoneStats::m_P95Time)
+            .def_readonly("p99", &ProfilingZoneStats::m_P99Time)
+            .def_readonly("max", &ProfilingZoneStats::m_MaxTime)
+        ;
+        to_python_converter<vector<ProfilingZoneStats>, 
+                to_list<vector<ProfilingZoneStats> > >();
+        def("enableProfilingZoneStats", &ThreadProfiler::enableZoneStats);
+        def("getProfilingZoneStats", getProfilingZoneStats);
+
+        class_<FrameStatsSummary>("FrameStatsSummary", no_init)
+            .def_readonly("numframes", &FrameStatsSummary::m_NumFrames)
+            .def_readonly("numlateframes", &FrameStatsSummary::m_NumLateFrames)
+            .def_readonly("avgframetime", &FrameStatsSummary::m_AvgFrameTime)
+            .def_readonly("maxframetime", &FrameStatsSummary::m_MaxFrameTime)
+            .def_readonly("avgrendertime", &FrameStatsSummary::m_AvgRenderTime)
+            .def_readonly("avgnodesrendered", &FrameStatsSummary::m_AvgNodesRendered)
+            .def_readonly("textureuploadbytes", &FrameStatsSummary::m_TextureUploadBytes)
+            .def_readonly("numvideoframesdropped",
+                    &FrameStatsSummary::m_NumVideoFramesDropped)
+        ;
+
         class_<MessageID>("MessageID", no_init)
             .def("__repr__", &MessageID::getRepr)
         ;
@@ -255,6 +336,10 @@ BOOST_PYTHON_MODULE(avg)
             .def("setFakeFPS", &Player::setFakeFPS)
             .def("getFrameTime", &Player::getFrameTime)
             .def("getFrameDuration", &Player::getFrameDuration)
+            .def("getFrameStats", Player_getFrameStats)
+            .def("getNumFrameStats", &Player::getNumFrameStats)
+            .def("getFrameStatsSummary", &Player::getFrameStatsSummary)
+            .def("getNumFrameArenaBytes", &Player::getNumFrameArenaBytes)
             .def("createNode", &Player::createNodeFromXmlString)
             .def("createNode", &Player::createNode, Player_createNode_overloads())
             .def("enableMultitouch", &Player::enableMultitouch)
@@ -294,6 +379,7 @@ BOOST_PYTHON_MODULE(avg)
             .add_property("pluginPath", &Player::getPluginPath, &Player::setPluginPath)
             .add_property("volume", &Player::getVolume, &Player::setVolume)
         ;
+        playerClass.attr("FRAME_STATS_FORMAT") = FrameStats::FORMAT;
         exportMessages(playerClass, "Player");
         
         class_<Canvas, boost::shared_ptr<Canvas>, bases<ExportedObject>, 
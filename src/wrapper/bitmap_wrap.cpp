@@ -26,6 +26,11 @@
 
 #include "../graphics/Bitmap.h"
 #include "../graphics/BitmapLoader.h"
+#include "../graphics/BitmapPool.h"
+#include "../graphics/BitmapCache.h"
+#include "../graphics/ImageContainer.h"
+#include "../graphics/ImageStats.h"
+#include "../graphics/ImageCompare.h"
 #include "../graphics/FilterResizeBilinear.h"
 
 #include "../base/CubicSpline.h"
@@ -178,8 +183,106 @@ BitmapPtr createBitmapWithRect(BitmapPtr pBmp,
     return BitmapPtr(new Bitmap(*pBmp, rect));
 }
 
-BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(loadBitmap_overloads, BitmapManager::loadBitmapPy, 
-        2, 3);
+BitmapPoolStats BitmapPool_getStats()
+{
+    return BitmapPool::get()->getStats();
+}
+
+void BitmapPool_setMaxBytesRetained(size_t numBytes)
+{
+    BitmapPool::get()->setMaxBytesRetained(numBytes);
+}
+
+void BitmapPool_trim()
+{
+    BitmapPool::get()->trim();
+}
+
+BitmapCacheStats BitmapCache_getStats()
+{
+    return BitmapCache::get()->getStats();
+}
+
+void BitmapCache_setMaxBytes(size_t numBytes)
+{
+    BitmapCache::get()->setMaxBytes(numBytes);
+}
+
+void BitmapCache_invalidate(const bp::object& filename)
+{
+    if (filename.ptr() == Py_None) {
+        BitmapCache::get()->clear();
+    } else {
+        UTF8String sFilename = bp::extract<UTF8String>(filename);
+        BitmapCache::get()->invalidate(sFilename);
+    }
+}
+
+void ImageContainer_save(BitmapPtr pBmp, const UTF8String& sFilename, bool bMipmaps)
+{
+    ImageContainer::save(sFilename, pBmp, bMipmaps);
+}
+
+ImageStats* createImageStats(BitmapPtr pBmp)
+{
+    return new ImageStats(*pBmp);
+}
+
+ImageStats* createImageStatsWithStride(BitmapPtr pBmp, int stride)
+{
+    return new ImageStats(*pBmp, stride);
+}
+
+ImageStats* createImageStatsWithRectAndStride(BitmapPtr pBmp, const glm::vec2& tlPos,
+        const glm::vec2& brPos, int stride)
+{
+    return new ImageStats(*pBmp, IntRect(IntPoint(tlPos), IntPoint(brPos)), stride);
+}
+
+ImageStats* createImageStatsWithRect(BitmapPtr pBmp, const glm::vec2& tlPos,
+        const glm::vec2& brPos)
+{
+    return createImageStatsWithRectAndStride(pBmp, tlPos, brPos, 1);
+}
+
+bp::list ImageStats_getHistogram(ImageStats& stats, int channel=0)
+{
+    HistogramPtr pHist = stats.getHistogram(channel);
+    bp::list hist;
+    for (Histogram::iterator it = pHist->begin(); it != pHist->end(); ++it) {
+        hist.append(*it);
+    }
+    return hist;
+}
+
+BOOST_PYTHON_FUNCTION_OVERLOADS(ImageStats_getHistogram_overloads,
+        ImageStats_getHistogram, 1, 2);
+BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(ImageStats_getMin_overloads, getMin, 0, 1);
+BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(ImageStats_getMax_overloads, getMax, 0, 1);
+
+vector<BitmapPtr> extractBitmaps(const bp::list& bmps)
+{
+    vector<BitmapPtr> pBmps;
+    for (int i = 0; i < bp::len(bmps); ++i) {
+        pBmps.push_back(bp::extract<BitmapPtr>(bmps[i]));
+    }
+    return pBmps;
+}
+
+bp::list ImageCompare_compareAll(const bp::list& bmps1, const bp::list& bmps2,
+        int tolerance=0, bool bCreateMismatchMasks=false)
+{
+    vector<ImageComparePtr> pResults = ImageCompare::compareAll(extractBitmaps(bmps1),
+            extractBitmaps(bmps2), tolerance, bCreateMismatchMasks);
+    bp::list results;
+    for (unsigned i = 0; i < pResults.size(); ++i) {
+        results.append(pResults[i]);
+    }
+    return results;
+}
+
+BOOST_PYTHON_FUNCTION_OVERLOADS(ImageCompare_compareAll_overloads,
+        ImageCompare_compareAll, 2, 4);
 
 void export_bitmap()
 {
@@ -233,6 +336,35 @@ void export_bitmap()
 
     def("getSupportedPixelFormats", &getSupportedPixelFormats);
 
+    class_<BitmapPoolStats>("BitmapPoolStats", no_init)
+        .def_readonly("numhits", &BitmapPoolStats::m_NumHits)
+        .def_readonly("nummisses", &BitmapPoolStats::m_NumMisses)
+        .def_readonly("bytesretained", &BitmapPoolStats::m_BytesRetained)
+        .def_readonly("bytesinuse", &BitmapPoolStats::m_BytesInUse)
+        .def_readonly("maxbytesretained", &BitmapPoolStats::m_MaxBytesRetained)
+    ;
+
+    def("getBitmapPoolStats", BitmapPool_getStats);
+    def("setBitmapPoolMaxBytes", BitmapPool_setMaxBytesRetained);
+    def("trimBitmapPool", BitmapPool_trim);
+
+    class_<BitmapCacheStats>("BitmapCacheStats", no_init)
+        .def_readonly("numhits", &BitmapCacheStats::m_NumHits)
+        .def_readonly("nummisses", &BitmapCacheStats::m_NumMisses)
+        .def_readonly("numevictions", &BitmapCacheStats::m_NumEvictions)
+        .def_readonly("numbitmaps", &BitmapCacheStats::m_NumBitmaps)
+        .def_readonly("bytesused", &BitmapCacheStats::m_BytesUsed)
+        .def_readonly("maxbytes", &BitmapCacheStats::m_MaxBytes)
+    ;
+
+    def("getBitmapCacheStats", BitmapCache_getStats);
+    def("setBitmapCacheMaxBytes", BitmapCache_setMaxBytes);
+    def("invalidateBitmapCache", BitmapCache_invalidate, 
+            (bp::arg("filename")=bp::object()));
+
+    def("savePrecompiledImage", ImageContainer_save,
+            (bp::arg("bitmap"), bp::arg("filename"), bp::arg("mipmaps")=false));
+
     to_python_converter<Pixel32, Pixel32_to_python_tuple>();
 
     class_<Bitmap, boost::shared_ptr<Bitmap> >("Bitmap", no_init)
@@ -255,13 +387,74 @@ void export_bitmap()
         .def("getName", &Bitmap::getName, 
                 return_value_policy<copy_const_reference>())
     ;
+
+    class_<ImageStats>("ImageStats", no_init)
+        .def("__init__", make_constructor(createImageStats))
+        .def("__init__", make_constructor(createImageStatsWithStride))
+        .def("__init__", make_constructor(createImageStatsWithRect))
+        .def("__init__", make_constructor(createImageStatsWithRectAndStride))
+        .def("getNumChannels", &ImageStats::getNumChannels)
+        .def("getNumPixels", &ImageStats::getNumPixels)
+        .def("getMin", &ImageStats::getMin, ImageStats_getMin_overloads())
+        .def("getMax", &ImageStats::getMax, ImageStats_getMax_overloads())
+        .def("getAvg", &ImageStats::getAvg)
+        .def("getChannelAvg", &ImageStats::getChannelAvg)
+        .def("getStdDev", &ImageStats::getStdDev)
+        .def("getChannelStdDev", &ImageStats::getChannelStdDev)
+        .def("getHistogram", &ImageStats_getHistogram,
+                ImageStats_getHistogram_overloads())
+    ;
     
-    class_<BitmapManager>("BitmapManager", no_init)
+    class_<ImageCompare, ImageComparePtr>("ImageCompare", no_init)
+        .def(init<const Bitmap&, const Bitmap&, optional<int, bool> >())
+        .def("getNumChannels", &ImageCompare::getNumChannels)
+        .def("getMaxDiff", &ImageCompare::getMaxDiff)
+        .def("getMeanError", &ImageCompare::getMeanError)
+        .def("getNumMismatches", &ImageCompare::getNumMismatches)
+        .def("getMismatchMask", &ImageCompare::getMismatchMask)
+        .def("getAvg", &ImageCompare::getAvg)
+        .def("getStdDev", &ImageCompare::getStdDev)
+        .def("isSimilar", &ImageCompare::isSimilar)
+        .staticmethod("isSimilar")
+        .def("isPixelFormatSupported", &ImageCompare::isPixelFormatSupported)
+        .staticmethod("isPixelFormatSupported")
+        .def("compareAll", &ImageCompare_compareAll,
+                ImageCompare_compareAll_overloads())
+        .staticmethod("compareAll")
+    ;
+
+    class_<BitmapManager, boost::noncopyable>("BitmapManager", no_init)
         .def("get", &BitmapManager::get,
                 return_value_policy<reference_existing_object>())
         .staticmethod("get")
-        .def("loadBitmap", &BitmapManager::loadBitmapPy, loadBitmap_overloads())
+        .def("loadBitmap", &BitmapManager::loadBitmapPy,
+                (bp::arg("filename"), bp::arg("callback"), 
+                 bp::arg("pixelformat")=NO_PIXELFORMAT, bp::arg("priority")=0.f))
         .def("setNumThreads", &BitmapManager::setNumThreads)
+        .def("getStats", &BitmapManager::getStats)
+    ;
+
+    class_<BitmapLoadRequest, BitmapLoadRequestPtr, boost::noncopyable>(
+            "BitmapLoadRequest", no_init)
+        .add_property("filename", make_function(&BitmapLoadRequest::getFilename,
+                return_value_policy<copy_const_reference>()))
+        .add_property("priority", &BitmapLoadRequest::getPriority,
+                &BitmapLoadRequest::setPriority)
+        .add_property("pending", &BitmapLoadRequest::isPending)
+        .def("cancel", &BitmapLoadRequest::cancel)
+    ;
+
+    class_<BitmapManagerStats>("BitmapManagerStats", no_init)
+        .def_readonly("numrequests", &BitmapManagerStats::m_NumRequests)
+        .def_readonly("numcoalescedrequests", 
+                &BitmapManagerStats::m_NumCoalescedRequests)
+        .def_readonly("numcanceledrequests", &BitmapManagerStats::m_NumCanceledRequests)
+        .def_readonly("queuedepth", &BitmapManagerStats::m_QueueDepth)
+        .def_readonly("maxqueuedepth", &BitmapManagerStats::m_MaxQueueDepth)
+        .def_readonly("numloads", &BitmapManagerStats::m_NumLoads)
+        .def_readonly("avglatency", &BitmapManagerStats::m_AvgLatency)
+        .def_readonly("p99latency", &BitmapManagerStats::m_P99Latency)
+        .def_readonly("maxlatency", &BitmapManagerStats::m_MaxLatency)
     ;
 
     class_<CubicSpline, boost::noncopyable>("CubicSpline", no_init)
@@ -91,6 +91,12 @@ void export_raster()
                 &ImageNode::setHRef)
         .add_property("compression",
                 &ImageNode::getCompression)
+        .add_property("maxdecodesize",
+                make_function(&ImageNode::getMaxDecodeSize,
+                        return_value_policy<copy_const_reference>()),
+                &ImageNode::setMaxDecodeSize)
+        .add_property("autodecodesize", &ImageNode::getAutoDecodeSize,
+                &ImageNode::setAutoDecodeSize)
     ;
 
     class_<CameraNode, bases<RasterNode> >("CameraNode", no_init)